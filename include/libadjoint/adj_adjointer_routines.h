@@ -3,9 +3,24 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <limits.h>
 #include <unistd.h>
 #include "adj_data_structures.h"
 #include "adj_variable_lookup.h"
+#include "adj_arena.h"
+#include "adj_vec_pool.h"
+#include "adj_memory_budget.h"
+#include "adj_prefetch.h"
+#include "adj_write_behind.h"
+#include "adj_disk_store.h"
+#include "adj_compression.h"
+#include "adj_pod.h"
+#include "adj_interpolation.h"
+#include "adj_dedup.h"
+#include "adj_digest.h"
+#include "adj_tiers.h"
+#include "adj_costs.h"
+#include "adj_expiry.h"
 #include "adj_error_handling.h"
 #include "revolve_c.h"
 
@@ -22,6 +37,13 @@ int adj_get_checkpoint_strategy(adj_adjointer* adjointer, int* strategy);
 int adj_set_checkpoint_strategy(adj_adjointer* adjointer, int strategy);
 int adj_set_revolve_options(adj_adjointer* adjointer, int steps, int snaps_on_disk, int snaps_in_ram, int verbose);
 int adj_set_revolve_debug_options(adj_adjointer* adjointer, int overwrite, adj_scalar comparison_tolerance);
+int adj_set_revolve_equation_options(adj_adjointer* adjointer, int snaps);
+int adj_set_revolve_verification(adj_adjointer* adjointer, int verify, adj_scalar tolerance);
+int adj_get_revolve_verification_stats(adj_adjointer* adjointer, int* nchecked, int* nfailed);
+int adj_set_memory_budget(adj_adjointer* adjointer, size_t budget);
+int adj_set_prefetch_options(adj_adjointer* adjointer, int window, size_t memory_cap);
+int adj_set_write_behind_options(adj_adjointer* adjointer, int depth);
+int adj_flush_disk_writes(adj_adjointer* adjointer);
 int adj_equation_count(adj_adjointer* adjointer, int* count);
 int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int* checkpoint_storage);
 int adj_record_variable(adj_adjointer* adjointer, adj_variable var, adj_storage_data storage);
@@ -49,10 +71,17 @@ int adj_timestep_set_functional_dependencies(adj_adjointer* adjointer, int times
 
 int adj_storage_memory_copy(adj_vector value, adj_storage_data* data);
 int adj_storage_memory_incref(adj_vector value, adj_storage_data* data);
+int adj_storage_memory_compressed(adj_vector value, adj_storage_data* data);
+int adj_storage_memory_pod(adj_vector value, adj_storage_data* data);
 int adj_storage_disk(adj_vector value, adj_storage_data* data);
 int adj_storage_set_compare(adj_storage_data* data, int compare, adj_scalar comparison_tolerance);
 int adj_storage_set_overwrite(adj_storage_data* data, int overwrite);
 int adj_storage_set_checkpoint(adj_storage_data* data, int checkpoint);
+int adj_storage_set_compression(adj_storage_data* data, int compression, adj_scalar tolerance);
+int adj_storage_set_precision(adj_storage_data* data, int precision);
+int adj_get_compression_stats(adj_adjointer* adjointer, size_t* raw_bytes, size_t* compressed_bytes, adj_scalar* compress_time, adj_scalar* decompress_time);
+int adj_set_pod_options(adj_adjointer* adjointer, int window, adj_scalar energy_threshold);
+int adj_get_pod_stats(adj_adjointer* adjointer, int* nbasis, size_t* pod_bytes, size_t* full_bytes);
 
 int adj_variable_known(adj_adjointer* adjointer, adj_variable var, int* known);
 int adj_get_variable_value(adj_adjointer* adjointer, adj_variable var, adj_vector* value);
@@ -63,6 +92,9 @@ int adj_get_finished(adj_adjointer* adjointer, int* finished);
 int adj_get_forward_variable(adj_adjointer* adjointer, int i, adj_variable* fwd_var);
 
 #ifndef ADJ_HIDE_FROM_USER
+/* The variable data record of the variable with dense id id */
+#define ADJ_VARIABLE_DATA(adjointer, id) (&((adjointer)->vardata_chunks[(id) / ADJ_VARDATA_CHUNK_SIZE][(id) % ADJ_VARDATA_CHUNK_SIZE]))
+
 int adj_set_storage_memory_copy(adj_adjointer* adjointer, adj_variable* var);
 int adj_set_storage_memory_incref(adj_adjointer* adjointer, adj_variable* var);
 int adj_set_option(adj_adjointer* adjointer, int option, int choice);
@@ -71,6 +103,8 @@ int adj_variable_get_depending_timestep(adj_adjointer* adjointer, adj_variable v
 int adj_forget_forward_equation_until(adj_adjointer* adjointer, int equation, int last_equation);
 
 int adj_find_operator_callback(adj_adjointer* adjointer, int type, char* name, void (**fn)(void));
+int adj_find_cached_operator_callback(adj_adjointer* adjointer, int type, adj_callback_entry* cache, char* name, void (**fn)(void));
+int adj_find_callback_entry(adj_adjointer* adjointer, char* name, int create, adj_callback_entry** entry);
 int adj_find_functional_callback(adj_adjointer* adjointer, char* name, void (**fn)(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output));
 int adj_find_functional_derivative_callback(adj_adjointer* adjointer, char* functional, void (**fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output));
 int adj_find_functional_second_derivative_callback(adj_adjointer* adjointer, char* functional, void (**fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output));
@@ -88,8 +122,14 @@ int adj_add_new_hash_entry(adj_adjointer* adjointer, adj_variable* var, adj_vari
 int adj_record_variable_core_disk(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data_ptr, adj_storage_data storage);
 int adj_record_variable_core_memory(adj_adjointer* adjointer, adj_variable_data* data_ptr, adj_storage_data storage);
 int adj_record_variable_compare(adj_adjointer* adjointer, adj_variable_data* data_ptr, adj_variable var, adj_storage_data storage);
+int adj_update_live_variable(adj_adjointer* adjointer, adj_variable_data* data);
 
 int adj_append_unique(int** array, int* array_sz, int value);
+int adj_append_adjoint_equation(adj_adjointer* adjointer, adj_variable_data* data, int equation);
+void adj_adjoint_equation_needs(adj_adjointer* adjointer, int equation, int* nids, int** ids);
+int adj_destroy_adjoint_needs(adj_adjointer* adjointer);
+int adj_has_unique_in_range(int* array, int array_sz, int lower, int upper);
+int adj_copy_unique(int* src, int src_sz, int** dest, int* dest_sz);
 int adj_extend_timestep_data(adj_adjointer* adjointer, int extent);
 int adj_extend_functional_data(adj_timestep_data* timestep_data, int extent);
 int adj_minval(int* array, int array_sz);
@@ -0,0 +1,19 @@
+#ifndef ADJ_ARENA_H
+#define ADJ_ARENA_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_arena_alloc(adj_arena** arena, size_t size, void** ptr);
+int adj_arena_destroy(adj_arena** arena);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
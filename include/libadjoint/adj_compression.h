@@ -0,0 +1,22 @@
+#ifndef ADJ_COMPRESSION_H
+#define ADJ_COMPRESSION_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_compress_value(adj_adjointer* adjointer, adj_variable_data* data, adj_storage_data storage);
+int adj_storage_memory_value(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value);
+size_t adj_compressed_size(adj_variable_data* data);
+int adj_destroy_compressed_value(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_destroy_compression(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
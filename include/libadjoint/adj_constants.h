@@ -42,15 +42,33 @@
 #define ADJ_CHECKPOINT_REVOLVE_OFFLINE 1
 #define ADJ_CHECKPOINT_REVOLVE_MULTISTAGE 2
 #define ADJ_CHECKPOINT_REVOLVE_ONLINE 3
+#define ADJ_CHECKPOINT_REVOLVE_COST_AWARE 4
 
 /* storage strategies for checkpointing */
 #define ADJ_CHECKPOINT_STORAGE_NONE 0
 #define ADJ_CHECKPOINT_STORAGE_MEMORY 1
 #define ADJ_CHECKPOINT_STORAGE_DISK 2
+/* ADJ_CHECKPOINT_STORAGE_TIER + k: on the k'th tier of adj_set_revolve_tier_options */
+#define ADJ_CHECKPOINT_STORAGE_TIER 3
 
 /* storage strategies */
 #define ADJ_STORAGE_MEMORY_COPY 0
 #define ADJ_STORAGE_MEMORY_INCREF 1
+#define ADJ_STORAGE_MEMORY_COMPRESSED 2
+#define ADJ_STORAGE_MEMORY_POD 3
+
+/* compression of ADJ_STORAGE_MEMORY_COMPRESSED values */
+#define ADJ_COMPRESSION_LOSSLESS 0
+#define ADJ_COMPRESSION_LOSSY 1
+
+/* precision memory copies and compressed values are kept in */
+#define ADJ_PRECISION_DOUBLE 0
+#define ADJ_PRECISION_SINGLE 1
+#define ADJ_PRECISION_BFLOAT16 2
+
+/* temporal interpolation of the values between anchors */
+#define ADJ_INTERPOLATION_LINEAR 0
+#define ADJ_INTERPOLATION_CUBIC_HERMITE 1
 
 /* operator callbacks */
 #define ADJ_NBLOCK_ACTION_CB 1
@@ -60,6 +78,9 @@
 #define ADJ_BLOCK_ASSEMBLY_CB 5
 #define ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB 6
 #define ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB 7
+#define ADJ_BLOCK_ACTION_ACCUMULATE_CB 8
+#define ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB 9
+#define ADJ_NO_OPERATOR_CALLBACKS 9
 /* if you add a new one, you must update the table in src/adj_adjointer_routines.c */
 
 #define ADJ_VEC_DUPLICATE_CB 10
@@ -75,6 +96,8 @@
 #define ADJ_VEC_WRITE_CB 20
 #define ADJ_VEC_READ_CB 21
 #define ADJ_VEC_DELETE_CB 22
+#define ADJ_VEC_ZERO_CB 23
+#define ADJ_VEC_WRAP_VALUES_CB 24
 
 #define ADJ_MAT_DUPLICATE_CB 30
 #define ADJ_MAT_AXPY_CB 31
@@ -82,9 +105,26 @@
 #define ADJ_MAT_ACTION_CB 33
 
 #define ADJ_SOLVE_CB 40
+#define ADJ_SOLVE_MULTI_CB 41
+
+/* kinds of term in a compiled adjoint plan */
+#define ADJ_PLAN_BLOCK_ASSEMBLY 1
+#define ADJ_PLAN_BLOCK_ACTION 2
+#define ADJ_PLAN_DERIVATIVE_ACTION 3
+#define ADJ_PLAN_RHS_DERIVATIVE_ASSEMBLY 4
+#define ADJ_PLAN_RHS_DERIVATIVE_ACTION 5
+
+/* prealloc constant: the initial capacity of the equation array, which then grows geometrically */
+#define ADJ_PREALLOC_SIZE 16
+
+/* size in bytes of each block of the equation arena */
+#define ADJ_ARENA_BLOCK_SIZE 1048576
+
+/* number of adj_variable_data records allocated together */
+#define ADJ_VARDATA_CHUNK_SIZE 1024
 
-/* prealloc constant */
-#define ADJ_PREALLOC_SIZE 1
+/* maximum number of work vectors kept for reuse by each adjointer */
+#define ADJ_VEC_POOL_SIZE 32
 
 /* value for unset variables */
 #define ADJ_UNSET -666
@@ -4,6 +4,7 @@
 #include "adj_adjointer_routines.h"
 #include "adj_evaluation.h"
 #include "adj_simplification.h"
+#include "adj_plan.h"
 #include "revolve_c.h"
 
 #ifdef __cplusplus
@@ -12,6 +13,8 @@ extern "C" {
 
 int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* functional, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_var);
 int adj_get_adjoint_solution(adj_adjointer* adjointer, int equation, char* functional, adj_vector* soln, adj_variable* adj_var);
+int adj_get_adjoint_equations(adj_adjointer* adjointer, int equation, int nfunctionals, char** functionals, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_vars);
+int adj_get_adjoint_solutions(adj_adjointer* adjointer, int equation, int nfunctionals, char** functionals, adj_vector* solns, adj_variable* adj_vars);
 int adj_get_forward_equation(adj_adjointer* adjointer, int equation, adj_matrix* lhs, adj_vector* rhs, adj_variable* fwd_var);
 int adj_get_forward_solution(adj_adjointer* adjointer, int equation, adj_vector* soln, adj_variable* fwd_var);
 int adj_get_tlm_equation    (adj_adjointer* adjointer, int equation, char* parameter,  adj_matrix* lhs, adj_vector* rhs, adj_variable* tlm_var);
@@ -0,0 +1,25 @@
+#ifndef ADJ_COSTS_H
+#define ADJ_COSTS_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int adj_set_revolve_cost_options(adj_adjointer* adjointer, int steps, size_t byte_budget, int verbose);
+int adj_set_timestep_cost(adj_adjointer* adjointer, int timestep, adj_scalar seconds, size_t bytes);
+int adj_get_timestep_cost(adj_adjointer* adjointer, int timestep, adj_scalar* seconds, size_t* bytes);
+
+#ifndef ADJ_HIDE_FROM_USER
+double adj_costs_clock(void);
+int adj_costs_record_solve(adj_adjointer* adjointer, int equation, double seconds, adj_vector soln);
+int adj_costs_schedule(adj_adjointer* adjointer);
+int adj_destroy_costs(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
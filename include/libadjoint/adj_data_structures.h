@@ -43,6 +43,7 @@ typedef struct
   adj_scalar tolerance;
   int test_derivative; /* Flags for test_derivative */
   int number_of_rounds;
+  struct adj_callback_entry* callbacks; /* the adjointer's callbacks for this name, cached by adj_register_equation */
 } adj_nonlinear_block;
 
 typedef struct
@@ -56,6 +57,7 @@ typedef struct
   int test_hermitian; /* Flags for test_hermitian */
   int number_of_tests;
   adj_scalar tolerance;
+  struct adj_callback_entry* callbacks; /* the adjointer's callbacks for this name, cached by adj_register_equation */
 } adj_block;
 
 typedef struct
@@ -77,6 +79,8 @@ typedef struct
   void (*rhs_callback)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, void* context, adj_vector* output, int* has_output);
   void (*rhs_deriv_action_callback)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
                                     adj_variable d_variable, adj_vector contraction, int hermitian, void* context, adj_vector* output, int* has_output);
+  void (*rhs_deriv_action_accumulate_callback)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
+                                    adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output);
   void (*rhs_second_deriv_action_callback)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
                                     adj_variable inner_variable, adj_vector inner_contraction, adj_variable outer_variable, int hermitian, adj_vector action, \
                                     void* context, adj_vector* output, int* has_output);
@@ -97,7 +101,7 @@ typedef struct
 
   adj_vector value;
   /* for ADJ_STORAGE_MEMORY */
-  int storage_memory_type; /* ADJ_STORAGE_MEMORY_COPY or ADJ_STORAGE_MEMORY_INCREF */
+  int storage_memory_type; /* ADJ_STORAGE_MEMORY_COPY, ADJ_STORAGE_MEMORY_INCREF, ADJ_STORAGE_MEMORY_COMPRESSED or ADJ_STORAGE_MEMORY_POD */
   int storage_memory_has_value;
   int storage_memory_is_checkpoint; /* memory checkpoints are not deleted by adj_forget_forward_equation */
 
@@ -105,7 +109,22 @@ typedef struct
   int storage_disk_has_value;
   int storage_disk_is_checkpoint; /* disk checkpoints are not deleted by adj_forget_forward_equation */
 
-  /* POD, temporal interpolation, ... */
+  /* for ADJ_STORAGE_MEMORY_COMPRESSED */
+  int compression; /* ADJ_COMPRESSION_LOSSLESS or ADJ_COMPRESSION_LOSSY */
+  adj_scalar compression_tolerance; /* the largest pointwise error ADJ_COMPRESSION_LOSSY may make */
+  struct adj_compressed_value* compressed; /* the value, compressed; value then only holds it while it is decompressed */
+
+  /* for ADJ_STORAGE_MEMORY_POD */
+  struct adj_pod_value* pod; /* its coefficients in the POD basis; value then only holds it while it is reconstructed */
+
+  /* for temporal interpolation (adj_set_interpolation) */
+  int interpolated; /* whether its value, if it has none, is interpolated between the anchors either side */
+
+  /* for ADJ_STORAGE_MEMORY_COPY and ADJ_STORAGE_MEMORY_COMPRESSED */
+  int precision; /* ADJ_PRECISION_DOUBLE, ADJ_PRECISION_SINGLE or ADJ_PRECISION_BFLOAT16 */
+
+  /* for deduplication (adj_set_deduplication) */
+  struct adj_dedup_entry* shared; /* the copy value is shared with other values of the same contents, if it is */
 } adj_storage_data;
 
 typedef struct adj_variable_data
@@ -130,6 +149,11 @@ typedef struct adj_variable_data
 
   adj_storage_data storage; /* its storage record */
   struct adj_variable_data* next; /* a pointer to the next one, so we can walk the list */
+  int id; /* dense index of this variable in the adjointer, or -1 if it is not owned by one */
+  int live_index; /* position of this variable in the adjointer's live_variables, or -1 if it holds no value */
+  size_t memory_size; /* bytes its memory copy is charged against the adjointer's memory budget */
+  void* mapping; /* the disk store mapping its memory copy wraps, or NULL if it has its own storage */
+  size_t mapping_size;
 } adj_variable_data;
 
 typedef struct
@@ -147,6 +171,8 @@ typedef struct
   void (*vec_write)(adj_variable var, adj_vector x);
   void (*vec_read)(adj_variable var, adj_vector* x);
   void (*vec_delete)(adj_variable var);
+  void (*vec_zero)(adj_vector* x);
+  void (*vec_wrap_values)(adj_vector model, adj_scalar scalars[], adj_vector* x);
 
   void (*mat_duplicate)(adj_matrix matin, adj_matrix *matout);
   void (*mat_axpy)(adj_matrix *Y, adj_scalar alpha, adj_matrix X);
@@ -154,6 +180,7 @@ typedef struct
   void (*mat_action)(adj_matrix mat, adj_vector x, adj_vector* y);
 
   void (*solve)(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector *soln);
+  void (*solve_multi)(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns);
 } adj_data_callbacks;
 
 typedef struct adj_op_callback
@@ -225,6 +252,17 @@ typedef struct
   adj_parameter_source_callback* lastnode;
 } adj_parameter_source_callback_list;
 
+typedef struct adj_callback_entry
+{
+  int name; /* interned id of the operator, functional or parameter name */
+  adj_op_callback* operators[ADJ_NO_OPERATOR_CALLBACKS]; /* indexed by the operator callback type, minus one */
+  adj_func_callback* functional;
+  adj_func_deriv_callback* functional_derivative;
+  adj_func_second_deriv_callback* functional_second_derivative;
+  adj_parameter_source_callback* parameter_source;
+  adj_hash_handle hh;
+} adj_callback_entry; /* indexes the callback lists by name */
+
 typedef struct
 {
   adj_nonlinear_block nonlinear_block; /* nonlinear operator to differentiate */
@@ -247,6 +285,40 @@ typedef struct
 
 typedef struct
 {
+  int name; /* interned id of the variable name */
+  int functional; /* interned id of the functional name */
+  int timestep;
+  int iteration;
+  int type;
+  int auxiliary;
+} adj_variable_key; /* compact, fixed-size stand-in for an adj_variable, used as the hash key */
+
+typedef struct
+{
+  adj_nonlinear_block_derivative derivative;
+  adj_variable_key contraction_key; /* the variable whose value is the contraction, if it has not been merged */
+  int input_id; /* derivative actions with the same input_id act on the same vector */
+  adj_vector input; /* the vector the derivative acts on */
+  int owns_input; /* whether input was created by the simplification, and must be destroyed */
+} adj_nonlinear_block_derivative_action; /* one term of a row of G*, used to merge terms across equations */
+
+typedef struct
+{
+  char* name;
+  int id;
+  adj_hash_handle hh;
+} adj_name_intern;
+
+typedef struct
+{
+  int* key; /* the properties that must match for two derivatives to be merged */
+  int first; /* the first derivative with this key */
+  adj_hash_handle hh;
+} adj_simplification_entry;
+
+typedef struct
+{
+  adj_variable_key key;
   adj_variable variable;
   adj_variable_data* data;
   adj_hash_handle hh;
@@ -297,13 +369,62 @@ typedef struct
   int overwrite; /* A flag indicating if a replay should be performed even if that variable is already recorded. */
                  /* The new value is compared with the existing one in order to check if the revolve replay produces the same solution than the original forward system */
   adj_scalar comparison_tolerance; /* The comparison tolerance in case that overwrite is ADJ_TRUE */
+  int equation_snaps; /* The number of equation checkpoints within a timestep, so that its adjoint replays only part of it; 0 replays all of it */
 } adj_revolve_data;
 
+typedef struct adj_arena
+{
+  struct adj_arena* next; /* the previously filled block */
+  size_t size; /* usable bytes in this block */
+  size_t used; /* bytes handed out so far */
+} adj_arena;
+
+typedef struct
+{
+  int kind; /* what to do with this term: ADJ_PLAN_BLOCK_ASSEMBLY etc. */
+  adj_block* block; /* the forward block, as stored in the adjointer; NULL for R* terms */
+  int hermitian; /* whether the adjoint term uses the block or its hermitian */
+  int source; /* the forward equation whose adjoint variable the term acts on */
+  adj_variable* contraction; /* for G* terms, the forward variable the derivative is contracted with */
+  adj_scalar coefficient; /* what the term is scaled by when it is added in */
+} adj_adjoint_plan_op;
+
+typedef struct
+{
+  int compiled; /* Has this plan been built yet? */
+  int nops;
+  adj_adjoint_plan_op* ops; /* the terms of the adjoint equation, in the order they are added up */
+  int nadjoint_equations;
+  int* adjoint_equations; /* the adjoint equations that need the adjoint variable this equation solves for */
+} adj_adjoint_plan;
+
+typedef struct
+{
+  int nvectors;
+  adj_vector vectors[ADJ_VEC_POOL_SIZE]; /* work vectors that have been handed back, ready for reuse */
+  int sizes[ADJ_VEC_POOL_SIZE]; /* and their sizes, so that we only hand them out for the same layout */
+} adj_vec_pool;
+
 typedef struct adj_adjointer
 {
   adj_equation* equations; /* Array of equations we have registered */
   int nequations; /* Number of equations we have registered */
   int equations_sz; /* Number of equations we can store without mallocing -- not the same! */
+  adj_arena* arena; /* Storage for the blocks, targets and dependencies of the registered equations */
+  adj_adjoint_plan* adjoint_plans; /* The compiled adjoint equation of each forward equation, once the annotation is finished */
+  int nadjoint_plans; /* Number of equations adjoint_plans was allocated for */
+  adj_vec_pool* vec_pool; /* Recycled work vectors; allocated on first use */
+  struct adj_prefetch* prefetch; /* Background reads of disk values for the coming adjoint equations; NULL unless switched on */
+  struct adj_write_behind* write_behind; /* Queue of disk writes done in the background; NULL unless switched on */
+  struct adj_compression* compression; /* Layouts and statistics of compressed storage; NULL until something is compressed */
+  struct adj_pod* pod; /* Bases of POD storage; NULL until it is used or configured */
+  struct adj_interpolation* interpolation; /* Variable names whose values are interpolated in time; NULL unless any are */
+  struct adj_dedup* dedup; /* Shared copies of recorded values with the same contents; NULL unless switched on */
+  struct adj_digests* digests; /* Digests of the forward values, to verify the replays against; NULL unless switched on */
+  struct adj_tiers* tiers; /* The storage tiers of the checkpoints, and which revolve slots go on each; NULL unless configured */
+  struct adj_costs* costs; /* The measured or estimated cost of each timestep, for cost-aware checkpointing; NULL unless configured */
+  struct adj_expiry* expiry; /* The variables the forget routines may drop, bucketed by the equation they expire at; NULL until something is recorded */
+  struct adj_adjoint_needs* adjoint_needs; /* For each equation, the variables its adjoint equation needs; NULL until any does */
 
   int ntimesteps; /* Number of timesteps we have seen */
   adj_timestep_data* timestep_data; /* Data for each timestep we have seen */
@@ -311,6 +432,16 @@ typedef struct adj_adjointer
   adj_revolve_data revolve_data; /* A data struct for revolve related information */
 
   adj_variable_hash* varhash; /* The hash table for looking up information about variables */
+  int nvariables; /* Number of variables we have seen; each has a dense id in [0, nvariables) */
+  int variables_sz; /* Number of variable ids we can store without mallocing */
+  adj_variable_data** vardata_chunks; /* Variable data, stored contiguously in chunks of ADJ_VARDATA_CHUNK_SIZE, indexed by id */
+  adj_variable_hash** varentries; /* The hash entry of each variable id, for when we need the adj_variable itself */
+  int* live_variables; /* Ids of the variables holding a value in memory or on disk, in no particular order */
+  int nlive_variables; /* Number of live variables */
+  int live_variables_sz; /* Number of live variable ids we can store without mallocing */
+  size_t memory_budget; /* Bytes of forward values to keep in memory before spilling to disk; 0 for no limit */
+  size_t memory_used; /* Bytes of forward values (and POD bases) currently charged against memory_budget */
+  struct adj_memory_heap* memory_heap; /* The values memory_budget may spill, on when the adjoint run needs them last; NULL until one is charged */
 
   int options[ADJ_NO_OPTIONS]; /* Pretty obvious */
 
@@ -322,10 +453,13 @@ typedef struct adj_adjointer
   adj_op_callback_list block_assembly_list;
   adj_op_callback_list nonlinear_second_derivative_action_list;
   adj_op_callback_list nonlinear_derivative_outer_action_list;
+  adj_op_callback_list block_action_accumulate_list;
+  adj_op_callback_list nonlinear_derivative_action_accumulate_list;
   adj_func_callback_list functional_list;
   adj_func_deriv_callback_list functional_derivative_list;
   adj_func_second_deriv_callback_list functional_second_derivative_list;
   adj_parameter_source_callback_list parameter_source_list;
+  adj_callback_entry* callback_hash; /* the callbacks registered under each name */
 
   int finished; /* Is the annotation finished? */
 } adj_adjointer;
@@ -361,6 +495,8 @@ int adj_add_term_to_equation(adj_term term, adj_equation* equation);
 int adj_equation_set_rhs_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, void* context, adj_vector* output, int* has_output));
 int adj_equation_set_rhs_derivative_action_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
                                     adj_variable d_variable, adj_vector contraction, int hermitian, void* context, adj_vector* output, int* has_output));
+int adj_equation_set_rhs_derivative_action_accumulate_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
+                                    adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output));
 int adj_equation_set_rhs_second_derivative_action_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
                                     adj_variable inner_variable, adj_vector inner_contraction, adj_variable outer_variable, int hermitian, adj_vector action, void* context, adj_vector* output, int* has_output));
 int adj_equation_set_rhs_derivative_assembly_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
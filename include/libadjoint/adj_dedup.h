@@ -0,0 +1,24 @@
+#ifndef ADJ_DEDUP_H
+#define ADJ_DEDUP_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int adj_set_deduplication(adj_adjointer* adjointer, int dedup);
+int adj_get_deduplication_stats(adj_adjointer* adjointer, int* ncopies, size_t* shared_bytes, size_t* saved_bytes);
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_dedup_copy_value(adj_adjointer* adjointer, adj_variable_data* data, adj_storage_data storage);
+int adj_dedup_take_charge(adj_variable_data* data);
+int adj_dedup_release(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_destroy_dedup(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef ADJ_DIGEST_H
+#define ADJ_DIGEST_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_digest_recorded(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_storage_data storage);
+int adj_destroy_digests(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
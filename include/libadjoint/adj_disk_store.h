@@ -0,0 +1,26 @@
+#ifndef ADJ_DISK_STORE_H
+#define ADJ_DISK_STORE_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int adj_set_disk_store(adj_adjointer* adjointer, char* directory, size_t segment_size);
+
+void adj_disk_store_vec_write(adj_variable var, adj_vector x);
+void adj_disk_store_vec_read(adj_variable var, adj_vector* x);
+void adj_disk_store_vec_delete(adj_variable var);
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_disk_store_map(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector* value, int* found);
+void adj_disk_store_unmap(adj_variable_data* data);
+int adj_destroy_disk_store(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ADJ_EXPIRY_H
+#define ADJ_EXPIRY_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_expiry_update(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_expiry_adjoint_equation(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_expiry_forget_adjoint(adj_adjointer* adjointer, int equation);
+int adj_expiry_forget_forward(adj_adjointer* adjointer, int equation, int last_equation);
+int adj_expiry_visits(adj_adjointer* adjointer);
+int adj_destroy_expiry(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ADJ_INTERPOLATION_H
+#define ADJ_INTERPOLATION_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int adj_set_interpolation(adj_adjointer* adjointer, char* name, int stride, int method);
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_interpolation_recorded(adj_adjointer* adjointer, adj_variable var);
+int adj_interpolate_value(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data);
+int adj_interpolation_anchor_expiry(adj_adjointer* adjointer, adj_variable var);
+int adj_destroy_interpolation(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef ADJ_MEMORY_BUDGET_H
+#define ADJ_MEMORY_BUDGET_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_memory_budget_charge(adj_adjointer* adjointer, adj_variable_data* data);
+void adj_memory_budget_release(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_memory_budget_recharge(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_memory_budget_update(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_memory_budget_enforce(adj_adjointer* adjointer);
+int adj_destroy_memory_budget(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -28,12 +28,14 @@ void petsc_vec_dot_product_proc(adj_vector x, adj_vector y, adj_scalar* val);
 void petsc_vec_write_proc(adj_variable var, adj_vector x);
 void petsc_vec_read_proc(adj_variable var, adj_vector* x);
 void petsc_vec_delete_proc(adj_variable var);
+void petsc_vec_zero_proc(adj_vector *x);
 
 void petsc_mat_getvec_proc(adj_matrix mat, adj_vector *left);
 void petsc_mat_axpy_proc(adj_matrix *Y, adj_scalar alpha, adj_matrix X);
 void petsc_mat_duplicate_proc(adj_matrix matin, adj_matrix *matout);
 void petsc_mat_destroy_proc(adj_matrix *mat);
 void petsc_solve_proc(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector *soln); 
+void petsc_solve_multi_proc(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns);
 
 #ifdef HAVE_PETSC
 adj_vector petsc_vec_to_adj_vector(Vec* v);
@@ -0,0 +1,24 @@
+#ifndef ADJ_PLAN_H
+#define ADJ_PLAN_H
+
+#include "adj_data_structures.h"
+#include "adj_error_handling.h"
+#include "adj_variable_lookup.h"
+#include "adj_adjointer_routines.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_find_adjoint_plan(adj_adjointer* adjointer, int equation, adj_adjoint_plan* scratch, adj_adjoint_plan** plan);
+int adj_compile_adjoint_plan(adj_adjointer* adjointer, int equation, adj_adjoint_plan* plan);
+int adj_destroy_adjoint_plan(adj_adjoint_plan* plan);
+int adj_destroy_adjoint_plans(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,22 @@
+#ifndef ADJ_POD_H
+#define ADJ_POD_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_pod_project_value(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_storage_data storage);
+int adj_pod_reconstruct_value(adj_adjointer* adjointer, adj_variable_data* data);
+size_t adj_pod_value_size(adj_variable_data* data);
+int adj_destroy_pod_value(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_destroy_pod(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
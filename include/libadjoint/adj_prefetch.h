@@ -0,0 +1,21 @@
+#ifndef ADJ_PREFETCH_H
+#define ADJ_PREFETCH_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_prefetch_schedule(adj_adjointer* adjointer, int equation);
+int adj_prefetch_take(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value, int* found);
+int adj_prefetch_cancel(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_destroy_prefetch(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
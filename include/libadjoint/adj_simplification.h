@@ -1,9 +1,14 @@
 #include "adj_data_structures.h"
 #include "adj_adjointer_routines.h"
 #include "adj_error_handling.h"
+#include "adj_variable_lookup.h"
 
 #ifndef ADJ_HIDE_FROM_USER
 int adj_simplify_derivatives(adj_adjointer* adjointer, int ninput, adj_nonlinear_block_derivative* input, int* noutput, adj_nonlinear_block_derivative** output);
+int adj_simplify_derivative_actions(adj_adjointer* adjointer, int ninput, adj_nonlinear_block_derivative_action* input, int* noutput, adj_nonlinear_block_derivative_action** output);
+int adj_destroy_nonlinear_block_derivative_action(adj_adjointer* adjointer, adj_nonlinear_block_derivative_action* action);
+int adj_simplification_group(int ninput, adj_nonlinear_block_derivative* input, int nextra, int* extra, int* first);
+int adj_simplification_key(adj_nonlinear_block_derivative d, int nextra, int* extra, int** key, int* keylen);
 int adj_simplification_compare(adj_nonlinear_block_derivative d1, adj_nonlinear_block_derivative d2);
 void adj_simplification_merge(adj_adjointer* adjointer, adj_nonlinear_block_derivative* d1, adj_nonlinear_block_derivative* d2, int merged);
 #endif
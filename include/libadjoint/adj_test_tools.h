@@ -9,6 +9,25 @@ extern "C" {
 void adj_test_assert(int passed, char *testdesc);
 int adj_sizeof_adjointer(void);
 
+#ifndef ADJ_HIDE_FROM_USER
+void adj_test_register_scalar_callbacks(adj_adjointer* adjointer);
+void adj_test_register_array_callbacks(adj_adjointer* adjointer, int n);
+void adj_test_register_null_disk_callbacks(adj_adjointer* adjointer);
+void adj_test_vec_duplicate(adj_vector x, adj_vector* newx);
+void adj_test_vec_axpy(adj_vector* y, adj_scalar alpha, adj_vector x);
+void adj_test_vec_destroy(adj_vector* x);
+void adj_test_vec_get_size(adj_vector x, int* sz);
+void adj_test_vec_get_values(adj_vector x, adj_scalar* scalars[]);
+void adj_test_vec_set_values(adj_vector* x, adj_scalar scalars[]);
+void adj_test_vec_dot_product(adj_vector x, adj_vector y, adj_scalar* val);
+void adj_test_mat_axpy(adj_matrix* Y, adj_scalar alpha, adj_matrix X);
+void adj_test_mat_destroy(adj_matrix* X);
+void adj_test_scalar_solve(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector* soln);
+void adj_test_scalar_block_assembly(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, void* context, adj_matrix* output, adj_vector* rhs);
+void adj_test_scalar_block_action(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, adj_vector input, void* context, adj_vector* output);
+void adj_test_scalar_block_action_accumulate(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, adj_vector input, adj_scalar alpha, void* context, adj_vector* output);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
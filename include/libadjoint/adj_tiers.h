@@ -0,0 +1,29 @@
+#ifndef ADJ_TIERS_H
+#define ADJ_TIERS_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int adj_set_revolve_tier_options(adj_adjointer* adjointer, int steps, int ntiers, int* capacities, adj_scalar* write_costs, adj_scalar* read_costs, int verbose);
+int adj_register_tier_data_callback(adj_adjointer* adjointer, int tier, int type, void (*fn)(void));
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_tiers_revolve_options(adj_adjointer* adjointer);
+int adj_tiers_schedule(adj_adjointer* adjointer);
+int adj_tiers_takeshot_storage(adj_adjointer* adjointer, int* checkpoint_storage);
+int adj_tiers_storage_kind(adj_adjointer* adjointer, int checkpoint_storage, int* kind);
+int adj_tiers_variable_tier(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_tiers_write(adj_adjointer* adjointer, int checkpoint_storage, adj_variable var, adj_variable_data* data);
+int adj_tiers_read(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector* value, int* found);
+int adj_tiers_delete(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, int* found);
+int adj_destroy_tiers(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -10,7 +10,12 @@ extern "C" {
 int adj_find_variable_equation_nb(adj_adjointer* adjointer, adj_variable* var, int* equation_nb);
 
 #ifndef ADJ_HIDE_FROM_USER
+int adj_intern_name(char* name, int create, int* id);
+void adj_intern_retain(void);
+void adj_intern_release(void);
+int adj_variable_key_from_variable(adj_variable* var, int create, adj_variable_key* key);
 int adj_add_variable_data(adj_variable_hash** hash, adj_variable* var, adj_variable_data* data);
+int adj_add_variable_data_entry(adj_variable_hash** hash, adj_variable* var, adj_variable_data* data, adj_variable_hash** entry);
 int adj_find_variable_data(adj_variable_hash** hash, adj_variable* var, adj_variable_data** data);
 void adj_print_hash(adj_variable_hash** hash);
 int adj_destroy_hash(adj_variable_hash** hash);
@@ -0,0 +1,20 @@
+#ifndef ADJ_VEC_POOL_H
+#define ADJ_VEC_POOL_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_vec_pool_get(adj_adjointer* adjointer, adj_vector model, adj_vector* x);
+int adj_vec_pool_put(adj_adjointer* adjointer, adj_vector* x);
+int adj_destroy_vec_pool(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
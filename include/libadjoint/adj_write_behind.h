@@ -0,0 +1,22 @@
+#ifndef ADJ_WRITE_BEHIND_H
+#define ADJ_WRITE_BEHIND_H
+
+#include "adj_data_structures.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef ADJ_HIDE_FROM_USER
+int adj_write_behind_write(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector value);
+int adj_write_behind_read(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value, int* found);
+int adj_write_behind_pending(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_write_behind_wait(adj_adjointer* adjointer, adj_variable_data* data);
+int adj_destroy_write_behind(adj_adjointer* adjointer);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -383,6 +383,36 @@ class Offline : public Schedule
 };
 
 
+/**
+\class Prescribed
+Prescribed inherates the basic class Schedule. This class replays a schedule that was computed outside of Revolve, as a list of actions with the checkpoint and the capo of each. The list has to follow the same protocol as the one of an Offline schedule.
+\brief Class for Checkpointing schedules given as a list of actions
+*/
+
+class Prescribed : public Schedule
+{
+	public:
+
+	/** This constructor needs the number of time steps, the number of snaps and the actions together with their checkpoints and capos. The lists are not copied, and have to outlive the schedule. */
+	Prescribed(int st,int sn,Checkpoint *c,const vector <ACTION::action> *a,const vector <int> *ch,const vector <int> *ca);
+
+	/** This function returns the next action of the list, and terminate once the list is done. */
+	ACTION::action revolve();
+
+	int get_check() { return check; }
+	int get_capo() { return capo; }
+	int get_fine() { return fine; }
+
+	~Prescribed() { };
+
+	private:
+
+	int check, capo, fine, next;
+	const vector <ACTION::action> *actions;
+	const vector <int> *checks, *capos;
+};
+
+
 /**
 \class Revolve 
 This class manages to create Schedules for Online or Offline Checkpointing. The user only needs to tell which Checkpointing Procedure he wants to use
@@ -400,6 +430,8 @@ class Revolve
 	Revolve(int st,int sn,int sn_ram);
 	/** Constructor for Online-Checkpointing */
 	Revolve(int sn);
+	/** Constructor for a Checkpointing schedule given as a list of actions */
+	Revolve(int st,int sn,const vector <ACTION::action> &a,const vector <int> &ch,const vector <int> &ca);
 
 	/**The calling sequence is REVOLVE(CHECK,CAPO,FINE,SNAPS,INFO) with the return value being one of the actions to be taken. The calling parameters are all integers with the following meaning: CHECK - number of checkpoint being written or retrieved. CAPO - beginning of subrange currently being processed. FINE - end of subrange currently being processed.SNAPS - upper bound on number of checkpoints taken. INFO - determines how much information will be printed and contains information about an error occured  */
 
@@ -451,6 +483,8 @@ class Revolve
 	Checkpoint *checkpoint;
 	vector <bool> where;
 	vector <int> indizes_ram,indizes_rom;
+	vector <ACTION::action> prescribed_actions;
+	vector <int> prescribed_checks,prescribed_capos;
 };
 
 
@@ -22,6 +22,7 @@ extern "C" {
 CRevolve revolve_create_offline(int st, int sn);
 CRevolve revolve_create_multistage(int st, int sn, int sn_ram);
 CRevolve revolve_create_online(int sn);
+CRevolve revolve_create_prescribed(int st, int nactions, const int* actions, const int* checks, const int* capos);
 void revolve_destroy(CRevolve r);
 CACTION revolve(CRevolve r); 
 int revolve_adjust(CRevolve r, int steps);
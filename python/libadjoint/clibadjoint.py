@@ -62,6 +62,24 @@ adj_set_revolve_options.argtypes = [POINTER(adj_adjointer), c_int, c_int, c_int,
 adj_set_revolve_debug_options = _library.adj_set_revolve_debug_options
 adj_set_revolve_debug_options.restype = c_int
 adj_set_revolve_debug_options.argtypes = [POINTER(adj_adjointer), c_int, c_double]
+adj_set_revolve_equation_options = _library.adj_set_revolve_equation_options
+adj_set_revolve_equation_options.restype = c_int
+adj_set_revolve_equation_options.argtypes = [POINTER(adj_adjointer), c_int]
+adj_set_memory_budget = _library.adj_set_memory_budget
+adj_set_memory_budget.restype = c_int
+adj_set_memory_budget.argtypes = [POINTER(adj_adjointer), c_size_t]
+adj_set_prefetch_options = _library.adj_set_prefetch_options
+adj_set_prefetch_options.restype = c_int
+adj_set_prefetch_options.argtypes = [POINTER(adj_adjointer), c_int, c_size_t]
+adj_set_write_behind_options = _library.adj_set_write_behind_options
+adj_set_write_behind_options.restype = c_int
+adj_set_write_behind_options.argtypes = [POINTER(adj_adjointer), c_int]
+adj_flush_disk_writes = _library.adj_flush_disk_writes
+adj_flush_disk_writes.restype = c_int
+adj_flush_disk_writes.argtypes = [POINTER(adj_adjointer)]
+adj_set_disk_store = _library.adj_set_disk_store
+adj_set_disk_store.restype = c_int
+adj_set_disk_store.argtypes = [POINTER(adj_adjointer), STRING, c_size_t]
 adj_equation_count = _library.adj_equation_count
 adj_equation_count.restype = c_int
 adj_equation_count.argtypes = [POINTER(adj_adjointer), POINTER(c_int)]
@@ -98,6 +116,7 @@ adj_equation._fields_ = [
     ('rhs_context', c_void_p),
     ('rhs_callback', CFUNCTYPE(None, c_void_p, adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), c_void_p, POINTER(adj_vector), POINTER(c_int))),
     ('rhs_deriv_action_callback', CFUNCTYPE(None, c_void_p, adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, c_int, c_void_p, POINTER(adj_vector), POINTER(c_int))),
+    ('rhs_deriv_action_accumulate_callback', CFUNCTYPE(None, c_void_p, adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, c_int, c_double, c_void_p, POINTER(adj_vector))),
     ('rhs_second_deriv_action_callback', CFUNCTYPE(None, c_void_p, adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, adj_variable, c_int, adj_vector, c_void_p, POINTER(adj_vector), POINTER(c_int))),
     ('rhs_deriv_assembly_callback', CFUNCTYPE(None, c_void_p, adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), c_int, c_void_p, POINTER(adj_matrix))),
     ('memory_checkpoint', c_int),
@@ -118,6 +137,13 @@ adj_storage_data._fields_ = [
     ('storage_memory_is_checkpoint', c_int),
     ('storage_disk_has_value', c_int),
     ('storage_disk_is_checkpoint', c_int),
+    ('compression', c_int),
+    ('compression_tolerance', c_double),
+    ('compressed', c_void_p),
+    ('pod', c_void_p),
+    ('interpolated', c_int),
+    ('precision', c_int),
+    ('shared', c_void_p),
 ]
 adj_record_variable = _library.adj_record_variable
 adj_record_variable.restype = c_int
@@ -185,6 +211,57 @@ adj_storage_memory_incref.argtypes = [adj_vector, POINTER(adj_storage_data)]
 adj_storage_disk = _library.adj_storage_disk
 adj_storage_disk.restype = c_int
 adj_storage_disk.argtypes = [adj_vector, POINTER(adj_storage_data)]
+adj_storage_memory_compressed = _library.adj_storage_memory_compressed
+adj_storage_memory_compressed.restype = c_int
+adj_storage_memory_compressed.argtypes = [adj_vector, POINTER(adj_storage_data)]
+adj_storage_memory_pod = _library.adj_storage_memory_pod
+adj_storage_memory_pod.restype = c_int
+adj_storage_memory_pod.argtypes = [adj_vector, POINTER(adj_storage_data)]
+adj_set_pod_options = _library.adj_set_pod_options
+adj_set_pod_options.restype = c_int
+adj_set_pod_options.argtypes = [POINTER(adj_adjointer), c_int, c_double]
+adj_get_pod_stats = _library.adj_get_pod_stats
+adj_get_pod_stats.restype = c_int
+adj_get_pod_stats.argtypes = [POINTER(adj_adjointer), POINTER(c_int), POINTER(c_size_t), POINTER(c_size_t)]
+adj_set_interpolation = _library.adj_set_interpolation
+adj_set_interpolation.restype = c_int
+adj_set_interpolation.argtypes = [POINTER(adj_adjointer), c_char_p, c_int, c_int]
+adj_set_revolve_verification = _library.adj_set_revolve_verification
+adj_set_revolve_verification.restype = c_int
+adj_set_revolve_verification.argtypes = [POINTER(adj_adjointer), c_int, c_double]
+adj_get_revolve_verification_stats = _library.adj_get_revolve_verification_stats
+adj_get_revolve_verification_stats.restype = c_int
+adj_get_revolve_verification_stats.argtypes = [POINTER(adj_adjointer), POINTER(c_int), POINTER(c_int)]
+adj_set_revolve_tier_options = _library.adj_set_revolve_tier_options
+adj_set_revolve_tier_options.restype = c_int
+adj_set_revolve_tier_options.argtypes = [POINTER(adj_adjointer), c_int, c_int, POINTER(c_int), POINTER(c_double), POINTER(c_double), c_int]
+adj_register_tier_data_callback = _library.adj_register_tier_data_callback
+adj_register_tier_data_callback.restype = c_int
+adj_register_tier_data_callback.argtypes = [POINTER(adj_adjointer), c_int, c_int, CFUNCTYPE(None)]
+adj_set_revolve_cost_options = _library.adj_set_revolve_cost_options
+adj_set_revolve_cost_options.restype = c_int
+adj_set_revolve_cost_options.argtypes = [POINTER(adj_adjointer), c_int, c_size_t, c_int]
+adj_set_timestep_cost = _library.adj_set_timestep_cost
+adj_set_timestep_cost.restype = c_int
+adj_set_timestep_cost.argtypes = [POINTER(adj_adjointer), c_int, c_double, c_size_t]
+adj_get_timestep_cost = _library.adj_get_timestep_cost
+adj_get_timestep_cost.restype = c_int
+adj_get_timestep_cost.argtypes = [POINTER(adj_adjointer), c_int, POINTER(c_double), POINTER(c_size_t)]
+adj_set_deduplication = _library.adj_set_deduplication
+adj_set_deduplication.restype = c_int
+adj_set_deduplication.argtypes = [POINTER(adj_adjointer), c_int]
+adj_get_deduplication_stats = _library.adj_get_deduplication_stats
+adj_get_deduplication_stats.restype = c_int
+adj_get_deduplication_stats.argtypes = [POINTER(adj_adjointer), POINTER(c_int), POINTER(c_size_t), POINTER(c_size_t)]
+adj_storage_set_compression = _library.adj_storage_set_compression
+adj_storage_set_compression.restype = c_int
+adj_storage_set_compression.argtypes = [POINTER(adj_storage_data), c_int, c_double]
+adj_storage_set_precision = _library.adj_storage_set_precision
+adj_storage_set_precision.restype = c_int
+adj_storage_set_precision.argtypes = [POINTER(adj_storage_data), c_int]
+adj_get_compression_stats = _library.adj_get_compression_stats
+adj_get_compression_stats.restype = c_int
+adj_get_compression_stats.argtypes = [POINTER(adj_adjointer), POINTER(c_size_t), POINTER(c_size_t), POINTER(c_double), POINTER(c_double)]
 adj_storage_set_compare = _library.adj_storage_set_compare
 adj_storage_set_compare.restype = c_int
 adj_storage_set_compare.argtypes = [POINTER(adj_storage_data), c_int, c_double]
@@ -218,6 +295,12 @@ adj_get_adjoint_equation.argtypes = [POINTER(adj_adjointer), c_int, STRING, POIN
 adj_get_adjoint_solution = _library.adj_get_adjoint_solution
 adj_get_adjoint_solution.restype = c_int
 adj_get_adjoint_solution.argtypes = [POINTER(adj_adjointer), c_int, STRING, POINTER(adj_vector), POINTER(adj_variable)]
+adj_get_adjoint_equations = _library.adj_get_adjoint_equations
+adj_get_adjoint_equations.restype = c_int
+adj_get_adjoint_equations.argtypes = [POINTER(adj_adjointer), c_int, c_int, STRING_POINTER, POINTER(adj_matrix), POINTER(adj_vector), POINTER(adj_variable)]
+adj_get_adjoint_solutions = _library.adj_get_adjoint_solutions
+adj_get_adjoint_solutions.restype = c_int
+adj_get_adjoint_solutions.argtypes = [POINTER(adj_adjointer), c_int, c_int, STRING_POINTER, POINTER(adj_vector), POINTER(adj_variable)]
 adj_get_forward_equation = _library.adj_get_forward_equation
 adj_get_forward_equation.restype = c_int
 adj_get_forward_equation.argtypes = [POINTER(adj_adjointer), c_int, POINTER(adj_matrix), POINTER(adj_vector), POINTER(adj_variable)]
@@ -254,6 +337,7 @@ adj_nonlinear_block._fields_ = [
     ('tolerance', c_double),
     ('test_derivative', c_int),
     ('number_of_rounds', c_int),
+    ('callbacks', c_void_p),
 ]
 adj_block._fields_ = [
     ('name', c_char * 4080),
@@ -265,6 +349,7 @@ adj_block._fields_ = [
     ('test_hermitian', c_int),
     ('number_of_tests', c_int),
     ('tolerance', c_double),
+    ('callbacks', c_void_p),
 ]
 class adj_term(Structure):
     pass
@@ -290,6 +375,11 @@ adj_variable_data._fields_ = [
     ('adjoint_equations', POINTER(c_int)),
     ('storage', adj_storage_data),
     ('next', POINTER(adj_variable_data)),
+    ('id', c_int),
+    ('live_index', c_int),
+    ('memory_size', c_size_t),
+    ('mapping', c_void_p),
+    ('mapping_size', c_size_t),
 ]
 class adj_data_callbacks(Structure):
     pass
@@ -307,11 +397,14 @@ adj_data_callbacks._fields_ = [
     ('vec_write', CFUNCTYPE(None, adj_variable, adj_vector)),
     ('vec_read', CFUNCTYPE(None, adj_variable, POINTER(adj_vector))),
     ('vec_delete', CFUNCTYPE(None, adj_variable)),
+    ('vec_zero', CFUNCTYPE(None, POINTER(adj_vector))),
+    ('vec_wrap_values', CFUNCTYPE(None, adj_vector, POINTER(c_double), POINTER(adj_vector))),
     ('mat_duplicate', CFUNCTYPE(None, adj_matrix, POINTER(adj_matrix))),
     ('mat_axpy', CFUNCTYPE(None, POINTER(adj_matrix), c_double, adj_matrix)),
     ('mat_destroy', CFUNCTYPE(None, POINTER(adj_matrix))),
     ('mat_action', CFUNCTYPE(None, adj_matrix, adj_vector, POINTER(adj_vector))),
     ('solve', CFUNCTYPE(None, adj_variable, adj_matrix, adj_vector, POINTER(adj_vector))),
+    ('solve_multi', CFUNCTYPE(None, c_int, POINTER(adj_variable), adj_matrix, POINTER(adj_vector), POINTER(adj_vector))),
 ]
 class adj_op_callback(Structure):
     pass
@@ -414,7 +507,18 @@ adj_hash_handle._fields_ = [
     ('keylen', c_uint),
     ('hashv', c_uint),
 ]
+class adj_variable_key(Structure):
+    pass
+adj_variable_key._fields_ = [
+    ('name', c_int),
+    ('functional', c_int),
+    ('timestep', c_int),
+    ('iteration', c_int),
+    ('type', c_int),
+    ('auxiliary', c_int),
+]
 adj_variable_hash._fields_ = [
+    ('key', adj_variable_key),
     ('variable', adj_variable),
     ('data', POINTER(adj_variable_data)),
     ('hh', adj_hash_handle),
@@ -475,15 +579,41 @@ adj_revolve_data._fields_ = [
     ('verbose', c_int),
     ('overwrite', c_int),
     ('comparison_tolerance', c_double),
+    ('equation_snaps', c_int),
 ]
 adj_adjointer._fields_ = [
     ('equations', POINTER(adj_equation)),
     ('nequations', c_int),
     ('equations_sz', c_int),
+    ('arena', c_void_p),
+    ('adjoint_plans', c_void_p),
+    ('nadjoint_plans', c_int),
+    ('vec_pool', c_void_p),
+    ('prefetch', c_void_p),
+    ('write_behind', c_void_p),
+    ('compression', c_void_p),
+    ('pod', c_void_p),
+    ('interpolation', c_void_p),
+    ('dedup', c_void_p),
+    ('digests', c_void_p),
+    ('tiers', c_void_p),
+    ('costs', c_void_p),
+    ('expiry', c_void_p),
+    ('adjoint_needs', c_void_p),
     ('ntimesteps', c_int),
     ('timestep_data', POINTER(adj_timestep_data)),
     ('revolve_data', adj_revolve_data),
     ('varhash', POINTER(adj_variable_hash)),
+    ('nvariables', c_int),
+    ('variables_sz', c_int),
+    ('vardata_chunks', POINTER(POINTER(adj_variable_data))),
+    ('varentries', POINTER(POINTER(adj_variable_hash))),
+    ('live_variables', POINTER(c_int)),
+    ('nlive_variables', c_int),
+    ('live_variables_sz', c_int),
+    ('memory_budget', c_size_t),
+    ('memory_used', c_size_t),
+    ('memory_heap', c_void_p),
     ('options', c_int * 3),
     ('callbacks', adj_data_callbacks),
     ('nonlinear_action_list', adj_op_callback_list),
@@ -493,10 +623,13 @@ adj_adjointer._fields_ = [
     ('block_assembly_list', adj_op_callback_list),
     ('nonlinear_second_derivative_action_list', adj_op_callback_list),
     ('nonlinear_derivative_outer_action_list', adj_op_callback_list),
+    ('block_action_accumulate_list', adj_op_callback_list),
+    ('nonlinear_derivative_action_accumulate_list', adj_op_callback_list),
     ('functional_list', adj_func_callback_list),
     ('functional_derivative_list', adj_func_deriv_callback_list),
     ('functional_second_derivative_list', adj_func_second_deriv_callback_list),
     ('parameter_source_list', adj_parameter_source_callback_list),
+    ('callback_hash', c_void_p),
     ('finished', c_int),
 ]
 adj_create_variable = _library.adj_create_variable
@@ -578,6 +711,9 @@ adj_equation_set_rhs_callback.argtypes = [POINTER(adj_equation), CFUNCTYPE(None,
 adj_equation_set_rhs_derivative_action_callback = _library.adj_equation_set_rhs_derivative_action_callback
 adj_equation_set_rhs_derivative_action_callback.restype = c_int
 adj_equation_set_rhs_derivative_action_callback.argtypes = [POINTER(adj_equation), CFUNCTYPE(None, POINTER(adj_adjointer), adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, c_int, c_void_p, POINTER(adj_vector), POINTER(c_int))]
+adj_equation_set_rhs_derivative_action_accumulate_callback = _library.adj_equation_set_rhs_derivative_action_accumulate_callback
+adj_equation_set_rhs_derivative_action_accumulate_callback.restype = c_int
+adj_equation_set_rhs_derivative_action_accumulate_callback.argtypes = [POINTER(adj_equation), CFUNCTYPE(None, POINTER(adj_adjointer), adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, c_int, c_double, c_void_p, POINTER(adj_vector))]
 adj_equation_set_rhs_second_derivative_action_callback = _library.adj_equation_set_rhs_second_derivative_action_callback
 adj_equation_set_rhs_second_derivative_action_callback.restype = c_int
 adj_equation_set_rhs_second_derivative_action_callback.argtypes = [POINTER(adj_equation), CFUNCTYPE(None, POINTER(adj_adjointer), adj_variable, c_int, POINTER(adj_variable), POINTER(adj_vector), adj_variable, adj_vector, adj_variable, c_int, adj_vector, c_void_p, POINTER(adj_vector), POINTER(c_int))]
@@ -704,6 +840,7 @@ __all__ = ['adj_variable_known', 'CACTION_YOUTURN',
            'adj_storage_memory_incref', 'adj_destroy_gst',
            'adj_advance_to_adjoint_run_revolve', 'adj_get_finished',
            'adj_timestep_get_times', 'adj_get_adjoint_solution',
+           'adj_get_adjoint_solutions', 'adj_get_adjoint_equations',
            'adj_register_parameter_source_callback',
            'adj_func_deriv_callback_list', 'adj_op_callback_list',
            'adj_get_adjoint_equation', 'CACTION',
@@ -713,12 +850,21 @@ __all__ = ['adj_variable_known', 'CACTION_YOUTURN',
            'adj_nonlinear_block_set_test_derivative',
            'adj_find_variable_equation_nb', 'adj_dict_destroy',
            'adj_create_equation', 'CACTION_RESTORE',
-           'adj_set_revolve_options', 'adj_timestep_set_times',
+           'adj_set_revolve_options', 'adj_set_memory_budget', 'adj_set_prefetch_options',
+           'adj_set_write_behind_options', 'adj_flush_disk_writes', 'adj_set_disk_store',
+           'adj_timestep_set_times',
            'adj_register_equation', 'adj_record_variable',
            'adj_nonlinear_block_set_test_hermitian',
            'adj_set_checkpoint_strategy', 'adj_adjointer',
            'adj_create_term', 'adj_test_assert', 'UT_hash_bucket',
            'adj_storage_memory_copy', 'size_t', 'adj_reset_revolve',
+           'adj_storage_memory_compressed', 'adj_storage_set_compression',
+           'adj_get_compression_stats', 'adj_storage_memory_pod', 'adj_set_pod_options',
+           'adj_get_pod_stats', 'adj_set_interpolation', 'adj_storage_set_precision',
+           'adj_set_deduplication', 'adj_get_deduplication_stats',
+           'adj_set_revolve_verification', 'adj_get_revolve_verification_stats',
+           'adj_set_revolve_tier_options', 'adj_register_tier_data_callback',
+           'adj_set_revolve_cost_options', 'adj_set_timestep_cost', 'adj_get_timestep_cost',
            'adj_get_tlm_equation', 'adj_add_term_to_equation',
            'adj_variable', 'adj_chkierr_auto_private',
            'CACTION_ADVANCE', 'adj_eps', 'adj_storage_disk',
@@ -727,7 +873,8 @@ __all__ = ['adj_variable_known', 'CACTION_YOUTURN',
            'adj_forget_tlm_equation', 'adj_storage_data',
            'adj_create_variable',
            'adj_equation_set_rhs_derivative_action_callback',
-           'adj_set_revolve_debug_options', 'adj_functional_data',
+           'adj_equation_set_rhs_derivative_action_accumulate_callback',
+           'adj_set_revolve_debug_options', 'adj_set_revolve_equation_options', 'adj_functional_data',
            'adj_data_callbacks', 'adj_dictionary_entry',
            'adj_iteration_count', 'adj_add_terms',
            'adj_forget_adjoint_equation',
@@ -741,6 +888,7 @@ __all__ = ['adj_variable_known', 'CACTION_YOUTURN',
            'adj_storage_set_checkpoint', 'adj_create_nonlinear_block',
            'adj_dict_find', 'adj_variable_set_auxiliary',
            'adj_destroy_nonlinear_block', 'adj_variable_hash',
+           'adj_variable_key',
            'adj_func_callback_list', 'adj_get_soa_equation',
            'adj_parameter_source_callback_list',
            'adj_nonlinear_block_second_derivative', 'adj_compute_eps',
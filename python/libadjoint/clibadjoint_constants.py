@@ -1 +1 @@
-adj_constants = {'ADJ_VEC_WRITE_CB': '20', 'ADJ_MAT_AXPY_CB': '31', 'ADJ_FORWARD': '1', 'ADJ_MAT_DESTROY_CB': '32', 'ADJ_VEC_GET_NORM_CB': '17', 'ADJ_ACTIVITY_NOTHING': '1', 'ADJ_NAME_LEN': '4080', 'ADJ_NORMAL_VARIABLE': '0', 'ADJ_AUXILIARY_VARIABLE': '1', 'ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB': '6', 'ADJ_SOA': '4', 'ADJ_ISP_ORDER': '1', 'ADJ_NBLOCK_DERIVATIVE_ASSEMBLY_CB': '3', 'ADJ_VEC_GET_SIZE_CB': '16', 'ADJ_DICT_LEN': '32768', 'ADJ_PREALLOC_SIZE': '1', 'ADJ_CHECKPOINT_NONE': '0', 'ADJ_CHECKPOINT_STORAGE_DISK': '2', 'ADJ_MAT_ACTION_CB': '33', 'ADJ_BLOCK_ASSEMBLY_CB': '5', 'ADJ_CHECKPOINT_STORAGE_NONE': '0', 'ADJ_VEC_AXPY_CB': '11', 'ADJ_BLOCK_ACTION_CB': '4', 'ADJ_VEC_DUPLICATE_CB': '10', 'ADJ_VEC_DIVIDE_CB': '13', 'ADJ_NO_OPTIONS': '3', 'ADJ_CHECKPOINT_STORAGE_MEMORY': '1', 'ADJ_MAT_DUPLICATE_CB': '30', 'ADJ_CHECKPOINT_REVOLVE_ONLINE': '3', 'ADJ_VEC_SET_VALUES_CB': '14', 'ADJ_VEC_DELETE_CB': '22', 'ADJ_SOLVE_CB': '40', 'adj_scalar': 'double', 'ADJ_STORAGE_MEMORY_INCREF': '1', 'ADJ_VEC_READ_CB': '21', 'adj_scalar_f': 'real(kind=c_double)', 'ADJ_CHECKPOINT_STRATEGY': '2', 'ADJ_ACTIVITY_ADJOINT': '0', 'ADJ_CHECKPOINT_REVOLVE_OFFLINE': '1', 'ADJ_ACTIVITY': '0', 'ADJ_STORAGE_MEMORY_COPY': '0', 'ADJ_VEC_DESTROY_CB': '12', 'ADJ_TLM': '3', 'ADJ_TRUE': '1', 'ADJ_VEC_DOT_PRODUCT_CB': '18', 'ADJ_UNSET': '-666', 'ADJ_NBLOCK_ACTION_CB': '1', 'ADJ_SCALAR_EPS': '1.0e-13', 'ADJ_NBLOCK_DERIVATIVE_ACTION_CB': '2', 'ADJ_VEC_GET_VALUES_CB': '15', 'ADJ_VEC_SET_RANDOM_CB': '19', 'ADJ_FALSE': '0', 'ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB': '7', 'ADJ_ADJOINT': '2', 'ADJ_CHECKPOINT_REVOLVE_MULTISTAGE': '2'}
\ No newline at end of file
+adj_constants = {'ADJ_NAME_LEN': '4080', 'ADJ_DICT_LEN': '32768', 'adj_scalar': 'double', 'adj_scalar_f': 'real(kind=c_double)', 'ADJ_SCALAR_EPS': '1.0e-13', 'ADJ_TRUE': '1', 'ADJ_FALSE': '0', 'ADJ_FORWARD': '1', 'ADJ_ADJOINT': '2', 'ADJ_TLM': '3', 'ADJ_SOA': '4', 'ADJ_NORMAL_VARIABLE': '0', 'ADJ_AUXILIARY_VARIABLE': '1', 'ADJ_NO_OPTIONS': '3', 'ADJ_ACTIVITY': '0', 'ADJ_ISP_ORDER': '1', 'ADJ_CHECKPOINT_STRATEGY': '2', 'ADJ_ACTIVITY_ADJOINT': '0', 'ADJ_ACTIVITY_NOTHING': '1', 'ADJ_CHECKPOINT_NONE': '0', 'ADJ_CHECKPOINT_REVOLVE_OFFLINE': '1', 'ADJ_CHECKPOINT_REVOLVE_MULTISTAGE': '2', 'ADJ_CHECKPOINT_REVOLVE_ONLINE': '3', 'ADJ_CHECKPOINT_REVOLVE_COST_AWARE': '4', 'ADJ_CHECKPOINT_STORAGE_NONE': '0', 'ADJ_CHECKPOINT_STORAGE_MEMORY': '1', 'ADJ_CHECKPOINT_STORAGE_DISK': '2', 'ADJ_CHECKPOINT_STORAGE_TIER': '3', 'ADJ_STORAGE_MEMORY_COPY': '0', 'ADJ_STORAGE_MEMORY_INCREF': '1', 'ADJ_STORAGE_MEMORY_COMPRESSED': '2', 'ADJ_STORAGE_MEMORY_POD': '3', 'ADJ_COMPRESSION_LOSSLESS': '0', 'ADJ_COMPRESSION_LOSSY': '1', 'ADJ_PRECISION_DOUBLE': '0', 'ADJ_PRECISION_SINGLE': '1', 'ADJ_PRECISION_BFLOAT16': '2', 'ADJ_INTERPOLATION_LINEAR': '0', 'ADJ_INTERPOLATION_CUBIC_HERMITE': '1', 'ADJ_NBLOCK_ACTION_CB': '1', 'ADJ_NBLOCK_DERIVATIVE_ACTION_CB': '2', 'ADJ_NBLOCK_DERIVATIVE_ASSEMBLY_CB': '3', 'ADJ_BLOCK_ACTION_CB': '4', 'ADJ_BLOCK_ASSEMBLY_CB': '5', 'ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB': '6', 'ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB': '7', 'ADJ_BLOCK_ACTION_ACCUMULATE_CB': '8', 'ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB': '9', 'ADJ_NO_OPERATOR_CALLBACKS': '9', 'ADJ_VEC_DUPLICATE_CB': '10', 'ADJ_VEC_AXPY_CB': '11', 'ADJ_VEC_DESTROY_CB': '12', 'ADJ_VEC_DIVIDE_CB': '13', 'ADJ_VEC_SET_VALUES_CB': '14', 'ADJ_VEC_GET_VALUES_CB': '15', 'ADJ_VEC_GET_SIZE_CB': '16', 'ADJ_VEC_GET_NORM_CB': '17', 'ADJ_VEC_DOT_PRODUCT_CB': '18', 'ADJ_VEC_SET_RANDOM_CB': '19', 'ADJ_VEC_WRITE_CB': '20', 'ADJ_VEC_READ_CB': '21', 'ADJ_VEC_DELETE_CB': '22', 'ADJ_VEC_ZERO_CB': '23', 'ADJ_VEC_WRAP_VALUES_CB': '24', 'ADJ_MAT_DUPLICATE_CB': '30', 'ADJ_MAT_AXPY_CB': '31', 'ADJ_MAT_DESTROY_CB': '32', 'ADJ_MAT_ACTION_CB': '33', 'ADJ_SOLVE_CB': '40', 'ADJ_SOLVE_MULTI_CB': '41', 'ADJ_PLAN_BLOCK_ASSEMBLY': '1', 'ADJ_PLAN_BLOCK_ACTION': '2', 'ADJ_PLAN_DERIVATIVE_ACTION': '3', 'ADJ_PLAN_RHS_DERIVATIVE_ASSEMBLY': '4', 'ADJ_PLAN_RHS_DERIVATIVE_ACTION': '5', 'ADJ_PREALLOC_SIZE': '16', 'ADJ_ARENA_BLOCK_SIZE': '1048576', 'ADJ_VARDATA_CHUNK_SIZE': '1024', 'ADJ_VEC_POOL_SIZE': '32', 'ADJ_UNSET': '-666'}
\ No newline at end of file
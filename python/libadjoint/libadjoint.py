@@ -883,21 +883,44 @@ class Adjointer(object):
   def get_checkpoint_strategy(self):
     strategy_id = ctypes.c_int()
     clib.adj_get_checkpoint_strategy(self.adjointer, strategy_id)
-    return [None, 'offline', 'multistage', 'online'][strategy_id.value]
+    return [None, 'offline', 'multistage', 'online', 'cost_aware'][strategy_id.value]
 
   def set_checkpoint_strategy(self, strategy):
     try:
       strategy_id = int(constants.adj_constants['ADJ_CHECKPOINT_REVOLVE_' + strategy.upper()])
     except KeyError:
-      raise exceptions.LibadjointErrorInvalidInputs("Unknown checkpointing strategy " + strategy + ". Known strategies: ['offline', 'online', 'multistage'].")
+      raise exceptions.LibadjointErrorInvalidInputs("Unknown checkpointing strategy " + strategy + ". Known strategies: ['offline', 'online', 'multistage', 'cost_aware'].")
     clib.adj_set_checkpoint_strategy(self.adjointer, strategy_id)
 
   def set_revolve_options(self, steps, snaps_on_disk, snaps_in_ram, verbose=False):
       clib.adj_set_revolve_options(self.adjointer, steps, snaps_on_disk, snaps_in_ram, verbose)
 
+  def set_revolve_tier_options(self, steps, capacities, write_costs, read_costs, verbose=False):
+      ntiers = len(capacities)
+      clib.adj_set_revolve_tier_options(self.adjointer, steps, ntiers, (ctypes.c_int * ntiers)(*capacities),
+                                        (ctypes.c_double * ntiers)(*write_costs), (ctypes.c_double * ntiers)(*read_costs), verbose)
+
+  def set_revolve_cost_options(self, steps, byte_budget, verbose=False):
+      clib.adj_set_revolve_cost_options(self.adjointer, steps, byte_budget, verbose)
+
+  def set_timestep_cost(self, timestep, seconds, nbytes):
+      clib.adj_set_timestep_cost(self.adjointer, timestep, seconds, nbytes)
+
+  def get_timestep_cost(self, timestep):
+      seconds = ctypes.c_double()
+      nbytes = ctypes.c_size_t()
+      clib.adj_get_timestep_cost(self.adjointer, timestep, seconds, nbytes)
+      return (seconds.value, nbytes.value)
+
   def set_revolve_debug_options(self, overwrite, comparison_tolerance):
       clib.adj_set_revolve_debug_options(self.adjointer, overwrite, comparison_tolerance)
 
+  def set_revolve_equation_options(self, snaps):
+      clib.adj_set_revolve_equation_options(self.adjointer, snaps)
+
+  def set_revolve_verification(self, verify, tolerance=0.0):
+      clib.adj_set_revolve_verification(self.adjointer, verify, tolerance)
+
   def check_checkpoints(self):
       clib.adj_adjointer_check_checkpoints(self.adjointer)
 
@@ -1,17 +1,43 @@
 #include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_plan.h"
 
-int adj_create_adjointer(adj_adjointer* adjointer)
+static int adj_reset_adjointer(adj_adjointer* adjointer)
 {
   int i;
 
   adjointer->nequations = 0;
   adjointer->equations_sz = 0;
   adjointer->equations = NULL;
+  adjointer->arena = NULL;
+  adjointer->adjoint_plans = NULL;
+  adjointer->nadjoint_plans = 0;
+  adjointer->vec_pool = NULL;
+  adjointer->prefetch = NULL;
+  adjointer->write_behind = NULL;
+  adjointer->compression = NULL;
+  adjointer->pod = NULL;
+  adjointer->interpolation = NULL;
+  adjointer->dedup = NULL;
+  adjointer->digests = NULL;
+  adjointer->tiers = NULL;
+  adjointer->costs = NULL;
+  adjointer->expiry = NULL;
+  adjointer->adjoint_needs = NULL;
 
   adjointer->ntimesteps = 0;
   adjointer->timestep_data = NULL;
 
   adjointer->varhash = NULL;
+  adjointer->nvariables = 0;
+  adjointer->variables_sz = 0;
+  adjointer->vardata_chunks = NULL;
+  adjointer->varentries = NULL;
+  adjointer->live_variables = NULL;
+  adjointer->nlive_variables = 0;
+  adjointer->live_variables_sz = 0;
+  adjointer->memory_budget = 0;
+  adjointer->memory_heap = NULL;
+  adjointer->memory_used = 0;
 
   adjointer->callbacks.vec_duplicate = NULL;
   adjointer->callbacks.vec_axpy = NULL;
@@ -26,12 +52,15 @@ int adj_create_adjointer(adj_adjointer* adjointer)
   adjointer->callbacks.vec_write = NULL;
   adjointer->callbacks.vec_read = NULL;
   adjointer->callbacks.vec_delete = NULL;
+  adjointer->callbacks.vec_zero = NULL;
+  adjointer->callbacks.vec_wrap_values = NULL;
 
   adjointer->callbacks.mat_duplicate = NULL;
   adjointer->callbacks.mat_axpy = NULL;
   adjointer->callbacks.mat_destroy = NULL;
 
   adjointer->callbacks.solve = NULL;
+  adjointer->callbacks.solve_multi = NULL;
 
   adjointer->revolve_data.steps = 0;
   adjointer->revolve_data.snaps = 0;
@@ -42,6 +71,7 @@ int adj_create_adjointer(adj_adjointer* adjointer)
   adjointer->revolve_data.verbose = ADJ_FALSE;
   adjointer->revolve_data.overwrite = ADJ_FALSE;
   adjointer->revolve_data.comparison_tolerance = 0.0;
+  adjointer->revolve_data.equation_snaps = 0;
 
   adjointer->nonlinear_action_list.firstnode = NULL;
   adjointer->nonlinear_action_list.lastnode = NULL;
@@ -55,12 +85,19 @@ int adj_create_adjointer(adj_adjointer* adjointer)
   adjointer->block_action_list.lastnode = NULL;
   adjointer->block_assembly_list.firstnode = NULL;
   adjointer->block_assembly_list.lastnode = NULL;
+  adjointer->block_action_accumulate_list.firstnode = NULL;
+  adjointer->block_action_accumulate_list.lastnode = NULL;
+  adjointer->nonlinear_derivative_action_accumulate_list.firstnode = NULL;
+  adjointer->nonlinear_derivative_action_accumulate_list.lastnode = NULL;
   adjointer->functional_list.firstnode = NULL;
   adjointer->functional_list.lastnode = NULL;
   adjointer->functional_derivative_list.firstnode = NULL;
   adjointer->functional_derivative_list.lastnode = NULL;
+  adjointer->functional_second_derivative_list.firstnode = NULL;
+  adjointer->functional_second_derivative_list.lastnode = NULL;
   adjointer->parameter_source_list.firstnode = NULL;
   adjointer->parameter_source_list.lastnode = NULL;
+  adjointer->callback_hash = NULL;
 
   adjointer->finished = ADJ_FALSE;
 
@@ -70,6 +107,12 @@ int adj_create_adjointer(adj_adjointer* adjointer)
   return ADJ_OK;
 }
 
+int adj_create_adjointer(adj_adjointer* adjointer)
+{
+  adj_intern_retain();
+  return adj_reset_adjointer(adjointer);
+}
+
 int adj_destroy_adjointer(adj_adjointer* adjointer)
 {
   int i;
@@ -77,7 +120,6 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
   adj_variable_hash* varhash;
   adj_variable_hash* varhash_tmp;
   adj_variable_data* data_ptr;
-  adj_variable_data* data_ptr_tmp;
   adj_op_callback* cb_ptr;
   adj_op_callback* cb_ptr_tmp;
   adj_func_callback* func_cb_ptr;
@@ -88,35 +130,32 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
   adj_func_second_deriv_callback* func_second_deriv_cb_ptr_tmp;
   adj_parameter_source_callback* parameter_source_cb_ptr;
   adj_parameter_source_callback* parameter_source_cb_ptr_tmp;
+  adj_callback_entry* cb_entry;
+  adj_callback_entry* cb_entry_tmp;
   adj_functional_data* functional_data_ptr_next = NULL;
   adj_functional_data* functional_data_ptr = NULL;
 
-  for (i = 0; i < adjointer->nequations; i++)
-  {
-    ierr = adj_destroy_equation(&(adjointer->equations[i]));
-    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-  }
+  /* The blocks, targets and dependencies of the equations all live in the arena */
   if (adjointer->equations != NULL) free(adjointer->equations);
+  ierr = adj_arena_destroy(&(adjointer->arena));
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_adjoint_plans(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_write_behind(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_vec_pool(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_prefetch(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  if (adjointer->timestep_data != NULL)
-  {
-    for (i = 0; i < adjointer->ntimesteps; i++)
-    {
-      functional_data_ptr = adjointer->timestep_data[i].functional_data_start;
-      while (functional_data_ptr != NULL)
-      {
-        functional_data_ptr_next = functional_data_ptr->next;
-        if (functional_data_ptr->dependencies != NULL) free(functional_data_ptr->dependencies);
-        free(functional_data_ptr);
-        functional_data_ptr = functional_data_ptr_next;
-      }
-    }
-    free(adjointer->timestep_data);
-  }
+  /* Forget the values first, while the lists and timesteps still say what they are needed for */
+  for (i = 0; i < adjointer->nvariables; i++)
+    ierr = adj_forget_variable_value(adjointer, adjointer->varentries[i]->variable, ADJ_VARIABLE_DATA(adjointer, i));
 
-  for (varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
+  for (i = 0; i < adjointer->nvariables; i++)
   {
-    data_ptr = varhash->data;
+    data_ptr = ADJ_VARIABLE_DATA(adjointer, i);
+    varhash = adjointer->varentries[i];
 
     if (data_ptr->targeting_equations) 
     {
@@ -148,14 +187,35 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
       data_ptr->adjoint_equations = NULL;
     }
 
-    ierr = adj_forget_variable_value(adjointer, varhash->variable, data_ptr);
     ierr = adj_destroy_variable_data(adjointer, varhash->variable, data_ptr);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    data_ptr_tmp = data_ptr;
-    data_ptr = data_ptr->next;
-    free(data_ptr_tmp);
   }
 
+  if (adjointer->timestep_data != NULL)
+  {
+    for (i = 0; i < adjointer->ntimesteps; i++)
+    {
+      functional_data_ptr = adjointer->timestep_data[i].functional_data_start;
+      while (functional_data_ptr != NULL)
+      {
+        functional_data_ptr_next = functional_data_ptr->next;
+        if (functional_data_ptr->dependencies != NULL) free(functional_data_ptr->dependencies);
+        free(functional_data_ptr);
+        functional_data_ptr = functional_data_ptr_next;
+      }
+    }
+    free(adjointer->timestep_data);
+  }
+
+  if (adjointer->vardata_chunks != NULL)
+  {
+    for (i = 0; i < adjointer->variables_sz / ADJ_VARDATA_CHUNK_SIZE; i++)
+      free(adjointer->vardata_chunks[i]);
+    free(adjointer->vardata_chunks);
+  }
+  if (adjointer->varentries != NULL) free(adjointer->varentries);
+  if (adjointer->live_variables != NULL) free(adjointer->live_variables);
+
   for (varhash = adjointer->varhash; varhash != NULL; )
   {
     varhash_tmp = varhash;
@@ -164,6 +224,30 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
   }
   adjointer->varhash = NULL;
 
+  /* Only once the values on disk have been deleted */
+  ierr = adj_destroy_disk_store(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_compression(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_pod(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_interpolation(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_dedup(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_digests(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_tiers(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_costs(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_expiry(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_adjoint_needs(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_destroy_memory_budget(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
   cb_ptr = adjointer->nonlinear_action_list.firstnode;
   while(cb_ptr != NULL)
   {
@@ -204,6 +288,22 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
     free(cb_ptr_tmp);
   }
 
+  cb_ptr = adjointer->block_action_accumulate_list.firstnode;
+  while(cb_ptr != NULL)
+  {
+    cb_ptr_tmp = cb_ptr;
+    cb_ptr = cb_ptr->next;
+    free(cb_ptr_tmp);
+  }
+
+  cb_ptr = adjointer->nonlinear_derivative_action_accumulate_list.firstnode;
+  while(cb_ptr != NULL)
+  {
+    cb_ptr_tmp = cb_ptr;
+    cb_ptr = cb_ptr->next;
+    free(cb_ptr_tmp);
+  }
+
   func_cb_ptr = adjointer->functional_list.firstnode;
   while(func_cb_ptr != NULL)
   {
@@ -236,7 +336,15 @@ int adj_destroy_adjointer(adj_adjointer* adjointer)
     free(parameter_source_cb_ptr_tmp);
   }
 
-  adj_create_adjointer(adjointer);
+  HASH_ITER(hh, adjointer->callback_hash, cb_entry, cb_entry_tmp)
+  {
+    HASH_DEL(adjointer->callback_hash, cb_entry);
+    free(cb_entry);
+  }
+
+  /* Leave it empty, and let the interned names go with the last adjointer */
+  adj_reset_adjointer(adjointer);
+  adj_intern_release();
   return ADJ_OK;
 }
 
@@ -277,6 +385,45 @@ int adj_set_revolve_debug_options(adj_adjointer* adjointer, int overwrite, adj_s
   return ADJ_OK;
 }
 
+int adj_set_revolve_equation_options(adj_adjointer* adjointer, int snaps)
+{
+  if (snaps < 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Can't keep %d equation checkpoints within a timestep.", snaps);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  adjointer->revolve_data.equation_snaps=snaps;
+  return ADJ_OK;
+}
+
+int adj_set_memory_budget(adj_adjointer* adjointer, size_t budget)
+{
+  adj_variable_data* data;
+  int k, ierr;
+
+  if (budget > 0 && (adjointer->callbacks.vec_get_size == NULL || adjointer->callbacks.vec_write == NULL ||
+                     adjointer->callbacks.vec_read == NULL || adjointer->callbacks.vec_delete == NULL))
+  {
+    strncpy(adj_error_msg, "A memory budget needs the ADJ_VEC_GET_SIZE_CB, ADJ_VEC_WRITE_CB, ADJ_VEC_READ_CB and ADJ_VEC_DELETE_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  adjointer->memory_budget = budget;
+
+  /* Charge the values we already hold */
+  for (k = 0; k < adjointer->nlive_variables; k++)
+  {
+    data = ADJ_VARIABLE_DATA(adjointer, adjointer->live_variables[k]);
+    if (data->storage.storage_memory_has_value)
+    {
+      ierr = adj_memory_budget_charge(adjointer, data);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+  }
+
+  return adj_memory_budget_enforce(adjointer);
+}
+
 int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int* checkpoint_storage)
 {
   adj_variable_data* data_ptr;
@@ -284,10 +431,15 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
   int i;
   int j;
   int checkpoint_strategy; /* ADJ_CHECKPOINT_STORAGE_NONE, ADJ_CHECKPOINT_STORAGE_MEMORY or ADJ_CHECKPOINT_STORAGE_DISK */
+  int checkpoint_kind; /* the same, for a checkpoint on a storage tier */
   *checkpoint_storage = ADJ_CHECKPOINT_STORAGE_NONE;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
+  /* The new equation may add terms to the adjoint of any earlier one */
+  ierr = adj_destroy_adjoint_plans(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
   /* Let's check we haven't solved for this variable before */
   ierr = adj_find_variable_data(&(adjointer->varhash), &(equation.variable), &data_ptr);
   if (ierr != ADJ_ERR_HASH_FAILED)
@@ -371,14 +523,19 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   }
   data_ptr->equation = adjointer->nequations;
+  /* A value recorded before its equation only now becomes one adj_forget_forward_equation may forget */
+  ierr = adj_update_live_variable(adjointer, data_ptr);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   /* OK. Next create an entry for the adj_equation in the adjointer. */
 
-  /* Check we have enough room, and if not, make some */
+  /* Check we have enough room, and if not, make some. Grow geometrically, so that
+     registering n equations costs O(n) copying in total */
   if (adjointer->nequations == adjointer->equations_sz)
   {
-    adjointer->equations = (adj_equation*) realloc(adjointer->equations, (adjointer->equations_sz + ADJ_PREALLOC_SIZE) * sizeof(adj_equation));
+    int new_sz = (adjointer->equations_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * adjointer->equations_sz;
+    adjointer->equations = (adj_equation*) realloc(adjointer->equations, new_sz * sizeof(adj_equation));
     ADJ_CHKMALLOC(adjointer->equations);
-    adjointer->equations_sz = adjointer->equations_sz + ADJ_PREALLOC_SIZE;
+    adjointer->equations_sz = new_sz;
   }
 
   adjointer->nequations++;
@@ -399,29 +556,45 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
   /* but for consistency, any libadjoint object that the user creates, he must destroy --
      it's simpler that way. */
   /* so we're going to make our own copies, so that the user can destroy his. */
+  /* Our copies come out of the adjointer's arena, and are freed with it in adj_destroy_adjointer. */
 
   /* blocks */
-  adjointer->equations[adjointer->nequations - 1].blocks = (adj_block*) malloc(equation.nblocks * sizeof(adj_block));
-  ADJ_CHKMALLOC(adjointer->equations[adjointer->nequations - 1].blocks);
+  ierr = adj_arena_alloc(&(adjointer->arena), equation.nblocks * sizeof(adj_block), (void**) &(adjointer->equations[adjointer->nequations - 1].blocks));
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   memcpy(adjointer->equations[adjointer->nequations - 1].blocks, equation.blocks, equation.nblocks * sizeof(adj_block));
   for (i = 0; i < equation.nblocks; i++)
   {
     if (equation.blocks[i].has_nonlinear_block)
     {
-      int ierr;
-      ierr = adj_copy_nonlinear_block(equation.blocks[i].nonlinear_block, &adjointer->equations[adjointer->nequations - 1].blocks[i].nonlinear_block);
+      adj_nonlinear_block* nblock = &adjointer->equations[adjointer->nequations - 1].blocks[i].nonlinear_block;
+      ierr = adj_arena_alloc(&(adjointer->arena), nblock->ndepends * sizeof(adj_variable), (void**) &(nblock->depends));
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      memcpy(nblock->depends, equation.blocks[i].nonlinear_block.depends, nblock->ndepends * sizeof(adj_variable));
+    }
+  }
+
+  /* Resolve the callback entries for the operators now, so that evaluating them later needs no lookup.
+     We store the entry rather than the function, as the callbacks may be (re-)registered afterwards. */
+  for (i = 0; i < equation.nblocks; i++)
+  {
+    adj_block* block = &adjointer->equations[adjointer->nequations - 1].blocks[i];
+    ierr = adj_find_callback_entry(adjointer, block->name, ADJ_TRUE, &(block->callbacks));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    if (block->has_nonlinear_block)
+    {
+      ierr = adj_find_callback_entry(adjointer, block->nonlinear_block.name, ADJ_TRUE, &(block->nonlinear_block.callbacks));
       if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
     }
   }
 
   /* targets */
-  adjointer->equations[adjointer->nequations - 1].targets = (adj_variable*) malloc(equation.nblocks * sizeof(adj_variable));
-  ADJ_CHKMALLOC(adjointer->equations[adjointer->nequations - 1].targets);
+  ierr = adj_arena_alloc(&(adjointer->arena), equation.nblocks * sizeof(adj_variable), (void**) &(adjointer->equations[adjointer->nequations - 1].targets));
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   memcpy(adjointer->equations[adjointer->nequations - 1].targets, equation.targets, equation.nblocks * sizeof(adj_variable));
   if (equation.nrhsdeps > 0)
   {
-    adjointer->equations[adjointer->nequations - 1].rhsdeps = (adj_variable*) malloc(equation.nrhsdeps * sizeof(adj_variable));
-    ADJ_CHKMALLOC(adjointer->equations[adjointer->nequations - 1].rhsdeps);
+    ierr = adj_arena_alloc(&(adjointer->arena), equation.nrhsdeps * sizeof(adj_variable), (void**) &(adjointer->equations[adjointer->nequations - 1].rhsdeps));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
     memcpy(adjointer->equations[adjointer->nequations - 1].rhsdeps, equation.rhsdeps, equation.nrhsdeps * sizeof(adj_variable));
   }
 
@@ -493,7 +666,7 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
     {
       ierr = adj_find_variable_data(&(adjointer->varhash), &(equation.rhsdeps[j]), &data_ptr);
       if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      ierr = adj_append_unique(&(data_ptr->adjoint_equations), &(data_ptr->nadjoint_equations), eqn_no); /* dependency j is necessary for equation i */
+      ierr = adj_append_adjoint_equation(adjointer, data_ptr, eqn_no); /* dependency j is necessary for equation i */
       if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
     }
   }
@@ -551,11 +724,11 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
         /* One set of dependencies: the (adjoint equation of) (the target of this block) (needs) (this dependency) */
-        ierr = adj_append_unique(&(j_data->adjoint_equations), &(j_data->nadjoint_equations), block_target_data->equation);
+        ierr = adj_append_adjoint_equation(adjointer, j_data, block_target_data->equation);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
         /* Another set of dependencies: the (adjoint equation of) (the j'th dependency) (needs) (the target of this block) */
-        ierr = adj_append_unique(&(block_target_data->adjoint_equations), &(block_target_data->nadjoint_equations), j_data->equation);
+        ierr = adj_append_adjoint_equation(adjointer, block_target_data, j_data->equation);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
         /* Now we loop over all the dependencies again and fill in the cross-dependencies */
@@ -568,7 +741,7 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
           /* Another set of dependencies: the (adjoint equation of) (the j'th dependency) (needs) (the k'th dependency) */
-          ierr = adj_append_unique(&(k_data->adjoint_equations), &(k_data->nadjoint_equations), j_data->equation);
+          ierr = adj_append_adjoint_equation(adjointer, k_data, j_data->equation);
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
         }
       }
@@ -581,14 +754,18 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
 
   if ((checkpoint_strategy == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || 
       (checkpoint_strategy == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) || 
-      (checkpoint_strategy == ADJ_CHECKPOINT_REVOLVE_ONLINE))
+      (checkpoint_strategy == ADJ_CHECKPOINT_REVOLVE_ONLINE) ||
+      (checkpoint_strategy == ADJ_CHECKPOINT_REVOLVE_COST_AWARE))
   {
     ierr = adj_get_revolve_checkpoint_storage(adjointer, equation, checkpoint_storage);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-    if (*checkpoint_storage == ADJ_CHECKPOINT_STORAGE_MEMORY)
+    ierr = adj_tiers_storage_kind(adjointer, *checkpoint_storage, &checkpoint_kind);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+    if (checkpoint_kind == ADJ_CHECKPOINT_STORAGE_MEMORY)
       adjointer->equations[adjointer->nequations - 1].memory_checkpoint = ADJ_TRUE;
-    else if (*checkpoint_storage == ADJ_CHECKPOINT_STORAGE_DISK)
+    else if (checkpoint_kind == ADJ_CHECKPOINT_STORAGE_DISK)
       adjointer->equations[adjointer->nequations - 1].disk_checkpoint = ADJ_TRUE;
   }
 
@@ -602,12 +779,19 @@ int adj_register_equation(adj_adjointer* adjointer, adj_equation equation, int*
 int adj_checkpoint_equation(adj_adjointer* adjointer, int eqn_number, int cs)
 {
   int eqn_number_iter, i, j, ierr;
+  int kind; /* ADJ_CHECKPOINT_STORAGE_MEMORY or ADJ_CHECKPOINT_STORAGE_DISK, also for a storage tier */
   adj_equation eqn;
   adj_variable var;
 
-  if (!(cs == ADJ_CHECKPOINT_STORAGE_MEMORY || cs == ADJ_CHECKPOINT_STORAGE_DISK))
+  ierr = adj_tiers_storage_kind(adjointer, cs, &kind);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (!(kind == ADJ_CHECKPOINT_STORAGE_MEMORY || kind == ADJ_CHECKPOINT_STORAGE_DISK))
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
 
+  /* A memory tier is memory like any other */
+  if (kind == ADJ_CHECKPOINT_STORAGE_MEMORY)
+    cs = ADJ_CHECKPOINT_STORAGE_MEMORY;
+
   if (eqn_number<0 || eqn_number>=adjointer->nequations)
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
 
@@ -713,9 +897,9 @@ int adj_checkpoint_equation(adj_adjointer* adjointer, int eqn_number, int cs)
   }
 
   /* If everything worked fine until here, we can set the checkpoint flag */
-  if (cs == ADJ_CHECKPOINT_STORAGE_MEMORY)
+  if (kind == ADJ_CHECKPOINT_STORAGE_MEMORY)
     adjointer->equations[eqn_number].memory_checkpoint = ADJ_TRUE;
-  else if (cs == ADJ_CHECKPOINT_STORAGE_DISK)
+  else if (kind == ADJ_CHECKPOINT_STORAGE_DISK)
     adjointer->equations[eqn_number].disk_checkpoint = ADJ_TRUE;
   else
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
@@ -723,12 +907,16 @@ int adj_checkpoint_equation(adj_adjointer* adjointer, int eqn_number, int cs)
   return ADJ_OK;
 }
 
-/* Checkpoints the given variable  */
+/* Checkpoints the given variable; cs is ADJ_CHECKPOINT_STORAGE_MEMORY, ADJ_CHECKPOINT_STORAGE_DISK
+ * or the storage of a tier that doesn't keep its checkpoints in memory */
 int adj_checkpoint_variable(adj_adjointer* adjointer, adj_variable var, int cs)
 {
   int ierr;
+  int found;
+  int on_disk = (cs == ADJ_CHECKPOINT_STORAGE_DISK || cs >= ADJ_CHECKPOINT_STORAGE_TIER);
   adj_variable_data* var_data;
   adj_storage_data storage;
+  adj_vector value;
 
   ierr = adj_find_variable_data(&(adjointer->varhash), &var, &var_data);
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
@@ -741,8 +929,8 @@ int adj_checkpoint_variable(adj_adjointer* adjointer, adj_variable var, int cs)
     return adj_chkierr_auto(ADJ_ERR_NEED_VALUE);
   }
 
-  /* Case 1: variable is on disk and we want to checkpoint it in disk */
-  if ((cs == ADJ_CHECKPOINT_STORAGE_DISK) && (var_data->storage.storage_disk_has_value == ADJ_TRUE))
+  /* Case 1: variable is on disk and we want to checkpoint it in disk; if it is already on disk, it stays where it is */
+  if (on_disk && (var_data->storage.storage_disk_has_value == ADJ_TRUE))
   {
     var_data->storage.storage_disk_is_checkpoint = ADJ_TRUE;
     return ADJ_OK;
@@ -753,10 +941,18 @@ int adj_checkpoint_variable(adj_adjointer* adjointer, adj_variable var, int cs)
     var_data->storage.storage_memory_is_checkpoint = ADJ_TRUE;
     return ADJ_OK;
   }
+  /* Case 3a: variable is in memory and we want to checkpoint it on a storage tier */
+  else if (cs >= ADJ_CHECKPOINT_STORAGE_TIER && (var_data->storage.storage_disk_has_value != ADJ_TRUE))
+  {
+    ierr = adj_tiers_write(adjointer, cs, var, var_data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
   /* Case 3: variable is in memory and we want to checkpoint it on disk */
   else if (cs == ADJ_CHECKPOINT_STORAGE_DISK && (var_data->storage.storage_disk_has_value != ADJ_TRUE))
   {
-    ierr = adj_storage_disk(var_data->storage.value, &storage);
+    ierr = adj_storage_memory_value(adjointer, var_data, &value);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_storage_disk(value, &storage);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
     ierr = adj_storage_set_checkpoint(&storage, ADJ_TRUE);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
@@ -768,16 +964,31 @@ int adj_checkpoint_variable(adj_adjointer* adjointer, adj_variable var, int cs)
   /* Case 4: variable is on disk and we want to checkpoint it in memory */
   else if  (cs == ADJ_CHECKPOINT_STORAGE_MEMORY && (var_data->storage.storage_memory_has_value != ADJ_TRUE))
   {
+    ierr = adj_tiers_read(adjointer, var_data, var, &(var_data->storage.value), &found);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
     /* Check for the required callbacks */
-    if (adjointer->callbacks.vec_read == NULL)
+    if (!found && adjointer->callbacks.vec_read == NULL)
     {
       strncpy(adj_error_msg, "Need the ADJ_VEC_READ_CB data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
       return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
     }
-    adjointer->callbacks.vec_read(var, &(var_data->storage.value));
+    if (!found)
+    {
+      ierr = adj_write_behind_read(adjointer, var_data, &(var_data->storage.value), &found);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (!found)
+    {
+      ierr = adj_disk_store_map(adjointer, var_data, var, &(var_data->storage.value), &found);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (!found)
+      adjointer->callbacks.vec_read(var, &(var_data->storage.value));
     var_data->storage.storage_memory_has_value=ADJ_TRUE;
 
     var_data->storage.storage_memory_is_checkpoint = ADJ_TRUE;
+    ierr = adj_memory_budget_charge(adjointer, var_data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   }
 
   return ADJ_OK;
@@ -890,7 +1101,14 @@ int adj_get_revolve_checkpoint_storage(adj_adjointer* adjointer, adj_equation eq
         break;
 
       case CACTION_TAKESHOT:
-        if (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE)
+        if (adjointer->tiers != NULL)
+        {
+          ierr = adj_tiers_takeshot_storage(adjointer, checkpoint_storage);
+          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        }
+        else if (cs == ADJ_CHECKPOINT_REVOLVE_COST_AWARE)
+          *checkpoint_storage = ADJ_CHECKPOINT_STORAGE_MEMORY;
+        else if (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE)
         {
           if (revolve_getwhere(adjointer->revolve_data.revolve))
               *checkpoint_storage = ADJ_CHECKPOINT_STORAGE_MEMORY;
@@ -910,6 +1128,10 @@ int adj_get_revolve_checkpoint_storage(adj_adjointer* adjointer, adj_equation eq
           {
             printf("Revolve: Checkpoint timestep %i (equation %i) in memory.\n", adjointer->revolve_data.current_timestep, start_equation);
           }
+          else if (*checkpoint_storage >= ADJ_CHECKPOINT_STORAGE_TIER)
+          {
+            printf("Revolve: Checkpoint timestep %i (equation %i) on tier %i.\n", adjointer->revolve_data.current_timestep, start_equation, *checkpoint_storage - ADJ_CHECKPOINT_STORAGE_TIER);
+          }
           else
           {
             printf("Revolve: Checkpoint timestep %i (equation %i) on disk.\n", adjointer->revolve_data.current_timestep, start_equation);
@@ -953,11 +1175,32 @@ int adj_get_revolve_checkpoint_storage(adj_adjointer* adjointer, adj_equation eq
 
 int adj_initialise_revolve(adj_adjointer* adjointer)
 {
-  int steps = adjointer->revolve_data.steps;
-  int snaps = adjointer->revolve_data.snaps-1;
-  int snaps_in_ram = adjointer->revolve_data.snaps_in_ram-1;
+  int steps, snaps, snaps_in_ram;
   int cs, ierr;
 
+  ierr = adj_get_checkpoint_strategy(adjointer, &cs);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* Cost-aware checkpointing works out its own schedule, and budgets bytes rather than checkpoints */
+  if (cs == ADJ_CHECKPOINT_REVOLVE_COST_AWARE)
+  {
+    if (adjointer->tiers != NULL)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Storage tiers only work with offline or multistage revolve.");
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
+    return adj_costs_schedule(adjointer);
+  }
+
+  if (adjointer->tiers != NULL)
+  {
+    ierr = adj_tiers_revolve_options(adjointer);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  steps = adjointer->revolve_data.steps;
+  snaps = adjointer->revolve_data.snaps-1;
+  snaps_in_ram = adjointer->revolve_data.snaps_in_ram-1;
+
   /* We need one memory checkpoint to checkpoint the last timestep before a FIRSTRUN or YOUTURN action. */
   if (snaps_in_ram < 0)
   {
@@ -971,9 +1214,20 @@ int adj_initialise_revolve(adj_adjointer* adjointer)
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-
-  ierr = adj_get_checkpoint_strategy(adjointer, &cs);
-  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  /* Offline checkpointing over storage tiers: the tiers decide where each checkpoint goes */
+  if ((adjointer->tiers != NULL) && ((cs == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE)))
+  {
+    if (steps <= 0)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Checkpointing over storage tiers needs to know the number of timesteps. Make sure you call adj_set_revolve_tier_options with 'steps>0'.");
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
+    ierr = adj_tiers_schedule(adjointer);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    printf("Revolve: Checkpoint statistics:\n");
+    adjointer->revolve_data.revolve = revolve_create_offline(steps, snaps);
+    return ADJ_OK;
+  }
 
   printf("Revolve: Checkpoint statistics:\n");
   /* Offline checkpointing */
@@ -1003,6 +1257,11 @@ int adj_initialise_revolve(adj_adjointer* adjointer)
   /* Online checkpointing */
   else if (cs == ADJ_CHECKPOINT_REVOLVE_ONLINE) 
   {
+    if (adjointer->tiers != NULL)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Storage tiers need the whole schedule in advance, so they only work with offline or multistage revolve.");
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
     if (snaps > 0)
     {
       adjointer->revolve_data.revolve = revolve_create_online(snaps);
@@ -1073,9 +1332,23 @@ int adj_record_variable(adj_adjointer* adjointer, adj_variable var, adj_storage_
 
   /* If we don't have a value recorded already, any compare or overwrite flags can be ignored */
   else if (storage.storage_memory_has_value && !data_ptr->storage.storage_memory_has_value)
-    return adj_record_variable_core_memory(adjointer, data_ptr, storage);
+  {
+    ierr = adj_record_variable_core_memory(adjointer, data_ptr, storage);
+    if (ierr != ADJ_OK) return ierr;
+    compare_ierr = adj_digest_recorded(adjointer, data_ptr, var, storage);
+    if (compare_ierr > 0) return compare_ierr;
+    ierr = adj_interpolation_recorded(adjointer, var);
+    return (ierr != ADJ_OK) ? ierr : compare_ierr;
+  }
   else if (storage.storage_disk_has_value && !data_ptr->storage.storage_disk_has_value)
-    return adj_record_variable_core_disk(adjointer, var, data_ptr, storage);
+  {
+    ierr = adj_record_variable_core_disk(adjointer, var, data_ptr, storage);
+    if (ierr != ADJ_OK) return ierr;
+    compare_ierr = adj_digest_recorded(adjointer, data_ptr, var, storage);
+    if (compare_ierr > 0) return compare_ierr;
+    ierr = adj_interpolation_recorded(adjointer, var);
+    return (ierr != ADJ_OK) ? ierr : compare_ierr;
+  }
   else
   /* Sorry for the slight mess. The easiest way to understand this block is to build a 2x2 graph of
      compare and overwrite:
@@ -1152,6 +1425,8 @@ int adj_record_variable(adj_adjointer* adjointer, adj_variable var, adj_storage_
 /* The core routine to record a variable to memory */
 int adj_record_variable_core_memory(adj_adjointer* adjointer, adj_variable_data* data_ptr, adj_storage_data storage)
 {
+  int ierr;
+
   if (adjointer->callbacks.vec_duplicate == NULL)
   {
     snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "You have asked to record a value, but no ADJ_VEC_DUPLICATE_CB callback has been provided.");
@@ -1181,26 +1456,65 @@ int adj_record_variable_core_memory(adj_adjointer* adjointer, adj_variable_data*
       data_ptr->storage.storage_memory_type = ADJ_STORAGE_MEMORY_COPY;
       data_ptr->storage.storage_memory_has_value = storage.storage_memory_has_value;
       data_ptr->storage.storage_memory_is_checkpoint = storage.storage_memory_is_checkpoint;
-      adjointer->callbacks.vec_duplicate(storage.value, &(data_ptr->storage.value));
-      adjointer->callbacks.vec_axpy(&(data_ptr->storage.value), (adj_scalar)1.0, storage.value);
+      data_ptr->storage.precision = storage.precision;
+      if (storage.precision != ADJ_PRECISION_DOUBLE)
+      {
+        /* Copies in a reduced precision are kept narrowed, and widened again when they are asked for */
+        ierr = adj_compress_value(adjointer, data_ptr, storage);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        break;
+      }
+      ierr = adj_dedup_copy_value(adjointer, data_ptr, storage);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
       break;
     case ADJ_STORAGE_MEMORY_INCREF:
+      if (storage.precision != ADJ_PRECISION_DOUBLE)
+      {
+        snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "ADJ_STORAGE_MEMORY_INCREF values are the caller's own, so they can't be kept in a reduced precision.");
+        return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+      }
       data_ptr->storage.storage_memory_type = ADJ_STORAGE_MEMORY_INCREF;
       data_ptr->storage.storage_memory_has_value = storage.storage_memory_has_value;
       data_ptr->storage.value = storage.value;
       data_ptr->storage.storage_memory_is_checkpoint = storage.storage_memory_is_checkpoint;
       break;
+    case ADJ_STORAGE_MEMORY_COMPRESSED:
+      ierr = adj_compress_value(adjointer, data_ptr, storage);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      data_ptr->storage.storage_memory_type = ADJ_STORAGE_MEMORY_COMPRESSED;
+      data_ptr->storage.storage_memory_has_value = storage.storage_memory_has_value;
+      data_ptr->storage.storage_memory_is_checkpoint = storage.storage_memory_is_checkpoint;
+      data_ptr->storage.compression = storage.compression;
+      data_ptr->storage.compression_tolerance = storage.compression_tolerance;
+      data_ptr->storage.precision = storage.precision;
+      break;
+    case ADJ_STORAGE_MEMORY_POD:
+      ierr = adj_pod_project_value(adjointer, data_ptr, adjointer->varentries[data_ptr->id]->variable, storage);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      data_ptr->storage.storage_memory_type = ADJ_STORAGE_MEMORY_POD;
+      data_ptr->storage.storage_memory_has_value = storage.storage_memory_has_value;
+      data_ptr->storage.storage_memory_is_checkpoint = storage.storage_memory_is_checkpoint;
+      break;
     default:
-      strncpy(adj_error_msg, "Memory storage types other than ADJ_STORAGE_MEMORY_COPY and ADJ_STORAGE_MEMORY_INCREF  are not implemented yet.", ADJ_ERROR_MSG_BUF);
+      strncpy(adj_error_msg, "Memory storage types other than ADJ_STORAGE_MEMORY_COPY, ADJ_STORAGE_MEMORY_INCREF, ADJ_STORAGE_MEMORY_COMPRESSED and ADJ_STORAGE_MEMORY_POD are not implemented yet.", ADJ_ERROR_MSG_BUF);
       return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
   }
 
-  return ADJ_OK;
+  ierr = adj_update_live_variable(adjointer, data_ptr);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* Values are only spilled here and in the forget routines: nobody holds on to the
+     vectors adj_get_variable_value handed out across either */
+  ierr = adj_memory_budget_charge(adjointer, data_ptr);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  return adj_memory_budget_enforce(adjointer);
 }
 
 /* The core routine to record a variable to disk */
 int adj_record_variable_core_disk(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data_ptr, adj_storage_data storage)
 {
+  int ierr;
+
   if (adjointer->callbacks.vec_write == NULL)
   {
     snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "You have asked to record a value to disk, but no ADJ_VEC_WRITE_CB callback has been provided.");
@@ -1221,9 +1535,10 @@ int adj_record_variable_core_disk(adj_adjointer* adjointer, adj_variable var, ad
 
   data_ptr->storage.storage_disk_has_value = storage.storage_disk_has_value;
   data_ptr->storage.storage_disk_is_checkpoint = storage.storage_disk_is_checkpoint;
-  adjointer->callbacks.vec_write(var, storage.value);
+  ierr = adj_write_behind_write(adjointer, data_ptr, var, storage.value);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  return ADJ_OK;
+  return adj_update_live_variable(adjointer, data_ptr);
 }
 
 int adj_record_variable_compare(adj_adjointer* adjointer, adj_variable_data* data_ptr, adj_variable var, adj_storage_data storage)
@@ -1231,7 +1546,9 @@ int adj_record_variable_compare(adj_adjointer* adjointer, adj_variable_data* dat
   if (data_ptr->storage.storage_memory_has_value && storage.compare)
   {
     adj_vector tmp;
+    adj_vector recorded;
     adj_scalar norm;
+    int ierr;
 
     if (adjointer->callbacks.vec_get_norm == NULL)
     {
@@ -1253,18 +1570,21 @@ int adj_record_variable_compare(adj_adjointer* adjointer, adj_variable_data* dat
       snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "You have asked to compare a value against one already recorded, but no ADJ_VEC_DESTROY_CB callback has been provided.");
       return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
     }
-    if (storage.storage_memory_type != ADJ_STORAGE_MEMORY_COPY && storage.storage_memory_type != ADJ_STORAGE_MEMORY_INCREF)
+    if (storage.storage_memory_type != ADJ_STORAGE_MEMORY_COPY && storage.storage_memory_type != ADJ_STORAGE_MEMORY_INCREF && storage.storage_memory_type != ADJ_STORAGE_MEMORY_COMPRESSED &&
+        storage.storage_memory_type != ADJ_STORAGE_MEMORY_POD)
     {
-      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, comparison of values hasn't been generalised to storage types other than ADJ_STORAGE_MEMORY_COPY and ADJ_STORAGE_MEMORY_INCREF yet.");
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, comparison of values hasn't been generalised to storage types other than ADJ_STORAGE_MEMORY_COPY, ADJ_STORAGE_MEMORY_INCREF, ADJ_STORAGE_MEMORY_COMPRESSED and ADJ_STORAGE_MEMORY_POD yet.");
       return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
       /* For future developers: the reason is that storage.value (used a few lines below) might not exist */
     }
 
-    adjointer->callbacks.vec_duplicate(data_ptr->storage.value, &tmp);
-    adjointer->callbacks.vec_axpy(&tmp, (adj_scalar)1.0, data_ptr->storage.value);
+    ierr = adj_storage_memory_value(adjointer, data_ptr, &recorded);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    adj_vec_pool_get(adjointer, recorded, &tmp);
+    adjointer->callbacks.vec_axpy(&tmp, (adj_scalar)1.0, recorded);
     adjointer->callbacks.vec_axpy(&tmp, (adj_scalar)-1.0, storage.value);
     adjointer->callbacks.vec_get_norm(tmp, &norm);
-    adjointer->callbacks.vec_destroy(&tmp);
+    adj_vec_pool_put(adjointer, &tmp);
 
     if (norm > storage.comparison_tolerance) /* Greater than, so that we can use a comparison tolerance of 0.0 */
     {
@@ -1288,6 +1608,8 @@ int adj_register_operator_callback(adj_adjointer* adjointer, int type, char* nam
 {
   adj_op_callback_list* cb_list_ptr;
   adj_op_callback* cb_ptr;
+  adj_callback_entry* entry;
+  int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
@@ -1314,20 +1636,24 @@ int adj_register_operator_callback(adj_adjointer* adjointer, int type, char* nam
     case ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB:
       cb_list_ptr = &(adjointer->nonlinear_derivative_outer_action_list);
       break;
+    case ADJ_BLOCK_ACTION_ACCUMULATE_CB:
+      cb_list_ptr = &(adjointer->block_action_accumulate_list);
+      break;
+    case ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB:
+      cb_list_ptr = &(adjointer->nonlinear_derivative_action_accumulate_list);
+      break;
     default:
       strncpy(adj_error_msg, "Unknown callback type.", ADJ_ERROR_MSG_BUF);
       return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
   /* First, we look for an existing callback data structure that might already exist, to replace the function */
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  ierr = adj_find_callback_entry(adjointer, name, ADJ_TRUE, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  cb_ptr = entry->operators[type-1];
+  if (cb_ptr != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      cb_ptr->callback = fn;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr->callback = fn;
+    return ADJ_OK;
   }
 
   /* If we got here, that means that we didn't find it. Tack it on to the end of the list. */
@@ -1336,6 +1662,7 @@ int adj_register_operator_callback(adj_adjointer* adjointer, int type, char* nam
   strncpy(cb_ptr->name, name, ADJ_NAME_LEN);
   cb_ptr->callback = fn;
   cb_ptr->next = NULL;
+  entry->operators[type-1] = cb_ptr;
 
   /* Special case for the first callback */
   if (cb_list_ptr->firstnode == NULL)
@@ -1397,6 +1724,12 @@ int adj_register_data_callback(adj_adjointer* adjointer, int type, void (*fn)(vo
     case ADJ_VEC_DELETE_CB:
       adjointer->callbacks.vec_delete = (void(*)(adj_variable var)) fn;
       break;
+    case ADJ_VEC_ZERO_CB:
+      adjointer->callbacks.vec_zero = (void(*)(adj_vector* x)) fn;
+      break;
+    case ADJ_VEC_WRAP_VALUES_CB:
+      adjointer->callbacks.vec_wrap_values = (void(*)(adj_vector model, adj_scalar scalars[], adj_vector* x)) fn;
+      break;
 
     case ADJ_MAT_DUPLICATE_CB:
       adjointer->callbacks.mat_duplicate = (void(*)(adj_matrix matin, adj_matrix *matout)) fn;
@@ -1413,6 +1746,9 @@ int adj_register_data_callback(adj_adjointer* adjointer, int type, void (*fn)(vo
     case ADJ_SOLVE_CB:
       adjointer->callbacks.solve = (void(*)(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector *soln)) fn;
       break;
+    case ADJ_SOLVE_MULTI_CB:
+      adjointer->callbacks.solve_multi = (void(*)(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns)) fn;
+      break;
 
    default:
       snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Unknown data callback type %d.", type);
@@ -1426,21 +1762,21 @@ int adj_register_functional_callback(adj_adjointer* adjointer, char* name, void
 {
   adj_func_callback_list* cb_list_ptr;
   adj_func_callback* cb_ptr;
+  adj_callback_entry* entry;
+  int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
   cb_list_ptr = &(adjointer->functional_list);
 
   /* First, we look for an existing callback data structure that might already exist, to replace the function */
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  ierr = adj_find_callback_entry(adjointer, name, ADJ_TRUE, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  cb_ptr = entry->functional;
+  if (cb_ptr != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      cb_ptr->callback = (void (*)(void* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)) fn;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr->callback = (void (*)(void* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)) fn;
+    return ADJ_OK;
   }
 
   /* If we got here, that means that we didn't find it. Tack it on to the end of the list. */
@@ -1450,6 +1786,7 @@ int adj_register_functional_callback(adj_adjointer* adjointer, char* name, void
   cb_ptr->name[ADJ_NAME_LEN-1] = '\0';
   cb_ptr->callback = (void (*)(void* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)) fn;
   cb_ptr->next = NULL;
+  entry->functional = cb_ptr;
 
   /* Special case for the first callback */
   if (cb_list_ptr->firstnode == NULL)
@@ -1470,21 +1807,21 @@ int adj_register_functional_derivative_callback(adj_adjointer* adjointer, char*
 {
   adj_func_deriv_callback_list* cb_list_ptr;
   adj_func_deriv_callback* cb_ptr;
+  adj_callback_entry* entry;
+  int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
   cb_list_ptr = &(adjointer->functional_derivative_list);
 
   /* First, we look for an existing callback data structure that might already exist, to replace the function */
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  ierr = adj_find_callback_entry(adjointer, name, ADJ_TRUE, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  cb_ptr = entry->functional_derivative;
+  if (cb_ptr != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)) fn;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)) fn;
+    return ADJ_OK;
   }
 
   /* If we got here, that means that we didn't find it. Tack it on to the end of the list. */
@@ -1493,6 +1830,7 @@ int adj_register_functional_derivative_callback(adj_adjointer* adjointer, char*
   strncpy(cb_ptr->name, name, ADJ_NAME_LEN);
   cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)) fn;
   cb_ptr->next = NULL;
+  entry->functional_derivative = cb_ptr;
 
   /* Special case for the first callback */
   if (cb_list_ptr->firstnode == NULL)
@@ -1513,21 +1851,21 @@ int adj_register_functional_second_derivative_callback(adj_adjointer* adjointer,
 {
   adj_func_second_deriv_callback_list* cb_list_ptr;
   adj_func_second_deriv_callback* cb_ptr;
+  adj_callback_entry* entry;
+  int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
   cb_list_ptr = &(adjointer->functional_second_derivative_list);
 
   /* First, we look for an existing callback data structure that might already exist, to replace the function */
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  ierr = adj_find_callback_entry(adjointer, name, ADJ_TRUE, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  cb_ptr = entry->functional_second_derivative;
+  if (cb_ptr != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output)) fn;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output)) fn;
+    return ADJ_OK;
   }
 
   /* If we got here, that means that we didn't find it. Tack it on to the end of the list. */
@@ -1536,6 +1874,7 @@ int adj_register_functional_second_derivative_callback(adj_adjointer* adjointer,
   strncpy(cb_ptr->name, name, ADJ_NAME_LEN);
   cb_ptr->callback = (void (*)(void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output)) fn;
   cb_ptr->next = NULL;
+  entry->functional_second_derivative = cb_ptr;
 
   /* Special case for the first callback */
   if (cb_list_ptr->firstnode == NULL)
@@ -1554,10 +1893,35 @@ int adj_register_functional_second_derivative_callback(adj_adjointer* adjointer,
 
 int adj_forget_adjoint_equation(adj_adjointer* adjointer, int equation)
 {
-  adj_variable_hash* varhash;
+  int ierr;
+
+  if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
+
+  /* Do not delete any variables if we want to compare forward variables with the revolve replay */
+  if (adjointer->revolve_data.overwrite == ADJ_TRUE)
+    return ADJ_OK;
+
+  if (equation >= adjointer->nequations)
+  {
+    strncpy(adj_error_msg, "No such equation.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  /* A variable can go once the adjoint equations it is needed for and the functional
+     right-hand-sides of its timesteps are solved, and nothing interpolated from it is needed
+     any more. Only the variables that expire here are looked at: see adj_expiry.c. */
+  ierr = adj_expiry_forget_adjoint(adjointer, equation);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* The values read back from disk for this equation are done with */
+  return adj_memory_budget_enforce(adjointer);
+}
+
+int adj_forget_adjoint_values(adj_adjointer* adjointer, int equation)
+{
+  int id, k;
   adj_variable_data* data;
   int should_we_delete;
-  int i;
   int ierr;
   int min_timestep;
 
@@ -1573,21 +1937,19 @@ int adj_forget_adjoint_equation(adj_adjointer* adjointer, int equation)
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
+  for (k = adjointer->nlive_variables - 1; k >= 0; k--)
   {
-    data = varhash->data;
+    id = adjointer->live_variables[k];
+    data = ADJ_VARIABLE_DATA(adjointer, id);
+    if (data->type != ADJ_ADJOINT)
+      continue;
+
     if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value)
     {
       should_we_delete = 1;
       /* Check the adjoint equations we could explicitly compute */
-      for (i = 0; i < data->nadjoint_equations; i++)
-      {
-        if (equation > data->adjoint_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
+      if (adj_has_unique_in_range(data->adjoint_equations, data->nadjoint_equations, INT_MIN, equation - 1))
+        should_we_delete = 0;
 
       /* Also check that it isn't necessary for any timesteps we still have to compute
          functional right-hand-sides for */
@@ -1609,83 +1971,7 @@ int adj_forget_adjoint_equation(adj_adjointer* adjointer, int equation)
         /* Forget only non-checkpoint variables */
         if (data->storage.storage_disk_has_value && !data->storage.storage_disk_is_checkpoint)
         {
-          ierr = adj_forget_variable_value_from_disk(adjointer, varhash->variable, data);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        }
-        if (data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint)
-        {
-          ierr = adj_forget_variable_value_from_memory(adjointer, data);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        }
-      }
-    }
-
-  }
-
-  return ADJ_OK;
-}
-
-int adj_forget_adjoint_values(adj_adjointer* adjointer, int equation)
-{
-  adj_variable_hash* varhash;
-  adj_variable_data* data;
-  int should_we_delete;
-  int i;
-  int ierr;
-  int min_timestep;
-
-  if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
-
-  /* Do not delete any variables if we want to compare forward variables with the revolve replay */
-  if (adjointer->revolve_data.overwrite == ADJ_TRUE)
-    return ADJ_OK;
-
-  if (equation >= adjointer->nequations)
-  {
-    strncpy(adj_error_msg, "No such equation.", ADJ_ERROR_MSG_BUF);
-    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
-  }
-
-  for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
-  {
-    data = varhash->data;
-    if (data->type != ADJ_ADJOINT)
-      continue;
-
-    if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value)
-    {
-      should_we_delete = 1;
-      /* Check the adjoint equations we could explicitly compute */
-      for (i = 0; i < data->nadjoint_equations; i++)
-      {
-        if (equation > data->adjoint_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      /* Also check that it isn't necessary for any timesteps we still have to compute
-         functional right-hand-sides for */
-      if (data->ndepending_timesteps > 0 && should_we_delete == 1)
-      {
-        int start_equation;
-        min_timestep = adj_minval(data->depending_timesteps, data->ndepending_timesteps);
-        ierr = adj_timestep_start_equation(adjointer, min_timestep, &start_equation);
-        assert(ierr == ADJ_OK);
-
-        if (equation > start_equation)
-        {
-          should_we_delete = 0;
-        }
-      }
-
-      if (should_we_delete)
-      {
-        /* Forget only non-checkpoint variables */
-        if (data->storage.storage_disk_has_value && !data->storage.storage_disk_is_checkpoint)
-        {
-          ierr = adj_forget_variable_value_from_disk(adjointer, varhash->variable, data);
+          ierr = adj_forget_variable_value_from_disk(adjointer, adjointer->varentries[id]->variable, data);
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
         }
         if (data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint)
@@ -1720,10 +2006,6 @@ int adj_forget_forward_equation(adj_adjointer* adjointer, int equation)
  */
 int adj_forget_forward_equation_until(adj_adjointer* adjointer, int equation, int last_equation)
 {
-  adj_variable_hash* varhash;
-  adj_variable_data* data;
-  int should_we_delete;
-  int i;
   int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
@@ -1734,104 +2016,21 @@ int adj_forget_forward_equation_until(adj_adjointer* adjointer, int equation, in
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
-  {
-      data = varhash->data;
-    /* Only forget forward variables */
-    /* FIXME: should this forget auxiliary forward variables too? */
-    if (data->type != ADJ_FORWARD || data->equation < 0) /* Skip adjoint or TLM variables. */
-      continue;
-
-    /* Only forget forward variables that are computed at equations <= equation */
-    if (data->equation>equation)
-      continue;
-
-    if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value)
-    {
-      should_we_delete = 1;
-      /* Check the forward equations we could explicitly compute */
-      for (i = 0; i < data->ntargeting_equations; i++)
-      {
-
-        /* If the variable is a target variable for one of the equations
-         * of interest then we keep it.
-         */
-        if (equation < data->targeting_equations[i] && data->targeting_equations[i] <= last_equation)
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->ndepending_equations; i++)
-      {
-        if (equation < data->depending_equations[i] && data->depending_equations[i] <= last_equation)
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->ndepending_timesteps; i++)
-      {
-        int timestep = data->depending_timesteps[i];
-        int max_eqn;
-        int min_eqn = adjointer->timestep_data[timestep].start_equation;
-
-        if (timestep == adjointer->ntimesteps - 1)
-        {
-          max_eqn = adjointer->nequations;
-        }
-        else
-        {
-          max_eqn  = adjointer->timestep_data[timestep+1].start_equation - 1;
-        }
-
-        if (equation <= max_eqn && min_eqn <= last_equation )
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      /* Also check that it isn't necessary for any timesteps we still have to compute
-         right-hand-sides for */
-      for (i = 0; i < data->nrhs_equations; i++)
-      {
-        if (equation < data->rhs_equations[i] && data->rhs_equations[i] <= last_equation)
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      if (should_we_delete)
-      {
-        /* Forget only non-checkpoint variables */
-        if (data->storage.storage_disk_has_value && !data->storage.storage_disk_is_checkpoint)
-        {
-          ierr = adj_forget_variable_value_from_disk(adjointer, varhash->variable, data);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        }
-        if (data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint)
-        {
-          ierr = adj_forget_variable_value_from_memory(adjointer, data);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        }
-      }
-    }
-
-  }
+  /* A forward variable computed at or before equation can go once no equation up to last_equation
+     targets it, depends on it or needs it on the right-hand side, and no functional evaluation
+     of a timestep in between needs it. Only the variables that expire here are looked at: see adj_expiry.c. */
+  /* FIXME: should this forget auxiliary forward variables too? */
+  ierr = adj_expiry_forget_forward(adjointer, equation, last_equation);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  return ADJ_OK;
+  return adj_memory_budget_enforce(adjointer);
 }
 
 int adj_forget_tlm_equation(adj_adjointer* adjointer, int equation)
 {
-  adj_variable_hash* varhash;
+  int id, k;
   adj_variable_data* data;
   int should_we_delete;
-  int i;
   int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
@@ -1842,42 +2041,21 @@ int adj_forget_tlm_equation(adj_adjointer* adjointer, int equation)
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
+  for (k = adjointer->nlive_variables - 1; k >= 0; k--)
   {
-    data = varhash->data;
+    id = adjointer->live_variables[k];
+    data = ADJ_VARIABLE_DATA(adjointer, id);
 
     if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value)
     {
       should_we_delete = 1;
-      for (i = 0; i < data->ntargeting_equations; i++)
-      {
-        /* If the variable is a target variable for one of the equations
-         * of interest then we keep it.
-         */
-        if (equation < data->targeting_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->ndepending_equations; i++)
-      {
-        if (equation < data->depending_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->nrhs_equations; i++)
-      {
-        if (equation < data->rhs_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
+      /* If the variable is a target variable for one of the equations
+       * of interest then we keep it.
+       */
+      if (adj_has_unique_in_range(data->targeting_equations, data->ntargeting_equations, equation + 1, INT_MAX) ||
+          adj_has_unique_in_range(data->depending_equations, data->ndepending_equations, equation + 1, INT_MAX) ||
+          adj_has_unique_in_range(data->rhs_equations, data->nrhs_equations, equation + 1, INT_MAX))
+        should_we_delete = 0;
 
       if (should_we_delete)
       {
@@ -1896,10 +2074,9 @@ int adj_forget_tlm_equation(adj_adjointer* adjointer, int equation)
 
 int adj_forget_tlm_values(adj_adjointer* adjointer, int equation)
 {
-  adj_variable_hash* varhash;
+  int id, k;
   adj_variable_data* data;
   int should_we_delete;
-  int i;
   int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
@@ -1910,9 +2087,10 @@ int adj_forget_tlm_values(adj_adjointer* adjointer, int equation)
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
+  for (k = adjointer->nlive_variables - 1; k >= 0; k--)
   {
-    data = varhash->data;
+    id = adjointer->live_variables[k];
+    data = ADJ_VARIABLE_DATA(adjointer, id);
 
     if (data->type != ADJ_TLM)
       continue;
@@ -1920,35 +2098,13 @@ int adj_forget_tlm_values(adj_adjointer* adjointer, int equation)
     if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value)
     {
       should_we_delete = 1;
-      for (i = 0; i < data->ntargeting_equations; i++)
-      {
-        /* If the variable is a target variable for one of the equations
-         * of interest then we keep it.
-         */
-        if (equation < data->targeting_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->ndepending_equations; i++)
-      {
-        if (equation < data->depending_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
-
-      for (i = 0; i < data->nrhs_equations; i++)
-      {
-        if (equation < data->rhs_equations[i])
-        {
-          should_we_delete = 0;
-          break;
-        }
-      }
+      /* If the variable is a target variable for one of the equations
+       * of interest then we keep it.
+       */
+      if (adj_has_unique_in_range(data->targeting_equations, data->ntargeting_equations, equation + 1, INT_MAX) ||
+          adj_has_unique_in_range(data->depending_equations, data->ndepending_equations, equation + 1, INT_MAX) ||
+          adj_has_unique_in_range(data->rhs_equations, data->nrhs_equations, equation + 1, INT_MAX))
+        should_we_delete = 0;
 
       if (should_we_delete)
       {
@@ -1965,74 +2121,83 @@ int adj_forget_tlm_values(adj_adjointer* adjointer, int equation)
   return ADJ_OK;
 }
 
+int adj_find_callback_entry(adj_adjointer* adjointer, char* name, int create, adj_callback_entry** entry)
+{
+  int ierr;
+  int id;
+  adj_callback_entry* check;
+
+  ierr = adj_intern_name(name, create, &id);
+  if (ierr != ADJ_OK) return ierr;
+
+  HASH_FIND_INT(adjointer->callback_hash, &id, check);
+  if (check == NULL)
+  {
+    if (!create)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "No callbacks have been registered for %s.", name);
+      return ADJ_ERR_HASH_FAILED;
+    }
+
+    check = (adj_callback_entry*) malloc(sizeof(adj_callback_entry));
+    ADJ_CHKMALLOC(check);
+    memset(check, 0, sizeof(adj_callback_entry));
+    check->name = id;
+    HASH_ADD_INT(adjointer->callback_hash, name, check);
+  }
+
+  *entry = check;
+  return ADJ_OK;
+}
+
 int adj_find_operator_callback(adj_adjointer* adjointer, int type, char* name, void (**fn)(void))
 {
-  adj_op_callback_list* cb_list_ptr;
-  adj_op_callback* cb_ptr;
+  adj_callback_entry* entry;
 
-  char adj_callback_types[7][ADJ_ERROR_MSG_BUF] = {"ADJ_NBLOCK_ACTION_CB", "ADJ_NBLOCK_DERIVATIVE_ACTION_CB",
+  char adj_callback_types[ADJ_NO_OPERATOR_CALLBACKS][ADJ_ERROR_MSG_BUF] = {"ADJ_NBLOCK_ACTION_CB", "ADJ_NBLOCK_DERIVATIVE_ACTION_CB",
                                                    "ADJ_NBLOCK_DERIVATIVE_ASSEMBLY_CB", "ADJ_BLOCK_ACTION_CB", "ADJ_BLOCK_ASSEMBLY_CB",
-                                                   "ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB", "ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB"};
+                                                   "ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB", "ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB",
+                                                   "ADJ_BLOCK_ACTION_ACCUMULATE_CB", "ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB"};
 
-  switch(type)
+  if (type < 1 || type > ADJ_NO_OPERATOR_CALLBACKS)
   {
-    case ADJ_NBLOCK_ACTION_CB:
-      cb_list_ptr = &(adjointer->nonlinear_action_list);
-      break;
-    case ADJ_NBLOCK_DERIVATIVE_ACTION_CB:
-      cb_list_ptr = &(adjointer->nonlinear_derivative_action_list);
-      break;
-    case ADJ_NBLOCK_DERIVATIVE_ASSEMBLY_CB:
-      cb_list_ptr = &(adjointer->nonlinear_derivative_assembly_list);
-      break;
-    case ADJ_BLOCK_ACTION_CB:
-      cb_list_ptr = &(adjointer->block_action_list);
-      break;
-    case ADJ_BLOCK_ASSEMBLY_CB:
-      cb_list_ptr = &(adjointer->block_assembly_list);
-      break;
-    case ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB:
-      cb_list_ptr = &(adjointer->nonlinear_second_derivative_action_list);
-      break;
-    case ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB:
-      cb_list_ptr = &(adjointer->nonlinear_derivative_outer_action_list);
-      break;
-    default:
-      strncpy(adj_error_msg, "Unknown callback type.", ADJ_ERROR_MSG_BUF);
-      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    strncpy(adj_error_msg, "Unknown callback type.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  if (adj_find_callback_entry(adjointer, name, ADJ_FALSE, &entry) == ADJ_OK && entry->operators[type-1] != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      *fn = cb_ptr->callback;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    *fn = entry->operators[type-1]->callback;
+    return ADJ_OK;
   }
 
   snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Could not find callback %s for operator %s.", adj_callback_types[type-1], name);
   return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
 }
 
+int adj_find_cached_operator_callback(adj_adjointer* adjointer, int type, adj_callback_entry* cache, char* name, void (**fn)(void))
+{
+  /* Blocks registered with an equation carry the adjointer's callback entry for their name,
+     so in the common case there is no lookup to do at all */
+  if (cache != NULL && cache->operators[type-1] != NULL)
+  {
+    *fn = cache->operators[type-1]->callback;
+    return ADJ_OK;
+  }
+
+  return adj_find_operator_callback(adjointer, type, name, fn);
+}
+
 int adj_find_functional_callback(adj_adjointer* adjointer, char* name, void (**fn)(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output))
 {
-  adj_func_callback_list* cb_list_ptr;
   adj_func_callback* cb_ptr;
+  adj_callback_entry* entry;
 
-  cb_list_ptr = &(adjointer->functional_list);
-
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  if (adj_find_callback_entry(adjointer, name, ADJ_FALSE, &entry) == ADJ_OK && entry->functional != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      *fn = (void (*)(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)) cb_ptr->callback;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr = entry->functional;
+    *fn = (void (*)(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)) cb_ptr->callback;
+    return ADJ_OK;
   }
 
   snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Could not find functional callback %s.", name);
@@ -2041,20 +2206,14 @@ int adj_find_functional_callback(adj_adjointer* adjointer, char* name, void (**f
 
 int adj_find_functional_derivative_callback(adj_adjointer* adjointer, char* name, void (**fn)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output))
 {
-  adj_func_deriv_callback_list* cb_list_ptr;
   adj_func_deriv_callback* cb_ptr;
+  adj_callback_entry* entry;
 
-  cb_list_ptr = &(adjointer->functional_derivative_list);
-
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  if (adj_find_callback_entry(adjointer, name, ADJ_FALSE, &entry) == ADJ_OK && entry->functional_derivative != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      *fn = (void (*)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)) cb_ptr->callback;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr = entry->functional_derivative;
+    *fn = (void (*)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)) cb_ptr->callback;
+    return ADJ_OK;
   }
 
   snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Could not find functional derivative callback %s.", name);
@@ -2063,20 +2222,14 @@ int adj_find_functional_derivative_callback(adj_adjointer* adjointer, char* name
 
 int adj_find_functional_second_derivative_callback(adj_adjointer* adjointer, char* name, void (**fn)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output))
 {
-  adj_func_second_deriv_callback_list* cb_list_ptr;
   adj_func_second_deriv_callback* cb_ptr;
+  adj_callback_entry* entry;
 
-  cb_list_ptr = &(adjointer->functional_second_derivative_list);
-
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  if (adj_find_callback_entry(adjointer, name, ADJ_FALSE, &entry) == ADJ_OK && entry->functional_second_derivative != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      *fn = (void (*)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output)) cb_ptr->callback;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr = entry->functional_second_derivative;
+    *fn = (void (*)(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_vector contraction, char* name, adj_vector* output)) cb_ptr->callback;
+    return ADJ_OK;
   }
 
   snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Could not find functional second derivative callback %s.", name);
@@ -2086,11 +2239,18 @@ int adj_find_functional_second_derivative_callback(adj_adjointer* adjointer, cha
 int adj_get_variable_value(adj_adjointer* adjointer, adj_variable var, adj_vector* value)
 {
   int ierr;
+  int found;
   adj_variable_data* data_ptr;
 
   ierr = adj_find_variable_data(&(adjointer->varhash), &var, &data_ptr);
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
+  if (!data_ptr->storage.storage_memory_has_value && !data_ptr->storage.storage_disk_has_value && data_ptr->storage.interpolated)
+  {
+    ierr = adj_interpolate_value(adjointer, var, data_ptr);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
   if (!data_ptr->storage.storage_memory_has_value && !data_ptr->storage.storage_disk_has_value)
   {
     char buf[ADJ_NAME_LEN];
@@ -2104,28 +2264,56 @@ int adj_get_variable_value(adj_adjointer* adjointer, adj_variable var, adj_vecto
   /* Memory storage */
   if (data_ptr->storage.storage_memory_has_value)
   {
-   *value = data_ptr->storage.value;
-   return ADJ_OK;
+    ierr = adj_storage_memory_value(adjointer, data_ptr, value);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    return ADJ_OK;
   }
   /* Disk storage */
   else if(data_ptr->storage.storage_disk_has_value)
   {
-    if (adjointer->callbacks.vec_read == NULL)
+    ierr = adj_tiers_read(adjointer, data_ptr, var, value, &found);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    if (!found && adjointer->callbacks.vec_read == NULL)
     {
       snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "You have asked to get a value from disk, but no ADJ_VEC_READ_CB callback has been provided.");
       return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
     }
-    adjointer->callbacks.vec_read(var, value);
+    if (!found)
+    {
+      ierr = adj_write_behind_read(adjointer, data_ptr, value, &found);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (!found)
+    {
+      ierr = adj_prefetch_take(adjointer, data_ptr, value, &found);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (!found)
+    {
+      ierr = adj_disk_store_map(adjointer, data_ptr, var, value, &found);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (!found)
+      adjointer->callbacks.vec_read(var, value);
     data_ptr->storage.storage_memory_has_value = ADJ_TRUE;
     data_ptr->storage.value = *value;
+    /* Charged now, but only spilled again at the next recording or forget call, as the caller
+       may still be holding on to the other values it asked for */
+    ierr = adj_memory_budget_charge(adjointer, data_ptr);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   }
   return ADJ_OK;
 }
 
 int adj_has_variable_value(adj_adjointer* adjointer, adj_variable var)
 {
+  adj_variable_data* data_ptr;
+
   if((adj_has_variable_value_memory(adjointer, var) == ADJ_OK) || (adj_has_variable_value_disk(adjointer, var) == ADJ_OK))
     return ADJ_OK;
+  /* Values interpolated in time are there for the asking */
+  else if (adj_find_variable_data(&(adjointer->varhash), &var, &data_ptr) == ADJ_OK && data_ptr->storage.interpolated)
+    return ADJ_OK;
   else
     return adj_chkierr_auto(ADJ_ERR_NEED_VALUE);
 }
@@ -2223,6 +2411,17 @@ int adj_forget_variable_value(adj_adjointer* adjointer, adj_variable var, adj_va
 
 int adj_forget_variable_value_from_disk(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data)
 {
+  int ierr, found;
+
+  /* A checkpoint on a storage tier goes with that tier's callbacks */
+  ierr = adj_tiers_delete(adjointer, data, var, &found);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (found)
+  {
+    data->storage.storage_disk_has_value = ADJ_FALSE;
+    return adj_update_live_variable(adjointer, data);
+  }
+
   if (adjointer->callbacks.vec_delete == NULL)
   {
     strncpy(adj_error_msg, "Need ADJ_VEC_DELETE_CB data callback.", ADJ_ERROR_MSG_BUF);
@@ -2231,9 +2430,15 @@ int adj_forget_variable_value_from_disk(adj_adjointer* adjointer, adj_variable v
 
   assert(data->storage.storage_disk_has_value);
 
+  /* Don't let the background threads touch a file we are about to delete */
+  ierr = adj_prefetch_cancel(adjointer, data);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_write_behind_wait(adjointer, data);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
   data->storage.storage_disk_has_value = ADJ_FALSE;
   adjointer->callbacks.vec_delete(var);
-  return ADJ_OK;
+  return adj_update_live_variable(adjointer, data);
 }
 
 int adj_forget_variable_value_from_memory(adj_adjointer* adjointer, adj_variable_data* data)
@@ -2247,8 +2452,52 @@ int adj_forget_variable_value_from_memory(adj_adjointer* adjointer, adj_variable
   assert(data->storage.storage_memory_has_value);
 
   data->storage.storage_memory_has_value = ADJ_FALSE;
-  adjointer->callbacks.vec_destroy(&(data->storage.value));
-  return ADJ_OK;
+  if (data->storage.compressed != NULL)
+    adj_destroy_compressed_value(adjointer, data);
+  else if (data->storage.pod != NULL)
+    adj_destroy_pod_value(adjointer, data);
+  else if (data->storage.shared != NULL)
+    adj_dedup_release(adjointer, data);
+  else
+    adjointer->callbacks.vec_destroy(&(data->storage.value));
+  adj_disk_store_unmap(data);
+  adj_memory_budget_release(adjointer, data);
+  return adj_update_live_variable(adjointer, data);
+}
+
+/* Keep adjointer->live_variables, the memory budget heap and the expiry buckets in step with whether data holds a value anywhere.
+   Call this whenever the has_value or is_checkpoint flags of an adjointer's variable change. */
+int adj_update_live_variable(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  int live = data->storage.storage_memory_has_value || data->storage.storage_disk_has_value;
+  int ierr;
+
+  if (data->id < 0) return ADJ_OK;
+
+  if (live && data->live_index < 0)
+  {
+    if (adjointer->nlive_variables == adjointer->live_variables_sz)
+    {
+      int new_sz = (adjointer->live_variables_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * adjointer->live_variables_sz;
+      adjointer->live_variables = (int*) realloc(adjointer->live_variables, new_sz * sizeof(int));
+      ADJ_CHKMALLOC(adjointer->live_variables);
+      adjointer->live_variables_sz = new_sz;
+    }
+    data->live_index = adjointer->nlive_variables;
+    adjointer->live_variables[adjointer->nlive_variables++] = data->id;
+  }
+  else if (!live && data->live_index >= 0)
+  {
+    /* Move the last live variable into the hole */
+    int last = adjointer->live_variables[--adjointer->nlive_variables];
+    adjointer->live_variables[data->live_index] = last;
+    ADJ_VARIABLE_DATA(adjointer, last)->live_index = data->live_index;
+    data->live_index = -1;
+  }
+
+  ierr = adj_memory_budget_update(adjointer, data);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  return adj_expiry_update(adjointer, data);
 }
 
 int adj_destroy_variable_data(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data)
@@ -2320,6 +2569,44 @@ int adj_storage_memory_incref(adj_vector value, adj_storage_data* data)
   return ADJ_OK;
 }
 
+int adj_storage_memory_compressed(adj_vector value, adj_storage_data* data)
+{
+  memset(data, 0, sizeof(adj_storage_data));
+
+  data->storage_memory_has_value = ADJ_TRUE;
+  data->storage_memory_type = ADJ_STORAGE_MEMORY_COMPRESSED;
+  data->value = value;
+  data->compression = ADJ_COMPRESSION_LOSSLESS;
+  data->compression_tolerance = (adj_scalar)0.0;
+
+  data->storage_disk_has_value = ADJ_FALSE;
+
+  data->compare = ADJ_FALSE;
+  data->comparison_tolerance = (adj_scalar)0.0;
+  data->overwrite = ADJ_FALSE;
+  data->storage_memory_is_checkpoint = ADJ_FALSE;
+  data->storage_disk_is_checkpoint = ADJ_FALSE;
+  return ADJ_OK;
+}
+
+int adj_storage_memory_pod(adj_vector value, adj_storage_data* data)
+{
+  memset(data, 0, sizeof(adj_storage_data));
+
+  data->storage_memory_has_value = ADJ_TRUE;
+  data->storage_memory_type = ADJ_STORAGE_MEMORY_POD;
+  data->value = value;
+
+  data->storage_disk_has_value = ADJ_FALSE;
+
+  data->compare = ADJ_FALSE;
+  data->comparison_tolerance = (adj_scalar)0.0;
+  data->overwrite = ADJ_FALSE;
+  data->storage_memory_is_checkpoint = ADJ_FALSE;
+  data->storage_disk_is_checkpoint = ADJ_FALSE;
+  return ADJ_OK;
+}
+
 int adj_storage_disk(adj_vector value, adj_storage_data* data)
 {
   memset(data, 0, sizeof(adj_storage_data));
@@ -2417,6 +2704,36 @@ int adj_storage_set_checkpoint(adj_storage_data* data, int checkpoint)
   return ADJ_OK;
 }
 
+int adj_storage_set_compression(adj_storage_data* data, int compression, adj_scalar tolerance)
+{
+  if (compression != ADJ_COMPRESSION_LOSSLESS && compression != ADJ_COMPRESSION_LOSSY)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "compression must either be ADJ_COMPRESSION_LOSSLESS or ADJ_COMPRESSION_LOSSY.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (compression == ADJ_COMPRESSION_LOSSY && !(tolerance > 0.0))
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Lossy compression needs a positive tolerance, but got %e.", tolerance);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  data->compression = compression;
+  data->compression_tolerance = tolerance;
+  return ADJ_OK;
+}
+
+int adj_storage_set_precision(adj_storage_data* data, int precision)
+{
+  if (precision != ADJ_PRECISION_DOUBLE && precision != ADJ_PRECISION_SINGLE && precision != ADJ_PRECISION_BFLOAT16)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "precision must be one of ADJ_PRECISION_DOUBLE, ADJ_PRECISION_SINGLE or ADJ_PRECISION_BFLOAT16.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  data->precision = precision;
+  return ADJ_OK;
+}
+
 int adj_add_new_hash_entry(adj_adjointer* adjointer, adj_variable* var, adj_variable_data** data)
 {
   int ierr;
@@ -2438,14 +2755,37 @@ int adj_add_new_hash_entry(adj_adjointer* adjointer, adj_variable* var, adj_vari
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
-  *data = (adj_variable_data*) malloc(sizeof(adj_variable_data));
-  ADJ_CHKMALLOC(*data);
+  /* Hand out the next dense id; the data records live in fixed-size chunks, so that
+     pointers to them stay valid as the tape grows and full-tape scans walk contiguous memory */
+  if (adjointer->nvariables == adjointer->variables_sz)
+  {
+    int nchunks = adjointer->variables_sz / ADJ_VARDATA_CHUNK_SIZE;
+
+    adjointer->vardata_chunks = (adj_variable_data**) realloc(adjointer->vardata_chunks, (nchunks + 1) * sizeof(adj_variable_data*));
+    ADJ_CHKMALLOC(adjointer->vardata_chunks);
+    adjointer->vardata_chunks[nchunks] = (adj_variable_data*) malloc(ADJ_VARDATA_CHUNK_SIZE * sizeof(adj_variable_data));
+    ADJ_CHKMALLOC(adjointer->vardata_chunks[nchunks]);
+    adjointer->varentries = (adj_variable_hash**) realloc(adjointer->varentries, (adjointer->variables_sz + ADJ_VARDATA_CHUNK_SIZE) * sizeof(adj_variable_hash*));
+    ADJ_CHKMALLOC(adjointer->varentries);
+    adjointer->variables_sz += ADJ_VARDATA_CHUNK_SIZE;
+  }
+
+  *data = ADJ_VARIABLE_DATA(adjointer, adjointer->nvariables);
   memset(*data, 0, sizeof(adj_variable_data));
+  (*data)->id = adjointer->nvariables;
+  (*data)->live_index = -1;
+  (*data)->memory_size = 0;
+  (*data)->mapping = NULL;
+  (*data)->mapping_size = 0;
   (*data)->equation = -1;
   (*data)->next = NULL;
   (*data)->storage.storage_memory_has_value = 0;
   (*data)->storage.storage_memory_type = ADJ_UNSET;
   (*data)->storage.storage_disk_has_value = 0;
+  (*data)->storage.compressed = NULL;
+  (*data)->storage.pod = NULL;
+  (*data)->storage.interpolated = ADJ_FALSE;
+  (*data)->storage.shared = NULL;
   (*data)->ntargeting_equations = 0;
   (*data)->targeting_equations = NULL;
   (*data)->ndepending_equations = 0;
@@ -2458,8 +2798,9 @@ int adj_add_new_hash_entry(adj_adjointer* adjointer, adj_variable* var, adj_vari
   (*data)->adjoint_equations = NULL;
 
   /* add to the hash table */
-  ierr = adj_add_variable_data(&(adjointer->varhash), var, *data);
+  ierr = adj_add_variable_data_entry(&(adjointer->varhash), var, *data, &(adjointer->varentries[adjointer->nvariables]));
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  adjointer->nvariables++;
 
   return ADJ_OK;
 }
@@ -2674,7 +3015,7 @@ int adj_timestep_set_functional_dependencies(adj_adjointer* adjointer, int times
 
       if (other_data_ptr->equation >= 0)
       {
-        ierr = adj_append_unique(&(data_ptr->adjoint_equations), &(data_ptr->nadjoint_equations), other_data_ptr->equation);
+        ierr = adj_append_adjoint_equation(adjointer, data_ptr, other_data_ptr->equation);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
       }
     }
@@ -2683,19 +3024,164 @@ int adj_timestep_set_functional_dependencies(adj_adjointer* adjointer, int times
   return ADJ_OK;
 }
 
+/* The equation and timestep lists in adj_variable_data are kept as sorted sets of ints.
+   Their capacity is not stored: a list of size n > 0 always has room for the next power
+   of two >= n entries, so we only have to reallocate when the size hits a power of two. */
 int adj_append_unique(int** array, int* array_sz, int value)
 {
-  int i;
+  int lo;
+  int hi;
+  int n = *array_sz;
 
-  for (i = 0; i < *array_sz; i++)
-    if ((*array)[i] == value)
+  /* Binary search for the insertion point; the common case of appending a new
+     largest value (e.g. the equation we are registering right now) is checked first */
+  if (n == 0 || (*array)[n - 1] < value)
+  {
+    lo = n;
+  }
+  else
+  {
+    lo = 0;
+    hi = n;
+    while (lo < hi)
+    {
+      int mid = lo + (hi - lo) / 2;
+      if ((*array)[mid] < value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if ((*array)[lo] == value)
       return ADJ_OK;
+  }
+
+  /* So if we got here, we really do need to insert it */
+  if ((n & (n - 1)) == 0) /* n is zero or a power of two, so the list is full */
+  {
+    *array = (int*) realloc(*array, (n == 0 ? 1 : 2 * n) * sizeof(int));
+    ADJ_CHKMALLOC(*array);
+  }
+  memmove(*array + lo + 1, *array + lo, (n - lo) * sizeof(int));
+  (*array)[lo] = value;
+  *array_sz = n + 1;
+  return ADJ_OK;
+}
+
+/* Does the sorted set contain any value in [lower, upper]? */
+int adj_has_unique_in_range(int* array, int array_sz, int lower, int upper)
+{
+  int lo = 0;
+  int hi = array_sz;
+
+  while (lo < hi)
+  {
+    int mid = lo + (hi - lo) / 2;
+    if (array[mid] < lower)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return (lo < array_sz && array[lo] <= upper);
+}
+
+/* The reverse of adj_variable_data.adjoint_equations: for each equation, the ids of the variables
+   its adjoint equation needs, in the order they were found to */
+typedef struct
+{
+  int nids;
+  int ids_sz;
+  int* ids;
+} adj_adjoint_needs_list;
 
-  /* So if we got here, we really do need to append it */
-  *array_sz = *array_sz + 1;
-  *array = (int*) realloc(*array, *array_sz * sizeof(int));
-  ADJ_CHKMALLOC(*array);
-  (*array)[*array_sz - 1] = value;
+struct adj_adjoint_needs
+{
+  int nequations;
+  adj_adjoint_needs_list* equations;
+};
+
+/* Record that the adjoint of equation needs data, in data->adjoint_equations and the reverse index */
+int adj_append_adjoint_equation(adj_adjointer* adjointer, adj_variable_data* data, int equation)
+{
+  adj_adjoint_needs_list* list;
+  int nadjoint_equations = data->nadjoint_equations;
+  int new_sz, i, ierr;
+
+  ierr = adj_append_unique(&(data->adjoint_equations), &(data->nadjoint_equations), equation);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (data->nadjoint_equations == nadjoint_equations || equation < 0) return ADJ_OK;
+
+  if (adjointer->adjoint_needs == NULL)
+  {
+    adjointer->adjoint_needs = (struct adj_adjoint_needs*) malloc(sizeof(struct adj_adjoint_needs));
+    ADJ_CHKMALLOC(adjointer->adjoint_needs);
+    adjointer->adjoint_needs->nequations = 0;
+    adjointer->adjoint_needs->equations = NULL;
+  }
+  if (equation >= adjointer->adjoint_needs->nequations)
+  {
+    new_sz = (adjointer->adjoint_needs->nequations == 0) ? ADJ_PREALLOC_SIZE : 2 * adjointer->adjoint_needs->nequations;
+    if (new_sz <= equation) new_sz = equation + 1;
+    adjointer->adjoint_needs->equations = (adj_adjoint_needs_list*) realloc(adjointer->adjoint_needs->equations, new_sz * sizeof(adj_adjoint_needs_list));
+    ADJ_CHKMALLOC(adjointer->adjoint_needs->equations);
+    for (i = adjointer->adjoint_needs->nequations; i < new_sz; i++)
+    {
+      adjointer->adjoint_needs->equations[i].nids = 0;
+      adjointer->adjoint_needs->equations[i].ids_sz = 0;
+      adjointer->adjoint_needs->equations[i].ids = NULL;
+    }
+    adjointer->adjoint_needs->nequations = new_sz;
+  }
+
+  list = &(adjointer->adjoint_needs->equations[equation]);
+  if (list->nids == list->ids_sz)
+  {
+    new_sz = (list->ids_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * list->ids_sz;
+    list->ids = (int*) realloc(list->ids, new_sz * sizeof(int));
+    ADJ_CHKMALLOC(list->ids);
+    list->ids_sz = new_sz;
+  }
+  list->ids[list->nids++] = data->id;
+  return ADJ_OK;
+}
+
+/* The ids of the variables the adjoint of equation needs; the list belongs to the adjointer */
+void adj_adjoint_equation_needs(adj_adjointer* adjointer, int equation, int* nids, int** ids)
+{
+  if (adjointer->adjoint_needs == NULL || equation < 0 || equation >= adjointer->adjoint_needs->nequations)
+  {
+    *nids = 0;
+    *ids = NULL;
+    return;
+  }
+  *nids = adjointer->adjoint_needs->equations[equation].nids;
+  *ids = adjointer->adjoint_needs->equations[equation].ids;
+}
+
+int adj_destroy_adjoint_needs(adj_adjointer* adjointer)
+{
+  int i;
+
+  if (adjointer->adjoint_needs == NULL) return ADJ_OK;
+
+  for (i = 0; i < adjointer->adjoint_needs->nequations; i++)
+    free(adjointer->adjoint_needs->equations[i].ids);
+  free(adjointer->adjoint_needs->equations);
+  free(adjointer->adjoint_needs);
+  adjointer->adjoint_needs = NULL;
+  return ADJ_OK;
+}
+
+int adj_copy_unique(int* src, int src_sz, int** dest, int* dest_sz)
+{
+  int capacity = 1;
+
+  while (capacity < src_sz)
+    capacity *= 2;
+
+  *dest = (int*) malloc(capacity * sizeof(int));
+  ADJ_CHKMALLOC(*dest);
+  memcpy(*dest, src, src_sz * sizeof(int));
+  *dest_sz = src_sz;
   return ADJ_OK;
 }
 
@@ -2847,20 +3333,14 @@ int adj_variable_known(adj_adjointer* adjointer, adj_variable var, int* known)
 
 int adj_find_parameter_source_callback(adj_adjointer* adjointer, char* parameter, void (**fn)(adj_adjointer* adjointer, int equation, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output))
 {
-  adj_parameter_source_callback_list* cb_list_ptr;
   adj_parameter_source_callback* cb_ptr;
+  adj_callback_entry* entry;
 
-  cb_list_ptr = &(adjointer->parameter_source_list);
-
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  if (adj_find_callback_entry(adjointer, parameter, ADJ_FALSE, &entry) == ADJ_OK && entry->parameter_source != NULL)
   {
-    if (strncmp(cb_ptr->name, parameter, ADJ_NAME_LEN) == 0)
-    {
-      *fn = (void (*)(adj_adjointer* adjointer, int equation, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output)) cb_ptr->callback;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr = entry->parameter_source;
+    *fn = (void (*)(adj_adjointer* adjointer, int equation, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output)) cb_ptr->callback;
+    return ADJ_OK;
   }
 
   snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Could not find parameter source callback %s.", parameter);
@@ -2871,21 +3351,21 @@ int adj_register_parameter_source_callback(adj_adjointer* adjointer, char* name,
 {
   adj_parameter_source_callback_list* cb_list_ptr;
   adj_parameter_source_callback* cb_ptr;
+  adj_callback_entry* entry;
+  int ierr;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING) return ADJ_OK;
 
   cb_list_ptr = &(adjointer->parameter_source_list);
 
   /* First, we look for an existing callback data structure that might already exist, to replace the function */
-  cb_ptr = cb_list_ptr->firstnode;
-  while (cb_ptr != NULL)
+  ierr = adj_find_callback_entry(adjointer, name, ADJ_TRUE, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  cb_ptr = entry->parameter_source;
+  if (cb_ptr != NULL)
   {
-    if (strncmp(cb_ptr->name, name, ADJ_NAME_LEN) == 0)
-    {
-      cb_ptr->callback = (void (*)(void* adjointer, int equation, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output)) fn;
-      return ADJ_OK;
-    }
-    cb_ptr = cb_ptr->next;
+    cb_ptr->callback = (void (*)(void* adjointer, int equation, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output)) fn;
+    return ADJ_OK;
   }
 
   /* If we got here, that means that we didn't find it. Tack it on to the end of the list. */
@@ -2894,6 +3374,7 @@ int adj_register_parameter_source_callback(adj_adjointer* adjointer, char* name,
   strncpy(cb_ptr->name, name, ADJ_NAME_LEN);
   cb_ptr->callback = (void (*)(void* adjointer, int equation, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output, int* has_output)) fn;
   cb_ptr->next = NULL;
+  entry->parameter_source = cb_ptr;
 
   /* Special case for the first callback */
   if (cb_list_ptr->firstnode == NULL)
@@ -2912,6 +3393,14 @@ int adj_register_parameter_source_callback(adj_adjointer* adjointer, char* name,
 
 int adj_set_finished(adj_adjointer* adjointer, int  finished)
 {
+  int ierr;
+
+  /* The compiled adjoint plans only hold while the annotation is finished */
+  if (!finished)
+  {
+    ierr = adj_destroy_adjoint_plans(adjointer);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
   adjointer->finished = finished;
   return ADJ_OK;
 }
@@ -0,0 +1,58 @@
+#include "libadjoint/adj_arena.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* A bump allocator for data that lives exactly as long as the adjointer, such as the
+   blocks, targets and dependencies of registered equations. Memory is handed out from
+   large blocks and is only ever released all at once, by adj_arena_destroy. */
+
+#define ADJ_ARENA_ALIGNMENT 16
+#define ADJ_ARENA_ROUND(x) ((((x) + ADJ_ARENA_ALIGNMENT - 1) / ADJ_ARENA_ALIGNMENT) * ADJ_ARENA_ALIGNMENT)
+
+int adj_arena_alloc(adj_arena** arena, size_t size, void** ptr)
+{
+  adj_arena* block;
+  size_t capacity;
+
+  size = ADJ_ARENA_ROUND(size);
+  block = *arena;
+
+  if (block == NULL || block->size - block->used < size)
+  {
+    capacity = (size > ADJ_ARENA_BLOCK_SIZE) ? size : ADJ_ARENA_BLOCK_SIZE;
+    block = (adj_arena*) malloc(ADJ_ARENA_ROUND(sizeof(adj_arena)) + capacity);
+    ADJ_CHKMALLOC(block);
+    block->size = capacity;
+    block->used = 0;
+
+    if (*arena != NULL && capacity > ADJ_ARENA_BLOCK_SIZE)
+    {
+      /* An oversized request gets a block of its own; keep filling the current one */
+      block->used = size;
+      block->next = (*arena)->next;
+      (*arena)->next = block;
+      *ptr = (char*) block + ADJ_ARENA_ROUND(sizeof(adj_arena));
+      return ADJ_OK;
+    }
+
+    block->next = *arena;
+    *arena = block;
+  }
+
+  *ptr = (char*) block + ADJ_ARENA_ROUND(sizeof(adj_arena)) + block->used;
+  block->used += size;
+  return ADJ_OK;
+}
+
+int adj_arena_destroy(adj_arena** arena)
+{
+  adj_arena* block;
+  adj_arena* next;
+
+  for (block = *arena; block != NULL; block = next)
+  {
+    next = block->next;
+    free(block);
+  }
+  *arena = NULL;
+  return ADJ_OK;
+}
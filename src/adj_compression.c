@@ -0,0 +1,590 @@
+#include "libadjoint/adj_compression.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+#include <math.h>
+#include <stdint.h>
+#include <sys/time.h>
+
+/* Values recorded with ADJ_STORAGE_MEMORY_COMPRESSED (adj_storage_memory_compressed) are taken
+   apart with vec_get_values and kept compressed, instead of as a full duplicate. There are two
+   ways of compressing them, chosen per variable with adj_storage_set_compression:
+
+   ADJ_COMPRESSION_LOSSLESS shuffles the bytes of the scalars, so that all their first bytes
+   come first, then all their second bytes and so on, and then LZ-compresses the result. Sign
+   and exponent bytes of neighbouring values are mostly the same, so the shuffle turns them into
+   long runs that the LZ stage can take out.
+
+   ADJ_COMPRESSION_LOSSY rounds every scalar to the nearest multiple of twice the tolerance, so
+   no value moves by more than the tolerance (up to the rounding of the last multiplication),
+   and stores the differences between successive multiples as variable-length integers, again
+   LZ-compressed. Smooth fields give small differences, which take a byte or two each.
+
+   Values recorded with a reduced precision (adj_storage_set_precision), with either
+   ADJ_STORAGE_MEMORY_COPY or lossless ADJ_STORAGE_MEMORY_COMPRESSED, are first narrowed to
+   single precision floats or bfloat16s (the upper half of a float, rounded to nearest even), and
+   widened again when they are decompressed. Copies are kept narrowed as they are; compressed
+   values have their narrowed bytes shuffled and LZ-compressed as above.
+
+   Whichever way, the value is only decompressed (with vec_duplicate and vec_set_values) when
+   adj_get_variable_value or the checkpointing asks for it, and the decompressed copy is kept
+   alongside until the value is forgotten from memory. adj_get_compression_stats reports how
+   many bytes went in and came out, and how long it all took. */
+
+#define ADJ_COMPRESSED_RAW 0 /* stored as they are, when compressing didn't make them smaller */
+#define ADJ_COMPRESSED_SHUFFLE_LZ 1
+#define ADJ_COMPRESSED_QUANTISED_LZ 2
+
+#define ADJ_LZ_MIN_MATCH 4
+#define ADJ_LZ_HASH_BITS 14
+
+struct adj_compressed_value
+{
+  int method; /* ADJ_COMPRESSED_RAW etc. */
+  int klass;
+  int nscalars;
+  int precision; /* ADJ_PRECISION_DOUBLE etc.: how the scalars are kept, before any compression */
+  adj_scalar step; /* the quantisation step of ADJ_COMPRESSED_QUANTISED_LZ */
+  size_t nstream; /* the bytes the LZ stage expands to */
+  size_t nbytes;
+  unsigned char* bytes;
+  int decompressed; /* whether storage.value holds the decompressed copy at the moment */
+};
+
+typedef struct
+{
+  int klass;
+  int nscalars;
+  adj_vector value;
+} adj_compression_template;
+
+struct adj_compression
+{
+  adj_compression_template* templates; /* a vector of each layout we have compressed, to decompress into duplicates of */
+  int ntemplates;
+  int templates_sz;
+
+  size_t raw_bytes;
+  size_t compressed_bytes;
+  double compress_time;
+  double decompress_time;
+};
+
+static double adj_compression_clock(void)
+{
+  struct timeval tval;
+  gettimeofday(&tval, NULL);
+  return (double) tval.tv_sec + 1.0e-6 * (double) tval.tv_usec;
+}
+
+static size_t adj_varint_len(unsigned long long v)
+{
+  size_t len = 1;
+  while (v >= 0x80)
+  {
+    v >>= 7;
+    len++;
+  }
+  return len;
+}
+
+static size_t adj_put_varint(unsigned char* out, size_t pos, unsigned long long v)
+{
+  while (v >= 0x80)
+  {
+    out[pos++] = (unsigned char) (v | 0x80);
+    v >>= 7;
+  }
+  out[pos++] = (unsigned char) v;
+  return pos;
+}
+
+static int adj_get_varint(unsigned char* in, size_t n, size_t* pos, unsigned long long* v)
+{
+  int shift = 0;
+
+  *v = 0;
+  while (*pos < n && shift < 64)
+  {
+    *v |= (unsigned long long) (in[*pos] & 0x7f) << shift;
+    if (!(in[(*pos)++] & 0x80)) return ADJ_OK;
+    shift += 7;
+  }
+  return ADJ_ERR_INVALID_INPUTS;
+}
+
+/* LZ77 over bytes: a sequence of (literal count, literals, match length code, match offset),
+   with a match length code of zero ending the stream. A match is only taken if it costs less
+   than the bytes it stands for, so the output is at most n + 16 bytes. */
+static int adj_lz_compress(unsigned char* in, size_t n, unsigned char* out, size_t* nout)
+{
+  long* table;
+  size_t i, anchor, pos, len, offset, cost;
+  uint32_t word;
+  long candidate;
+  unsigned int h;
+
+  table = (long*) malloc((1 << ADJ_LZ_HASH_BITS) * sizeof(long));
+  ADJ_CHKMALLOC(table);
+  for (h = 0; h < (1 << ADJ_LZ_HASH_BITS); h++)
+    table[h] = -1;
+
+  i = 0;
+  anchor = 0;
+  pos = 0;
+  while (i + ADJ_LZ_MIN_MATCH <= n)
+  {
+    memcpy(&word, in + i, sizeof(uint32_t));
+    h = (unsigned int) ((word * 2654435761u) >> (32 - ADJ_LZ_HASH_BITS));
+    candidate = table[h];
+    table[h] = (long) i;
+
+    if (candidate >= 0 && memcmp(in + candidate, in + i, ADJ_LZ_MIN_MATCH) == 0)
+    {
+      len = ADJ_LZ_MIN_MATCH;
+      while (i + len < n && in[candidate + len] == in[i + len])
+        len++;
+      offset = i - (size_t) candidate;
+      cost = adj_varint_len(i - anchor) + adj_varint_len(len - ADJ_LZ_MIN_MATCH + 1) + adj_varint_len(offset);
+      if (len > cost)
+      {
+        pos = adj_put_varint(out, pos, i - anchor);
+        memcpy(out + pos, in + anchor, i - anchor);
+        pos += i - anchor;
+        pos = adj_put_varint(out, pos, len - ADJ_LZ_MIN_MATCH + 1);
+        pos = adj_put_varint(out, pos, offset);
+        i += len;
+        anchor = i;
+        continue;
+      }
+    }
+    i++;
+  }
+
+  pos = adj_put_varint(out, pos, n - anchor);
+  memcpy(out + pos, in + anchor, n - anchor);
+  pos += n - anchor;
+  pos = adj_put_varint(out, pos, 0);
+
+  free(table);
+  *nout = pos;
+  return ADJ_OK;
+}
+
+static int adj_lz_decompress(unsigned char* in, size_t nin, unsigned char* out, size_t nout)
+{
+  size_t ipos, opos, k;
+  unsigned long long literals, code, offset;
+  int ierr;
+
+  ipos = 0;
+  opos = 0;
+  for (;;)
+  {
+    ierr = adj_get_varint(in, nin, &ipos, &literals);
+    if (ierr != ADJ_OK || literals > nin - ipos || literals > nout - opos) return ADJ_ERR_INVALID_INPUTS;
+    memcpy(out + opos, in + ipos, literals);
+    ipos += literals;
+    opos += literals;
+
+    ierr = adj_get_varint(in, nin, &ipos, &code);
+    if (ierr != ADJ_OK) return ierr;
+    if (code == 0) break;
+
+    ierr = adj_get_varint(in, nin, &ipos, &offset);
+    if (ierr != ADJ_OK || offset == 0 || offset > opos || code + ADJ_LZ_MIN_MATCH - 1 > nout - opos) return ADJ_ERR_INVALID_INPUTS;
+    /* Byte by byte, as a match may overlap what it is copying */
+    for (k = 0; k < code + ADJ_LZ_MIN_MATCH - 1; k++, opos++)
+      out[opos] = out[opos - offset];
+  }
+
+  return (opos == nout) ? ADJ_OK : ADJ_ERR_INVALID_INPUTS;
+}
+
+/* The quantised, delta-coded stream of ADJ_COMPRESSION_LOSSY; fails if a scalar is too large
+   for the step, or isn't finite */
+static int adj_quantise(adj_scalar* scalars, int nscalars, adj_scalar step, unsigned char* stream, size_t* nstream)
+{
+  long long q, previous;
+  unsigned long long zigzag;
+  size_t pos;
+  int i;
+
+  previous = 0;
+  pos = 0;
+  for (i = 0; i < nscalars; i++)
+  {
+    if (!isfinite(scalars[i]) || fabs(scalars[i] / step) > 4.0e15) return ADJ_ERR_INVALID_INPUTS;
+    q = llround(scalars[i] / step);
+    zigzag = ((unsigned long long) (q - previous) << 1) ^ (unsigned long long) -((q - previous) < 0);
+    pos = adj_put_varint(stream, pos, zigzag);
+    previous = q;
+  }
+
+  *nstream = pos;
+  return ADJ_OK;
+}
+
+static int adj_dequantise(unsigned char* stream, size_t nstream, adj_scalar step, adj_scalar* scalars, int nscalars)
+{
+  long long q;
+  unsigned long long zigzag;
+  size_t pos;
+  int i, ierr;
+
+  q = 0;
+  pos = 0;
+  for (i = 0; i < nscalars; i++)
+  {
+    ierr = adj_get_varint(stream, nstream, &pos, &zigzag);
+    if (ierr != ADJ_OK) return ierr;
+    q += (long long) (zigzag >> 1) ^ -(long long) (zigzag & 1);
+    scalars[i] = (adj_scalar) q * step;
+  }
+  return ADJ_OK;
+}
+
+static size_t adj_precision_width(int precision)
+{
+  switch (precision)
+  {
+    case ADJ_PRECISION_SINGLE:
+      return sizeof(float);
+    case ADJ_PRECISION_BFLOAT16:
+      return sizeof(uint16_t);
+    default:
+      return sizeof(adj_scalar);
+  }
+}
+
+static void adj_narrow(adj_scalar* scalars, int nscalars, int precision, unsigned char* out)
+{
+  float single;
+  uint32_t bits;
+  uint16_t half;
+  int i;
+
+  for (i = 0; i < nscalars; i++)
+  {
+    if (precision == ADJ_PRECISION_DOUBLE)
+    {
+      memcpy(out + i * sizeof(adj_scalar), &scalars[i], sizeof(adj_scalar));
+      continue;
+    }
+
+    single = (float) scalars[i];
+    if (precision == ADJ_PRECISION_SINGLE)
+    {
+      memcpy(out + i * sizeof(float), &single, sizeof(float));
+      continue;
+    }
+
+    memcpy(&bits, &single, sizeof(uint32_t));
+    if (isnan(single))
+      half = (uint16_t) ((bits >> 16) | 0x40); /* keep it a NaN */
+    else
+      half = (uint16_t) ((bits + 0x7fff + ((bits >> 16) & 1)) >> 16);
+    memcpy(out + i * sizeof(uint16_t), &half, sizeof(uint16_t));
+  }
+}
+
+static void adj_widen(unsigned char* in, int nscalars, int precision, adj_scalar* scalars)
+{
+  float single;
+  uint32_t bits;
+  uint16_t half;
+  int i;
+
+  for (i = 0; i < nscalars; i++)
+  {
+    if (precision == ADJ_PRECISION_DOUBLE)
+      memcpy(&scalars[i], in + i * sizeof(adj_scalar), sizeof(adj_scalar));
+    else if (precision == ADJ_PRECISION_SINGLE)
+    {
+      memcpy(&single, in + i * sizeof(float), sizeof(float));
+      scalars[i] = (adj_scalar) single;
+    }
+    else
+    {
+      memcpy(&half, in + i * sizeof(uint16_t), sizeof(uint16_t));
+      bits = (uint32_t) half << 16;
+      memcpy(&single, &bits, sizeof(float));
+      scalars[i] = (adj_scalar) single;
+    }
+  }
+}
+
+static adj_vector* adj_compression_find_template(struct adj_compression* compression, int klass, int nscalars)
+{
+  int i;
+
+  for (i = 0; i < compression->ntemplates; i++)
+    if (compression->templates[i].klass == klass && compression->templates[i].nscalars == nscalars)
+      return &compression->templates[i].value;
+  return NULL;
+}
+
+static int adj_compression_add_template(adj_adjointer* adjointer, adj_vector value, int nscalars)
+{
+  struct adj_compression* compression;
+  adj_compression_template* tmpl;
+
+  if (adjointer->compression == NULL)
+  {
+    adjointer->compression = (struct adj_compression*) malloc(sizeof(struct adj_compression));
+    ADJ_CHKMALLOC(adjointer->compression);
+    memset(adjointer->compression, 0, sizeof(struct adj_compression));
+  }
+  compression = adjointer->compression;
+
+  if (adj_compression_find_template(compression, value.klass, nscalars) != NULL) return ADJ_OK;
+
+  if (compression->ntemplates == compression->templates_sz)
+  {
+    int new_sz = (compression->templates_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * compression->templates_sz;
+    compression->templates = (adj_compression_template*) realloc(compression->templates, new_sz * sizeof(adj_compression_template));
+    ADJ_CHKMALLOC(compression->templates);
+    compression->templates_sz = new_sz;
+  }
+
+  tmpl = &compression->templates[compression->ntemplates++];
+  tmpl->klass = value.klass;
+  tmpl->nscalars = nscalars;
+  adjointer->callbacks.vec_duplicate(value, &tmpl->value);
+  return ADJ_OK;
+}
+
+int adj_compress_value(adj_adjointer* adjointer, adj_variable_data* data, adj_storage_data storage)
+{
+  struct adj_compressed_value* compressed;
+  adj_scalar* scalars;
+  unsigned char* narrowed;
+  unsigned char* stream;
+  unsigned char* out;
+  size_t nraw, nout, width;
+  double start;
+  int ierr, i, b;
+
+  if (adjointer->callbacks.vec_get_size == NULL || adjointer->callbacks.vec_get_values == NULL || adjointer->callbacks.vec_set_values == NULL ||
+      adjointer->callbacks.vec_duplicate == NULL || adjointer->callbacks.vec_destroy == NULL)
+  {
+    strncpy(adj_error_msg, "Compressed storage needs the ADJ_VEC_GET_SIZE_CB, ADJ_VEC_GET_VALUES_CB, ADJ_VEC_SET_VALUES_CB, ADJ_VEC_DUPLICATE_CB and ADJ_VEC_DESTROY_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  start = adj_compression_clock();
+  compressed = (struct adj_compressed_value*) malloc(sizeof(struct adj_compressed_value));
+  ADJ_CHKMALLOC(compressed);
+  compressed->klass = storage.value.klass;
+  adjointer->callbacks.vec_get_size(storage.value, &compressed->nscalars);
+  compressed->precision = storage.precision;
+  compressed->step = (adj_scalar) 0.0;
+  compressed->decompressed = ADJ_FALSE;
+
+  ierr = adj_compression_add_template(adjointer, storage.value, compressed->nscalars);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  nraw = compressed->nscalars * sizeof(adj_scalar);
+  scalars = (adj_scalar*) malloc(nraw);
+  ADJ_CHKMALLOC(scalars);
+  adjointer->callbacks.vec_get_values(storage.value, &scalars);
+
+  stream = NULL;
+  if (storage.storage_memory_type == ADJ_STORAGE_MEMORY_COMPRESSED && storage.compression == ADJ_COMPRESSION_LOSSY && storage.compression_tolerance > 0.0)
+  {
+    compressed->method = ADJ_COMPRESSED_QUANTISED_LZ;
+    compressed->precision = ADJ_PRECISION_DOUBLE; /* the tolerance already bounds the error */
+    compressed->step = 2.0 * storage.compression_tolerance;
+    stream = (unsigned char*) malloc(compressed->nscalars * 10 + 1);
+    ADJ_CHKMALLOC(stream);
+    /* Values the step can't cope with are kept losslessly instead */
+    if (adj_quantise(scalars, compressed->nscalars, compressed->step, stream, &compressed->nstream) != ADJ_OK)
+    {
+      free(stream);
+      stream = NULL;
+    }
+  }
+
+  /* Otherwise, narrow the scalars to the precision they are kept in */
+  width = adj_precision_width(compressed->precision);
+  narrowed = NULL;
+  if (stream == NULL)
+  {
+    narrowed = (unsigned char*) malloc(compressed->nscalars * width + 1);
+    ADJ_CHKMALLOC(narrowed);
+    adj_narrow(scalars, compressed->nscalars, compressed->precision, narrowed);
+  }
+  if (stream == NULL && storage.storage_memory_type == ADJ_STORAGE_MEMORY_COMPRESSED)
+  {
+    compressed->method = ADJ_COMPRESSED_SHUFFLE_LZ;
+    compressed->nstream = compressed->nscalars * width;
+    stream = (unsigned char*) malloc(compressed->nstream + 1);
+    ADJ_CHKMALLOC(stream);
+    for (i = 0; i < compressed->nscalars; i++)
+      for (b = 0; b < (int) width; b++)
+        stream[b * compressed->nscalars + i] = narrowed[i * width + b];
+  }
+
+  out = NULL;
+  nout = 0;
+  if (stream != NULL)
+  {
+    out = (unsigned char*) malloc(compressed->nstream + 16);
+    ADJ_CHKMALLOC(out);
+    ierr = adj_lz_compress(stream, compressed->nstream, out, &nout);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  /* Copies, and what compressing didn't make any smaller, are kept narrowed as they are */
+  if (out == NULL || (compressed->method == ADJ_COMPRESSED_SHUFFLE_LZ && nout >= compressed->nscalars * width))
+  {
+    compressed->method = ADJ_COMPRESSED_RAW;
+    free(out);
+    out = narrowed;
+    narrowed = NULL;
+    nout = compressed->nscalars * width;
+  }
+  free(narrowed);
+  free(stream);
+  free(scalars);
+
+  compressed->nbytes = nout;
+  compressed->bytes = (unsigned char*) realloc(out, nout > 0 ? nout : 1);
+  ADJ_CHKMALLOC(compressed->bytes);
+
+  data->storage.compressed = compressed;
+  memset(&(data->storage.value), 0, sizeof(adj_vector));
+
+  adjointer->compression->raw_bytes += nraw;
+  adjointer->compression->compressed_bytes += nout;
+  adjointer->compression->compress_time += adj_compression_clock() - start;
+  return ADJ_OK;
+}
+
+static int adj_decompress_value(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_compressed_value* compressed = data->storage.compressed;
+  adj_vector* model;
+  adj_scalar* scalars;
+  unsigned char* stream;
+  unsigned char* narrowed;
+  size_t width;
+  double start;
+  int ierr, i, b;
+
+  start = adj_compression_clock();
+  model = adj_compression_find_template(adjointer->compression, compressed->klass, compressed->nscalars);
+  assert(model != NULL);
+
+  scalars = (adj_scalar*) malloc(compressed->nscalars * sizeof(adj_scalar) + 1);
+  ADJ_CHKMALLOC(scalars);
+  width = adj_precision_width(compressed->precision);
+  if (compressed->method == ADJ_COMPRESSED_RAW)
+    adj_widen(compressed->bytes, compressed->nscalars, compressed->precision, scalars);
+  else
+  {
+    stream = (unsigned char*) malloc(compressed->nstream + 1);
+    ADJ_CHKMALLOC(stream);
+    ierr = adj_lz_decompress(compressed->bytes, compressed->nbytes, stream, compressed->nstream);
+    if (ierr == ADJ_OK && compressed->method == ADJ_COMPRESSED_QUANTISED_LZ)
+      ierr = adj_dequantise(stream, compressed->nstream, compressed->step, scalars, compressed->nscalars);
+    else if (ierr == ADJ_OK)
+    {
+      narrowed = (unsigned char*) malloc(compressed->nstream + 1);
+      ADJ_CHKMALLOC(narrowed);
+      for (i = 0; i < compressed->nscalars; i++)
+        for (b = 0; b < (int) width; b++)
+          narrowed[i * width + b] = stream[b * compressed->nscalars + i];
+      adj_widen(narrowed, compressed->nscalars, compressed->precision, scalars);
+      free(narrowed);
+    }
+    free(stream);
+    if (ierr != ADJ_OK)
+    {
+      free(scalars);
+      strncpy(adj_error_msg, "A compressed value is corrupt.", ADJ_ERROR_MSG_BUF);
+      return adj_chkierr_auto(ierr);
+    }
+  }
+
+  adjointer->callbacks.vec_duplicate(*model, &(data->storage.value));
+  adjointer->callbacks.vec_set_values(&(data->storage.value), scalars);
+  free(scalars);
+  compressed->decompressed = ADJ_TRUE;
+
+  adjointer->compression->decompress_time += adj_compression_clock() - start;
+  return ADJ_OK;
+}
+
+int adj_storage_memory_value(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value)
+{
+  int ierr;
+
+  if (data->storage.compressed != NULL && !data->storage.compressed->decompressed)
+  {
+    ierr = adj_decompress_value(adjointer, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_memory_budget_recharge(adjointer, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  else if (data->storage.pod != NULL)
+  {
+    ierr = adj_pod_reconstruct_value(adjointer, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_memory_budget_recharge(adjointer, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  *value = data->storage.value;
+  return ADJ_OK;
+}
+
+size_t adj_compressed_size(adj_variable_data* data)
+{
+  struct adj_compressed_value* compressed = data->storage.compressed;
+
+  if (compressed == NULL) return 0;
+  /* The decompressed copy counts too, for as long as it is kept */
+  if (compressed->decompressed)
+    return compressed->nbytes + (size_t) compressed->nscalars * sizeof(adj_scalar);
+  return compressed->nbytes;
+}
+
+int adj_destroy_compressed_value(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_compressed_value* compressed = data->storage.compressed;
+
+  if (compressed == NULL) return ADJ_OK;
+
+  if (compressed->decompressed)
+    adjointer->callbacks.vec_destroy(&(data->storage.value));
+  free(compressed->bytes);
+  free(compressed);
+  data->storage.compressed = NULL;
+  return ADJ_OK;
+}
+
+int adj_destroy_compression(adj_adjointer* adjointer)
+{
+  struct adj_compression* compression = adjointer->compression;
+  int i;
+
+  if (compression == NULL) return ADJ_OK;
+
+  for (i = 0; i < compression->ntemplates; i++)
+    adjointer->callbacks.vec_destroy(&compression->templates[i].value);
+  free(compression->templates);
+  free(compression);
+  adjointer->compression = NULL;
+  return ADJ_OK;
+}
+
+int adj_get_compression_stats(adj_adjointer* adjointer, size_t* raw_bytes, size_t* compressed_bytes, adj_scalar* compress_time, adj_scalar* decompress_time)
+{
+  struct adj_compression* compression = adjointer->compression;
+
+  *raw_bytes = (compression == NULL) ? 0 : compression->raw_bytes;
+  *compressed_bytes = (compression == NULL) ? 0 : compression->compressed_bytes;
+  *compress_time = (compression == NULL) ? (adj_scalar) 0.0 : (adj_scalar) compression->compress_time;
+  *decompress_time = (compression == NULL) ? (adj_scalar) 0.0 : (adj_scalar) compression->decompress_time;
+  return ADJ_OK;
+}
@@ -1,14 +1,29 @@
 #include "libadjoint/adj_core.h"
 
+static int adj_assemble_adjoint_equations(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_variable fwd_var, int nfunctionals, char** functionals, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_vars);
+static int adj_check_adjoint_values(adj_adjointer* adjointer, adj_adjoint_plan* plan, char* functional);
+static int adj_assemble_adjoint_lhs(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_matrix* lhs, adj_vector* rhs);
+static int adj_assemble_adjoint_rhs(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_variable fwd_var, char* functional, adj_vector* rhs, adj_variable* adj_var);
+static int adj_revolve_within_timestep(adj_adjointer* adjointer, int equation, int start_eqn, int end_eqn);
+static int adj_replay_forward_equation(adj_adjointer* adjointer, int equation, adj_variable* var);
+
 int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* functional, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_var)
 {
   int ierr;
-  adj_equation fwd_eqn;
+
+  ierr = adj_get_adjoint_equations(adjointer, equation, 1, &functional, lhs, rhs, adj_var);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  return ADJ_OK;
+}
+
+int adj_get_adjoint_equations(adj_adjointer* adjointer, int equation, int nfunctionals, char** functionals, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_vars)
+{
+  int ierr;
+  int k;
   adj_variable fwd_var;
-  adj_variable_data* adj_data;
-  adj_variable_data* fwd_data;
-  int i;
-  int j;
+  adj_adjoint_plan scratch;
+  adj_adjoint_plan* plan;
   void (*functional_derivative_func)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output) = NULL;
 
   if (adjointer->options[ADJ_ACTIVITY] == ADJ_ACTIVITY_NOTHING)
@@ -23,6 +38,12 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
     return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
   }
 
+  if (nfunctionals < 1)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Need at least one functional, but got %d.", nfunctionals);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
   if (adjointer->callbacks.vec_destroy == NULL)
   {
     strncpy(adj_error_msg, "Need the ADJ_VEC_DESTROY_CB callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
@@ -33,6 +54,11 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
     strncpy(adj_error_msg, "Need the ADJ_VEC_AXPY_CB callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
+  if (adjointer->callbacks.vec_duplicate == NULL && nfunctionals > 1)
+  {
+    strncpy(adj_error_msg, "Need the ADJ_VEC_DUPLICATE_CB callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
   if (adjointer->callbacks.mat_axpy == NULL)
   {
     strncpy(adj_error_msg, "Need the ADJ_MAT_AXPY_CB callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
@@ -44,27 +70,77 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
 
-  ierr = adj_find_functional_derivative_callback(adjointer, functional, &functional_derivative_func);
+  for (k = 0; k < nfunctionals; k++)
+  {
+    ierr = adj_find_functional_derivative_callback(adjointer, functionals[k], &functional_derivative_func);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  fwd_var = adjointer->equations[equation].variable;
+
+  /* Start reading what the next adjoint equations need from disk while we work on this one */
+  ierr = adj_prefetch_schedule(adjointer, equation);
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  fwd_eqn = adjointer->equations[equation];
-  fwd_var = fwd_eqn.variable;
+  /* Which terms make up this adjoint equation only depends on the annotation; once that is
+     finished, they are worked out on the first call and kept for every later sweep. */
+  ierr = adj_find_adjoint_plan(adjointer, equation, &scratch, &plan);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  ierr = adj_find_variable_data(&(adjointer->varhash), &fwd_var, &fwd_data);
-  assert(ierr == ADJ_OK);
+  ierr = adj_assemble_adjoint_equations(adjointer, plan, fwd_var, nfunctionals, functionals, lhs, rhs, adj_vars);
+  if (plan == &scratch) adj_destroy_adjoint_plan(&scratch);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  return ADJ_OK;
+}
+
+static int adj_assemble_adjoint_equations(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_variable fwd_var, int nfunctionals, char** functionals, adj_matrix* lhs, adj_vector* rhs, adj_variable* adj_vars)
+{
+  int ierr;
+  int k;
 
   /* Check that we have all the adjoint values we need, before we start allocating stuff */
-  for (i = 0; i < fwd_data->ntargeting_equations; i++)
+  for (k = 0; k < nfunctionals; k++)
+  {
+    ierr = adj_check_adjoint_values(adjointer, plan, functionals[k]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  /* The adjoint operator does not depend on the functional, so it is assembled once for all of them */
+  ierr = adj_assemble_adjoint_lhs(adjointer, plan, lhs, &rhs[0]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* The assembly gave us the rhs to start from; each other functional gets its own copy of it */
+  for (k = 1; k < nfunctionals; k++)
+  {
+    ierr = adj_vec_pool_get(adjointer, rhs[0], &rhs[k]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    adjointer->callbacks.vec_axpy(&rhs[k], (adj_scalar)1.0, rhs[0]);
+  }
+
+  for (k = 0; k < nfunctionals; k++)
+  {
+    ierr = adj_assemble_adjoint_rhs(adjointer, plan, fwd_var, functionals[k], &rhs[k], &adj_vars[k]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  return ADJ_OK;
+}
+
+static int adj_check_adjoint_values(adj_adjointer* adjointer, adj_adjoint_plan* plan, char* functional)
+{
+  int ierr;
+  int i;
+
+  for (i = 0; i < plan->nops; i++)
   {
-    adj_equation other_fwd_eqn;
     adj_variable other_adj_var;
 
-    if (fwd_data->targeting_equations[i] == equation) continue; /* that term goes in the lhs, and we've already taken care of it */
-    other_fwd_eqn = adjointer->equations[fwd_data->targeting_equations[i]];
+    if (plan->ops[i].kind != ADJ_PLAN_BLOCK_ACTION) continue;
 
     /* Find the adjoint variable we want this to multiply */
-    other_adj_var = other_fwd_eqn.variable; other_adj_var.type = ADJ_ADJOINT; strncpy(other_adj_var.functional, functional, ADJ_NAME_LEN);
-    /* and now get its value */
+    other_adj_var = adjointer->equations[plan->ops[i].source].variable; other_adj_var.type = ADJ_ADJOINT; strncpy(other_adj_var.functional, functional, ADJ_NAME_LEN);
+    /* and now check we have its value */
     ierr = adj_has_variable_value(adjointer, other_adj_var);
     if (ierr != ADJ_OK)
     {
@@ -75,6 +151,61 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
     }
   }
 
+  return ADJ_OK;
+}
+
+static int adj_assemble_adjoint_lhs(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_matrix* lhs, adj_vector* rhs)
+{
+  int ierr;
+  int i;
+  int nassembled = 0;
+
+  for (i = 0; i < plan->nops; i++)
+  {
+    adj_adjoint_plan_op* op = &(plan->ops[i]);
+
+    if (op->kind == ADJ_PLAN_BLOCK_ASSEMBLY)
+    {
+      /* the diagonal blocks of A* */
+      adj_block block = *(op->block);
+      block.hermitian = op->hermitian;
+      nassembled++;
+      if (nassembled == 1) /* the first one we've found */
+      {
+        ierr = adj_evaluate_block_assembly(adjointer, block, lhs, rhs);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      }
+      else
+      {
+        adj_matrix lhs_tmp;
+        adj_vector rhs_tmp;
+        ierr = adj_evaluate_block_assembly(adjointer, block, &lhs_tmp, &rhs_tmp);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        adj_vec_pool_put(adjointer, &rhs_tmp); /* we already have rhs from the first block assembly */
+        adjointer->callbacks.mat_axpy(lhs, op->coefficient, lhs_tmp); /* add lhs_tmp to lhs */
+        adjointer->callbacks.mat_destroy(&lhs_tmp);
+      }
+    }
+    else if (op->kind == ADJ_PLAN_RHS_DERIVATIVE_ASSEMBLY)
+    {
+      /* an R* that contributes to the adjoint matrix */
+      adj_matrix rstar;
+      ierr = adj_evaluate_rhs_derivative_assembly(adjointer, adjointer->equations[op->source], op->hermitian, &rstar);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      adjointer->callbacks.mat_axpy(lhs, op->coefficient, rstar); /* Subtract the R* contribution from the adjoint lhs */
+      adjointer->callbacks.mat_destroy(&rstar);
+    }
+  }
+
+  return ADJ_OK;
+}
+
+static int adj_assemble_adjoint_rhs(adj_adjointer* adjointer, adj_adjoint_plan* plan, adj_variable fwd_var, char* functional, adj_vector* rhs, adj_variable* adj_var)
+{
+  int ierr;
+  adj_variable_data* adj_data;
+  int i;
+
   /* Create the associated adjoint variable */
   ierr = adj_create_variable(fwd_var.name, fwd_var.timestep, fwd_var.iteration, fwd_var.auxiliary, adj_var);
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
@@ -92,264 +223,122 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
 
   /* Now let's fill in its data */
   adj_data->equation = -1; /* it never has a forward equation */
-  /* And fill in its .adjoint_equations */
-  /* The adjoint equations this variable is necessary for are:
-     * The (adjoint equation) of (the target) of (each block) in (the forward equation) associated with (the adjoint equation we're fetching)
-     * The (adjoint equation) of (the dependencies) of (each block) in (the forward equation) associated with (the adjoint equation we're fetching)
-     * The (adjoint equation) of (the dependencies) of (the right-hand-side) of (the forward equation) associated with (the adjoint equation we're fetching)
-   Do you see why working that out gave me an almighty headache? */
-  for (i = 0; i < fwd_eqn.nblocks; i++)
-  {
-    /* A* terms */
-    adj_variable_data* block_target_data;
-    ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn.targets[i]), &block_target_data);
-    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    adj_append_unique(&(adj_data->adjoint_equations), &(adj_data->nadjoint_equations), block_target_data->equation);
-
-    /* G* terms */
-    for (j = 0; j < fwd_eqn.blocks[i].nonlinear_block.ndepends; j++)
-    {
-      adj_variable_data* j_data;
-      ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn.blocks[i].nonlinear_block.depends[j]), &j_data);
-      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      adj_append_unique(&(adj_data->adjoint_equations), &(adj_data->nadjoint_equations), j_data->equation);
-    }
-  }
-  /* R* terms */
-  for (i = 0; i < fwd_eqn.nrhsdeps; i++)
+  /* And fill in its .adjoint_equations: see adj_compile_adjoint_plan for what they are */
+  for (i = 0; i < plan->nadjoint_equations; i++)
   {
-    adj_variable_data* rhs_dep_data;
-    ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn.rhsdeps[i]), &rhs_dep_data);
+    ierr = adj_append_unique(&(adj_data->adjoint_equations), &(adj_data->nadjoint_equations), plan->adjoint_equations[i]);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    adj_append_unique(&(adj_data->adjoint_equations), &(adj_data->nadjoint_equations), rhs_dep_data->equation);
   }
 
-  /* --------------------------------------------------------------------------
-   * Computation of A* terms                                                  |
-   * -------------------------------------------------------------------------- */
-
-  /* fwd_data->targeting_equations what forward equations have nonzero blocks in the column of A associated with fwd_var. */
-  /* That column of A becomes the current row of A* we want to now compute. */
-
-  /* First we find the diagonal entry and assemble that, to compute the A* of lhs. */
-  /* Find the block in fwd_eqn that targets fwd_var, and assemble that (hermitianed) */
+  /* Now evaluate the terms that go in the rhs, in order: the off-diagonal A* blocks, the G* row,
+     and the R* terms */
+  i = 0;
+  while (i < plan->nops)
   {
-    adj_block block;
-    int blockcount = 0;
-    for (i = 0; i < fwd_eqn.nblocks; i++)
-    {
+    adj_adjoint_plan_op* op = &(plan->ops[i]);
 
-      if (adj_variable_equal(&(fwd_eqn.targets[i]), &fwd_var, 1))
-      {
-        /* this is the right block */
-        block = fwd_eqn.blocks[i];
-        block.hermitian = !block.hermitian;
-        blockcount++;
-        if (blockcount == 1) /* the first one we've found */
-        {
-          ierr = adj_evaluate_block_assembly(adjointer, block, lhs, rhs);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        }
-        else
-        {
-          adj_matrix lhs_tmp;
-          adj_vector rhs_tmp;
-          ierr = adj_evaluate_block_assembly(adjointer, block, &lhs_tmp, &rhs_tmp);
-          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-          adjointer->callbacks.vec_destroy(&rhs_tmp); /* we already have rhs from the first block assembly */
-          adjointer->callbacks.mat_axpy(lhs, (adj_scalar) 1.0, lhs_tmp); /* add lhs_tmp to lhs */
-          adjointer->callbacks.mat_destroy(&lhs_tmp);
-        }
-      }
+    if (op->kind == ADJ_PLAN_BLOCK_ASSEMBLY || op->kind == ADJ_PLAN_RHS_DERIVATIVE_ASSEMBLY)
+    {
+      /* these went into the lhs, in adj_assemble_adjoint_lhs */
+      i++;
     }
-  }
-
-  /* Great! Now let's assemble the RHS contributions of A*. */
-
-  /* Now loop through the off-diagonal blocks of A*. */
-  for (i = 0; i < fwd_data->ntargeting_equations; i++)
-  {
-    adj_equation other_fwd_eqn;
-    adj_block block;
-    adj_variable other_adj_var;
-    adj_vector adj_value;
-    adj_vector rhs_tmp;
-
-    if (fwd_data->targeting_equations[i] == equation) continue; /* that term goes in the lhs, and we've already taken care of it */
-    other_fwd_eqn = adjointer->equations[fwd_data->targeting_equations[i]];
-
-    for (j = 0; j < other_fwd_eqn.nblocks; j++)
+    else if (op->kind == ADJ_PLAN_BLOCK_ACTION)
     {
-      if (adj_variable_equal(&fwd_var, &(other_fwd_eqn.targets[j]), 1))
-      {
-        block = other_fwd_eqn.blocks[j];
+      adj_block block = *(op->block);
+      adj_variable other_adj_var;
+      adj_vector adj_value;
 
-        /* OK. Now we've found the right block ... */
-        block.hermitian = !block.hermitian;
+      block.hermitian = op->hermitian;
 
-        /* Find the adjoint variable we want this to multiply */
-        other_adj_var = other_fwd_eqn.variable; other_adj_var.type = ADJ_ADJOINT; strncpy(other_adj_var.functional, functional, ADJ_NAME_LEN);
-        /* and now get its value */
-        ierr = adj_get_variable_value(adjointer, other_adj_var, &adj_value);
-        assert(ierr == ADJ_OK); /* we should have them all, we checked for them earlier */
+      /* Find the adjoint variable we want this to multiply */
+      other_adj_var = adjointer->equations[op->source].variable; other_adj_var.type = ADJ_ADJOINT; strncpy(other_adj_var.functional, functional, ADJ_NAME_LEN);
+      /* and now get its value */
+      ierr = adj_get_variable_value(adjointer, other_adj_var, &adj_value);
+      assert(ierr == ADJ_OK); /* we should have them all, we checked for them earlier */
 
-        ierr = adj_evaluate_block_action(adjointer, block, adj_value, &rhs_tmp);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        adjointer->callbacks.vec_axpy(rhs, (adj_scalar)-1.0, rhs_tmp);
-        adjointer->callbacks.vec_destroy(&rhs_tmp);
-      }
+      ierr = adj_evaluate_block_action_accumulate(adjointer, block, adj_value, op->coefficient, rhs);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      i++;
     }
-
-  }
-
-  /* --------------------------------------------------------------------------
-   * Computation of G* terms                                                  |
-   * -------------------------------------------------------------------------- */
-
-  /* We need to loop through the equations that depend on fwd_var; each one of those will produce
-     a term in this row of G*. */
-  {
-    for (i = 0; i < fwd_data->ndepending_equations; i++)
+    else if (op->kind == ADJ_PLAN_DERIVATIVE_ACTION)
     {
-      /* We compute the block of G*, either assembling it, or computing its action, as appropriate. */
-      int ndepending_eqn;
-      adj_equation depending_eqn;
-      int nderivs; /* these two are the raw derivatives to compute */
-      adj_nonlinear_block_derivative* derivs;
+      /* The G* terms of the row are contiguous in the plan; we collect all of them before
+         simplifying, so that terms from different equations can be merged too. */
+      int nactions; /* these two are the raw derivative actions to compute */
+      adj_nonlinear_block_derivative_action* actions;
 
-      int nnew_derivs; /* and these two are after derivative simplification */
-      adj_nonlinear_block_derivative* new_derivs;
-      int l, k;
-
-      ndepending_eqn = fwd_data->depending_equations[i];
-      depending_eqn = adjointer->equations[ndepending_eqn];
-
-      /* Now, we loop through the blocks of this forward equation, finding the ones that depend on the fwd variable.
-         First, let's find out how many blocks depend on this variable; then we'll malloc that many 
-         adj_nonlinear_block_derivatives, and then we'll go about filling them in. */
-      nderivs = 0;
-      for (j = 0; j < depending_eqn.nblocks; j++)
-      {
-        if (depending_eqn.blocks[j].has_nonlinear_block)
-        {
-          for (k = 0; k < depending_eqn.blocks[j].nonlinear_block.ndepends; k++)
-          {
-            if (adj_variable_equal(&fwd_var, &depending_eqn.blocks[j].nonlinear_block.depends[k], 1))
-            {
-              nderivs++;
-            }
-          }
-        }
-      }
-
-      /* Now that we have ndepending_blocks, let's use it */
-      derivs = (adj_nonlinear_block_derivative*) malloc(nderivs * sizeof(adj_nonlinear_block_derivative));
-      ADJ_CHKMALLOC(derivs);
-      l = 0;
-      for (j = 0; j < depending_eqn.nblocks; j++)
-      {
-        if (depending_eqn.blocks[j].has_nonlinear_block)
-        {
-          for (k = 0; k < depending_eqn.blocks[j].nonlinear_block.ndepends; k++)
-          {
-            if (adj_variable_equal(&fwd_var, &depending_eqn.blocks[j].nonlinear_block.depends[k], 1))
-            {
-              adj_vector target;
-              ierr = adj_get_variable_value(adjointer, depending_eqn.targets[j], &target);
-              if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-              ierr = adj_create_nonlinear_block_derivative(adjointer, depending_eqn.blocks[j].nonlinear_block, depending_eqn.blocks[j].coefficient, fwd_var, target, !depending_eqn.blocks[j].hermitian, ADJ_FALSE, &derivs[l]);
-              if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-              l++;
-            }
-          }
-        }
-      }
+      int nnew_actions; /* and these two are after derivative simplification */
+      adj_nonlinear_block_derivative_action* new_actions;
+      int l;
 
-      /* OK, Here's where we do our simplifications; this can be a significant optimisation */
-      /* .......................................................................................... */
-      ierr = adj_simplify_derivatives(adjointer, nderivs, derivs, &nnew_derivs, &new_derivs);
-      for (l = 0; l < nderivs; l++)
-      {
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &derivs[l]);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      }
-      free(derivs);
+      for (nactions = 0; i + nactions < plan->nops && plan->ops[i + nactions].kind == ADJ_PLAN_DERIVATIVE_ACTION; nactions++);
 
-      /* Now, we go and evaluate each one of the derivatives, assembling or acting as appropriate */
-      if (ndepending_eqn == equation)
+      actions = (adj_nonlinear_block_derivative_action*) malloc(nactions * sizeof(adj_nonlinear_block_derivative_action));
+      ADJ_CHKMALLOC(actions);
+      for (l = 0; l < nactions; l++)
       {
-        /* This G-block is on the diagonal, and so we must assemble it .. later */
-        snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, we can't handle G-blocks on the diagonal (yet).");
-        return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
-      }
-      else
-      {
-        /* This G-block is NOT on the diagonal, so we only need its action */
+        adj_adjoint_plan_op* dop = &(plan->ops[i + l]);
         adj_variable adj_associated;
         adj_vector adj_value;
+        adj_vector target;
 
-        adj_associated = depending_eqn.variable;
+        adj_associated = adjointer->equations[dop->source].variable;
         adj_associated.type = ADJ_ADJOINT;
         strncpy(adj_associated.functional, functional, ADJ_NAME_LEN);
         ierr = adj_get_variable_value(adjointer, adj_associated, &adj_value);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-        /* And now we are ready */
-        ierr = adj_evaluate_nonlinear_derivative_action(adjointer, nnew_derivs, new_derivs, adj_value, rhs);
+        ierr = adj_get_variable_value(adjointer, *(dop->contraction), &target);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      }
 
-      for (l = 0; l < nnew_derivs; l++)
-      {
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &new_derivs[l]);
+        ierr = adj_create_nonlinear_block_derivative(adjointer, dop->block->nonlinear_block, dop->coefficient, fwd_var, target, dop->hermitian, ADJ_FALSE, &actions[l].derivative);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        ierr = adj_variable_key_from_variable(dop->contraction, ADJ_TRUE, &actions[l].contraction_key);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        actions[l].input_id = dop->source;
+        actions[l].input = adj_value;
+        actions[l].owns_input = ADJ_FALSE;
       }
-      free(new_derivs);
-    }
-  }
 
-  /* --------------------------------------------------------------------------
-   * Computation of R* terms                                                  |
-   * -------------------------------------------------------------------------- */
-  {
-    for (i = 0; i < fwd_data->nrhs_equations; i++)
-    {
-      int rhs_equation = fwd_data->rhs_equations[i];
-      /* Does this R* contribute to the adjoint matrix ... */
-      if (adj_variable_equal(&(adjointer->equations[rhs_equation].variable), &fwd_var, 1))
+      /* OK, Here's where we do our simplifications; this can be a significant optimisation */
+      ierr = adj_simplify_derivative_actions(adjointer, nactions, actions, &nnew_actions, &new_actions);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      for (l = 0; l < nactions; l++)
       {
-        adj_matrix rstar;
-        ierr = adj_evaluate_rhs_derivative_assembly(adjointer, adjointer->equations[rhs_equation], ADJ_TRUE, &rstar);
+        ierr = adj_destroy_nonlinear_block_derivative_action(adjointer, &actions[l]);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        adjointer->callbacks.mat_axpy(lhs, (adj_scalar) -1.0, rstar); /* Subtract the R* contribution from the adjoint lhs */
-        adjointer->callbacks.mat_destroy(&rstar);
       }
-      /* ... or to the right-hand side of the adjoint system? */
-      else
-      {
-        /* Get the adj_equation associated with this dependency, so we can pull out the relevant rhs_deriv_action callback */
-        adj_vector deriv_action;
-        adj_variable contraction_var;
-        adj_vector contraction;
-        int has_output;
+      free(actions);
 
-        has_output = -666;
-
-        contraction_var = adjointer->equations[rhs_equation].variable; contraction_var.type = ADJ_ADJOINT; strncpy(contraction_var.functional, functional, ADJ_NAME_LEN);
-        ierr = adj_get_variable_value(adjointer, contraction_var, &contraction);
+      /* Now, we go and evaluate each one of the derivatives */
+      for (l = 0; l < nnew_actions; l++)
+      {
+        ierr = adj_evaluate_nonlinear_derivative_action(adjointer, 1, &new_actions[l].derivative, new_actions[l].input, rhs);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        ierr = adj_evaluate_rhs_derivative_action(adjointer, adjointer->equations[rhs_equation], fwd_var, contraction, ADJ_TRUE, &deriv_action, &has_output);
+        ierr = adj_destroy_nonlinear_block_derivative_action(adjointer, &new_actions[l]);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        if (has_output)
-        {
-          /* Now that we have the contribution, we need to add it to the adjoint right hand side */
-          adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, deriv_action);
-          adjointer->callbacks.vec_destroy(&deriv_action);
-        }
       }
+      free(new_actions);
+      i += nactions;
+    }
+    else if (op->kind == ADJ_PLAN_RHS_DERIVATIVE_ACTION)
+    {
+      /* an R* that contributes to the right-hand side of the adjoint system */
+      adj_variable contraction_var;
+      adj_vector contraction;
+
+      contraction_var = adjointer->equations[op->source].variable; contraction_var.type = ADJ_ADJOINT; strncpy(contraction_var.functional, functional, ADJ_NAME_LEN);
+      ierr = adj_get_variable_value(adjointer, contraction_var, &contraction);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+      ierr = adj_evaluate_rhs_derivative_action_accumulate(adjointer, adjointer->equations[op->source], fwd_var, contraction, op->hermitian, op->coefficient, rhs);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      i++;
+    }
+    else
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Unknown adjoint plan term %d.", op->kind);
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
     }
   }
 
@@ -362,7 +351,7 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
     if (has_djdu)
     {
       adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
   }
 
@@ -372,12 +361,23 @@ int adj_get_adjoint_equation(adj_adjointer* adjointer, int equation, char* funct
 int adj_get_adjoint_solution(adj_adjointer* adjointer, int equation, char* functional, adj_vector* soln, adj_variable* adj_var)
 {
   int ierr;
+
+  ierr = adj_get_adjoint_solutions(adjointer, equation, 1, &functional, soln, adj_var);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  return ADJ_OK;
+}
+
+int adj_get_adjoint_solutions(adj_adjointer* adjointer, int equation, int nfunctionals, char** functionals, adj_vector* solns, adj_variable* adj_vars)
+{
+  int ierr;
+  int k;
   adj_matrix lhs;
-  adj_vector rhs;
+  adj_vector* rhs;
   int cs;
 
   /* Check for the required callbacks */ 
-  if (adjointer->callbacks.solve == NULL)
+  if (adjointer->callbacks.solve == NULL && adjointer->callbacks.solve_multi == NULL)
   {   
     strncpy(adj_error_msg, "Need the solve data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
@@ -395,7 +395,8 @@ int adj_get_adjoint_solution(adj_adjointer* adjointer, int equation, char* funct
       revolve_turn(adjointer->revolve_data.revolve, adjointer->revolve_data.steps);
     }
 
-  if ((cs == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) || (cs == ADJ_CHECKPOINT_REVOLVE_ONLINE))
+  if ((cs == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) || (cs == ADJ_CHECKPOINT_REVOLVE_ONLINE) ||
+      (cs == ADJ_CHECKPOINT_REVOLVE_COST_AWARE))
   {
     /* Recompute any variables that is required for solving this adjoint equation */
     ierr = adj_revolve_to_adjoint_equation(adjointer, equation);
@@ -406,17 +407,31 @@ int adj_get_adjoint_solution(adj_adjointer* adjointer, int equation, char* funct
      printf("Revolve: Solving adjoint equation %i.\n", equation);
 
   /* At this point, all the dependencies are available to assemble the adjoint equation */
-  ierr = adj_get_adjoint_equation(adjointer, equation, functional, &lhs, &rhs, adj_var);
+  rhs = (adj_vector*) malloc(nfunctionals * sizeof(adj_vector));
+  ADJ_CHKMALLOC(rhs);
+  ierr = adj_get_adjoint_equations(adjointer, equation, nfunctionals, functionals, &lhs, rhs, adj_vars);
   if (ierr != ADJ_OK)
+  {
+    free(rhs);
     return adj_chkierr_auto(ierr);
+  }
 
-  /* Solve the linear system */
-  adjointer->callbacks.solve(*adj_var, lhs, rhs, soln); 
-  adjointer->callbacks.vec_destroy(&rhs);
+  /* Solve the linear systems: all at once if the backend can, so that it can reuse its factorisation */
+  if (adjointer->callbacks.solve_multi != NULL)
+    adjointer->callbacks.solve_multi(nfunctionals, adj_vars, lhs, rhs, solns);
+  else
+  {
+    for (k = 0; k < nfunctionals; k++)
+      adjointer->callbacks.solve(adj_vars[k], lhs, rhs[k], &solns[k]);
+  }
+  for (k = 0; k < nfunctionals; k++)
+    adj_vec_pool_put(adjointer, &rhs[k]);
   adjointer->callbacks.mat_destroy(&lhs);
+  free(rhs);
 
   /* We can now safely un-checkoint this equation and its associated forward variable */
-  if ((cs == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) || (cs == ADJ_CHECKPOINT_REVOLVE_ONLINE))
+  if ((cs == ADJ_CHECKPOINT_REVOLVE_OFFLINE) || (cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) || (cs == ADJ_CHECKPOINT_REVOLVE_ONLINE) ||
+      (cs == ADJ_CHECKPOINT_REVOLVE_COST_AWARE))
   {
     adj_variable_data* data_ptr;
 
@@ -439,7 +454,7 @@ int adj_get_adjoint_solution(adj_adjointer* adjointer, int equation, char* funct
 
 int adj_revolve_to_adjoint_equation(adj_adjointer* adjointer, int equation)
 {
-  int ierr, cs;
+  int ierr, cs, tier_storage;
   int capo, oldcapo;
   int start_eqn, end_eqn;
   int loop = ADJ_TRUE;
@@ -491,8 +506,18 @@ int adj_revolve_to_adjoint_equation(adj_adjointer* adjointer, int equation)
         if (adjointer->revolve_data.verbose)
           printf("Revolve: Create checkpoint of equation %i (first equation of timestep %i).\n", start_eqn, adjointer->revolve_data.current_timestep);
 
+        /* over storage tiers, the slot revolve takes the checkpoint in decides the tier */
+        if (adjointer->tiers != NULL)
+        {
+          ierr = adj_tiers_takeshot_storage(adjointer, &tier_storage);
+          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+          ierr = adj_checkpoint_equation(adjointer, start_eqn, tier_storage);
+        }
+        /* cost-aware checkpoints are budgeted in memory */
+        else if (cs == ADJ_CHECKPOINT_REVOLVE_COST_AWARE)
+          ierr = adj_checkpoint_equation(adjointer, start_eqn, ADJ_CHECKPOINT_STORAGE_MEMORY);
         /* in a multistage setting, we have to ask revolve where to store the checkpoint */
-        if ((cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) && (revolve_getwhere(adjointer->revolve_data.revolve) == 1))
+        else if ((cs == ADJ_CHECKPOINT_REVOLVE_MULTISTAGE) && (revolve_getwhere(adjointer->revolve_data.revolve) == 1))
           ierr = adj_checkpoint_equation(adjointer, start_eqn, ADJ_CHECKPOINT_STORAGE_MEMORY);
          else
           ierr = adj_checkpoint_equation(adjointer, start_eqn, ADJ_CHECKPOINT_STORAGE_DISK);
@@ -520,9 +545,15 @@ int adj_revolve_to_adjoint_equation(adj_adjointer* adjointer, int equation)
         ierr = adj_timestep_end_equation(adjointer, adjointer->revolve_data.current_timestep, &end_eqn);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
+        /* With equation checkpoints, only the part of the timestep this adjoint equation needs is replayed */
+        if (adjointer->revolve_data.equation_snaps > 0 && end_eqn > start_eqn && adjointer->revolve_data.overwrite != ADJ_TRUE)
+        {
+          ierr = adj_revolve_within_timestep(adjointer, equation, start_eqn, end_eqn);
+          if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+        }
         /* When replaying the timestep of the current adjoint equation, the replay records all variables of that timestep. */
         /* For that reason, we need to execute the replay only if we are about to solve the last equation of a timestep */
-        if (equation == end_eqn)
+        else if (equation == end_eqn)
         {
           if (adjointer->revolve_data.verbose)
             printf("====== Revolve: Replay from equation %i (first equation of timestep %i) to equation %i (last equation of timestep %i). ======\n", start_eqn, adjointer->revolve_data.current_timestep, end_eqn, adjointer->revolve_data.current_timestep);
@@ -695,7 +726,7 @@ int adj_get_forward_equation(adj_adjointer* adjointer, int equation, adj_matrix*
           adj_vector rhs_tmp;
           ierr = adj_evaluate_block_assembly(adjointer, block, &lhs_tmp, &rhs_tmp);
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-          adjointer->callbacks.vec_destroy(&rhs_tmp); /* we already have rhs from the first block assembly */
+          adj_vec_pool_put(adjointer, &rhs_tmp); /* we already have rhs from the first block assembly */
           adjointer->callbacks.mat_axpy(lhs, (adj_scalar) 1.0, lhs_tmp); /* add lhs_tmp to lhs */
           adjointer->callbacks.mat_destroy(&lhs_tmp);
         }
@@ -725,10 +756,8 @@ int adj_get_forward_equation(adj_adjointer* adjointer, int equation, adj_matrix*
     ierr = adj_get_variable_value(adjointer, other_var, &value);
     assert(ierr == ADJ_OK); /* we should have them all, we checked for them earlier */
 
-    ierr = adj_evaluate_block_action(adjointer, block, value, &rhs_tmp);
+    ierr = adj_evaluate_block_action_accumulate(adjointer, block, value, (adj_scalar)-1.0, rhs);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    adjointer->callbacks.vec_axpy(rhs, (adj_scalar)-1.0, rhs_tmp);
-    adjointer->callbacks.vec_destroy(&rhs_tmp);
   }
 
   /* And any forward source terms */
@@ -741,7 +770,7 @@ int adj_get_forward_equation(adj_adjointer* adjointer, int equation, adj_matrix*
     if (has_output)
     {
       adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
   }
 
@@ -754,20 +783,26 @@ int adj_get_forward_solution(adj_adjointer* adjointer, int equation, adj_vector*
   int ierr;
   adj_matrix lhs;
   adj_vector rhs;
+  double start;
 
   /* Check for the required callbacks */ 
   strncpy(adj_error_msg, "Need the solve data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
   if (adjointer->callbacks.solve == NULL) return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   strncpy(adj_error_msg, "", ADJ_ERROR_MSG_BUF);
 
+  start = adj_costs_clock();
   ierr = adj_get_forward_equation(adjointer, equation, &lhs, &rhs, fwd_var);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
   /* Solve the linear system */
   adjointer->callbacks.solve(*fwd_var, lhs, rhs, soln); 
-  adjointer->callbacks.vec_destroy(&rhs);
+  adj_vec_pool_put(adjointer, &rhs);
   adjointer->callbacks.mat_destroy(&lhs);
+
+  /* Cost-aware checkpointing schedules by what the timesteps cost */
+  ierr = adj_costs_record_solve(adjointer, equation, adj_costs_clock() - start, *soln);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   
   return ADJ_OK;
 }
@@ -781,10 +816,8 @@ int adj_replay_forward_equations(adj_adjointer* adjointer, int start_equation, i
 {
   int equation, stop_timestep;
   int ierr;
-  adj_vector soln;
   adj_variable var;
   adj_variable_data* var_data;
-  adj_storage_data storage;
 
 
   /* Get the timstep of the last equation in the replay. Its solution will be recorded to memory */
@@ -795,39 +828,8 @@ int adj_replay_forward_equations(adj_adjointer* adjointer, int start_equation, i
     /* We might have the solution of this equation already,
      * in which case we do not have to solve for it.
      */
-    if ((adj_has_variable_value(adjointer, adjointer->equations[equation].variable) != ADJ_OK) ||
-         (adjointer->revolve_data.overwrite == ADJ_TRUE))
-    {
-      if (adjointer->revolve_data.verbose)
-        printf("Revolve: Replaying equation %i.\n", equation);
-      ierr = adj_get_forward_solution(adjointer, equation, &soln, &var);
-      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-      /* Record the solution to memory. We always use adj_storage_memory_copy for recording as it is a safe choice */
-      ierr = adj_storage_memory_copy(soln, &storage);
-      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      if (adjointer->revolve_data.overwrite)
-      {
-        ierr = adj_storage_set_overwrite(&storage, ADJ_TRUE);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        ierr = adj_storage_set_compare(&storage, ADJ_TRUE, adjointer->revolve_data.comparison_tolerance);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      }
-
-      ierr = adj_record_variable(adjointer, var, storage);
-      if (ierr<0)
-        adj_chkierr(ierr);
-      else if (ierr != ADJ_OK)
-        return adj_chkierr_auto(ierr);
-
-      adjointer->callbacks.vec_destroy(&soln);
-    }
-    else
-    {
-      var = adjointer->equations[equation].variable;
-      if (adjointer->revolve_data.verbose)
-        printf("Revolve: No need to replay equation %i.\n", equation);
-    }
+    ierr = adj_replay_forward_equation(adjointer, equation, &var);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
     /* Checkpoint the equation if desired */
     if (checkpoint_last_timestep == ADJ_TRUE && var.timestep == stop_timestep)
@@ -856,11 +858,206 @@ int adj_replay_forward_equations(adj_adjointer* adjointer, int start_equation, i
   return ADJ_OK;
 }
 
+/* Solves a forward equation of a replay and records its solution in memory, unless it is recorded already */
+static int adj_replay_forward_equation(adj_adjointer* adjointer, int equation, adj_variable* var)
+{
+  int ierr;
+  adj_vector soln;
+  adj_storage_data storage;
+
+  if ((adj_has_variable_value(adjointer, adjointer->equations[equation].variable) != ADJ_OK) ||
+       (adjointer->revolve_data.overwrite == ADJ_TRUE))
+  {
+    if (adjointer->revolve_data.verbose)
+      printf("Revolve: Replaying equation %i.\n", equation);
+    ierr = adj_get_forward_solution(adjointer, equation, &soln, var);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+    /* Record the solution to memory. We always use adj_storage_memory_copy for recording as it is a safe choice */
+    ierr = adj_storage_memory_copy(soln, &storage);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    if (adjointer->revolve_data.overwrite)
+    {
+      ierr = adj_storage_set_overwrite(&storage, ADJ_TRUE);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      ierr = adj_storage_set_compare(&storage, ADJ_TRUE, adjointer->revolve_data.comparison_tolerance);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+
+    ierr = adj_record_variable(adjointer, *var, storage);
+    if (ierr<0)
+      adj_chkierr(ierr);
+    else if (ierr != ADJ_OK)
+      return adj_chkierr_auto(ierr);
+
+    adj_vec_pool_put(adjointer, &soln);
+  }
+  else
+  {
+    *var = adjointer->equations[equation].variable;
+    if (adjointer->revolve_data.verbose)
+      printf("Revolve: No need to replay equation %i.\n", equation);
+  }
+
+  return ADJ_OK;
+}
+
+/* Without equation checkpoints, the adjoint of a timestep starts with a replay of all of it, and
+ * keeps every value of the timestep until its adjoint is solved. With them, the adjoint equations
+ * of the timestep are taken in segments instead. Before an adjoint equation that is missing some of the
+ * values of the timestep it needs, the timestep is replayed from the last equation checkpoint before the
+ * first of them, and as many of the revolve_data.equation_snaps checkpoints as are free are placed evenly
+ * between there and the adjoint equation. The replay only keeps the values the adjoint equations from
+ * the last of those checkpoints on need, and a checkpoint is freed once the adjoint of its equation is solved,
+ * so that the segments before it can be split in turn. */
+static int adj_revolve_within_timestep(adj_adjointer* adjointer, int equation, int start_eqn, int end_eqn)
+{
+  int ierr, j, k;
+  int first_missing, last_missing;
+  int nneeds;
+  int* needs;
+  int restart, segment, nfree, span, stop_eqn;
+  int ncheckpoints;
+  int* checkpoints;
+  adj_variable var;
+  adj_variable_data* data;
+
+  /* The replays within the timestep might go back to its start, so that needs a checkpoint */
+  if (equation == end_eqn && start_eqn > 0 &&
+      !adjointer->equations[start_eqn].memory_checkpoint && !adjointer->equations[start_eqn].disk_checkpoint)
+  {
+    if (adjointer->revolve_data.verbose)
+      printf("Revolve: Checkpoint equation %i in memory.\n", start_eqn);
+    ierr = adj_checkpoint_equation(adjointer, start_eqn, ADJ_CHECKPOINT_STORAGE_MEMORY);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  /* Find the values of the timestep this adjoint equation needs but that aren't recorded.
+     Only its own dependencies are looked at, not every equation of the timestep. */
+  first_missing = -1;
+  last_missing = -1;
+  adj_adjoint_equation_needs(adjointer, equation, &nneeds, &needs);
+  for (k = 0; k < nneeds; k++)
+  {
+    data = ADJ_VARIABLE_DATA(adjointer, needs[k]);
+    j = data->equation;
+    if (j < start_eqn || j > end_eqn)
+      continue;
+    if (data->storage.storage_memory_has_value || data->storage.storage_disk_has_value || data->storage.interpolated)
+      continue;
+
+    if (first_missing < 0 || j < first_missing) first_missing = j;
+    if (j > last_missing) last_missing = j;
+  }
+  if (first_missing < 0) return ADJ_OK;
+
+  /* Restart from the last equation checkpoint before the first of them, and count the free ones */
+  restart = start_eqn;
+  nfree = adjointer->revolve_data.equation_snaps;
+  for (j = end_eqn; j > start_eqn; j--)
+  {
+    if (adjointer->equations[j].memory_checkpoint || adjointer->equations[j].disk_checkpoint)
+    {
+      nfree--;
+      if (restart == start_eqn && j <= first_missing) restart = j;
+    }
+  }
+
+  /* Place the free checkpoints evenly between there and this adjoint equation */
+  checkpoints = NULL;
+  ncheckpoints = 0;
+  if (nfree > 0)
+  {
+    checkpoints = (int*) malloc(nfree * sizeof(int));
+    ADJ_CHKMALLOC(checkpoints);
+  }
+  span = equation - restart + 1;
+  segment = restart;
+  for (k = 1; k <= nfree; k++)
+  {
+    j = restart + (k * span) / (nfree + 1);
+    if (j <= segment || j > equation) continue;
+    checkpoints[ncheckpoints++] = j;
+    segment = j;
+  }
+  /* The replay keeps what the adjoint equations from the last checkpoint on need */
+  for (j = equation; j > segment; j--)
+  {
+    if (adjointer->equations[j].memory_checkpoint || adjointer->equations[j].disk_checkpoint)
+    {
+      segment = j;
+      break;
+    }
+  }
+
+  stop_eqn = (last_missing > equation) ? last_missing : equation;
+  if (adjointer->revolve_data.verbose)
+    printf("====== Revolve: Replay from equation %i to equation %i within timestep %i. ======\n", restart, stop_eqn, adjointer->equations[equation].variable.timestep);
+
+  /* The values recorded before the replay that the segment needs must survive it */
+  for (j = start_eqn; j < restart; j++)
+  {
+    ierr = adj_find_variable_data(&(adjointer->varhash), &(adjointer->equations[j].variable), &data);
+    if (ierr != ADJ_OK)
+    {
+      free(checkpoints);
+      return adj_chkierr_auto(ierr);
+    }
+    if (adj_has_unique_in_range(data->adjoint_equations, data->nadjoint_equations, segment, equation))
+    {
+      if (data->storage.storage_memory_has_value) data->storage.storage_memory_is_checkpoint = ADJ_TRUE;
+      if (data->storage.storage_disk_has_value) data->storage.storage_disk_is_checkpoint = ADJ_TRUE;
+    }
+  }
+
+  k = 0;
+  for (j = restart; j <= stop_eqn; j++)
+  {
+    if (k < ncheckpoints && checkpoints[k] == j)
+    {
+      if (adjointer->revolve_data.verbose)
+        printf("Revolve: Checkpoint equation %i in memory.\n", j);
+      ierr = adj_checkpoint_equation(adjointer, j, ADJ_CHECKPOINT_STORAGE_MEMORY);
+      if (ierr != ADJ_OK) break;
+      k++;
+    }
+
+    ierr = adj_replay_forward_equation(adjointer, j, &var);
+    if (ierr != ADJ_OK) break;
+
+    ierr = adj_find_variable_data(&(adjointer->varhash), &var, &data);
+    if (ierr != ADJ_OK) break;
+    if (adj_has_unique_in_range(data->adjoint_equations, data->nadjoint_equations, segment, equation))
+    {
+      if (data->storage.storage_memory_has_value) data->storage.storage_memory_is_checkpoint = ADJ_TRUE;
+      if (data->storage.storage_disk_has_value) data->storage.storage_disk_is_checkpoint = ADJ_TRUE;
+    }
+
+    ierr = adj_forget_forward_equation(adjointer, j);
+    if (ierr != ADJ_OK) break;
+  }
+  free(checkpoints);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* The adjoint equations of the values after this one are solved already, so forgetting them is
+     up to adj_forget_adjoint_equation again */
+  for (j = equation + 1; j <= stop_eqn; j++)
+  {
+    ierr = adj_find_variable_data(&(adjointer->varhash), &(adjointer->equations[j].variable), &data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    data->storage.storage_memory_is_checkpoint = ADJ_FALSE;
+    data->storage.storage_disk_is_checkpoint = ADJ_FALSE;
+    ierr = adj_update_live_variable(adjointer, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  return ADJ_OK;
+}
+
 int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter, adj_matrix* lhs, adj_vector* rhs, adj_variable* tlm_var)
 {
   int ierr;
   adj_equation fwd_eqn;
-  adj_vector rhs_tmp;
   int i, j;
   adj_variable fwd_var;
   adj_variable_data* tlm_data;
@@ -918,20 +1115,12 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
     tlm_data->equation = -2;
-    tlm_data->ntargeting_equations = fwd_data->ntargeting_equations;
-    tlm_data->targeting_equations = (int*) malloc(fwd_data->ntargeting_equations * sizeof(int));
-    ADJ_CHKMALLOC(tlm_data->targeting_equations);
-    memcpy(tlm_data->targeting_equations, fwd_data->targeting_equations, fwd_data->ntargeting_equations * sizeof(int));
-
-    tlm_data->ndepending_equations = fwd_data->ndepending_equations;
-    tlm_data->depending_equations = (int*) malloc(fwd_data->ndepending_equations * sizeof(int));
-    ADJ_CHKMALLOC(tlm_data->depending_equations);
-    memcpy(tlm_data->depending_equations, fwd_data->depending_equations, fwd_data->ndepending_equations * sizeof(int));
-
-    tlm_data->nrhs_equations = fwd_data->nrhs_equations;
-    tlm_data->rhs_equations = (int*) malloc(fwd_data->nrhs_equations * sizeof(int));
-    ADJ_CHKMALLOC(tlm_data->rhs_equations);
-    memcpy(tlm_data->rhs_equations, fwd_data->rhs_equations, fwd_data->nrhs_equations * sizeof(int));
+    ierr = adj_copy_unique(fwd_data->targeting_equations, fwd_data->ntargeting_equations, &(tlm_data->targeting_equations), &(tlm_data->ntargeting_equations));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_copy_unique(fwd_data->depending_equations, fwd_data->ndepending_equations, &(tlm_data->depending_equations), &(tlm_data->ndepending_equations));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_copy_unique(fwd_data->rhs_equations, fwd_data->nrhs_equations, &(tlm_data->rhs_equations), &(tlm_data->nrhs_equations));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   }
 
 
@@ -1001,7 +1190,7 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
           adj_vector rhs_tmp;
           ierr = adj_evaluate_block_assembly(adjointer, block, &lhs_tmp, &rhs_tmp);
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-          adjointer->callbacks.vec_destroy(&rhs_tmp); /* we already have rhs from the first block assembly */
+          adj_vec_pool_put(adjointer, &rhs_tmp); /* we already have rhs from the first block assembly */
           adjointer->callbacks.mat_axpy(lhs, (adj_scalar) 1.0, lhs_tmp); /* add lhs_tmp to lhs */
           adjointer->callbacks.mat_destroy(&lhs_tmp);
         }
@@ -1033,10 +1222,8 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
     ierr = adj_get_variable_value(adjointer, tlm_var, &value);
     assert(ierr == ADJ_OK); /* we should have them all, we checked for them earlier */
 
-    ierr = adj_evaluate_block_action(adjointer, block, value, &rhs_tmp);
+    ierr = adj_evaluate_block_action_accumulate(adjointer, block, value, (adj_scalar)-1.0, rhs);
     if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    adjointer->callbacks.vec_axpy(rhs, (adj_scalar)-1.0, rhs_tmp);
-    adjointer->callbacks.vec_destroy(&rhs_tmp);
   }
 
   /* --------------------------------------------------------------------------
@@ -1153,11 +1340,6 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
       /* ... or to the right-hand side of the adjoint system? */
       else
       {
-        adj_vector deriv_action;
-        int has_output;
-
-        has_output = -666;
-
         adj_variable contraction_var;
         adj_vector contraction;
 
@@ -1167,15 +1349,8 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
         ierr = adj_get_variable_value(adjointer, contraction_var, &contraction);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-        ierr = adj_evaluate_rhs_derivative_action(adjointer, fwd_eqn, fwd_eqn.rhsdeps[i], contraction, ADJ_FALSE, &deriv_action, &has_output);
+        ierr = adj_evaluate_rhs_derivative_action_accumulate(adjointer, fwd_eqn, fwd_eqn.rhsdeps[i], contraction, ADJ_FALSE, (adj_scalar)1.0, rhs);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        if (has_output)
-        {
-          /* Now that we have the contribution, we need to add it to the adjoint right hand side */
-          adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, deriv_action);
-          adjointer->callbacks.vec_destroy(&deriv_action);
-        }
       }
     }
   }
@@ -1190,7 +1365,7 @@ int adj_get_tlm_equation(adj_adjointer* adjointer, int equation, char* parameter
     if (has_psrc)
     {
       adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
   }
 
@@ -1215,7 +1390,7 @@ int adj_get_tlm_solution(adj_adjointer* adjointer, int equation, char* parameter
 
   /* Solve the linear system */
   adjointer->callbacks.solve(*tlm_var, lhs, rhs, soln); 
-  adjointer->callbacks.vec_destroy(&rhs);
+  adj_vec_pool_put(adjointer, &rhs);
   adjointer->callbacks.mat_destroy(&lhs);
 
   return ADJ_OK;
@@ -1325,7 +1500,7 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
           adj_vector rhs_tmp;
           ierr = adj_evaluate_block_assembly(adjointer, block, &lhs_tmp, &rhs_tmp);
           if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-          adjointer->callbacks.vec_destroy(&rhs_tmp); /* we already have rhs from the first block assembly */
+          adj_vec_pool_put(adjointer, &rhs_tmp); /* we already have rhs from the first block assembly */
           adjointer->callbacks.mat_axpy(lhs, (adj_scalar) 1.0, lhs_tmp); /* add lhs_tmp to lhs */
           adjointer->callbacks.mat_destroy(&lhs_tmp);
         }
@@ -1342,7 +1517,6 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
     adj_block block;
     adj_variable other_soa_var;
     adj_vector soa_value;
-    adj_vector rhs_tmp;
 
     if (fwd_data->targeting_equations[i] == equation) continue; /* that term goes in the lhs, and we've already taken care of it */
     other_fwd_eqn = adjointer->equations[fwd_data->targeting_equations[i]];
@@ -1365,10 +1539,8 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
         ierr = adj_get_variable_value(adjointer, other_soa_var, &soa_value);
         assert(ierr == ADJ_OK); /* we should have them all, we checked for them earlier */
 
-        ierr = adj_evaluate_block_action(adjointer, block, soa_value, &rhs_tmp);
+        ierr = adj_evaluate_block_action_accumulate(adjointer, block, soa_value, (adj_scalar)-1.0, rhs);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        adjointer->callbacks.vec_axpy(rhs, (adj_scalar)-1.0, rhs_tmp);
-        adjointer->callbacks.vec_destroy(&rhs_tmp);
       }
     }
 
@@ -1381,27 +1553,32 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
   /* We need to loop through the equations that depend on fwd_var; each one of those will produce
      a term in this row of G*. */
   {
+    /* We collect the terms of the whole row before simplifying them, so that terms from different
+       equations can be merged too. Each depending equation contributes two kinds of term:
+       (dA/du target)^* soa and (dA/du tlm_target)^* adj, the (dA/du \dot{u})^* \lambda term in ( d^2 F / du^2 )^* \lambda */
+    int nactions; /* these two are the raw derivative actions to compute */
+    adj_nonlinear_block_derivative_action* actions;
+
+    int nnew_actions; /* and these two are after derivative simplification */
+    adj_nonlinear_block_derivative_action* new_actions;
+    int l, k;
+
+    nactions = 0;
     for (i = 0; i < fwd_data->ndepending_equations; i++)
     {
-      /* We compute the block of G*, either assembling it, or computing its action, as appropriate. */
       int ndepending_eqn;
       adj_equation depending_eqn;
-      int nderivs; /* these two are the raw derivatives to compute */
-      adj_nonlinear_block_derivative* derivs;
-      adj_nonlinear_block_derivative* second_derivs; /* the (dA/du \dot{u})^* \lambda term in ( d^2 F / du^2 )^* \lambda */
-
-      int nnew_derivs; /* and these two are after derivative simplification */
-      adj_nonlinear_block_derivative* new_derivs;
-      adj_nonlinear_block_derivative* new_second_derivs;
-      int l, k;
 
       ndepending_eqn = fwd_data->depending_equations[i];
       depending_eqn = adjointer->equations[ndepending_eqn];
 
-      /* Now, we loop through the blocks of this forward equation, finding the ones that depend on the fwd variable.
-         First, let's find out how many blocks depend on this variable; then we'll malloc that many 
-         adj_nonlinear_block_derivatives, and then we'll go about filling them in. */
-      nderivs = 0;
+      if (ndepending_eqn == equation)
+      {
+        /* This G-block is on the diagonal, and so we must assemble it .. later */
+        snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, we can't handle G-blocks on the diagonal (yet).");
+        return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
+      }
+
       for (j = 0; j < depending_eqn.nblocks; j++)
       {
         if (depending_eqn.blocks[j].has_nonlinear_block)
@@ -1410,19 +1587,43 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
           {
             if (adj_variable_equal(&fwd_var, &depending_eqn.blocks[j].nonlinear_block.depends[k], 1))
             {
-              nderivs++;
+              nactions += 2;
             }
           }
         }
       }
+    }
 
-      /* Now that we have ndepending_blocks, let's use it */
-      derivs = (adj_nonlinear_block_derivative*) malloc(nderivs * sizeof(adj_nonlinear_block_derivative));
-      ADJ_CHKMALLOC(derivs);
-      second_derivs = (adj_nonlinear_block_derivative*) malloc(nderivs * sizeof(adj_nonlinear_block_derivative));
-      ADJ_CHKMALLOC(second_derivs);
+    actions = (adj_nonlinear_block_derivative_action*) malloc(nactions * sizeof(adj_nonlinear_block_derivative_action));
+    ADJ_CHKMALLOC(actions);
+    l = 0;
+    for (i = 0; i < fwd_data->ndepending_equations; i++)
+    {
+      /* None of these G-blocks are on the diagonal, so we only need their action */
+      int ndepending_eqn;
+      adj_equation depending_eqn;
+      adj_variable soa_associated;
+      adj_vector soa_value;
+      adj_variable adj_associated;
+      adj_vector adj_value;
+
+      ndepending_eqn = fwd_data->depending_equations[i];
+      depending_eqn = adjointer->equations[ndepending_eqn];
+
+      soa_associated = depending_eqn.variable;
+      soa_associated.type = ADJ_SOA;
+      strncpy(soa_associated.functional, functional, ADJ_NAME_LEN);
+      strncat(soa_associated.functional, ":", 1); 
+      strncat(soa_associated.functional, parameter, ADJ_NAME_LEN);
+      ierr = adj_get_variable_value(adjointer, soa_associated, &soa_value);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+      adj_associated = depending_eqn.variable;
+      adj_associated.type = ADJ_ADJOINT;
+      strncpy(adj_associated.functional, functional, ADJ_NAME_LEN);
+      ierr = adj_get_variable_value(adjointer, adj_associated, &adj_value);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-      l = 0;
       for (j = 0; j < depending_eqn.nblocks; j++)
       {
         if (depending_eqn.blocks[j].has_nonlinear_block)
@@ -1442,85 +1643,52 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
               ierr = adj_get_variable_value(adjointer, tlm_target_var, &tlm_target);
               if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-              ierr = adj_create_nonlinear_block_derivative(adjointer, depending_eqn.blocks[j].nonlinear_block, depending_eqn.blocks[j].coefficient, fwd_var, target, !depending_eqn.blocks[j].hermitian, ADJ_FALSE, &derivs[l]);
+              ierr = adj_create_nonlinear_block_derivative(adjointer, depending_eqn.blocks[j].nonlinear_block, depending_eqn.blocks[j].coefficient, fwd_var, target, !depending_eqn.blocks[j].hermitian, ADJ_FALSE, &actions[l].derivative);
+              if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+              ierr = adj_variable_key_from_variable(&depending_eqn.targets[j], ADJ_TRUE, &actions[l].contraction_key);
               if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+              actions[l].input_id = 2*ndepending_eqn;
+              actions[l].input = soa_value;
+              actions[l].owns_input = ADJ_FALSE;
+              l++;
 
-              ierr = adj_create_nonlinear_block_derivative(adjointer, depending_eqn.blocks[j].nonlinear_block, depending_eqn.blocks[j].coefficient, fwd_var, tlm_target, !depending_eqn.blocks[j].hermitian, ADJ_FALSE, &second_derivs[l]);
+              ierr = adj_create_nonlinear_block_derivative(adjointer, depending_eqn.blocks[j].nonlinear_block, depending_eqn.blocks[j].coefficient, fwd_var, tlm_target, !depending_eqn.blocks[j].hermitian, ADJ_FALSE, &actions[l].derivative);
+              if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+              ierr = adj_variable_key_from_variable(&tlm_target_var, ADJ_TRUE, &actions[l].contraction_key);
               if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+              actions[l].input_id = 2*ndepending_eqn + 1;
+              actions[l].input = adj_value;
+              actions[l].owns_input = ADJ_FALSE;
               l++;
             }
           }
         }
       }
+    }
 
-      /* OK, Here's where we do our simplifications; this can be a significant optimisation */
-      /* .......................................................................................... */
-      ierr = adj_simplify_derivatives(adjointer, nderivs, derivs, &nnew_derivs, &new_derivs);
-      for (l = 0; l < nderivs; l++)
-      {
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &derivs[l]);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      }
-      free(derivs);
-
-      ierr = adj_simplify_derivatives(adjointer, nderivs, second_derivs, &nnew_derivs, &new_second_derivs);
-      for (l = 0; l < nderivs; l++)
-      {
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &second_derivs[l]);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-      }
-      free(second_derivs);
-
-      /* Now, we go and evaluate each one of the derivatives, assembling or acting as appropriate */
-      if (ndepending_eqn == equation)
-      {
-        /* This G-block is on the diagonal, and so we must assemble it .. later */
-        snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, we can't handle G-blocks on the diagonal (yet).");
-        return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
-      }
-      else
+    /* OK, Here's where we do our simplifications; this can be a significant optimisation */
+    /* .......................................................................................... */
+    if (nactions > 0)
+    {
+      ierr = adj_simplify_derivative_actions(adjointer, nactions, actions, &nnew_actions, &new_actions);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      for (l = 0; l < nactions; l++)
       {
-        /* This G-block is NOT on the diagonal, so we only need its action */
-        adj_variable soa_associated;
-        adj_vector soa_value;
-        adj_variable adj_associated;
-        adj_vector adj_value;
-
-        soa_associated = depending_eqn.variable;
-        soa_associated.type = ADJ_SOA;
-        strncpy(soa_associated.functional, functional, ADJ_NAME_LEN);
-        strncat(soa_associated.functional, ":", 1); 
-        strncat(soa_associated.functional, parameter, ADJ_NAME_LEN);
-
-        ierr = adj_get_variable_value(adjointer, soa_associated, &soa_value);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        /* And now we are ready */
-        ierr = adj_evaluate_nonlinear_derivative_action(adjointer, nnew_derivs, new_derivs, soa_value, rhs);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        adj_associated = depending_eqn.variable;
-        adj_associated.type = ADJ_ADJOINT;
-        strncpy(adj_associated.functional, functional, ADJ_NAME_LEN);
-
-        ierr = adj_get_variable_value(adjointer, adj_associated, &adj_value);
-        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        /* And now we are ready */
-        ierr = adj_evaluate_nonlinear_derivative_action(adjointer, nnew_derivs, new_second_derivs, adj_value, rhs);
+        ierr = adj_destroy_nonlinear_block_derivative_action(adjointer, &actions[l]);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
       }
 
-      for (l = 0; l < nnew_derivs; l++)
+      /* Now, we go and evaluate each one of the derivatives */
+      for (l = 0; l < nnew_actions; l++)
       {
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &new_derivs[l]);
+        ierr = adj_evaluate_nonlinear_derivative_action(adjointer, 1, &new_actions[l].derivative, new_actions[l].input, rhs);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-        ierr = adj_destroy_nonlinear_block_derivative(adjointer, &new_second_derivs[l]);
+        ierr = adj_destroy_nonlinear_block_derivative_action(adjointer, &new_actions[l]);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
       }
-      free(new_derivs);
-      free(new_second_derivs);
+      free(new_actions);
     }
+    free(actions);
   }
 
   /* --------------------------------------------------------------------------
@@ -1543,12 +1711,8 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
       else
       {
         /* Get the adj_equation associated with this dependency, so we can pull out the relevant rhs_deriv_action callback */
-        adj_vector deriv_action;
         adj_variable contraction_var;
         adj_vector contraction;
-        int has_output;
-
-        has_output = -666;
 
         contraction_var = adjointer->equations[rhs_equation].variable; contraction_var.type = ADJ_SOA; 
         strncpy(contraction_var.functional, functional, ADJ_NAME_LEN);
@@ -1557,21 +1721,8 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
         ierr = adj_get_variable_value(adjointer, contraction_var, &contraction);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-        ierr = adj_evaluate_rhs_derivative_action(adjointer, adjointer->equations[rhs_equation], fwd_var, contraction, ADJ_TRUE, &deriv_action, &has_output);
+        ierr = adj_evaluate_rhs_derivative_action_accumulate(adjointer, adjointer->equations[rhs_equation], fwd_var, contraction, ADJ_TRUE, (adj_scalar)1.0, rhs);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-
-        if (has_output == -666)
-        {
-          snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Your rhs derivative action callback should set has_output!");
-          return adj_chkierr_auto(ierr);
-        }
-
-        if (has_output)
-        {
-          /* Now that we have the contribution, we need to add it to the adjoint right hand side */
-          adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, deriv_action);
-          adjointer->callbacks.vec_destroy(&deriv_action);
-        }
       }
     }
   }
@@ -1717,7 +1868,7 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
       {
         /* Now that we have the contribution, we need to add it to the adjoint right hand side */
         adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, rhs_tmp);
-        adjointer->callbacks.vec_destroy(&rhs_tmp);
+        adj_vec_pool_put(adjointer, &rhs_tmp);
       }
     }
   }
@@ -1741,7 +1892,7 @@ int adj_get_soa_equation(adj_adjointer* adjointer, int equation, char* functiona
     if (has_d2jdu2)
     {
       adjointer->callbacks.vec_axpy(rhs, (adj_scalar)1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
   }
 
@@ -1765,7 +1916,7 @@ int adj_get_soa_solution(adj_adjointer* adjointer, int equation, char* functiona
 
   /* Solve the linear system */
   adjointer->callbacks.solve(*soa_var, lhs, rhs, soln); 
-  adjointer->callbacks.vec_destroy(&rhs);
+  adj_vec_pool_put(adjointer, &rhs);
   adjointer->callbacks.mat_destroy(&lhs);
 
   return ADJ_OK;
@@ -0,0 +1,615 @@
+#include "libadjoint/adj_costs.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+#include <math.h>
+#include <sys/time.h>
+
+/* Revolve takes every timestep to cost the same to recompute, and every checkpoint to cost the
+   same to keep. With ADJ_CHECKPOINT_REVOLVE_COST_AWARE, each timestep t has its own cost: the
+   seconds it takes to solve, and the bytes of the values it solves for. adj_get_forward_solution
+   times the first solve of every equation and adds it to its timestep, and so does its size if
+   there is an ADJ_VEC_GET_SIZE_CB; adj_set_timestep_cost gives an estimate instead, for the
+   timesteps that haven't been solved through libadjoint yet. The checkpoint taken at the start of
+   timestep t holds what timestep t-1 solved for, so that is taken to be its size.
+
+   The schedule keeps the same shape as revolve's: checkpoints are taken on the way forward, and
+   while a range is reversed, the checkpoint at its start is restored from, and maybe further ones
+   taken, which are dropped once the reversal has passed them. What it minimises is the seconds
+   spent advancing, rather than the number of timesteps, and what bounds it is the bytes of the
+   checkpoints held at once, rather than their number. With F(l, r, B) the least time to reverse
+   the timesteps [l, r), starting from a checkpoint at l, with B bytes to spare,
+
+     F(l, r, B) = min( sum_{l<i<r} T(l, i),
+                       min_{l<m<r-1, b_m<=B} T(l, m) + F(m, r, B-b_m) + F(l, m, B) )
+
+   where T(l, i) is the time to advance from l to i and b_m the size of the checkpoint at m; on the
+   way forward, the first term is replaced by the same sum up to the last but one timestep (the last
+   one is solved anyway) and the advances to the checkpoints are free. The budget is worked in at
+   most ADJ_COSTS_BUDGET_UNITS units, up to ADJ_COSTS_UNITS_PER_CHECKPOINT of them to the smallest
+   checkpoint, and the checkpoint sizes are rounded up, so the schedule never holds more than
+   the budget; when all the checkpoints are the same size, it holds as many as revolve would. For
+   more than ADJ_COSTS_MAX_BLOCKS timesteps, checkpoints only go at the start of ADJ_COSTS_MAX_BLOCKS
+   evenly sized blocks of them, which keeps the work to O(ADJ_COSTS_MAX_BLOCKS^3 ADJ_COSTS_BUDGET_UNITS);
+   since that can do worse than revolve, revolve's own schedule with as many checkpoints as the budget
+   holds of the largest size is costed too, and taken instead if it recomputes less.
+
+   The schedule is worked out when revolve is initialised, so from the costs known at that point:
+   in a first run, the estimates; after it, by adj_reset_revolve, the measurements too. The
+   schedule is then handed to revolve as a list of actions, so the rest of libadjoint drives it
+   like any other revolve schedule. The checkpoints are kept in memory. */
+
+#define ADJ_COSTS_MAX_BLOCKS 128
+#define ADJ_COSTS_BUDGET_UNITS 64
+#define ADJ_COSTS_UNITS_PER_CHECKPOINT 8
+
+#define ADJ_COST_UNKNOWN 0
+#define ADJ_COST_ESTIMATED 1
+#define ADJ_COST_MEASURED 2
+
+typedef struct
+{
+  double seconds; /* to solve the equations of the timestep */
+  size_t bytes; /* of the values the timestep solves for */
+  int seconds_source; /* ADJ_COST_UNKNOWN, ADJ_COST_ESTIMATED or ADJ_COST_MEASURED */
+  int bytes_source;
+} adj_timestep_cost;
+
+struct adj_costs
+{
+  size_t byte_budget; /* for the checkpoints held at once */
+  adj_timestep_cost* timesteps;
+  int ntimesteps;
+  char* timed; /* whether each equation has been timed already */
+  int ntimed;
+};
+
+typedef struct
+{
+  int nsteps; /* timesteps */
+  int nblocks; /* blocks of timesteps a checkpoint can go at the start of */
+  int nunits; /* the budget, in units */
+  int* pos; /* the first timestep of each block, and nsteps */
+  int* units; /* the budget units the checkpoint at the start of each block takes */
+  double* prefix; /* prefix[i]: seconds to advance from timestep 0 to timestep i */
+  double* prefix2; /* prefix2[i]: the sum of prefix[j] over j < i */
+  double* reverse; /* F, by block range and units to spare */
+  int* reverse_choice; /* the block the next checkpoint of F goes at, or -1 for none */
+  double* forward; /* the same on the way forward, by block and units to spare */
+  int* forward_choice;
+  int nactions;
+  int actions_sz;
+  int* actions;
+  int* checks;
+  int* capos;
+} adj_cost_schedule;
+
+#define ADJ_REVERSE_IDX(s, l, r, k) ((((l) * ((s)->nblocks + 1)) + (r)) * ((s)->nunits + 1) + (k))
+#define ADJ_FORWARD_IDX(s, l, k) ((l) * ((s)->nunits + 1) + (k))
+
+static int adj_costs_timestep(adj_adjointer* adjointer, int timestep, adj_timestep_cost** cost)
+{
+  struct adj_costs* costs;
+  int n;
+
+  if (adjointer->costs == NULL)
+  {
+    adjointer->costs = (struct adj_costs*) malloc(sizeof(struct adj_costs));
+    ADJ_CHKMALLOC(adjointer->costs);
+    memset(adjointer->costs, 0, sizeof(struct adj_costs));
+  }
+  costs = adjointer->costs;
+
+  if (timestep >= costs->ntimesteps)
+  {
+    n = costs->ntimesteps;
+    costs->ntimesteps = timestep + 1 > 2 * n ? timestep + 1 : 2 * n;
+    costs->timesteps = (adj_timestep_cost*) realloc(costs->timesteps, costs->ntimesteps * sizeof(adj_timestep_cost));
+    ADJ_CHKMALLOC(costs->timesteps);
+    memset(costs->timesteps + n, 0, (costs->ntimesteps - n) * sizeof(adj_timestep_cost));
+  }
+
+  *cost = &costs->timesteps[timestep];
+  return ADJ_OK;
+}
+
+int adj_set_revolve_cost_options(adj_adjointer* adjointer, int steps, size_t byte_budget, int verbose)
+{
+  adj_timestep_cost* cost;
+  int ierr;
+
+  if (byte_budget == 0)
+  {
+    strncpy(adj_error_msg, "The checkpoints need a byte budget greater than zero.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  /* Make sure there is somewhere to keep the budget */
+  ierr = adj_costs_timestep(adjointer, 0, &cost);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  adjointer->costs->byte_budget = byte_budget;
+  adjointer->revolve_data.steps = steps;
+  adjointer->revolve_data.verbose = verbose;
+  return ADJ_OK;
+}
+
+int adj_set_timestep_cost(adj_adjointer* adjointer, int timestep, adj_scalar seconds, size_t bytes)
+{
+  adj_timestep_cost* cost;
+  int ierr;
+
+  if (timestep < 0 || seconds < 0.0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Can't set a cost of %g seconds for timestep %d.", (double) seconds, timestep);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  ierr = adj_costs_timestep(adjointer, timestep, &cost);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  cost->seconds = seconds;
+  cost->bytes = bytes;
+  cost->seconds_source = ADJ_COST_ESTIMATED;
+  cost->bytes_source = ADJ_COST_ESTIMATED;
+  return ADJ_OK;
+}
+
+int adj_get_timestep_cost(adj_adjointer* adjointer, int timestep, adj_scalar* seconds, size_t* bytes)
+{
+  adj_timestep_cost* cost;
+
+  if (adjointer->costs == NULL || timestep < 0 || timestep >= adjointer->costs->ntimesteps ||
+      adjointer->costs->timesteps[timestep].seconds_source == ADJ_COST_UNKNOWN)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The cost of timestep %d is neither measured nor estimated.", timestep);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  cost = &adjointer->costs->timesteps[timestep];
+  *seconds = (adj_scalar) cost->seconds;
+  *bytes = cost->bytes;
+  return ADJ_OK;
+}
+
+double adj_costs_clock(void)
+{
+  struct timeval tval;
+  gettimeofday(&tval, NULL);
+  return (double) tval.tv_sec + 1.0e-6 * (double) tval.tv_usec;
+}
+
+int adj_costs_record_solve(adj_adjointer* adjointer, int equation, double seconds, adj_vector soln)
+{
+  struct adj_costs* costs = adjointer->costs;
+  adj_timestep_cost* cost;
+  int n, sz, ierr;
+
+  if (costs == NULL) return ADJ_OK;
+
+  /* Only the first solve counts; the rest are replays */
+  if (equation >= costs->ntimed)
+  {
+    n = costs->ntimed;
+    costs->ntimed = adjointer->equations_sz > equation + 1 ? adjointer->equations_sz : equation + 1;
+    costs->timed = (char*) realloc(costs->timed, costs->ntimed * sizeof(char));
+    ADJ_CHKMALLOC(costs->timed);
+    memset(costs->timed + n, 0, costs->ntimed - n);
+  }
+  if (costs->timed[equation]) return ADJ_OK;
+  costs->timed[equation] = 1;
+
+  ierr = adj_costs_timestep(adjointer, adjointer->equations[equation].variable.timestep, &cost);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* A measurement replaces an estimate */
+  if (cost->seconds_source != ADJ_COST_MEASURED)
+  {
+    cost->seconds = 0.0;
+    cost->seconds_source = ADJ_COST_MEASURED;
+  }
+  cost->seconds += seconds;
+
+  if (adjointer->callbacks.vec_get_size != NULL)
+  {
+    if (cost->bytes_source != ADJ_COST_MEASURED)
+    {
+      cost->bytes = 0;
+      cost->bytes_source = ADJ_COST_MEASURED;
+    }
+    adjointer->callbacks.vec_get_size(soln, &sz);
+    cost->bytes += (size_t) sz * sizeof(adj_scalar);
+  }
+
+  return ADJ_OK;
+}
+
+/* The seconds to advance from timestep l to each of the timesteps l+1, ..., r-1 in turn, starting over from l every time */
+static double adj_costs_advance_all(adj_cost_schedule* s, int l, int r)
+{
+  if (r <= l + 1) return 0.0;
+  return (s->prefix2[r] - s->prefix2[l + 1]) - (r - l - 1) * s->prefix[l];
+}
+
+static int adj_costs_emit(adj_cost_schedule* s, CACTION action, int check, int capo)
+{
+  if (s->nactions == s->actions_sz)
+  {
+    s->actions_sz = s->actions_sz == 0 ? 64 : 2 * s->actions_sz;
+    s->actions = (int*) realloc(s->actions, s->actions_sz * sizeof(int));
+    ADJ_CHKMALLOC(s->actions);
+    s->checks = (int*) realloc(s->checks, s->actions_sz * sizeof(int));
+    ADJ_CHKMALLOC(s->checks);
+    s->capos = (int*) realloc(s->capos, s->actions_sz * sizeof(int));
+    ADJ_CHKMALLOC(s->capos);
+  }
+  s->actions[s->nactions] = (int) action;
+  s->checks[s->nactions] = check;
+  s->capos[s->nactions] = capo;
+  s->nactions++;
+  return ADJ_OK;
+}
+
+/* Reverse the timesteps [first, end) one by one, each time restoring from the checkpoint `check` at first */
+static int adj_costs_emit_sweep(adj_cost_schedule* s, int first, int end, int check, int at_first)
+{
+  int i, ierr;
+
+  for (i = end - 1; i >= first; i--)
+  {
+    if (!at_first || i != end - 1)
+    {
+      ierr = adj_costs_emit(s, CACTION_RESTORE, check, first);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    if (i > first)
+    {
+      ierr = adj_costs_emit(s, CACTION_ADVANCE, check, i);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    /* The checkpoint is dropped once the reversal has passed it */
+    ierr = adj_costs_emit(s, CACTION_YOUTURN, i == first ? check - 1 : check, i);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  return ADJ_OK;
+}
+
+/* The actions of F(l, r, k), with the checkpoint at l in slot `check`; at_l says whether we are at l already */
+static int adj_costs_emit_reverse(adj_cost_schedule* s, int l, int r, int k, int check, int at_l)
+{
+  int m, ierr;
+
+  m = s->reverse_choice[ADJ_REVERSE_IDX(s, l, r, k)];
+  if (m < 0)
+    return adj_costs_emit_sweep(s, s->pos[l], s->pos[r], check, at_l);
+
+  if (!at_l)
+  {
+    ierr = adj_costs_emit(s, CACTION_RESTORE, check, s->pos[l]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  ierr = adj_costs_emit(s, CACTION_ADVANCE, check, s->pos[m]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_costs_emit(s, CACTION_TAKESHOT, check + 1, s->pos[m]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_costs_emit_reverse(s, m, r, k - s->units[m], check + 1, ADJ_TRUE);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  return adj_costs_emit_reverse(s, l, m, k, check, ADJ_FALSE);
+}
+
+/* The actions from the checkpoint at the start of block l on the way forward to the end */
+static int adj_costs_emit_forward(adj_cost_schedule* s, int l, int k, int check)
+{
+  int c, ierr;
+
+  c = s->forward_choice[ADJ_FORWARD_IDX(s, l, k)];
+  if (c < 0)
+  {
+    if (s->pos[l] < s->nsteps - 1)
+    {
+      ierr = adj_costs_emit(s, CACTION_ADVANCE, check, s->nsteps - 1);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    ierr = adj_costs_emit(s, CACTION_FIRSTRUN, check, s->nsteps - 1);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    return adj_costs_emit_sweep(s, s->pos[l], s->nsteps - 1, check, ADJ_FALSE);
+  }
+
+  ierr = adj_costs_emit(s, CACTION_ADVANCE, check, s->pos[c]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_costs_emit(s, CACTION_TAKESHOT, check + 1, s->pos[c]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_costs_emit_forward(s, c, k - s->units[c], check + 1);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  return adj_costs_emit_reverse(s, l, c, k, check, ADJ_FALSE);
+}
+
+/* Revolve's own schedule for the given number of checkpoints, and the seconds it recomputes */
+static int adj_costs_emit_revolve(adj_cost_schedule* s, int snaps, double* seconds)
+{
+  CRevolve r;
+  CACTION action;
+  int reversing = ADJ_FALSE, ierr = ADJ_OK;
+
+  *seconds = 0.0;
+  r = revolve_create_offline(s->nsteps, snaps);
+  do
+  {
+    action = revolve(r);
+    if (action == CACTION_TERMINATE || action == CACTION_ERROR) break;
+    if (action == CACTION_FIRSTRUN)
+      reversing = ADJ_TRUE;
+    else if (action == CACTION_ADVANCE && reversing)
+      *seconds += s->prefix[revolve_getcapo(r)] - s->prefix[revolve_getoldcapo(r)];
+    ierr = adj_costs_emit(s, action, revolve_getcheck(r), revolve_getcapo(r));
+  } while (ierr == ADJ_OK);
+  revolve_destroy(r);
+
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (action == CACTION_ERROR)
+  {
+    strncpy(adj_error_msg, "An internal error occured: Irregular termination of revolve.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_REVOLVE_ERROR);
+  }
+  return ADJ_OK;
+}
+
+static void adj_costs_destroy_schedule(adj_cost_schedule* s)
+{
+  free(s->pos);
+  free(s->units);
+  free(s->prefix);
+  free(s->prefix2);
+  free(s->reverse);
+  free(s->reverse_choice);
+  free(s->forward);
+  free(s->forward_choice);
+  free(s->actions);
+  free(s->checks);
+  free(s->capos);
+}
+
+int adj_costs_schedule(adj_adjointer* adjointer)
+{
+  struct adj_costs* costs = adjointer->costs;
+  adj_cost_schedule s, uniform;
+  adj_timestep_cost* cost;
+  double* seconds;
+  double* bytes;
+  double mean_seconds = 0.0, mean_bytes = 0.0, min_checkpoint = 0.0, max_checkpoint = 0.0, unit, best, c;
+  int nseconds = 0, nbytes = 0;
+  int n, g, i, l, r, m, k, q, len, k0, snaps, ierr;
+
+  n = adjointer->revolve_data.steps;
+  if (n < 2)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Cost-aware checkpointing needs to know the number of timesteps. Make sure you call adj_set_revolve_cost_options with 'steps>1'.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (costs == NULL || costs->byte_budget == 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Cost-aware checkpointing needs a byte budget. Make sure you call adj_set_revolve_cost_options.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  /* The timesteps we know nothing about are taken to cost as much as the ones we do know about, on average */
+  for (i = 0; i < n && i < costs->ntimesteps; i++)
+  {
+    cost = &costs->timesteps[i];
+    if (cost->seconds_source != ADJ_COST_UNKNOWN)
+    {
+      mean_seconds += cost->seconds;
+      nseconds++;
+    }
+    if (cost->bytes_source != ADJ_COST_UNKNOWN)
+    {
+      mean_bytes += (double) cost->bytes;
+      nbytes++;
+    }
+  }
+  if (nseconds == 0 || nbytes == 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Cost-aware checkpointing needs the cost of at least one timestep. Call adj_set_timestep_cost with an estimate, or solve a timestep with adj_get_forward_solution first.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  mean_seconds /= nseconds;
+  mean_bytes /= nbytes;
+
+  seconds = (double*) malloc(n * sizeof(double));
+  ADJ_CHKMALLOC(seconds);
+  bytes = (double*) malloc(n * sizeof(double));
+  ADJ_CHKMALLOC(bytes);
+  for (i = 0; i < n; i++)
+  {
+    cost = i < costs->ntimesteps ? &costs->timesteps[i] : NULL;
+    seconds[i] = (cost != NULL && cost->seconds_source != ADJ_COST_UNKNOWN) ? cost->seconds : mean_seconds;
+    bytes[i] = (cost != NULL && cost->bytes_source != ADJ_COST_UNKNOWN) ? (double) cost->bytes : mean_bytes;
+  }
+
+  memset(&s, 0, sizeof(adj_cost_schedule));
+  s.nsteps = n;
+  g = (n + ADJ_COSTS_MAX_BLOCKS - 1) / ADJ_COSTS_MAX_BLOCKS;
+  s.nblocks = (n + g - 1) / g;
+
+  s.prefix = (double*) malloc((n + 1) * sizeof(double));
+  ADJ_CHKMALLOC(s.prefix);
+  s.prefix2 = (double*) malloc((n + 1) * sizeof(double));
+  ADJ_CHKMALLOC(s.prefix2);
+  s.prefix[0] = 0.0;
+  s.prefix2[0] = 0.0;
+  for (i = 0; i < n; i++)
+  {
+    s.prefix[i + 1] = s.prefix[i] + seconds[i];
+    s.prefix2[i + 1] = s.prefix2[i] + s.prefix[i];
+  }
+
+  /* The checkpoint at the start of timestep t holds what timestep t-1 solved for */
+  s.pos = (int*) malloc((s.nblocks + 1) * sizeof(int));
+  ADJ_CHKMALLOC(s.pos);
+  s.units = (int*) malloc((s.nblocks + 1) * sizeof(int));
+  ADJ_CHKMALLOC(s.units);
+  for (l = 0; l < s.nblocks; l++)
+  {
+    s.pos[l] = l * g;
+    c = bytes[s.pos[l] > 0 ? s.pos[l] - 1 : 0];
+    if (c > 0.0 && (min_checkpoint == 0.0 || c < min_checkpoint))
+      min_checkpoint = c;
+  }
+  s.pos[s.nblocks] = n;
+  for (i = 0; i < n - 1; i++)
+    max_checkpoint = bytes[i] > max_checkpoint ? bytes[i] : max_checkpoint;
+
+  /* Pick the unit so that a budget of so many of the smallest checkpoints holds exactly that many */
+  if (min_checkpoint > 0.0)
+  {
+    q = (int) floor(ADJ_COSTS_BUDGET_UNITS * min_checkpoint / (double) costs->byte_budget);
+    q = q < 1 ? 1 : (q > ADJ_COSTS_UNITS_PER_CHECKPOINT ? ADJ_COSTS_UNITS_PER_CHECKPOINT : q);
+    unit = min_checkpoint / q;
+    c = floor((double) costs->byte_budget / unit + 1.0e-9);
+    s.nunits = c > ADJ_COSTS_BUDGET_UNITS ? ADJ_COSTS_BUDGET_UNITS : (int) c;
+    if (s.nunits == ADJ_COSTS_BUDGET_UNITS)
+      unit = (double) costs->byte_budget / ADJ_COSTS_BUDGET_UNITS;
+  }
+  else
+  {
+    s.nunits = ADJ_COSTS_BUDGET_UNITS;
+    unit = (double) costs->byte_budget / ADJ_COSTS_BUDGET_UNITS;
+  }
+  for (l = 0; l < s.nblocks; l++)
+  {
+    c = ceil(bytes[s.pos[l] > 0 ? s.pos[l] - 1 : 0] / unit - 1.0e-9);
+    s.units[l] = c > s.nunits ? s.nunits + 1 : (int) c;
+  }
+  s.units[s.nblocks] = s.nunits + 1;
+  free(seconds);
+  free(bytes);
+
+  k0 = s.nunits - s.units[0];
+  if (k0 < 0)
+  {
+    adj_costs_destroy_schedule(&s);
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The byte budget of %lu is too small for even the checkpoint of timestep 0.", (unsigned long) costs->byte_budget);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  s.reverse = (double*) malloc((size_t) (s.nblocks + 1) * (s.nblocks + 1) * (s.nunits + 1) * sizeof(double));
+  ADJ_CHKMALLOC(s.reverse);
+  s.reverse_choice = (int*) malloc((size_t) (s.nblocks + 1) * (s.nblocks + 1) * (s.nunits + 1) * sizeof(int));
+  ADJ_CHKMALLOC(s.reverse_choice);
+  s.forward = (double*) malloc((size_t) s.nblocks * (s.nunits + 1) * sizeof(double));
+  ADJ_CHKMALLOC(s.forward);
+  s.forward_choice = (int*) malloc((size_t) s.nblocks * (s.nunits + 1) * sizeof(int));
+  ADJ_CHKMALLOC(s.forward_choice);
+
+  /* F, shortest ranges first; the last block only ever ends the forward sweep */
+  for (len = 1; len < s.nblocks; len++)
+  {
+    for (l = 0; l + len < s.nblocks; l++)
+    {
+      r = l + len;
+      for (k = 0; k <= s.nunits; k++)
+      {
+        best = adj_costs_advance_all(&s, s.pos[l], s.pos[r]);
+        s.reverse_choice[ADJ_REVERSE_IDX(&s, l, r, k)] = -1;
+        /* A checkpoint at the last timestep of the range would never be restored from */
+        for (m = l + 1; m < r && s.pos[m] <= s.pos[r] - 2; m++)
+        {
+          if (s.units[m] > k) continue;
+          c = (s.prefix[s.pos[m]] - s.prefix[s.pos[l]]) + s.reverse[ADJ_REVERSE_IDX(&s, m, r, k - s.units[m])] + s.reverse[ADJ_REVERSE_IDX(&s, l, m, k)];
+          if (c < best)
+          {
+            best = c;
+            s.reverse_choice[ADJ_REVERSE_IDX(&s, l, r, k)] = m;
+          }
+        }
+        s.reverse[ADJ_REVERSE_IDX(&s, l, r, k)] = best;
+      }
+    }
+  }
+
+  /* The way forward, from the end backwards */
+  for (l = s.nblocks - 1; l >= 0; l--)
+  {
+    for (k = 0; k <= s.nunits; k++)
+    {
+      best = adj_costs_advance_all(&s, s.pos[l], n - 1);
+      s.forward_choice[ADJ_FORWARD_IDX(&s, l, k)] = -1;
+      for (m = l + 1; m < s.nblocks && s.pos[m] <= n - 2; m++)
+      {
+        if (s.units[m] > k) continue;
+        c = s.forward[ADJ_FORWARD_IDX(&s, m, k - s.units[m])] + s.reverse[ADJ_REVERSE_IDX(&s, l, m, k)];
+        if (c < best)
+        {
+          best = c;
+          s.forward_choice[ADJ_FORWARD_IDX(&s, l, k)] = m;
+        }
+      }
+      s.forward[ADJ_FORWARD_IDX(&s, l, k)] = best;
+    }
+  }
+
+  ierr = adj_costs_emit(&s, CACTION_TAKESHOT, 0, 0);
+  if (ierr == ADJ_OK)
+    ierr = adj_costs_emit_forward(&s, 0, k0, 0);
+  if (ierr != ADJ_OK)
+  {
+    adj_costs_destroy_schedule(&s);
+    return adj_chkierr_auto(ierr);
+  }
+
+  best = s.forward[ADJ_FORWARD_IDX(&s, 0, k0)];
+
+  /* With blocks of timesteps, or checkpoints of many sizes, revolve's own schedule with as many
+     checkpoints as the budget holds of the largest size may still do better */
+  c = max_checkpoint > 0.0 ? floor((double) costs->byte_budget / max_checkpoint + 1.0e-9) : n;
+  snaps = c > n ? n : (int) c;
+  if (snaps >= 2)
+  {
+    memset(&uniform, 0, sizeof(adj_cost_schedule));
+    uniform.nsteps = n;
+    uniform.prefix = s.prefix;
+    ierr = adj_costs_emit_revolve(&uniform, snaps, &c);
+    if (ierr != ADJ_OK)
+    {
+      free(uniform.actions);
+      free(uniform.checks);
+      free(uniform.capos);
+      adj_costs_destroy_schedule(&s);
+      return adj_chkierr_auto(ierr);
+    }
+    if (c < best)
+    {
+      best = c;
+      free(s.actions);
+      free(s.checks);
+      free(s.capos);
+      s.nactions = uniform.nactions;
+      s.actions = uniform.actions;
+      s.checks = uniform.checks;
+      s.capos = uniform.capos;
+    }
+    else
+    {
+      free(uniform.actions);
+      free(uniform.checks);
+      free(uniform.capos);
+    }
+  }
+
+  if (adjointer->revolve_data.verbose)
+    printf("Revolve: Cost-aware schedule for %i timesteps recomputes %g seconds.\n", n, best);
+
+  adjointer->revolve_data.revolve = revolve_create_prescribed(n, s.nactions, s.actions, s.checks, s.capos);
+  adj_costs_destroy_schedule(&s);
+  return ADJ_OK;
+}
+
+int adj_destroy_costs(adj_adjointer* adjointer)
+{
+  if (adjointer->costs == NULL) return ADJ_OK;
+
+  free(adjointer->costs->timesteps);
+  free(adjointer->costs->timed);
+  free(adjointer->costs);
+  adjointer->costs = NULL;
+  return ADJ_OK;
+}
@@ -1,5 +1,6 @@
 #include "libadjoint/adj_data_structures.h"
 #include "libadjoint/adj_error_handling.h"
+#include "libadjoint/adj_vec_pool.h"
 
 int adj_create_variable(char* name, int timestep, int iteration, int auxiliary, adj_variable* var)
 {
@@ -94,6 +95,7 @@ int adj_create_nonlinear_block(char* name, int ndepends, adj_variable* depends,
   nblock->tolerance = (adj_scalar) 0.0;
   nblock->test_derivative = ADJ_FALSE;
   nblock->number_of_rounds = 0;
+  nblock->callbacks = NULL;
   return ADJ_OK;
 }
 
@@ -142,6 +144,7 @@ int adj_create_block(char* name, adj_nonlinear_block* nblock, void* context, adj
   block->test_hermitian = ADJ_FALSE;
   block->number_of_tests = 0;
   block->tolerance = (adj_scalar) 0.0;
+  block->callbacks = NULL;
 
   return ADJ_OK;
 }
@@ -419,6 +422,7 @@ int adj_create_equation(adj_variable var, int nblocks, adj_block* blocks, adj_va
 
   equation->rhs_callback = NULL;
   equation->rhs_deriv_action_callback = NULL;
+  equation->rhs_deriv_action_accumulate_callback = NULL;
 
   /* First, let's check the variable isn't auxiliary.
      Auxiliary means we don't solve an equation for it ... */
@@ -477,6 +481,7 @@ int adj_create_equation(adj_variable var, int nblocks, adj_block* blocks, adj_va
   equation->rhs_context = NULL;
   equation->rhs_callback = NULL;
   equation->rhs_deriv_action_callback = NULL;
+  equation->rhs_deriv_action_accumulate_callback = NULL;
   equation->rhs_second_deriv_action_callback = NULL;
   equation->rhs_deriv_assembly_callback = NULL;
 
@@ -534,6 +539,8 @@ int adj_variable_set_auxiliary(adj_variable* var, int auxiliary)
 
 int adj_create_nonlinear_block_derivative(adj_adjointer* adjointer, adj_nonlinear_block nblock, adj_scalar block_coefficient, adj_variable fwd, adj_vector contraction, int hermitian, int outer, adj_nonlinear_block_derivative* deriv)
 {
+  int ierr;
+
   if (adjointer->callbacks.vec_duplicate == NULL)
   {
     snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "We need the ADJ_VEC_DUPLICATE_CB callback to do nonlinear differentiation.");
@@ -556,7 +563,8 @@ int adj_create_nonlinear_block_derivative(adj_adjointer* adjointer, adj_nonlinea
      of derivatives we have to compute will create new contractions.) So we make it so that
      the nonlinear_block_derivative ALWAYS owns its contraction, so that we can unambiguously
      decide to deallocate it. */
-  adjointer->callbacks.vec_duplicate(contraction, &(deriv->contraction));
+  ierr = adj_vec_pool_get(adjointer, contraction, &(deriv->contraction));
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
   adjointer->callbacks.vec_axpy(&(deriv->contraction), (adj_scalar) 1.0, contraction);
 
   return ADJ_OK;
@@ -570,8 +578,7 @@ int adj_destroy_nonlinear_block_derivative(adj_adjointer* adjointer, adj_nonline
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
 
-  adjointer->callbacks.vec_destroy(&(deriv->contraction));
-  return ADJ_OK;
+  return adj_vec_pool_put(adjointer, &(deriv->contraction));
 }
 
 int adj_create_nonlinear_block_second_derivative(adj_adjointer* adjointer, adj_nonlinear_block nblock, adj_scalar block_coefficient, 
@@ -629,6 +636,13 @@ int adj_equation_set_rhs_derivative_action_callback(adj_equation* equation, void
   return ADJ_OK;
 }
 
+int adj_equation_set_rhs_derivative_action_accumulate_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
+                                    adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output))
+{
+  equation->rhs_deriv_action_accumulate_callback = (void (*) (void* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output)) fn;
+  return ADJ_OK;
+}
+
 int adj_equation_set_rhs_second_derivative_action_callback(adj_equation* equation, void (*fn)(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, \
                                     adj_variable inner_variable, adj_vector inner_contraction, adj_variable outer_variable, int hermitian, adj_vector action, void* context, adj_vector* output, int* has_output))
 {
@@ -3,13 +3,12 @@
 int adj_adjointer_check_consistency(adj_adjointer* adjointer)
 {
   int ierr;
-  adj_variable_hash* hash_ptr;
+  int id;
 
-  hash_ptr = adjointer->varhash;
-  while(hash_ptr != NULL)
+  for (id = 0; id < adjointer->nvariables; id++)
   {
-    adj_variable var = hash_ptr->variable;
-    adj_variable_data* data_ptr = hash_ptr->data;
+    adj_variable_data* data_ptr = ADJ_VARIABLE_DATA(adjointer, id);
+    adj_variable var = adjointer->varentries[id]->variable;
 
     if (var.auxiliary == ADJ_FALSE && data_ptr->equation < 0)
     {
@@ -19,8 +18,6 @@ int adj_adjointer_check_consistency(adj_adjointer* adjointer)
       snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Variable %s is not auxiliary, but has no equation set for it.", buf);
       return adj_chkierr_auto(ierr);
     }
-
-    hash_ptr = (adj_variable_hash*) hash_ptr->hh.next;
   }
 
   return ADJ_OK;
@@ -209,7 +206,7 @@ int adj_adjointer_check_checkpoints(adj_adjointer* adjointer)
 
   if (cp_num>0)
   {
-    adj_variable_hash* varhash;
+    int id;
     adj_variable_data* data;
 
     /* The first checkpoint equation must be zero, otherwise */
@@ -221,9 +218,9 @@ int adj_adjointer_check_checkpoints(adj_adjointer* adjointer)
     }
 
     /* Check we have the required variables for the adjoint equations */
-    for(varhash = adjointer->varhash; varhash != NULL; varhash = (adj_variable_hash*) varhash->hh.next)
+    for (id = 0; id < adjointer->nvariables; id++)
     {
-    	data = varhash->data;
+      data = ADJ_VARIABLE_DATA(adjointer, id);
       /* We are only interested in forward variables */
       if (data->equation < 0)
         continue;
@@ -299,13 +296,13 @@ int adj_test_block_action_transpose(adj_adjointer* adjointer, adj_block block, a
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_BLOCK_ACTION_CB, block.name, (void (**)(void)) &block_action_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_BLOCK_ACTION_CB, block.callbacks, block.name, (void (**)(void)) &block_action_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
 
-  adjointer->callbacks.vec_duplicate(model_input, &x);
-  adjointer->callbacks.vec_duplicate(model_output, &y);
+  adj_vec_pool_get(adjointer, model_input, &x);
+  adj_vec_pool_get(adjointer, model_output, &y);
   block.test_hermitian = ADJ_FALSE;
 
   for (i = 0; i < N; i++)
@@ -325,8 +322,8 @@ int adj_test_block_action_transpose(adj_adjointer* adjointer, adj_block block, a
 
     adjointer->callbacks.vec_dot_product(x, ATy, &ATyx);
     adjointer->callbacks.vec_dot_product(y, Ax, &yAx);
-    adjointer->callbacks.vec_destroy(&ATy);
-    adjointer->callbacks.vec_destroy(&Ax);
+    adj_vec_pool_put(adjointer, &ATy);
+    adj_vec_pool_put(adjointer, &Ax);
 
     if (COMPLEX_ABS(yAx - ATyx) > tol) 
     {
@@ -336,8 +333,8 @@ int adj_test_block_action_transpose(adj_adjointer* adjointer, adj_block block, a
     }
   }
 
-  adjointer->callbacks.vec_destroy(&x);
-  adjointer->callbacks.vec_destroy(&y);
+  adj_vec_pool_put(adjointer, &x);
+  adj_vec_pool_put(adjointer, &y);
 
   return adj_chkierr_auto(ierr);
 }
@@ -371,13 +368,13 @@ int adj_test_nonlinear_derivative_action_transpose(adj_adjointer* adjointer, adj
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, nonlinear_block_derivative.nonlinear_block.callbacks, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
 
-  adjointer->callbacks.vec_duplicate(model_input, &x);
-  adjointer->callbacks.vec_duplicate(model_output, &y);
+  adj_vec_pool_get(adjointer, model_input, &x);
+  adj_vec_pool_get(adjointer, model_output, &y);
   nonlinear_block_derivative.nonlinear_block.test_deriv_hermitian = ADJ_FALSE;
   nonlinear_block_derivative.nonlinear_block.test_derivative = ADJ_FALSE;
 
@@ -385,8 +382,8 @@ int adj_test_nonlinear_derivative_action_transpose(adj_adjointer* adjointer, adj
   {
     adjointer->callbacks.vec_set_random(&x);
     adjointer->callbacks.vec_set_random(&y);
-    adjointer->callbacks.vec_duplicate(model_output, &Gx);
-    adjointer->callbacks.vec_duplicate(model_input, &GTy);
+    adj_vec_pool_get(adjointer, model_output, &Gx);
+    adj_vec_pool_get(adjointer, model_input, &GTy);
 
     ierr = adj_evaluate_nonlinear_derivative_action(adjointer, 1, &nonlinear_block_derivative, x, &Gx);
     if (ierr != ADJ_OK)
@@ -400,8 +397,8 @@ int adj_test_nonlinear_derivative_action_transpose(adj_adjointer* adjointer, adj
 
     adjointer->callbacks.vec_dot_product(x, GTy, &GTyx);
     adjointer->callbacks.vec_dot_product(y, Gx, &yGx);
-    adjointer->callbacks.vec_destroy(&GTy);
-    adjointer->callbacks.vec_destroy(&Gx);
+    adj_vec_pool_put(adjointer, &GTy);
+    adj_vec_pool_put(adjointer, &Gx);
 
     if (COMPLEX_ABS(yGx - GTyx) > tol) 
     {
@@ -411,8 +408,8 @@ int adj_test_nonlinear_derivative_action_transpose(adj_adjointer* adjointer, adj
     }
   }
 
-  adjointer->callbacks.vec_destroy(&x);
-  adjointer->callbacks.vec_destroy(&y);
+  adj_vec_pool_put(adjointer, &x);
+  adj_vec_pool_put(adjointer, &y);
 
   return adj_chkierr_auto(ierr);
 }
@@ -483,11 +480,11 @@ int adj_test_nonlinear_derivative_action_consistency(adj_adjointer* adjointer, a
     return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
   }
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_ACTION_CB, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_action_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_ACTION_CB, nonlinear_block_derivative.nonlinear_block.callbacks, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_action_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, nonlinear_block_derivative.nonlinear_block.callbacks, nonlinear_block_derivative.nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
@@ -501,20 +498,20 @@ int adj_test_nonlinear_derivative_action_consistency(adj_adjointer* adjointer, a
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
   /* First, let's check if contraction vector is suitable (nonzero) */
-  adjointer->callbacks.vec_duplicate(nonlinear_block_derivative.contraction, &contraction_bak);
+  adj_vec_pool_get(adjointer, nonlinear_block_derivative.contraction, &contraction_bak);
   adjointer->callbacks.vec_axpy(&contraction_bak, (adj_scalar) 1.0, nonlinear_block_derivative.contraction);
 
   adjointer->callbacks.vec_get_norm(nonlinear_block_derivative.contraction, &contraction_norm);
   if (contraction_norm > 0)
   {
-    adjointer->callbacks.vec_duplicate(nonlinear_block_derivative.contraction, &contraction);
+    adj_vec_pool_get(adjointer, nonlinear_block_derivative.contraction, &contraction);
     adjointer->callbacks.vec_axpy(&contraction, (adj_scalar) 1.0, nonlinear_block_derivative.contraction);
   }
   else
   {
     int contraction_sz;
     adj_scalar* contraction_vec; /* the direction of the perturbation */
-    adjointer->callbacks.vec_duplicate(nonlinear_block_derivative.contraction, &contraction);
+    adj_vec_pool_get(adjointer, nonlinear_block_derivative.contraction, &contraction);
     adjointer->callbacks.vec_get_size(nonlinear_block_derivative.contraction, &contraction_sz);
 
     contraction_vec = (adj_scalar*) malloc(contraction_sz * sizeof(adj_scalar));
@@ -533,7 +530,7 @@ int adj_test_nonlinear_derivative_action_consistency(adj_adjointer* adjointer, a
   ierr = adj_evaluate_nonlinear_action(adjointer, nonlinear_action_func, nonlinear_block_derivative.nonlinear_block, contraction, NULL, NULL, &original_output);
   if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
 
-  adjointer->callbacks.vec_duplicate(original_dependency, &dependency_perturbation);
+  adj_vec_pool_get(adjointer, original_dependency, &dependency_perturbation);
   fd_errors = (adj_scalar*) malloc(N * sizeof(adj_scalar));
   ADJ_CHKMALLOC(fd_errors);
   grad_errors = (adj_scalar*) malloc(N * sizeof(adj_scalar));
@@ -574,10 +571,10 @@ int adj_test_nonlinear_derivative_action_consistency(adj_adjointer* adjointer, a
       return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
     }
 
-    adjointer->callbacks.vec_duplicate(original_output, &gradient);
+    adj_vec_pool_get(adjointer, original_output, &gradient);
     ierr = adj_evaluate_nonlinear_derivative_action(adjointer, 1, &nonlinear_block_derivative, dependency_perturbation, &gradient);
     adjointer->callbacks.vec_axpy(&perturbed_output, (adj_scalar) 1.0, gradient);
-    adjointer->callbacks.vec_destroy(&gradient);
+    adj_vec_pool_put(adjointer, &gradient);
 
     adjointer->callbacks.vec_get_norm(perturbed_output, &grad_errors[i]);
     if (isnan(grad_errors[i]))
@@ -585,18 +582,18 @@ int adj_test_nonlinear_derivative_action_consistency(adj_adjointer* adjointer, a
       snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "A norm during the derivative test returned NaN.");
       return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
     }
-    adjointer->callbacks.vec_destroy(&perturbed_output);
+    adj_vec_pool_put(adjointer, &perturbed_output);
   }
 
   free(perturbations);
   free(unscaled_perturbation);
-  adjointer->callbacks.vec_destroy(&dependency_perturbation);
-  adjointer->callbacks.vec_destroy(&original_output);
+  adj_vec_pool_put(adjointer, &dependency_perturbation);
+  adj_vec_pool_put(adjointer, &original_output);
 
   adjointer->callbacks.vec_axpy(&nonlinear_block_derivative.contraction, (adj_scalar)-1.0, contraction);
   adjointer->callbacks.vec_axpy(&nonlinear_block_derivative.contraction, (adj_scalar) 1.0, contraction_bak);
 
-  adjointer->callbacks.vec_destroy(&contraction);
+  adj_vec_pool_put(adjointer, &contraction);
 
   /* Now we analyse the fd_errors and grad_errors to investigate the order of convergence.
      fd_errors should converge at first order, and grad_errors should converge at second order. */
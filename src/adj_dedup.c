@@ -0,0 +1,228 @@
+#include "libadjoint/adj_dedup.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+#include <stdint.h>
+
+/* With deduplication switched on (adj_set_deduplication), ADJ_STORAGE_MEMORY_COPY values in
+   full precision are taken apart with vec_get_values and hashed when they are recorded. Values
+   whose contents are bitwise the same as a copy already held share that copy instead of getting
+   their own: time-invariant coefficients, boundary data and converged nonlinear iterations
+   come up again and again. The hash only picks the candidate; the contents are compared in
+   full before anything is shared.
+
+   A shared copy is counted by the values that hold it, and destroyed when the last of them is
+   forgotten from memory. Under a memory budget it is charged to one of its holders only, and the
+   charge moves on to another holder when that one lets go. */
+
+struct adj_dedup_entry
+{
+  uint64_t hash;
+  int klass;
+  int nscalars;
+  int nrefs;
+  adj_vector value;
+  adj_variable_data* charged; /* the holder whose memory_size pays for the copy */
+  adj_hash_handle hh;
+};
+
+struct adj_dedup
+{
+  int on;
+  struct adj_dedup_entry* entries;
+  int ncopies;
+  size_t shared_bytes; /* what the shared copies take */
+  size_t saved_bytes; /* what the extra references to them would have taken as copies of their own */
+};
+
+static uint64_t adj_dedup_hash(adj_scalar* scalars, int nscalars, int klass)
+{
+  const unsigned char* bytes = (const unsigned char*) scalars;
+  uint64_t hash = UINT64_C(14695981039346656037);
+  size_t i;
+
+  /* FNV-1a, with the layout folded in */
+  for (i = 0; i < (size_t) nscalars * sizeof(adj_scalar); i++)
+    hash = (hash ^ bytes[i]) * UINT64_C(1099511628211);
+  hash = (hash ^ (uint64_t) (unsigned int) nscalars) * UINT64_C(1099511628211);
+  hash = (hash ^ (uint64_t) (unsigned int) klass) * UINT64_C(1099511628211);
+  return hash;
+}
+
+int adj_set_deduplication(adj_adjointer* adjointer, int dedup)
+{
+  if (dedup != ADJ_TRUE && dedup != ADJ_FALSE)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "dedup must either be ADJ_TRUE or ADJ_FALSE.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  if (adjointer->dedup == NULL)
+  {
+    if (dedup == ADJ_FALSE) return ADJ_OK;
+    adjointer->dedup = (struct adj_dedup*) malloc(sizeof(struct adj_dedup));
+    ADJ_CHKMALLOC(adjointer->dedup);
+    memset(adjointer->dedup, 0, sizeof(struct adj_dedup));
+  }
+
+  /* Copies already shared stay shared until they are forgotten */
+  adjointer->dedup->on = dedup;
+  return ADJ_OK;
+}
+
+int adj_dedup_copy_value(adj_adjointer* adjointer, adj_variable_data* data, adj_storage_data storage)
+{
+  struct adj_dedup* dedup = adjointer->dedup;
+  struct adj_dedup_entry* entry;
+  adj_scalar* scalars;
+  adj_scalar* shared;
+  uint64_t hash;
+  int nscalars, same;
+
+  if (dedup == NULL || !dedup->on)
+  {
+    adjointer->callbacks.vec_duplicate(storage.value, &(data->storage.value));
+    adjointer->callbacks.vec_axpy(&(data->storage.value), (adj_scalar)1.0, storage.value);
+    return ADJ_OK;
+  }
+
+  if (adjointer->callbacks.vec_get_size == NULL || adjointer->callbacks.vec_get_values == NULL)
+  {
+    strncpy(adj_error_msg, "Deduplication needs the ADJ_VEC_GET_SIZE_CB and ADJ_VEC_GET_VALUES_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  adjointer->callbacks.vec_get_size(storage.value, &nscalars);
+  scalars = (adj_scalar*) malloc(nscalars * sizeof(adj_scalar) + 1);
+  ADJ_CHKMALLOC(scalars);
+  adjointer->callbacks.vec_get_values(storage.value, &scalars);
+  hash = adj_dedup_hash(scalars, nscalars, storage.value.klass);
+
+  HASH_FIND(hh, dedup->entries, &hash, sizeof(uint64_t), entry);
+  if (entry != NULL)
+  {
+    same = (entry->klass == storage.value.klass && entry->nscalars == nscalars);
+    if (same)
+    {
+      shared = (adj_scalar*) malloc(nscalars * sizeof(adj_scalar) + 1);
+      ADJ_CHKMALLOC(shared);
+      adjointer->callbacks.vec_get_values(entry->value, &shared);
+      same = (memcmp(scalars, shared, nscalars * sizeof(adj_scalar)) == 0);
+      free(shared);
+    }
+    free(scalars);
+
+    if (same)
+    {
+      entry->nrefs++;
+      dedup->saved_bytes += nscalars * sizeof(adj_scalar);
+      data->storage.value = entry->value;
+      data->storage.shared = entry;
+      return ADJ_OK;
+    }
+
+    /* A collision: this one gets a copy of its own */
+    adjointer->callbacks.vec_duplicate(storage.value, &(data->storage.value));
+    adjointer->callbacks.vec_axpy(&(data->storage.value), (adj_scalar)1.0, storage.value);
+    return ADJ_OK;
+  }
+  free(scalars);
+
+  entry = (struct adj_dedup_entry*) malloc(sizeof(struct adj_dedup_entry));
+  ADJ_CHKMALLOC(entry);
+  entry->hash = hash;
+  entry->klass = storage.value.klass;
+  entry->nscalars = nscalars;
+  entry->nrefs = 1;
+  entry->charged = NULL;
+  adjointer->callbacks.vec_duplicate(storage.value, &(entry->value));
+  adjointer->callbacks.vec_axpy(&(entry->value), (adj_scalar)1.0, storage.value);
+  HASH_ADD(hh, dedup->entries, hash, sizeof(uint64_t), entry);
+
+  dedup->ncopies++;
+  dedup->shared_bytes += nscalars * sizeof(adj_scalar);
+  data->storage.value = entry->value;
+  data->storage.shared = entry;
+  return ADJ_OK;
+}
+
+/* Whether data should be charged for its value under the memory budget */
+int adj_dedup_take_charge(adj_variable_data* data)
+{
+  struct adj_dedup_entry* entry = data->storage.shared;
+
+  if (entry == NULL) return ADJ_TRUE;
+  if (entry->charged != NULL && entry->charged != data) return ADJ_FALSE;
+
+  entry->charged = data;
+  return ADJ_TRUE;
+}
+
+int adj_dedup_release(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_dedup* dedup = adjointer->dedup;
+  struct adj_dedup_entry* entry = data->storage.shared;
+  adj_variable_data* other;
+  int k;
+
+  data->storage.shared = NULL;
+  memset(&(data->storage.value), 0, sizeof(adj_vector));
+
+  entry->nrefs--;
+  if (entry->nrefs > 0)
+  {
+    dedup->saved_bytes -= entry->nscalars * sizeof(adj_scalar);
+    if (entry->charged != data) return ADJ_OK;
+
+    /* Hand the charge on to another forward holder, if there is one */
+    entry->charged = NULL;
+    for (k = 0; k < adjointer->nlive_variables; k++)
+    {
+      other = ADJ_VARIABLE_DATA(adjointer, adjointer->live_variables[k]);
+      if (other != data && other->storage.shared == entry && other->type == ADJ_FORWARD)
+      {
+        other->memory_size = data->memory_size;
+        entry->charged = other;
+        data->memory_size = 0;
+        break;
+      }
+    }
+    return ADJ_OK;
+  }
+
+  HASH_DEL(dedup->entries, entry);
+  adjointer->callbacks.vec_destroy(&(entry->value));
+  dedup->ncopies--;
+  dedup->shared_bytes -= entry->nscalars * sizeof(adj_scalar);
+  free(entry);
+  return ADJ_OK;
+}
+
+int adj_get_deduplication_stats(adj_adjointer* adjointer, int* ncopies, size_t* shared_bytes, size_t* saved_bytes)
+{
+  struct adj_dedup* dedup = adjointer->dedup;
+
+  *ncopies = (dedup == NULL) ? 0 : dedup->ncopies;
+  *shared_bytes = (dedup == NULL) ? 0 : dedup->shared_bytes;
+  *saved_bytes = (dedup == NULL) ? 0 : dedup->saved_bytes;
+  return ADJ_OK;
+}
+
+int adj_destroy_dedup(adj_adjointer* adjointer)
+{
+  struct adj_dedup_entry* entry;
+  struct adj_dedup_entry* tmp;
+
+  if (adjointer->dedup == NULL) return ADJ_OK;
+
+  /* Every holder has been forgotten by now, so this only frees what an error left behind */
+  HASH_ITER(hh, adjointer->dedup->entries, entry, tmp)
+  {
+    HASH_DEL(adjointer->dedup->entries, entry);
+    if (adjointer->callbacks.vec_destroy != NULL)
+      adjointer->callbacks.vec_destroy(&(entry->value));
+    free(entry);
+  }
+  free(adjointer->dedup);
+  adjointer->dedup = NULL;
+  return ADJ_OK;
+}
@@ -0,0 +1,163 @@
+#include "libadjoint/adj_digest.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+#include <math.h>
+
+/* Replay verification (adj_set_revolve_verification) checks that the forward values the
+   checkpointing recomputes match those of the original forward run, like the overwrite flag of
+   adj_set_revolve_debug_options, but without keeping the values themselves: the first time a
+   forward variable is recorded, a digest of it is kept (its 2-norm and the sums of its scalars
+   over ADJ_DIGEST_NBLOCKS contiguous blocks), and whenever it is recorded again, the new
+   value's digest is compared with that one. Forgetting carries on as normal, so the check
+   costs a few scalars a variable and can be left on for production runs.
+
+   If the new value is within the tolerance of the original in the 2-norm, the norms differ by
+   no more than the tolerance and the sum over a block of n scalars by no more than sqrt(n)
+   times it, so a replay that is fine never fails the check. The converse doesn't hold: the
+   digest can miss a difference that the norm, and every block sum, happen to hide. */
+
+#define ADJ_DIGEST_NBLOCKS 8
+
+typedef struct
+{
+  int recorded;
+  int nscalars;
+  adj_scalar norm;
+  adj_scalar sums[ADJ_DIGEST_NBLOCKS];
+} adj_digest;
+
+struct adj_digests
+{
+  int verify;
+  adj_scalar tolerance;
+  int ndigests; /* the digests are indexed by the id of the variable data */
+  adj_digest* digests;
+  int nchecked;
+  int nfailed;
+};
+
+static int adj_digest_block_start(int nscalars, int block)
+{
+  return (int) (((long) nscalars * block) / ADJ_DIGEST_NBLOCKS);
+}
+
+static int adj_digest_compute(adj_adjointer* adjointer, adj_vector value, adj_digest* digest)
+{
+  adj_scalar* scalars;
+  int i, block;
+
+  adjointer->callbacks.vec_get_size(value, &digest->nscalars);
+  scalars = (adj_scalar*) malloc(digest->nscalars * sizeof(adj_scalar) + 1);
+  ADJ_CHKMALLOC(scalars);
+  adjointer->callbacks.vec_get_values(value, &scalars);
+
+  digest->norm = 0.0;
+  for (i = 0; i < digest->nscalars; i++)
+    digest->norm += scalars[i] * scalars[i];
+  digest->norm = sqrt(digest->norm);
+
+  for (block = 0; block < ADJ_DIGEST_NBLOCKS; block++)
+  {
+    digest->sums[block] = 0.0;
+    for (i = adj_digest_block_start(digest->nscalars, block); i < adj_digest_block_start(digest->nscalars, block + 1); i++)
+      digest->sums[block] += scalars[i];
+  }
+
+  free(scalars);
+  digest->recorded = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+int adj_set_revolve_verification(adj_adjointer* adjointer, int verify, adj_scalar tolerance)
+{
+  if (verify != ADJ_TRUE && verify != ADJ_FALSE)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "verify must either be ADJ_TRUE or ADJ_FALSE.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (tolerance < 0.0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The verification tolerance must be >= 0.0, but got %e.", tolerance);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  if (adjointer->digests == NULL)
+  {
+    if (verify == ADJ_FALSE) return ADJ_OK;
+    adjointer->digests = (struct adj_digests*) malloc(sizeof(struct adj_digests));
+    ADJ_CHKMALLOC(adjointer->digests);
+    memset(adjointer->digests, 0, sizeof(struct adj_digests));
+  }
+
+  adjointer->digests->verify = verify;
+  adjointer->digests->tolerance = tolerance;
+  return ADJ_OK;
+}
+
+int adj_digest_recorded(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_storage_data storage)
+{
+  struct adj_digests* digests = adjointer->digests;
+  adj_digest replayed;
+  adj_digest* original;
+  adj_scalar tolerance;
+  char buf[ADJ_NAME_LEN];
+  int block, n, failed, ierr;
+
+  if (digests == NULL || !digests->verify || var.type != ADJ_FORWARD) return ADJ_OK;
+
+  if (adjointer->callbacks.vec_get_size == NULL || adjointer->callbacks.vec_get_values == NULL)
+  {
+    strncpy(adj_error_msg, "Replay verification needs the ADJ_VEC_GET_SIZE_CB and ADJ_VEC_GET_VALUES_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  if (data->id >= digests->ndigests)
+  {
+    n = digests->ndigests;
+    digests->ndigests = adjointer->variables_sz;
+    digests->digests = (adj_digest*) realloc(digests->digests, digests->ndigests * sizeof(adj_digest));
+    ADJ_CHKMALLOC(digests->digests);
+    memset(digests->digests + n, 0, (digests->ndigests - n) * sizeof(adj_digest));
+  }
+
+  original = &digests->digests[data->id];
+  if (!original->recorded)
+    return adj_digest_compute(adjointer, storage.value, original);
+
+  ierr = adj_digest_compute(adjointer, storage.value, &replayed);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  tolerance = digests->tolerance;
+  failed = (replayed.nscalars != original->nscalars || fabs(replayed.norm - original->norm) > tolerance);
+  for (block = 0; block < ADJ_DIGEST_NBLOCKS && !failed; block++)
+  {
+    n = adj_digest_block_start(original->nscalars, block + 1) - adj_digest_block_start(original->nscalars, block);
+    if (fabs(replayed.sums[block] - original->sums[block]) > sqrt((adj_scalar) n) * tolerance)
+      failed = 1;
+  }
+
+  digests->nchecked++;
+  if (!failed) return ADJ_OK;
+
+  digests->nfailed++;
+  adj_variable_str(var, buf, ADJ_NAME_LEN);
+  snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The replayed value of %s doesn't match the digest of the original: norm %e against %e (tolerance %e).", buf, replayed.norm, original->norm, tolerance);
+  return adj_chkierr_auto(ADJ_WARN_COMPARISON_FAILED);
+}
+
+int adj_get_revolve_verification_stats(adj_adjointer* adjointer, int* nchecked, int* nfailed)
+{
+  *nchecked = (adjointer->digests == NULL) ? 0 : adjointer->digests->nchecked;
+  *nfailed = (adjointer->digests == NULL) ? 0 : adjointer->digests->nfailed;
+  return ADJ_OK;
+}
+
+int adj_destroy_digests(adj_adjointer* adjointer)
+{
+  if (adjointer->digests == NULL) return ADJ_OK;
+
+  free(adjointer->digests->digests);
+  free(adjointer->digests);
+  adjointer->digests = NULL;
+  return ADJ_OK;
+}
@@ -0,0 +1,591 @@
+#include "libadjoint/adj_disk_store.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* A disk backend for models that would otherwise write one file per variable value. Once
+   adj_set_disk_store is called, the ADJ_VEC_WRITE_CB, ADJ_VEC_READ_CB and ADJ_VEC_DELETE_CB
+   data callbacks are the ones below, and every value recorded to disk is appended to a log
+   in the given directory, as a record of the variable's key, the value's klass and size, and
+   its scalars. An in-memory index maps each variable key to the latest record of its value.
+
+   The log is split into segment files of about segment_size bytes: once the segment being
+   appended to is full, a new one is started. Overwriting or deleting a value only drops its
+   index entry, and when the last live record of a full segment goes, the whole segment file
+   is removed, so the space taken by forgotten values comes back a segment at a time without
+   ever rewriting a file.
+
+   Values are taken apart with vec_get_size and vec_get_values, and put back together by
+   duplicating a vector of the same layout (kept from the first value of that klass and size
+   written) and filling it with vec_set_values.
+
+   If the model supplies the ADJ_VEC_WRAP_VALUES_CB data callback, values restored through
+   adj_get_variable_value and memory checkpoints do not go through vec_read at all: the record
+   is mapped privately into memory with mmap and wrapped as a vector in place, so nothing is
+   copied, pages are only read in as they are touched, and the mapping turns copy-on-write if
+   the model changes the value. The mapping goes when the value is forgotten from memory, and
+   outlives the segment file if need be.
+
+   The data callbacks carry no context, so there is one store per process, owned by the
+   adjointer that set it up. It is locked, as write-behind and prefetch call it from their
+   worker threads; the vector callbacks it uses must then be safe to call from them too. */
+
+#include <sys/mman.h>
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+typedef struct
+{
+  adj_variable_key key;
+  int segment; /* the segment the latest record of the value is in */
+  long offset; /* where its scalars start in that segment */
+  int klass;
+  int nscalars;
+  adj_hash_handle hh;
+} adj_disk_store_entry;
+
+typedef struct
+{
+  adj_variable_key key;
+  int klass;
+  int nscalars;
+} adj_disk_store_header; /* written in front of the scalars of each record */
+
+typedef struct
+{
+  FILE* file; /* NULL once the segment has been removed */
+  long size; /* bytes appended so far */
+  int nlive; /* records in it that the index still points to */
+} adj_disk_segment;
+
+typedef struct
+{
+  int klass;
+  int nscalars;
+  adj_vector value;
+} adj_disk_store_template;
+
+typedef struct
+{
+  adj_adjointer* owner; /* NULL if no adjointer has set the store up */
+  char* directory;
+  size_t segment_size;
+
+  adj_disk_segment* segments;
+  int nsegments;
+  int segments_sz;
+
+  adj_disk_store_entry* index;
+  adj_name_intern* names; /* our own name table, as the global one is not safe to use from other threads */
+  int nnames;
+
+  adj_disk_store_template* templates;
+  int ntemplates;
+  int templates_sz;
+
+  void (*vec_duplicate)(adj_vector x, adj_vector *newx);
+  void (*vec_destroy)(adj_vector *x);
+  void (*vec_get_size)(adj_vector x, int *sz);
+  void (*vec_get_values)(adj_vector vec, adj_scalar *scalars[]);
+  void (*vec_set_values)(adj_vector *vec, adj_scalar scalars[]);
+} adj_disk_store;
+
+static adj_disk_store adj_store;
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t adj_store_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void adj_disk_store_lock(void)
+{
+#ifdef HAVE_PTHREADS
+  pthread_mutex_lock(&adj_store_lock);
+#endif
+}
+
+static void adj_disk_store_unlock(void)
+{
+#ifdef HAVE_PTHREADS
+  pthread_mutex_unlock(&adj_store_lock);
+#endif
+}
+
+static int adj_disk_store_intern(char* name, int* id)
+{
+  adj_name_intern* entry;
+  size_t len;
+
+  len = strnlen(name, ADJ_NAME_LEN);
+  HASH_FIND(hh, adj_store.names, name, len, entry);
+  if (entry == NULL)
+  {
+    entry = (adj_name_intern*) malloc(sizeof(adj_name_intern));
+    ADJ_CHKMALLOC(entry);
+    entry->name = (char*) malloc((len + 1) * sizeof(char));
+    ADJ_CHKMALLOC(entry->name);
+    memcpy(entry->name, name, len);
+    entry->name[len] = '\0';
+    entry->id = adj_store.nnames++;
+    HASH_ADD_KEYPTR(hh, adj_store.names, entry->name, len, entry);
+  }
+
+  *id = entry->id;
+  return ADJ_OK;
+}
+
+static int adj_disk_store_key(adj_variable* var, adj_variable_key* key)
+{
+  int ierr;
+
+  memset(key, 0, sizeof(adj_variable_key));
+  ierr = adj_disk_store_intern(var->name, &key->name);
+  if (ierr != ADJ_OK) return ierr;
+  ierr = adj_disk_store_intern(var->functional, &key->functional);
+  if (ierr != ADJ_OK) return ierr;
+
+  key->timestep = var->timestep;
+  key->iteration = var->iteration;
+  key->type = var->type;
+  key->auxiliary = var->auxiliary;
+  return ADJ_OK;
+}
+
+static void adj_disk_store_segment_name(int segment, char* filename, size_t len)
+{
+  snprintf(filename, len, "%s/adj_segment_%d.log", adj_store.directory, segment);
+}
+
+/* Remove a segment once nothing in it is needed, unless we are still appending to it */
+static void adj_disk_store_reclaim(int segment)
+{
+  adj_disk_segment* seg = &adj_store.segments[segment];
+  char filename[ADJ_NAME_LEN];
+
+  if (seg->file == NULL || seg->nlive > 0 || segment == adj_store.nsegments - 1) return;
+
+  fclose(seg->file);
+  seg->file = NULL;
+  adj_disk_store_segment_name(segment, filename, ADJ_NAME_LEN);
+  remove(filename);
+}
+
+static void adj_disk_store_drop(adj_disk_store_entry* entry)
+{
+  HASH_DEL(adj_store.index, entry);
+  adj_store.segments[entry->segment].nlive--;
+  adj_disk_store_reclaim(entry->segment);
+  free(entry);
+}
+
+/* The segment to append to, starting a new one if the last is full */
+static int adj_disk_store_segment(int* segment)
+{
+  adj_disk_segment* seg;
+  char filename[ADJ_NAME_LEN];
+  int last;
+
+  last = adj_store.nsegments - 1;
+  if (last >= 0 && adj_store.segments[last].size < (long) adj_store.segment_size)
+  {
+    *segment = last;
+    return ADJ_OK;
+  }
+
+  if (adj_store.nsegments == adj_store.segments_sz)
+  {
+    int new_sz = (adj_store.segments_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * adj_store.segments_sz;
+    adj_store.segments = (adj_disk_segment*) realloc(adj_store.segments, new_sz * sizeof(adj_disk_segment));
+    ADJ_CHKMALLOC(adj_store.segments);
+    adj_store.segments_sz = new_sz;
+  }
+
+  seg = &adj_store.segments[adj_store.nsegments];
+  adj_disk_store_segment_name(adj_store.nsegments, filename, ADJ_NAME_LEN);
+  seg->file = fopen(filename, "w+b");
+  if (seg->file == NULL) return ADJ_ERR_INVALID_INPUTS;
+  seg->size = 0;
+  seg->nlive = 0;
+  adj_store.nsegments++;
+
+  /* The segment we were appending to may have emptied while we were */
+  if (last >= 0) adj_disk_store_reclaim(last);
+
+  *segment = adj_store.nsegments - 1;
+  return ADJ_OK;
+}
+
+static int adj_disk_store_find_template(int klass, int nscalars, adj_disk_store_template** tmpl)
+{
+  int i;
+
+  for (i = 0; i < adj_store.ntemplates; i++)
+    if (adj_store.templates[i].klass == klass && adj_store.templates[i].nscalars == nscalars)
+    {
+      *tmpl = &adj_store.templates[i];
+      return ADJ_OK;
+    }
+
+  *tmpl = NULL;
+  return ADJ_ERR_HASH_FAILED;
+}
+
+static int adj_disk_store_add_template(adj_vector x, int nscalars)
+{
+  adj_disk_store_template* tmpl;
+
+  if (adj_disk_store_find_template(x.klass, nscalars, &tmpl) == ADJ_OK) return ADJ_OK;
+
+  if (adj_store.ntemplates == adj_store.templates_sz)
+  {
+    int new_sz = (adj_store.templates_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * adj_store.templates_sz;
+    adj_store.templates = (adj_disk_store_template*) realloc(adj_store.templates, new_sz * sizeof(adj_disk_store_template));
+    ADJ_CHKMALLOC(adj_store.templates);
+    adj_store.templates_sz = new_sz;
+  }
+
+  tmpl = &adj_store.templates[adj_store.ntemplates++];
+  tmpl->klass = x.klass;
+  tmpl->nscalars = nscalars;
+  adj_store.vec_duplicate(x, &tmpl->value);
+  return ADJ_OK;
+}
+
+static int adj_disk_store_write(adj_variable* var, adj_vector x)
+{
+  adj_disk_store_header header;
+  adj_disk_store_entry* entry;
+  adj_disk_segment* seg;
+  adj_scalar* scalars;
+  int segment;
+  long offset;
+  int ierr;
+
+  memset(&header, 0, sizeof(adj_disk_store_header));
+  ierr = adj_disk_store_key(var, &header.key);
+  if (ierr != ADJ_OK) return ierr;
+  header.klass = x.klass;
+  adj_store.vec_get_size(x, &header.nscalars);
+
+  ierr = adj_disk_store_add_template(x, header.nscalars);
+  if (ierr != ADJ_OK) return ierr;
+
+  scalars = (adj_scalar*) malloc(header.nscalars * sizeof(adj_scalar));
+  ADJ_CHKMALLOC(scalars);
+  adj_store.vec_get_values(x, &scalars);
+
+  ierr = adj_disk_store_segment(&segment);
+  if (ierr != ADJ_OK)
+  {
+    free(scalars);
+    return ierr;
+  }
+
+  seg = &adj_store.segments[segment];
+  offset = seg->size;
+  if (fseek(seg->file, offset, SEEK_SET) != 0 ||
+      fwrite(&header, sizeof(adj_disk_store_header), 1, seg->file) != 1 ||
+      fwrite(scalars, sizeof(adj_scalar), header.nscalars, seg->file) != (size_t) header.nscalars)
+  {
+    free(scalars);
+    return ADJ_ERR_INVALID_INPUTS;
+  }
+  free(scalars);
+  seg->size += sizeof(adj_disk_store_header) + header.nscalars * sizeof(adj_scalar);
+
+  /* Only the latest record of a value is live */
+  HASH_FIND(hh, adj_store.index, &header.key, sizeof(adj_variable_key), entry);
+  if (entry != NULL) adj_disk_store_drop(entry);
+
+  entry = (adj_disk_store_entry*) malloc(sizeof(adj_disk_store_entry));
+  ADJ_CHKMALLOC(entry);
+  entry->key = header.key;
+  entry->segment = segment;
+  entry->offset = offset + sizeof(adj_disk_store_header);
+  entry->klass = header.klass;
+  entry->nscalars = header.nscalars;
+  HASH_ADD(hh, adj_store.index, key, sizeof(adj_variable_key), entry);
+  seg->nlive++;
+
+  return ADJ_OK;
+}
+
+static int adj_disk_store_read(adj_variable* var, adj_vector* x)
+{
+  adj_variable_key key;
+  adj_disk_store_entry* entry;
+  adj_disk_store_template* tmpl;
+  adj_disk_segment* seg;
+  adj_scalar* scalars;
+  int ierr;
+
+  ierr = adj_disk_store_key(var, &key);
+  if (ierr != ADJ_OK) return ierr;
+  HASH_FIND(hh, adj_store.index, &key, sizeof(adj_variable_key), entry);
+  if (entry == NULL) return ADJ_ERR_HASH_FAILED;
+
+  ierr = adj_disk_store_find_template(entry->klass, entry->nscalars, &tmpl);
+  if (ierr != ADJ_OK) return ierr;
+
+  scalars = (adj_scalar*) malloc(entry->nscalars * sizeof(adj_scalar));
+  ADJ_CHKMALLOC(scalars);
+  seg = &adj_store.segments[entry->segment];
+  if (fseek(seg->file, entry->offset, SEEK_SET) != 0 ||
+      fread(scalars, sizeof(adj_scalar), entry->nscalars, seg->file) != (size_t) entry->nscalars)
+  {
+    free(scalars);
+    return ADJ_ERR_INVALID_INPUTS;
+  }
+
+  adj_store.vec_duplicate(tmpl->value, x);
+  adj_store.vec_set_values(x, scalars);
+  free(scalars);
+  return ADJ_OK;
+}
+
+static int adj_disk_store_delete(adj_variable* var)
+{
+  adj_variable_key key;
+  adj_disk_store_entry* entry;
+  int ierr;
+
+  ierr = adj_disk_store_key(var, &key);
+  if (ierr != ADJ_OK) return ierr;
+  HASH_FIND(hh, adj_store.index, &key, sizeof(adj_variable_key), entry);
+  if (entry == NULL) return ADJ_ERR_HASH_FAILED;
+
+  adj_disk_store_drop(entry);
+  return ADJ_OK;
+}
+
+void adj_disk_store_vec_write(adj_variable var, adj_vector x)
+{
+  char buf[ADJ_NAME_LEN];
+  int ierr;
+
+  adj_disk_store_lock();
+  ierr = (adj_store.owner == NULL) ? ADJ_ERR_INVALID_INPUTS : adj_disk_store_write(&var, x);
+  adj_disk_store_unlock();
+
+  if (ierr != ADJ_OK)
+  {
+    adj_variable_str(var, buf, ADJ_NAME_LEN);
+    fprintf(stderr, "Could not write variable %s to the disk store.\n", buf);
+  }
+}
+
+void adj_disk_store_vec_read(adj_variable var, adj_vector* x)
+{
+  char buf[ADJ_NAME_LEN];
+  int ierr;
+
+  adj_disk_store_lock();
+  ierr = (adj_store.owner == NULL) ? ADJ_ERR_INVALID_INPUTS : adj_disk_store_read(&var, x);
+  adj_disk_store_unlock();
+
+  if (ierr != ADJ_OK)
+  {
+    adj_variable_str(var, buf, ADJ_NAME_LEN);
+    fprintf(stderr, "Could not read variable %s from the disk store.\n", buf);
+  }
+}
+
+void adj_disk_store_vec_delete(adj_variable var)
+{
+  char buf[ADJ_NAME_LEN];
+  int ierr;
+
+  adj_disk_store_lock();
+  ierr = (adj_store.owner == NULL) ? ADJ_ERR_INVALID_INPUTS : adj_disk_store_delete(&var);
+  adj_disk_store_unlock();
+
+  if (ierr != ADJ_OK)
+  {
+    adj_variable_str(var, buf, ADJ_NAME_LEN);
+    fprintf(stderr, "Can't remove variable %s from the disk store. It isn't there.\n", buf);
+  }
+}
+
+int adj_disk_store_map(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector* value, int* found)
+{
+  adj_variable_key key;
+  adj_disk_store_entry* entry;
+  adj_disk_store_template* tmpl;
+  adj_disk_segment* seg;
+  adj_vector model;
+  adj_scalar* scalars;
+  long page, start;
+  size_t size;
+  void* mapping;
+  int ierr;
+
+  *found = ADJ_FALSE;
+  if (adjointer->callbacks.vec_wrap_values == NULL) return ADJ_OK;
+
+  adj_disk_store_lock();
+  if (adj_store.owner != adjointer)
+  {
+    adj_disk_store_unlock();
+    return ADJ_OK;
+  }
+
+  ierr = adj_disk_store_key(&var, &key);
+  if (ierr != ADJ_OK)
+  {
+    adj_disk_store_unlock();
+    return adj_chkierr_auto(ierr);
+  }
+  HASH_FIND(hh, adj_store.index, &key, sizeof(adj_variable_key), entry);
+  if (entry == NULL || adj_disk_store_find_template(entry->klass, entry->nscalars, &tmpl) != ADJ_OK)
+  {
+    /* Leave it to vec_read to complain */
+    adj_disk_store_unlock();
+    return ADJ_OK;
+  }
+
+  /* Mappings start on a page boundary */
+  seg = &adj_store.segments[entry->segment];
+  page = sysconf(_SC_PAGESIZE);
+  start = entry->offset - entry->offset % page;
+  size = (entry->offset - start) + entry->nscalars * sizeof(adj_scalar);
+  fflush(seg->file);
+  mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(seg->file), start);
+  model = tmpl->value;
+  scalars = (adj_scalar*) ((char*) mapping + (entry->offset - start));
+  adj_disk_store_unlock();
+  if (mapping == MAP_FAILED)
+  {
+    /* Fall back to reading it */
+    return ADJ_OK;
+  }
+
+  adjointer->callbacks.vec_wrap_values(model, scalars, value);
+  data->mapping = mapping;
+  data->mapping_size = size;
+  *found = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+void adj_disk_store_unmap(adj_variable_data* data)
+{
+  if (data->mapping == NULL) return;
+  munmap(data->mapping, data->mapping_size);
+  data->mapping = NULL;
+  data->mapping_size = 0;
+}
+
+int adj_set_disk_store(adj_adjointer* adjointer, char* directory, size_t segment_size)
+{
+  char* copy;
+  int ierr;
+
+  if (segment_size == 0)
+  {
+    strncpy(adj_error_msg, "The disk store needs a positive segment size.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  if (access(directory, W_OK) != 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Can't write to the disk store directory '%s'.", directory);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  if (adjointer->callbacks.vec_duplicate == NULL || adjointer->callbacks.vec_destroy == NULL || adjointer->callbacks.vec_get_size == NULL ||
+      adjointer->callbacks.vec_get_values == NULL || adjointer->callbacks.vec_set_values == NULL)
+  {
+    strncpy(adj_error_msg, "The disk store needs the ADJ_VEC_DUPLICATE_CB, ADJ_VEC_DESTROY_CB, ADJ_VEC_GET_SIZE_CB, ADJ_VEC_GET_VALUES_CB and ADJ_VEC_SET_VALUES_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  /* The write-behind thread holds on to the vec_write it was started with */
+  if (adjointer->write_behind != NULL)
+  {
+    strncpy(adj_error_msg, "Set up the disk store before switching on write-behind.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  adj_disk_store_lock();
+  if (adj_store.owner != NULL && (adj_store.owner != adjointer || adj_store.index != NULL))
+  {
+    adj_disk_store_unlock();
+    strncpy(adj_error_msg, "The disk store is already holding values; there can only be one per process.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  adj_disk_store_unlock();
+
+  /* Setting it up again starts afresh, with the new options */
+  ierr = adj_destroy_disk_store(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  copy = (char*) malloc((strlen(directory) + 1) * sizeof(char));
+  ADJ_CHKMALLOC(copy);
+  strcpy(copy, directory);
+
+  adj_disk_store_lock();
+  adj_store.directory = copy;
+  adj_store.segment_size = segment_size;
+  adj_store.vec_duplicate = adjointer->callbacks.vec_duplicate;
+  adj_store.vec_destroy = adjointer->callbacks.vec_destroy;
+  adj_store.vec_get_size = adjointer->callbacks.vec_get_size;
+  adj_store.vec_get_values = adjointer->callbacks.vec_get_values;
+  adj_store.vec_set_values = adjointer->callbacks.vec_set_values;
+  adj_store.owner = adjointer;
+  adj_disk_store_unlock();
+
+  ierr = adj_register_data_callback(adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) adj_disk_store_vec_write);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_register_data_callback(adjointer, ADJ_VEC_READ_CB, (void (*)(void)) adj_disk_store_vec_read);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  ierr = adj_register_data_callback(adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) adj_disk_store_vec_delete);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  return ADJ_OK;
+}
+
+int adj_destroy_disk_store(adj_adjointer* adjointer)
+{
+  adj_disk_store_entry* entry;
+  adj_disk_store_entry* entry_tmp;
+  adj_name_intern* name;
+  adj_name_intern* name_tmp;
+  char filename[ADJ_NAME_LEN];
+  int i;
+
+  adj_disk_store_lock();
+  if (adj_store.owner != adjointer)
+  {
+    adj_disk_store_unlock();
+    return ADJ_OK;
+  }
+
+  HASH_ITER(hh, adj_store.index, entry, entry_tmp)
+  {
+    HASH_DEL(adj_store.index, entry);
+    free(entry);
+  }
+
+  HASH_ITER(hh, adj_store.names, name, name_tmp)
+  {
+    HASH_DEL(adj_store.names, name);
+    free(name->name);
+    free(name);
+  }
+
+  for (i = 0; i < adj_store.nsegments; i++)
+  {
+    if (adj_store.segments[i].file == NULL) continue;
+    fclose(adj_store.segments[i].file);
+    adj_disk_store_segment_name(i, filename, ADJ_NAME_LEN);
+    remove(filename);
+  }
+  free(adj_store.segments);
+
+  for (i = 0; i < adj_store.ntemplates; i++)
+    adj_store.vec_destroy(&adj_store.templates[i].value);
+  free(adj_store.templates);
+
+  free(adj_store.directory);
+  memset(&adj_store, 0, sizeof(adj_disk_store));
+  adj_disk_store_unlock();
+
+  return ADJ_OK;
+}
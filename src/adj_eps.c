@@ -24,12 +24,12 @@ PetscErrorCode eps_mult(Mat A, Vec x, Vec y)
   eps_data->multiplications++;
   printf("Beginning matrix action %d.\n", eps_data->multiplications-1);
 
-  adjointer->callbacks.vec_duplicate(eps_data->input, &work_input);
+  adj_vec_pool_get(adjointer, eps_data->input, &work_input);
   ierr = VecGetArrayRead(x, (const PetscScalar**) &input_arr); CHKERRQ(ierr);
   adjointer->callbacks.vec_set_values(&work_input, input_arr);
   ierr = VecRestoreArrayRead(x, (const PetscScalar**) &input_arr); CHKERRQ(ierr);
 
-  adjointer->callbacks.vec_duplicate(eps_data->output, &work_output);
+  adj_vec_pool_get(adjointer, eps_data->output, &work_output);
 
   adjointer->callbacks.mat_action(matrix, work_input, &work_output);
 
@@ -37,8 +37,8 @@ PetscErrorCode eps_mult(Mat A, Vec x, Vec y)
   adjointer->callbacks.vec_get_values(work_output, &output_arr);
   ierr = VecRestoreArray(y, &output_arr); CHKERRQ(ierr);
 
-  adjointer->callbacks.vec_destroy(&work_input);
-  adjointer->callbacks.vec_destroy(&work_output);
+  adj_vec_pool_put(adjointer, &work_input);
+  adj_vec_pool_put(adjointer, &work_output);
   printf("Matrix action %d completed.\n", eps_data->multiplications-1);
 
   PetscFunctionReturn(0);
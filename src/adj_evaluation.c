@@ -8,7 +8,7 @@ int adj_evaluate_block_action(adj_adjointer* adjointer, adj_block block, adj_vec
   int ndepends = 0;
   adj_variable* variables = NULL;
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_BLOCK_ACTION_CB, block.name, (void (**)(void)) &block_action_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_BLOCK_ACTION_CB, block.callbacks, block.name, (void (**)(void)) &block_action_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
@@ -42,6 +42,63 @@ int adj_evaluate_block_action(adj_adjointer* adjointer, adj_block block, adj_vec
   return adj_chkierr_auto(ierr);
 }
 
+int adj_evaluate_block_action_accumulate(adj_adjointer* adjointer, adj_block block, adj_vector input, adj_scalar alpha, adj_vector* output)
+{
+  /* output += alpha * (block action on input). If the model supplied an accumulating action we
+     can do that in place; otherwise we go through a temporary. */
+  int i, ierr;
+  void (*block_action_accumulate_func)(int, adj_variable*, adj_vector*, int, adj_scalar, adj_vector, adj_scalar, void*, adj_vector*) = NULL;
+  adj_vector* dependencies = NULL;
+  int ndepends = 0;
+  adj_variable* variables = NULL;
+  adj_vector tmp;
+
+  /* The hermitian test needs the action on its own, so that always goes the long way round */
+  if (!block.test_hermitian)
+    ierr = adj_find_cached_operator_callback(adjointer, ADJ_BLOCK_ACTION_ACCUMULATE_CB, block.callbacks, block.name, (void (**)(void)) &block_action_accumulate_func);
+  else
+    ierr = ADJ_ERR_NEED_CALLBACK;
+
+  if (ierr != ADJ_OK)
+  {
+    strncpy(adj_error_msg, "Need a data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    if (adjointer->callbacks.vec_axpy == NULL)    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+    if (adjointer->callbacks.vec_destroy == NULL) return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+    strncpy(adj_error_msg, "", ADJ_ERROR_MSG_BUF);
+
+    ierr = adj_evaluate_block_action(adjointer, block, input, &tmp);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    adjointer->callbacks.vec_axpy(output, alpha, tmp);
+    adj_vec_pool_put(adjointer, &tmp);
+    return ADJ_OK;
+  }
+
+  if (block.has_nonlinear_block)
+  {
+    ndepends = block.nonlinear_block.ndepends;
+    variables = block.nonlinear_block.depends;
+    dependencies = (adj_vector*) malloc(ndepends * sizeof(adj_vector));
+    ADJ_CHKMALLOC(dependencies);
+
+    for (i = 0; i < ndepends; i++)
+    {
+      ierr = adj_get_variable_value(adjointer, variables[i], &dependencies[i]);
+      if (ierr != ADJ_OK)
+      {
+        free(dependencies);
+        return adj_chkierr_auto(ierr);
+      }
+    }
+  }
+
+  block_action_accumulate_func(ndepends, variables, dependencies, block.hermitian, block.coefficient, input, alpha, block.context, output);
+
+  if (block.has_nonlinear_block)
+    free(dependencies);
+
+  return ADJ_OK;
+}
+
 
 int adj_evaluate_block_assembly(adj_adjointer* adjointer, adj_block block, adj_matrix *output, adj_vector* rhs)
 {
@@ -51,7 +108,7 @@ int adj_evaluate_block_assembly(adj_adjointer* adjointer, adj_block block, adj_m
   int ndepends = 0;
   adj_variable* variables = NULL;
 
-  ierr = adj_find_operator_callback(adjointer, ADJ_BLOCK_ASSEMBLY_CB, block.name, (void (**)(void)) &block_assembly_func);
+  ierr = adj_find_cached_operator_callback(adjointer, ADJ_BLOCK_ASSEMBLY_CB, block.callbacks, block.name, (void (**)(void)) &block_assembly_func);
   if (ierr != ADJ_OK)
     return adj_chkierr_auto(ierr);
 
@@ -86,6 +143,7 @@ int adj_evaluate_nonlinear_derivative_action(adj_adjointer* adjointer, int nderi
   int ierr;
   int deriv;
   void (*nonlinear_derivative_action_func)(int ndepends, adj_variable* variables, adj_vector* dependencies, adj_variable derivative, adj_vector contraction, int hermitian, adj_vector input, adj_scalar coefficient, void* context, adj_vector* output);
+  void (*nonlinear_derivative_action_accumulate_func)(int ndepends, adj_variable* variables, adj_vector* dependencies, adj_variable derivative, adj_vector contraction, int hermitian, adj_vector input, adj_scalar coefficient, adj_scalar alpha, void* context, adj_vector* output);
 
   /* As usual, check as much as we can at the start */
   strncpy(adj_error_msg, "Need a data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
@@ -108,35 +166,68 @@ int adj_evaluate_nonlinear_derivative_action(adj_adjointer* adjointer, int nderi
 
   for (deriv = 0; deriv < nderivatives; deriv++)
   {
-    /* First, try to find a routine supplied by the user. */
-    /* Outer refers to the index of contraction: if deriv.outer is FALSE, then we want ADJ_NBLOCK_DERIVATIVE_ACTION_CB; if it is TRUE, we want ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB. */
-
-    if (derivatives[deriv].outer == ADJ_FALSE)
+    /* If the model can subtract the action from rhs in place, we don't need a temporary.
+       The tests need the action on its own, so they always go the long way round. */
+    nonlinear_derivative_action_accumulate_func = NULL;
+    if (derivatives[deriv].outer == ADJ_FALSE && !derivatives[deriv].nonlinear_block.test_deriv_hermitian && !derivatives[deriv].nonlinear_block.test_derivative)
     {
-      ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
+      ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB, derivatives[deriv].nonlinear_block.callbacks, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_accumulate_func);
+      if (ierr != ADJ_OK) nonlinear_derivative_action_accumulate_func = NULL;
     }
-    else
+
+    if (nonlinear_derivative_action_accumulate_func == NULL)
     {
-      ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
-    }
+      /* Otherwise, find the routine supplied by the user. */
+      /* Outer refers to the index of contraction: if deriv.outer is FALSE, then we want ADJ_NBLOCK_DERIVATIVE_ACTION_CB; if it is TRUE, we want ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB. */
+      if (derivatives[deriv].outer == ADJ_FALSE)
+      {
+        ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_CB, derivatives[deriv].nonlinear_block.callbacks, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
+      }
+      else
+      {
+        ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_DERIVATIVE_OUTER_ACTION_CB, derivatives[deriv].nonlinear_block.callbacks, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_derivative_action_func);
+      }
 
-    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+      if (derivatives[deriv].nonlinear_block.test_deriv_hermitian)
+      {
+        ierr = adj_test_nonlinear_derivative_action_transpose(adjointer, derivatives[deriv], value, *rhs, derivatives[deriv].nonlinear_block.number_of_tests, derivatives[deriv].nonlinear_block.tolerance);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      }
+      if (derivatives[deriv].nonlinear_block.test_derivative)
+      {
+        ierr = adj_test_nonlinear_derivative_action_consistency(adjointer, derivatives[deriv], derivatives[deriv].variable, derivatives[deriv].nonlinear_block.number_of_rounds);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      }
+    }
 
-    if (derivatives[deriv].nonlinear_block.test_deriv_hermitian)
+    if (nonlinear_derivative_action_accumulate_func != NULL)
     {
-      ierr = adj_test_nonlinear_derivative_action_transpose(adjointer, derivatives[deriv], value, *rhs, derivatives[deriv].nonlinear_block.number_of_tests, derivatives[deriv].nonlinear_block.tolerance);
-      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      adj_vector* dependencies;
+      int i;
+
+      dependencies = (adj_vector*) malloc(derivatives[deriv].nonlinear_block.ndepends * sizeof(adj_vector));
+      ADJ_CHKMALLOC(dependencies);
+      for (i = 0; i < derivatives[deriv].nonlinear_block.ndepends; i++)
+      {
+        ierr = adj_get_variable_value(adjointer, derivatives[deriv].nonlinear_block.depends[i], &(dependencies[i]));
+        assert(ierr == ADJ_OK); /* We checked for them earlier */
+      }
+
+      nonlinear_derivative_action_accumulate_func(derivatives[deriv].nonlinear_block.ndepends, derivatives[deriv].nonlinear_block.depends, dependencies, derivatives[deriv].variable,
+                                                  derivatives[deriv].contraction, derivatives[deriv].hermitian, value, derivatives[deriv].nonlinear_block.coefficient,
+                                                  (adj_scalar) -1.0, derivatives[deriv].nonlinear_block.context, rhs);
+      free(dependencies);
     }
-    if (derivatives[deriv].nonlinear_block.test_derivative)
+    else
     {
-      ierr = adj_test_nonlinear_derivative_action_consistency(adjointer, derivatives[deriv], derivatives[deriv].variable, derivatives[deriv].nonlinear_block.number_of_rounds);
+      adj_vector rhs_tmp;
+      ierr = adj_evaluate_nonlinear_derivative_action_supplied(adjointer, nonlinear_derivative_action_func, derivatives[deriv], value, &rhs_tmp);
       if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      adjointer->callbacks.vec_axpy(rhs, (adj_scalar) -1.0, rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
-    adj_vector rhs_tmp;
-    ierr = adj_evaluate_nonlinear_derivative_action_supplied(adjointer, nonlinear_derivative_action_func, derivatives[deriv], value, &rhs_tmp);
-    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
-    adjointer->callbacks.vec_axpy(rhs, (adj_scalar) -1.0, rhs_tmp);
-    adjointer->callbacks.vec_destroy(&rhs_tmp);
   }
 
   return ADJ_OK;
@@ -170,7 +261,7 @@ int adj_evaluate_nonlinear_second_derivative_action(adj_adjointer* adjointer, in
 
   for (deriv = 0; deriv < nderivatives; deriv++)
   {
-    ierr = adj_find_operator_callback(adjointer, ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_second_derivative_action_func);
+    ierr = adj_find_cached_operator_callback(adjointer, ADJ_NBLOCK_SECOND_DERIVATIVE_ACTION_CB, derivatives[deriv].nonlinear_block.callbacks, derivatives[deriv].nonlinear_block.name, (void (**)(void)) &nonlinear_second_derivative_action_func);
     if (ierr == ADJ_OK)
     {
       int i;
@@ -190,7 +281,7 @@ int adj_evaluate_nonlinear_second_derivative_action(adj_adjointer* adjointer, in
                                               derivatives[deriv].nonlinear_block.context, &rhs_tmp);
       free(dependencies);
       adjointer->callbacks.vec_axpy(rhs, (adj_scalar) -1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
     else
     {
@@ -269,7 +360,7 @@ int adj_evaluate_nonlinear_action(adj_adjointer* adjointer, void (*nonlinear_act
           return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
         }
 
-        adjointer->callbacks.vec_duplicate(dependencies[i], &perturbed_dependency);
+        adj_vec_pool_get(adjointer, dependencies[i], &perturbed_dependency);
         adjointer->callbacks.vec_axpy(&perturbed_dependency, (adj_scalar) 1.0, dependencies[i]);
         adjointer->callbacks.vec_axpy(&perturbed_dependency, (adj_scalar) 1.0, *perturbation);
         dependencies[i] = perturbed_dependency;
@@ -287,7 +378,7 @@ int adj_evaluate_nonlinear_action(adj_adjointer* adjointer, void (*nonlinear_act
 
   /* If we perturbed something, we allocated it, so we have to destroy it */
   if (perturbed_var != NULL)
-    adjointer->callbacks.vec_destroy(&perturbed_dependency);
+    adj_vec_pool_put(adjointer, &perturbed_dependency);
 
   free(dependencies);
   return ADJ_OK;
@@ -680,6 +771,69 @@ int adj_evaluate_rhs_derivative_action(adj_adjointer* adjointer, adj_equation so
 
 }
 
+int adj_evaluate_rhs_derivative_action_accumulate(adj_adjointer* adjointer, adj_equation source_eqn, adj_variable diff_var, adj_vector contraction, int hermitian, adj_scalar alpha, adj_vector* output)
+{
+  int nrhsdeps;
+  int j;
+  int ierr;
+  adj_variable* variables;
+  adj_vector* dependencies;
+
+  /* Without an accumulating callback, evaluate the action on its own and add it on */
+  if (source_eqn.rhs_deriv_action_accumulate_callback == NULL)
+  {
+    adj_vector deriv_action;
+    int has_output;
+
+    strncpy(adj_error_msg, "Need a data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    if (adjointer->callbacks.vec_axpy == NULL)    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+    if (adjointer->callbacks.vec_destroy == NULL) return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+    strncpy(adj_error_msg, "", ADJ_ERROR_MSG_BUF);
+
+    has_output = -666;
+    ierr = adj_evaluate_rhs_derivative_action(adjointer, source_eqn, diff_var, contraction, hermitian, &deriv_action, &has_output);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+    if (has_output == -666)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Your rhs derivative action callback should set has_output!");
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
+
+    if (has_output)
+    {
+      adjointer->callbacks.vec_axpy(output, alpha, deriv_action);
+      adj_vec_pool_put(adjointer, &deriv_action);
+    }
+    return ADJ_OK;
+  }
+
+  nrhsdeps = source_eqn.nrhsdeps;
+
+  variables = (adj_variable*) malloc(nrhsdeps * sizeof(adj_variable));
+  ADJ_CHKMALLOC(variables);
+  dependencies = (adj_vector*) malloc(nrhsdeps * sizeof(adj_vector));
+  ADJ_CHKMALLOC(dependencies);
+
+  for (j=0; j < nrhsdeps; j++)
+  {
+    memcpy(&variables[j], &source_eqn.rhsdeps[j], sizeof(adj_variable));
+    ierr = adj_get_variable_value(adjointer, variables[j], &(dependencies[j]));
+    if (ierr != ADJ_OK)
+    {
+      free(variables);
+      free(dependencies);
+      return adj_chkierr_auto(ierr);
+    }
+  }
+
+  source_eqn.rhs_deriv_action_accumulate_callback((void*) adjointer, source_eqn.variable, nrhsdeps, variables, dependencies, diff_var, contraction, hermitian, alpha, source_eqn.rhs_context, output);
+
+  free(variables);
+  free(dependencies);
+  return ADJ_OK;
+}
+
 int adj_evaluate_rhs_second_derivative_action(adj_adjointer* adjointer, adj_equation source_eqn, adj_variable inner_var, adj_vector inner_contraction, adj_variable outer_var, int hermitian, adj_vector action, adj_vector* output, int* has_output)
 {
   int nrhsdeps;
@@ -0,0 +1,468 @@
+#include "libadjoint/adj_expiry.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* Per-equation expiry buckets, so that adj_forget_adjoint_equation and adj_forget_forward_equation
+   only look at the variables that die at the equation they are given, not at every value held.
+
+   Each variable that holds a value the forget routines may drop (one in memory or on disk that is
+   not a checkpoint) sits in two queues of buckets indexed by equation:
+
+   - the adjoint queue, in the bucket of the lowest equation adj_forget_adjoint_equation may forget
+     it at: the first of its adjoint_equations, the start of the first of its depending_timesteps,
+     or the lowest such equation of the values interpolated from it if it is an anchor;
+   - the forward queue, if it is a forward variable with an equation, in the bucket of the last
+     equation of the forward run that uses it: the last of its targeting, depending and rhs
+     equations, or the end of the last of its depending_timesteps.
+
+   The adjoint sweep drains the adjoint buckets from the top down, and the forward sweep the forward
+   buckets from the bottom up. Both keys are taken when the variable is queued, which is usually
+   before the equations that use it are registered. Registering equations only ever moves them in
+   the direction of the sweep, though (the adjoint key down, the forward key up), so a variable is
+   never drained too late. When it is drained, its key is taken again, and it goes into the bucket of
+   the new key if that is still to come. A variable whose key has already been drained, because
+   it was recorded again during a replay or only queued late, goes into a pending list that the next
+   forget call looks at whatever its equation is.
+
+   Each variable is therefore looked at once per forget call that actually concerns it, plus once per
+   time its key moved. A full sweep costs O(equations + variables), rather than O(equations) times the
+   number of values held. */
+
+#define ADJ_EXPIRY_NONE -1
+#define ADJ_EXPIRY_PENDING -2
+#define ADJ_EXPIRY_VISITING -3
+
+typedef struct
+{
+  int nids;
+  int ids_sz;
+  int* ids;
+} adj_expiry_bucket;
+
+typedef struct
+{
+  int bucket; /* the equation of the bucket the variable is in, or ADJ_EXPIRY_NONE, _PENDING or _VISITING */
+  int slot; /* and where in it */
+} adj_expiry_position;
+
+typedef struct
+{
+  int nbuckets;
+  adj_expiry_bucket* buckets; /* indexed by equation */
+  adj_expiry_bucket pending; /* looked at by the next forget call, whatever its equation */
+  int cursor; /* the buckets beyond it in the direction of the sweep have been drained, and are empty */
+  int npositions;
+  adj_expiry_position* positions; /* indexed by variable id */
+} adj_expiry_queue;
+
+struct adj_expiry
+{
+  adj_expiry_queue adjoint; /* drained downwards by adj_forget_adjoint_equation: cursor is the highest bucket not yet drained */
+  adj_expiry_queue forward; /* drained upwards by adj_forget_forward_equation: cursor is the lowest bucket not yet drained */
+  int nvisited; /* the number of variables the last forget call looked at */
+};
+
+static int adj_expiry_forgettable(adj_variable_data* data)
+{
+  return (data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint) ||
+         (data->storage.storage_disk_has_value && !data->storage.storage_disk_is_checkpoint);
+}
+
+/* The lowest equation adj_forget_adjoint_equation may forget data at, from its own adjoint equations and
+   functional dependencies: the adjoint run needs it until both are solved. INT_MAX if nothing needs it. */
+int adj_expiry_adjoint_equation(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  int expiry = INT_MAX;
+  int start_equation;
+  int ierr;
+
+  /* Both lists are sorted */
+  if (data->nadjoint_equations > 0)
+    expiry = data->adjoint_equations[0];
+
+  if (data->ndepending_timesteps > 0)
+  {
+    ierr = adj_timestep_start_equation(adjointer, data->depending_timesteps[0], &start_equation);
+    assert(ierr == ADJ_OK);
+    if (start_equation < expiry) expiry = start_equation;
+  }
+
+  return expiry;
+}
+
+static int adj_expiry_adjoint_key(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  int key, anchor;
+
+  key = adj_expiry_adjoint_equation(adjointer, data);
+  anchor = adj_interpolation_anchor_expiry(adjointer, adjointer->varentries[data->id]->variable);
+  return (anchor < key) ? anchor : key;
+}
+
+/* The last equation of the forward run that needs data; adj_forget_forward_equation may forget it after that */
+static int adj_expiry_forward_key(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  int key = data->equation;
+  int timestep, end;
+
+  /* The lists are sorted, so the last entry is the largest */
+  if (data->ntargeting_equations > 0 && data->targeting_equations[data->ntargeting_equations - 1] > key)
+    key = data->targeting_equations[data->ntargeting_equations - 1];
+  if (data->ndepending_equations > 0 && data->depending_equations[data->ndepending_equations - 1] > key)
+    key = data->depending_equations[data->ndepending_equations - 1];
+  if (data->nrhs_equations > 0 && data->rhs_equations[data->nrhs_equations - 1] > key)
+    key = data->rhs_equations[data->nrhs_equations - 1];
+
+  /* A functional dependency is needed until the equation after the end of its timestep; the last
+     timestep isn't over yet */
+  if (data->ndepending_timesteps > 0)
+  {
+    timestep = data->depending_timesteps[data->ndepending_timesteps - 1];
+    if (timestep == adjointer->ntimesteps - 1)
+      end = adjointer->nequations;
+    else
+      end = adjointer->timestep_data[timestep + 1].start_equation - 1;
+    if (end + 1 > key) key = end + 1;
+  }
+
+  return key;
+}
+
+static int adj_expiry_bucket_push(adj_expiry_bucket* bucket, int id)
+{
+  if (bucket->nids == bucket->ids_sz)
+  {
+    int new_sz = (bucket->ids_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * bucket->ids_sz;
+    bucket->ids = (int*) realloc(bucket->ids, new_sz * sizeof(int));
+    ADJ_CHKMALLOC(bucket->ids);
+    bucket->ids_sz = new_sz;
+  }
+  bucket->ids[bucket->nids++] = id;
+  return ADJ_OK;
+}
+
+static int adj_expiry_reserve(adj_expiry_queue* queue, int id)
+{
+  int new_sz, i;
+
+  if (id < queue->npositions) return ADJ_OK;
+
+  new_sz = (queue->npositions == 0) ? ADJ_PREALLOC_SIZE : 2 * queue->npositions;
+  if (new_sz <= id) new_sz = id + 1;
+  queue->positions = (adj_expiry_position*) realloc(queue->positions, new_sz * sizeof(adj_expiry_position));
+  ADJ_CHKMALLOC(queue->positions);
+  for (i = queue->npositions; i < new_sz; i++)
+  {
+    queue->positions[i].bucket = ADJ_EXPIRY_NONE;
+    queue->positions[i].slot = -1;
+  }
+  queue->npositions = new_sz;
+  return ADJ_OK;
+}
+
+/* Put id into the bucket of equation bucket, or into the pending list */
+static int adj_expiry_insert(adj_expiry_queue* queue, int id, int bucket)
+{
+  adj_expiry_bucket* target;
+  int new_sz, i, ierr;
+
+  if (bucket == ADJ_EXPIRY_PENDING)
+  {
+    target = &queue->pending;
+  }
+  else
+  {
+    if (bucket >= queue->nbuckets)
+    {
+      new_sz = (queue->nbuckets == 0) ? ADJ_PREALLOC_SIZE : 2 * queue->nbuckets;
+      if (new_sz <= bucket) new_sz = bucket + 1;
+      queue->buckets = (adj_expiry_bucket*) realloc(queue->buckets, new_sz * sizeof(adj_expiry_bucket));
+      ADJ_CHKMALLOC(queue->buckets);
+      for (i = queue->nbuckets; i < new_sz; i++)
+      {
+        queue->buckets[i].nids = 0;
+        queue->buckets[i].ids_sz = 0;
+        queue->buckets[i].ids = NULL;
+      }
+      queue->nbuckets = new_sz;
+    }
+    target = &queue->buckets[bucket];
+  }
+
+  ierr = adj_expiry_bucket_push(target, id);
+  if (ierr != ADJ_OK) return ierr;
+  queue->positions[id].bucket = bucket;
+  queue->positions[id].slot = target->nids - 1;
+  return ADJ_OK;
+}
+
+static void adj_expiry_remove(adj_expiry_queue* queue, int id)
+{
+  adj_expiry_bucket* bucket;
+  adj_expiry_position* position;
+  int last;
+
+  if (id >= queue->npositions) return;
+  position = &queue->positions[id];
+  if (position->bucket == ADJ_EXPIRY_NONE || position->bucket == ADJ_EXPIRY_VISITING)
+  {
+    position->bucket = ADJ_EXPIRY_NONE;
+    return;
+  }
+
+  /* Move the last id of the bucket into the hole */
+  bucket = (position->bucket == ADJ_EXPIRY_PENDING) ? &queue->pending : &queue->buckets[position->bucket];
+  last = bucket->ids[--bucket->nids];
+  bucket->ids[position->slot] = last;
+  queue->positions[last].slot = position->slot;
+  position->bucket = ADJ_EXPIRY_NONE;
+  position->slot = -1;
+}
+
+static int adj_expiry_pop(adj_expiry_queue* queue, adj_expiry_bucket* bucket)
+{
+  int id = bucket->ids[--bucket->nids];
+  queue->positions[id].bucket = ADJ_EXPIRY_NONE;
+  queue->positions[id].slot = -1;
+  return id;
+}
+
+/* Keep the queues in step with whether data holds a value the forget routines may drop.
+   adj_update_live_variable calls this whenever the storage of a variable changes. */
+int adj_expiry_update(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_expiry* expiry;
+  int key, ierr;
+
+  if (data->id < 0) return ADJ_OK;
+
+  if (adjointer->expiry == NULL)
+  {
+    if (!adj_expiry_forgettable(data)) return ADJ_OK;
+    adjointer->expiry = (struct adj_expiry*) malloc(sizeof(struct adj_expiry));
+    ADJ_CHKMALLOC(adjointer->expiry);
+    memset(adjointer->expiry, 0, sizeof(struct adj_expiry));
+    adjointer->expiry->adjoint.cursor = INT_MAX;
+    adjointer->expiry->forward.cursor = 0;
+  }
+  expiry = adjointer->expiry;
+
+  if (!adj_expiry_forgettable(data))
+  {
+    adj_expiry_remove(&expiry->adjoint, data->id);
+    adj_expiry_remove(&expiry->forward, data->id);
+    return ADJ_OK;
+  }
+
+  ierr = adj_expiry_reserve(&expiry->adjoint, data->id);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (expiry->adjoint.positions[data->id].bucket == ADJ_EXPIRY_NONE)
+  {
+    key = adj_expiry_adjoint_key(adjointer, data);
+    ierr = adj_expiry_insert(&expiry->adjoint, data->id, (key == INT_MAX || key > expiry->adjoint.cursor) ? ADJ_EXPIRY_PENDING : key);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  if (data->type != ADJ_FORWARD || data->equation < 0) return ADJ_OK;
+
+  ierr = adj_expiry_reserve(&expiry->forward, data->id);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (expiry->forward.positions[data->id].bucket == ADJ_EXPIRY_NONE)
+  {
+    key = adj_expiry_forward_key(adjointer, data);
+    ierr = adj_expiry_insert(&expiry->forward, data->id, (key < expiry->forward.cursor) ? ADJ_EXPIRY_PENDING : key);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  return ADJ_OK;
+}
+
+/* Forget the values of data that aren't checkpoints. The variable is marked as being visited
+   meanwhile, so that forgetting one of them doesn't queue it again. */
+static int adj_expiry_forget_value(adj_adjointer* adjointer, adj_expiry_queue* queue, adj_variable_data* data)
+{
+  int ierr = ADJ_OK;
+
+  queue->positions[data->id].bucket = ADJ_EXPIRY_VISITING;
+  if (data->storage.storage_disk_has_value && !data->storage.storage_disk_is_checkpoint)
+    ierr = adj_forget_variable_value_from_disk(adjointer, adjointer->varentries[data->id]->variable, data);
+  if (ierr == ADJ_OK && data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint)
+    ierr = adj_forget_variable_value_from_memory(adjointer, data);
+  queue->positions[data->id].bucket = ADJ_EXPIRY_NONE;
+  return ierr;
+}
+
+static int adj_expiry_visit_adjoint(adj_adjointer* adjointer, int id, int equation)
+{
+  adj_expiry_queue* queue = &adjointer->expiry->adjoint;
+  adj_variable_data* data = ADJ_VARIABLE_DATA(adjointer, id);
+  int key;
+
+  adjointer->expiry->nvisited++;
+
+  /* It has become a checkpoint since it was queued: it is queued again once it stops being one */
+  if (!adj_expiry_forgettable(data)) return ADJ_OK;
+
+  /* It was found to be needed further down the run after it was queued */
+  key = adj_expiry_adjoint_key(adjointer, data);
+  if (key < equation) return adj_expiry_insert(queue, id, key);
+
+  return adj_expiry_forget_value(adjointer, queue, data);
+}
+
+int adj_expiry_forget_adjoint(adj_adjointer* adjointer, int equation)
+{
+  adj_expiry_queue* queue;
+  int bucket, ierr;
+
+  if (adjointer->expiry == NULL) return ADJ_OK;
+  queue = &adjointer->expiry->adjoint;
+  adjointer->expiry->nvisited = 0;
+
+  /* A new sweep from higher up: the buckets up to here are still empty */
+  if (queue->cursor < equation - 1) queue->cursor = equation - 1;
+
+  while (queue->pending.nids > 0)
+  {
+    ierr = adj_expiry_visit_adjoint(adjointer, adj_expiry_pop(queue, &queue->pending), equation);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  for (bucket = (queue->cursor < queue->nbuckets) ? queue->cursor : queue->nbuckets - 1; bucket >= equation; bucket--)
+  {
+    while (queue->buckets[bucket].nids > 0)
+    {
+      ierr = adj_expiry_visit_adjoint(adjointer, adj_expiry_pop(queue, &queue->buckets[bucket]), equation);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+  }
+  queue->cursor = equation - 1;
+
+  return ADJ_OK;
+}
+
+/* Whether the forward equations after equation up to last_equation still need data,
+   as adj_forget_forward_equation_until decides it */
+static int adj_expiry_forward_needed(adj_adjointer* adjointer, adj_variable_data* data, int equation, int last_equation)
+{
+  int i, timestep, min_eqn, max_eqn;
+
+  if (adj_has_unique_in_range(data->targeting_equations, data->ntargeting_equations, equation + 1, last_equation) ||
+      adj_has_unique_in_range(data->depending_equations, data->ndepending_equations, equation + 1, last_equation) ||
+      adj_has_unique_in_range(data->rhs_equations, data->nrhs_equations, equation + 1, last_equation))
+    return ADJ_TRUE;
+
+  for (i = 0; i < data->ndepending_timesteps; i++)
+  {
+    timestep = data->depending_timesteps[i];
+    min_eqn = adjointer->timestep_data[timestep].start_equation;
+    if (timestep == adjointer->ntimesteps - 1)
+      max_eqn = adjointer->nequations;
+    else
+      max_eqn = adjointer->timestep_data[timestep + 1].start_equation - 1;
+
+    if (equation <= max_eqn && min_eqn <= last_equation)
+      return ADJ_TRUE;
+  }
+
+  return ADJ_FALSE;
+}
+
+static int adj_expiry_visit_forward(adj_adjointer* adjointer, int id, int equation)
+{
+  adj_expiry_queue* queue = &adjointer->expiry->forward;
+  adj_variable_data* data = ADJ_VARIABLE_DATA(adjointer, id);
+  int key;
+
+  adjointer->expiry->nvisited++;
+
+  if (!adj_expiry_forgettable(data)) return ADJ_OK;
+
+  /* It was found to be needed further up the run after it was queued */
+  key = adj_expiry_forward_key(adjointer, data);
+  if (key > equation) return adj_expiry_insert(queue, id, key);
+
+  return adj_expiry_forget_value(adjointer, queue, data);
+}
+
+int adj_expiry_forget_forward(adj_adjointer* adjointer, int equation, int last_equation)
+{
+  adj_expiry_queue* queue;
+  adj_variable_data* data;
+  int bucket, k, ierr;
+
+  if (adjointer->expiry == NULL) return ADJ_OK;
+  queue = &adjointer->expiry->forward;
+  adjointer->expiry->nvisited = 0;
+
+  /* A new sweep from further down: the buckets from here on are still empty */
+  if (queue->cursor > equation + 1) queue->cursor = equation + 1;
+
+  while (queue->pending.nids > 0)
+  {
+    ierr = adj_expiry_visit_forward(adjointer, adj_expiry_pop(queue, &queue->pending), equation);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  for (bucket = queue->cursor; bucket <= equation && bucket < queue->nbuckets; bucket++)
+  {
+    while (queue->buckets[bucket].nids > 0)
+    {
+      ierr = adj_expiry_visit_forward(adjointer, adj_expiry_pop(queue, &queue->buckets[bucket]), equation);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+  }
+  queue->cursor = equation + 1;
+
+  /* If the equations after last_equation don't count, the values they are the only ones to use can go too.
+     Only adj_forget_forward_equation_until asks for that; forgetting one moves the last id of its
+     bucket into its slot, so walk them backwards. */
+  if (last_equation < adjointer->nequations - 1)
+  {
+    for (bucket = queue->nbuckets - 1; bucket > last_equation; bucket--)
+    {
+      for (k = queue->buckets[bucket].nids - 1; k >= 0; k--)
+      {
+        adjointer->expiry->nvisited++;
+        data = ADJ_VARIABLE_DATA(adjointer, queue->buckets[bucket].ids[k]);
+        if (data->equation > equation || adj_expiry_forward_needed(adjointer, data, equation, last_equation))
+          continue;
+
+        adj_expiry_remove(queue, data->id);
+        ierr = adj_expiry_forget_value(adjointer, queue, data);
+        if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      }
+    }
+  }
+
+  return ADJ_OK;
+}
+
+/* The number of variables the last forget call looked at */
+int adj_expiry_visits(adj_adjointer* adjointer)
+{
+  if (adjointer->expiry == NULL) return 0;
+  return adjointer->expiry->nvisited;
+}
+
+static void adj_expiry_free_queue(adj_expiry_queue* queue)
+{
+  int i;
+
+  for (i = 0; i < queue->nbuckets; i++)
+    free(queue->buckets[i].ids);
+  free(queue->buckets);
+  free(queue->pending.ids);
+  free(queue->positions);
+}
+
+int adj_destroy_expiry(adj_adjointer* adjointer)
+{
+  if (adjointer->expiry == NULL) return ADJ_OK;
+
+  adj_expiry_free_queue(&adjointer->expiry->adjoint);
+  adj_expiry_free_queue(&adjointer->expiry->forward);
+  free(adjointer->expiry);
+  adjointer->expiry = NULL;
+  return ADJ_OK;
+}
@@ -241,13 +241,13 @@ int adj_get_gst(adj_gst* gst_handle, int i, adj_scalar* sigma, adj_vector* u, ad
       ierr = VecRestoreArray(u_vec, &u_arr);
 
       /* Now u is an adj_vector containing the unnormalized values */
-      adjointer->callbacks.vec_duplicate(*u, &Xu);
+      adj_vec_pool_get(adjointer, *u, &Xu);
       adjointer->callbacks.mat_action(*gst_data->final_norm, *u, &Xu);
 
       /* Now Xu contains the product X.u. We want to inner that with u
          to get the actual norm */
       adjointer->callbacks.vec_dot_product(*u, Xu, &inner);
-      adjointer->callbacks.vec_destroy(&Xu);
+      adj_vec_pool_put(adjointer, &Xu);
 
       /* Now finally scale u_vec by the norm */
       norm = sqrt(inner);
@@ -280,10 +280,10 @@ int adj_get_gst(adj_gst* gst_handle, int i, adj_scalar* sigma, adj_vector* u, ad
       adj_scalar inner;
       adj_scalar norm;
 
-      adjointer->callbacks.vec_duplicate(*v, &Xv);
+      adj_vec_pool_get(adjointer, *v, &Xv);
       adjointer->callbacks.mat_action(*gst_data->ic_norm, *v, &Xv);
       adjointer->callbacks.vec_dot_product(*v, Xv, &inner);
-      adjointer->callbacks.vec_destroy(&Xv);
+      adj_vec_pool_put(adjointer, &Xv);
 
       /* Now finally scale v_vec by the norm */
       norm = sqrt(inner);
@@ -414,18 +414,18 @@ PetscErrorCode tlm_solve(Mat A, Vec x, Vec y)
     if (adj_variable_equal(&gst_data->ic, &fwd_var, 1))
     {
       /* fetch the vector from our input PETSc Vec, stuff it into rhs_tmp */
-      adjointer->callbacks.vec_duplicate(rhs, &rhs_tmp);
+      adj_vec_pool_get(adjointer, rhs, &rhs_tmp);
 
       ierr = VecGetArrayRead(x, (const PetscScalar**) &px); CHKERRQ(ierr);
       adjointer->callbacks.vec_set_values(&rhs_tmp, px);
       ierr = VecRestoreArrayRead(x, (const PetscScalar**) &px); CHKERRQ(ierr);
 
       adjointer->callbacks.vec_axpy(&rhs, (adj_scalar) 1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
 
     adjointer->callbacks.solve(tlm_var, lhs, rhs, &soln);
-    adjointer->callbacks.vec_destroy(&rhs);
+    adj_vec_pool_put(adjointer, &rhs);
     adjointer->callbacks.mat_destroy(&lhs);
 
     ierr = adj_storage_memory_copy(soln, &storage);
@@ -444,7 +444,7 @@ PetscErrorCode tlm_solve(Mat A, Vec x, Vec y)
       return_flag = ADJ_TRUE;
     }
 
-    adjointer->callbacks.vec_destroy(&soln);
+    adj_vec_pool_put(adjointer, &soln);
 
     if (return_flag)
     {
@@ -511,18 +511,18 @@ PetscErrorCode adj_solve(Mat A, Vec x, Vec y)
     if (adj_variable_equal(&gst_data->final, &fwd_var, 1))
     {
       /* fetch the vector from our input PETSc Vec, stuff it into rhs_tmp */
-      adjointer->callbacks.vec_duplicate(rhs, &rhs_tmp);
+      adj_vec_pool_get(adjointer, rhs, &rhs_tmp);
 
       ierr = VecGetArrayRead(x, (const PetscScalar**) &px); CHKERRQ(ierr);
       adjointer->callbacks.vec_set_values(&rhs_tmp, px);
       ierr = VecRestoreArrayRead(x, (const PetscScalar**) &px); CHKERRQ(ierr);
 
       adjointer->callbacks.vec_axpy(&rhs, (adj_scalar) 1.0, rhs_tmp);
-      adjointer->callbacks.vec_destroy(&rhs_tmp);
+      adj_vec_pool_put(adjointer, &rhs_tmp);
     }
 
     adjointer->callbacks.solve(adj_var, lhs, rhs, &soln);
-    adjointer->callbacks.vec_destroy(&rhs);
+    adj_vec_pool_put(adjointer, &rhs);
     adjointer->callbacks.mat_destroy(&lhs);
 
     ierr = adj_storage_memory_copy(soln, &storage);
@@ -541,7 +541,7 @@ PetscErrorCode adj_solve(Mat A, Vec x, Vec y)
       return_flag = ADJ_TRUE;
     }
 
-    adjointer->callbacks.vec_destroy(&soln);
+    adj_vec_pool_put(adjointer, &soln);
 
     if (return_flag)
     {
@@ -606,8 +606,8 @@ PetscErrorCode gst_mult(Mat A, Vec x, Vec y)
     ierr = VecGetArray(XLx, &XLx_array);           CHKERRQ(ierr);
 
     ierr = adj_get_variable_value(adjointer, gst_data->final, &final_val);
-    adjointer->callbacks.vec_duplicate(final_val, &Lx_vector);
-    adjointer->callbacks.vec_duplicate(final_val, &XLx_vector);
+    adj_vec_pool_get(adjointer, final_val, &Lx_vector);
+    adj_vec_pool_get(adjointer, final_val, &XLx_vector);
 
     /* OK. Stuff the values from Lx into Lx_vector. */
     adjointer->callbacks.vec_set_values(&Lx_vector, Lx_array);
@@ -620,8 +620,8 @@ PetscErrorCode gst_mult(Mat A, Vec x, Vec y)
     ierr = VecRestoreArray(Lx, &Lx_array);         CHKERRQ(ierr);
     ierr = VecRestoreArray(XLx, &XLx_array);       CHKERRQ(ierr);
 
-    adjointer->callbacks.vec_destroy(&Lx_vector);
-    adjointer->callbacks.vec_destroy(&XLx_vector);
+    adj_vec_pool_put(adjointer, &Lx_vector);
+    adj_vec_pool_put(adjointer, &XLx_vector);
 
     ierr = VecDestroy(&Lx);                         CHKERRQ(ierr);
 
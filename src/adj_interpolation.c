@@ -0,0 +1,276 @@
+#include "libadjoint/adj_interpolation.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* Temporal interpolation of recorded values, set per variable name with adj_set_interpolation.
+   Of the values of such a variable, only those of every stride-th timestep (the anchors) are
+   kept: once an anchor is recorded, the values recorded since the one before it are forgotten
+   and marked as interpolated. adj_get_variable_value serves them by interpolating between the
+   anchors either side, at the end times of the timesteps (adj_timestep_get_times), either
+   linearly or with a cubic Hermite interpolant whose slopes are central differences of the
+   neighbouring anchors (one-sided at the ends of the run). The interpolated value is then held
+   like any other memory value until it is forgotten, and can be interpolated again.
+
+   Anchors are kept for as long as a value interpolated from them may still be needed by the
+   adjoint run, so adj_forget_adjoint_equation leaves only the anchor states alive. This is an
+   approximation meant for adjoint runs without revolve checkpointing, where recomputing the
+   forward run is too expensive. */
+
+typedef struct
+{
+  char name[ADJ_NAME_LEN];
+  int stride;
+  int method; /* ADJ_INTERPOLATION_LINEAR or ADJ_INTERPOLATION_CUBIC_HERMITE */
+} adj_interpolation_rule;
+
+struct adj_interpolation
+{
+  int nrules;
+  int rules_sz;
+  adj_interpolation_rule* rules;
+};
+
+static adj_interpolation_rule* adj_interpolation_find_rule(adj_adjointer* adjointer, adj_variable var)
+{
+  int i;
+
+  if (adjointer->interpolation == NULL || var.type != ADJ_FORWARD) return NULL;
+
+  for (i = 0; i < adjointer->interpolation->nrules; i++)
+    if (strncmp(adjointer->interpolation->rules[i].name, var.name, ADJ_NAME_LEN) == 0)
+      return &adjointer->interpolation->rules[i];
+  return NULL;
+}
+
+int adj_set_interpolation(adj_adjointer* adjointer, char* name, int stride, int method)
+{
+  struct adj_interpolation* interpolation;
+  adj_interpolation_rule* rule;
+  int i;
+
+  if (strlen(name) >= ADJ_NAME_LEN)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Variable name %s is too long.", name);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (stride < 1)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The interpolation stride must be at least one, but got %d.", stride);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (method != ADJ_INTERPOLATION_LINEAR && method != ADJ_INTERPOLATION_CUBIC_HERMITE)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "method must either be ADJ_INTERPOLATION_LINEAR or ADJ_INTERPOLATION_CUBIC_HERMITE.");
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  if (adjointer->interpolation == NULL)
+  {
+    adjointer->interpolation = (struct adj_interpolation*) malloc(sizeof(struct adj_interpolation));
+    ADJ_CHKMALLOC(adjointer->interpolation);
+    memset(adjointer->interpolation, 0, sizeof(struct adj_interpolation));
+  }
+  interpolation = adjointer->interpolation;
+
+  rule = NULL;
+  for (i = 0; i < interpolation->nrules; i++)
+    if (strncmp(interpolation->rules[i].name, name, ADJ_NAME_LEN) == 0)
+      rule = &interpolation->rules[i];
+
+  if (rule == NULL)
+  {
+    if (interpolation->nrules == interpolation->rules_sz)
+    {
+      int new_sz = (interpolation->rules_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * interpolation->rules_sz;
+      interpolation->rules = (adj_interpolation_rule*) realloc(interpolation->rules, new_sz * sizeof(adj_interpolation_rule));
+      ADJ_CHKMALLOC(interpolation->rules);
+      interpolation->rules_sz = new_sz;
+    }
+    rule = &interpolation->rules[interpolation->nrules++];
+    strncpy(rule->name, name, ADJ_NAME_LEN);
+  }
+
+  rule->stride = stride;
+  rule->method = method;
+  return ADJ_OK;
+}
+
+static int adj_interpolation_has_value(adj_adjointer* adjointer, adj_variable var)
+{
+  adj_variable_data* data;
+
+  if (adj_find_variable_data(&(adjointer->varhash), &var, &data) != ADJ_OK) return ADJ_FALSE;
+  return data->storage.storage_memory_has_value || data->storage.storage_disk_has_value;
+}
+
+int adj_interpolation_recorded(adj_adjointer* adjointer, adj_variable var)
+{
+  adj_interpolation_rule* rule;
+  adj_variable_data* data;
+  adj_variable other;
+  int anchor, ierr;
+
+  rule = adj_interpolation_find_rule(adjointer, var);
+  if (rule == NULL || rule->stride == 1 || var.timestep % rule->stride != 0 || var.timestep < rule->stride) return ADJ_OK;
+
+  /* var is an anchor: if the one before it is there, what lies between can be interpolated */
+  anchor = var.timestep - rule->stride;
+  other = var;
+  other.timestep = anchor;
+  if (!adj_interpolation_has_value(adjointer, other)) return ADJ_OK;
+
+  for (other.timestep = anchor + 1; other.timestep < var.timestep; other.timestep++)
+  {
+    if (adj_find_variable_data(&(adjointer->varhash), &other, &data) != ADJ_OK) continue;
+    if (data->storage.storage_memory_is_checkpoint || data->storage.storage_disk_is_checkpoint) continue;
+    if (!data->storage.storage_memory_has_value && !data->storage.storage_disk_has_value) continue;
+
+    ierr = adj_forget_variable_value(adjointer, other, data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    data->storage.interpolated = ADJ_TRUE;
+  }
+
+  return ADJ_OK;
+}
+
+/* The state time of a variable is the end of its timestep */
+static int adj_interpolation_time(adj_adjointer* adjointer, int timestep, adj_scalar* time)
+{
+  adj_scalar start;
+  int ierr;
+
+  ierr = adj_timestep_get_times(adjointer, timestep, &start, time);
+  if (ierr != ADJ_OK)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Temporal interpolation needs the times of timestep %d; set them with adj_timestep_set_times.", timestep);
+    return adj_chkierr_auto(ierr);
+  }
+  return ADJ_OK;
+}
+
+int adj_interpolate_value(adj_adjointer* adjointer, adj_variable var, adj_variable_data* data)
+{
+  adj_interpolation_rule* rule;
+  adj_variable anchor_var;
+  adj_vector anchors[4]; /* the anchors before, at the start, at the end and after the interval */
+  adj_scalar times[4];
+  adj_scalar weights[4];
+  int have[4];
+  adj_scalar time, h, s, h00, h10, h01, h11, c;
+  int j, ierr;
+
+  if (adjointer->callbacks.vec_duplicate == NULL || adjointer->callbacks.vec_axpy == NULL)
+  {
+    strncpy(adj_error_msg, "Temporal interpolation needs the ADJ_VEC_DUPLICATE_CB and ADJ_VEC_AXPY_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  rule = adj_interpolation_find_rule(adjointer, var);
+  assert(rule != NULL);
+
+  anchor_var = var;
+  for (j = 0; j < 4; j++)
+  {
+    anchor_var.timestep = var.timestep - var.timestep % rule->stride + (j - 1) * rule->stride;
+    have[j] = (anchor_var.timestep >= 0 && adj_interpolation_has_value(adjointer, anchor_var));
+    if (!have[j] && (j == 1 || j == 2))
+    {
+      char buf[ADJ_NAME_LEN];
+      adj_variable_str(anchor_var, buf, ADJ_NAME_LEN);
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Need the value of %s to interpolate from, but don't have one.", buf);
+      return adj_chkierr_auto(ADJ_ERR_NEED_VALUE);
+    }
+    if (!have[j]) continue;
+
+    ierr = adj_get_variable_value(adjointer, anchor_var, &anchors[j]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_interpolation_time(adjointer, anchor_var.timestep, &times[j]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  ierr = adj_interpolation_time(adjointer, var.timestep, &time);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  h = times[2] - times[1];
+  if (!(h > 0.0))
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Can't interpolate in time between timesteps %d and %d, as their times don't increase.", var.timestep - var.timestep % rule->stride, var.timestep - var.timestep % rule->stride + rule->stride);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  s = (time - times[1]) / h;
+
+  memset(weights, 0, sizeof(weights));
+  if (rule->method == ADJ_INTERPOLATION_LINEAR)
+  {
+    weights[1] = 1.0 - s;
+    weights[2] = s;
+  }
+  else
+  {
+    h00 = 2.0 * s * s * s - 3.0 * s * s + 1.0;
+    h10 = s * s * s - 2.0 * s * s + s;
+    h01 = -2.0 * s * s * s + 3.0 * s * s;
+    h11 = s * s * s - s * s;
+    weights[1] = h00;
+    weights[2] = h01;
+
+    /* The slope at the start, h10 * h * (u[2] - u[0]) / (t[2] - t[0]), or one-sided */
+    c = have[0] ? h10 * h / (times[2] - times[0]) : h10;
+    weights[2] += c;
+    weights[have[0] ? 0 : 1] -= c;
+
+    /* and at the end, h11 * h * (u[3] - u[1]) / (t[3] - t[1]), or one-sided */
+    c = have[3] ? h11 * h / (times[3] - times[1]) : h11;
+    weights[have[3] ? 3 : 2] += c;
+    weights[1] -= c;
+  }
+
+  adjointer->callbacks.vec_duplicate(anchors[1], &(data->storage.value));
+  for (j = 0; j < 4; j++)
+    if (have[j] && weights[j] != 0.0)
+      adjointer->callbacks.vec_axpy(&(data->storage.value), weights[j], anchors[j]);
+
+  data->storage.storage_memory_type = ADJ_STORAGE_MEMORY_COPY;
+  data->storage.storage_memory_has_value = ADJ_TRUE;
+  data->storage.storage_memory_is_checkpoint = ADJ_FALSE;
+  ierr = adj_update_live_variable(adjointer, data);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  return adj_memory_budget_charge(adjointer, data);
+}
+
+/* The lowest equation adj_forget_adjoint_equation may forget the anchor var at: the values interpolated
+   from it are needed by the adjoint run down to there. INT_MAX if var is not an anchor, or nothing is
+   interpolated from it. */
+int adj_interpolation_anchor_expiry(adj_adjointer* adjointer, adj_variable var)
+{
+  adj_interpolation_rule* rule;
+  adj_variable_data* data;
+  adj_variable other;
+  int reach, expiry, other_expiry;
+
+  rule = adj_interpolation_find_rule(adjointer, var);
+  if (rule == NULL || var.timestep % rule->stride != 0) return INT_MAX;
+
+  /* The cubic interpolant also takes the slope from the anchors beyond the interval */
+  reach = (rule->method == ADJ_INTERPOLATION_CUBIC_HERMITE) ? 2 * rule->stride : rule->stride;
+  expiry = INT_MAX;
+  other = var;
+  for (other.timestep = var.timestep - reach + 1; other.timestep < var.timestep + reach; other.timestep++)
+  {
+    if (other.timestep < 0 || other.timestep % rule->stride == 0) continue;
+    if (adj_find_variable_data(&(adjointer->varhash), &other, &data) != ADJ_OK) continue;
+    if (!data->storage.interpolated) continue;
+    other_expiry = adj_expiry_adjoint_equation(adjointer, data);
+    if (other_expiry < expiry) expiry = other_expiry;
+  }
+  return expiry;
+}
+
+int adj_destroy_interpolation(adj_adjointer* adjointer)
+{
+  if (adjointer->interpolation == NULL) return ADJ_OK;
+
+  free(adjointer->interpolation->rules);
+  free(adjointer->interpolation);
+  adjointer->interpolation = NULL;
+  return ADJ_OK;
+}
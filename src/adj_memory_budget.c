@@ -0,0 +1,271 @@
+#include "libadjoint/adj_memory_budget.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* With a memory budget set (adj_set_memory_budget), every forward value held in memory is
+   charged its size in bytes, and whenever a recording takes the total over the budget the
+   values the adjoint run will need last are moved to disk with vec_write, until it fits again.
+   They come back through the usual vec_read path in adj_get_variable_value.
+
+   The adjoint sweep runs backwards over the equations, so a forward value is first needed at
+   the last adjoint equation that uses it, the largest entry of its (sorted) adjoint_equations.
+   Spilling the value with the smallest such entry first is therefore furthest-next-use
+   eviction for the adjoint run; values no adjoint equation needs go before anything else.
+   Memory checkpoints are never spilled.
+
+   The values that may be spilled are kept in a binary heap on that entry, so each victim costs
+   O(log n) rather than a scan of everything held. Registering equations only ever raises the
+   entry, so the keys in the heap may be stale, but never too high: the top is looked at again
+   before it is spilled, and sifted down if it has moved.
+
+   Values are only spilled when a value is recorded and when the forget routines are called: the
+   callers of adj_get_variable_value hold on to the vectors it hands out until then. Values read
+   back from disk are charged straight away, and brought back under the budget at the next of those. */
+
+struct adj_memory_heap
+{
+  int nentries;
+  int entries_sz;
+  int* ids; /* the variables that may be spilled, as a binary heap on keys */
+  int* keys; /* the last adjoint equation each one was needed at when it was last looked at */
+  int npositions;
+  int* positions; /* indexed by variable id: where it is in ids, or -1 */
+};
+
+/* The adjoint equation that needs data last; -1 if none does */
+static int adj_memory_budget_key(adj_variable_data* data)
+{
+  return (data->nadjoint_equations > 0) ? data->adjoint_equations[data->nadjoint_equations - 1] : -1;
+}
+
+/* Ties go to the value recorded first */
+static int adj_memory_heap_less(struct adj_memory_heap* heap, int i, int j)
+{
+  return heap->keys[i] < heap->keys[j] || (heap->keys[i] == heap->keys[j] && heap->ids[i] < heap->ids[j]);
+}
+
+static void adj_memory_heap_swap(struct adj_memory_heap* heap, int i, int j)
+{
+  int id = heap->ids[i];
+  int key = heap->keys[i];
+
+  heap->ids[i] = heap->ids[j];
+  heap->keys[i] = heap->keys[j];
+  heap->ids[j] = id;
+  heap->keys[j] = key;
+  heap->positions[heap->ids[i]] = i;
+  heap->positions[heap->ids[j]] = j;
+}
+
+static void adj_memory_heap_sift_up(struct adj_memory_heap* heap, int i)
+{
+  while (i > 0 && adj_memory_heap_less(heap, i, (i - 1) / 2))
+  {
+    adj_memory_heap_swap(heap, i, (i - 1) / 2);
+    i = (i - 1) / 2;
+  }
+}
+
+static void adj_memory_heap_sift_down(struct adj_memory_heap* heap, int i)
+{
+  int child;
+
+  for (;;)
+  {
+    child = 2 * i + 1;
+    if (child >= heap->nentries) break;
+    if (child + 1 < heap->nentries && adj_memory_heap_less(heap, child + 1, child)) child++;
+    if (!adj_memory_heap_less(heap, child, i)) break;
+    adj_memory_heap_swap(heap, i, child);
+    i = child;
+  }
+}
+
+static void adj_memory_heap_remove(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_memory_heap* heap = adjointer->memory_heap;
+  int i, moved;
+
+  if (heap == NULL || data->id >= heap->npositions || heap->positions[data->id] < 0) return;
+
+  /* Move the last entry into the hole, and put it where it belongs from there */
+  i = heap->positions[data->id];
+  heap->positions[data->id] = -1;
+  heap->nentries--;
+  if (i == heap->nentries) return;
+  moved = heap->ids[heap->nentries];
+  heap->ids[i] = moved;
+  heap->keys[i] = heap->keys[heap->nentries];
+  heap->positions[moved] = i;
+  adj_memory_heap_sift_up(heap, i);
+  if (heap->positions[moved] == i) adj_memory_heap_sift_down(heap, i);
+}
+
+static int adj_memory_heap_insert(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_memory_heap* heap;
+  int new_sz, i;
+
+  if (adjointer->memory_heap == NULL)
+  {
+    adjointer->memory_heap = (struct adj_memory_heap*) malloc(sizeof(struct adj_memory_heap));
+    ADJ_CHKMALLOC(adjointer->memory_heap);
+    memset(adjointer->memory_heap, 0, sizeof(struct adj_memory_heap));
+  }
+  heap = adjointer->memory_heap;
+
+  if (data->id >= heap->npositions)
+  {
+    new_sz = (heap->npositions == 0) ? ADJ_PREALLOC_SIZE : 2 * heap->npositions;
+    if (new_sz <= data->id) new_sz = data->id + 1;
+    heap->positions = (int*) realloc(heap->positions, new_sz * sizeof(int));
+    ADJ_CHKMALLOC(heap->positions);
+    for (i = heap->npositions; i < new_sz; i++)
+      heap->positions[i] = -1;
+    heap->npositions = new_sz;
+  }
+  if (heap->positions[data->id] >= 0) return ADJ_OK;
+
+  if (heap->nentries == heap->entries_sz)
+  {
+    new_sz = (heap->entries_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * heap->entries_sz;
+    heap->ids = (int*) realloc(heap->ids, new_sz * sizeof(int));
+    ADJ_CHKMALLOC(heap->ids);
+    heap->keys = (int*) realloc(heap->keys, new_sz * sizeof(int));
+    ADJ_CHKMALLOC(heap->keys);
+    heap->entries_sz = new_sz;
+  }
+
+  i = heap->nentries++;
+  heap->ids[i] = data->id;
+  heap->keys[i] = adj_memory_budget_key(data);
+  heap->positions[data->id] = i;
+  adj_memory_heap_sift_up(heap, i);
+  return ADJ_OK;
+}
+
+/* Keep the heap in step with whether data holds a charged value in memory that isn't a checkpoint.
+   adj_update_live_variable calls this whenever the storage of a variable changes. */
+int adj_memory_budget_update(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  if (data->id < 0) return ADJ_OK;
+
+  if (data->memory_size > 0 && data->storage.storage_memory_has_value && !data->storage.storage_memory_is_checkpoint)
+    return adj_memory_heap_insert(adjointer, data);
+
+  adj_memory_heap_remove(adjointer, data);
+  return ADJ_OK;
+}
+
+int adj_memory_budget_charge(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  int size;
+
+  if (adjointer->memory_budget == 0 || data->type != ADJ_FORWARD || data->memory_size > 0)
+    return ADJ_OK;
+
+  /* A shared copy is only charged to one of the values that hold it */
+  if (!adj_dedup_take_charge(data))
+    return ADJ_OK;
+
+  /* Compressed values are charged what they take compressed, POD values their coefficients,
+     and either of them the full value as well while it is decompressed */
+  if (data->storage.compressed != NULL || data->storage.pod != NULL)
+  {
+    data->memory_size = adj_compressed_size(data) + adj_pod_value_size(data);
+    adjointer->memory_used += data->memory_size;
+    return adj_memory_budget_update(adjointer, data);
+  }
+
+  if (adjointer->callbacks.vec_get_size == NULL)
+  {
+    strncpy(adj_error_msg, "Need the ADJ_VEC_GET_SIZE_CB data callback to keep to the memory budget, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  adjointer->callbacks.vec_get_size(data->storage.value, &size);
+  data->memory_size = (size_t) size * sizeof(adj_scalar);
+  adjointer->memory_used += data->memory_size;
+  return adj_memory_budget_update(adjointer, data);
+}
+
+void adj_memory_budget_release(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  adjointer->memory_used -= data->memory_size;
+  data->memory_size = 0;
+  adj_memory_heap_remove(adjointer, data);
+}
+
+/* A compressed or POD value grows when it is decompressed, so what it is charged has to follow */
+int adj_memory_budget_recharge(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  if (data->memory_size == 0) return ADJ_OK;
+
+  adj_memory_budget_release(adjointer, data);
+  return adj_memory_budget_charge(adjointer, data);
+}
+
+static int adj_spill_variable(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  adj_vector value;
+  int ierr;
+
+  if (adjointer->callbacks.vec_write == NULL)
+  {
+    strncpy(adj_error_msg, "Need the ADJ_VEC_WRITE_CB data callback to keep to the memory budget, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  /* A value read back from disk is still there */
+  if (!data->storage.storage_disk_has_value)
+  {
+    ierr = adj_storage_memory_value(adjointer, data, &value);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_write_behind_write(adjointer, data, adjointer->varentries[data->id]->variable, value);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    data->storage.storage_disk_has_value = ADJ_TRUE;
+    data->storage.storage_disk_is_checkpoint = ADJ_FALSE;
+  }
+
+  return adj_forget_variable_value_from_memory(adjointer, data);
+}
+
+int adj_memory_budget_enforce(adj_adjointer* adjointer)
+{
+  struct adj_memory_heap* heap;
+  int key, ierr;
+
+  while (adjointer->memory_budget > 0 && adjointer->memory_used > adjointer->memory_budget)
+  {
+    /* Everything left in memory is a checkpoint */
+    heap = adjointer->memory_heap;
+    if (heap == NULL || heap->nentries == 0) break;
+
+    /* An equation registered since it was keyed needs it later on */
+    key = adj_memory_budget_key(ADJ_VARIABLE_DATA(adjointer, heap->ids[0]));
+    if (key != heap->keys[0])
+    {
+      heap->keys[0] = key;
+      adj_memory_heap_sift_down(heap, 0);
+      continue;
+    }
+
+    /* Spilling it takes it off the heap */
+    ierr = adj_spill_variable(adjointer, ADJ_VARIABLE_DATA(adjointer, heap->ids[0]));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  return ADJ_OK;
+}
+
+int adj_destroy_memory_budget(adj_adjointer* adjointer)
+{
+  if (adjointer->memory_heap == NULL) return ADJ_OK;
+
+  free(adjointer->memory_heap->ids);
+  free(adjointer->memory_heap->keys);
+  free(adjointer->memory_heap->positions);
+  free(adjointer->memory_heap);
+  adjointer->memory_heap = NULL;
+  return ADJ_OK;
+}
@@ -13,6 +13,8 @@ int adj_set_petsc_data_callbacks(adj_adjointer* adjointer)
   adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_VEC_SET_VALUES_CB,(void (*)(void)) petsc_vec_setvalues_proc);
   adj_chkierr(ierr);
+  ierr = adj_register_data_callback(adjointer, ADJ_VEC_GET_SIZE_CB,(void (*)(void)) petsc_vec_getsize_proc);
+  adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_VEC_DIVIDE_CB,(void (*)(void)) petsc_vec_divide_proc);
   adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_VEC_GET_NORM_CB,(void (*)(void)) petsc_vec_getnorm_proc);
@@ -27,6 +29,8 @@ int adj_set_petsc_data_callbacks(adj_adjointer* adjointer)
   adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_VEC_DELETE_CB,(void (*)(void)) petsc_vec_delete_proc);
   adj_chkierr(ierr);
+  ierr = adj_register_data_callback(adjointer, ADJ_VEC_ZERO_CB,(void (*)(void)) petsc_vec_zero_proc);
+  adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_MAT_AXPY_CB,(void (*)(void)) petsc_mat_axpy_proc);
   adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_MAT_DESTROY_CB,(void (*)(void)) petsc_mat_destroy_proc);
@@ -35,6 +39,8 @@ int adj_set_petsc_data_callbacks(adj_adjointer* adjointer)
   adj_chkierr(ierr);
   ierr = adj_register_data_callback(adjointer, ADJ_SOLVE_CB,(void (*)(void)) petsc_solve_proc);
   adj_chkierr(ierr);
+  ierr = adj_register_data_callback(adjointer, ADJ_SOLVE_MULTI_CB,(void (*)(void)) petsc_solve_multi_proc);
+  adj_chkierr(ierr);
 #else
   (void) adjointer;
   ierr = ADJ_ERR_INVALID_INPUTS;
@@ -83,6 +89,15 @@ void petsc_vec_destroy_proc(adj_vector *x)
 #endif
 }
 
+void petsc_vec_zero_proc(adj_vector *x)
+{
+#ifdef HAVE_PETSC
+  VecZeroEntries(*(Vec*) x->ptr);
+#else
+  (void) x;
+#endif
+}
+
 void petsc_vec_delete_proc(adj_variable var)
 {
 #ifdef HAVE_PETSC
@@ -276,6 +291,62 @@ void petsc_solve_proc(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vect
     (void) var;
 }
 
+void petsc_solve_multi_proc(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns)
+{
+    /*************************************************/
+    /* As petsc_solve_proc, but for several rhs: the */
+    /* LU factorisation is computed on the first     */
+    /* solve and reused for the others.              */
+    /*************************************************/
+#ifdef HAVE_PETSC
+    KSP            ksp; /* linear solver context */ 
+    PC             pc;  /* preconditioner context */
+    int            i;
+#if PETSC_VERSION_MINOR <= 1
+    PetscTruth assembled;
+#else
+    PetscBool assembled;
+#endif
+   
+    MatAssembled(*(Mat*) mat.ptr, &assembled);
+    if (!assembled)
+      MatAssemblyEnd(petsc_mat_from_adj_matrix(mat), MAT_FINAL_ASSEMBLY);
+
+    KSPCreate(PETSC_COMM_WORLD, &ksp);
+    KSPSetOperators(ksp, petsc_mat_from_adj_matrix(mat), petsc_mat_from_adj_matrix(mat), DIFFERENT_NONZERO_PATTERN);
+
+    KSPGetPC(ksp, &pc);
+    KSPSetType(ksp, KSPPREONLY);
+    PCSetType(pc, PCLU);
+    KSPSetTolerances(ksp, 1.e-7, PETSC_DEFAULT, PETSC_DEFAULT, PETSC_DEFAULT);
+
+    for (i = 0; i < nrhs; i++)
+    {
+      /* Create the output vector */
+      Vec *sol_vec=(Vec*) malloc(sizeof(Vec));
+#if PETSC_VERSION_MAJOR == 3 && PETSC_VERSION_MINOR <= 5 && PETSC_VERSION_RELEASE == 1
+      MatGetVecs(petsc_mat_from_adj_matrix(mat), sol_vec, NULL);
+#else
+      MatCreateVecs(petsc_mat_from_adj_matrix(mat), sol_vec, NULL);
+#endif
+      KSPSolve(ksp, petsc_vec_from_adj_vector(rhs[i]), *sol_vec);
+      solns[i] = petsc_vec_to_adj_vector(sol_vec);
+    }
+
+#if PETSC_VERSION_MINOR > 1
+    KSPDestroy(&ksp);
+#else
+    KSPDestroy(ksp);
+#endif
+#else
+    (void) nrhs;
+    (void) mat;
+    (void) rhs;
+    (void) solns;
+#endif
+    (void) vars;
+}
+
 void petsc_mat_axpy_proc(adj_matrix *Y, adj_scalar alpha, adj_matrix X)
 {
     /* Computes Y = alpha*X + Y. */
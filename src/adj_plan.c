@@ -0,0 +1,229 @@
+#include "libadjoint/adj_plan.h"
+
+/* The terms of an adjoint equation only depend on the structure of the annotation, which
+   is fixed once the annotation is finished. Working them out means walking the targeting,
+   depending and rhs lists of the forward variable and comparing variables against every
+   block found there, so we do that once per equation and keep the result as a flat list
+   of terms; adj_get_adjoint_equation then only has to evaluate them. */
+
+static void adj_plan_add(adj_adjoint_plan* plan, int kind, adj_block* block, int hermitian, int source, adj_variable* contraction, adj_scalar coefficient)
+{
+  adj_adjoint_plan_op* op = &(plan->ops[plan->nops]);
+
+  op->kind = kind;
+  op->block = block;
+  op->hermitian = hermitian;
+  op->source = source;
+  op->contraction = contraction;
+  op->coefficient = coefficient;
+  plan->nops++;
+}
+
+int adj_find_adjoint_plan(adj_adjointer* adjointer, int equation, adj_adjoint_plan* scratch, adj_adjoint_plan** plan)
+{
+  int ierr;
+
+  /* Until the annotation is finished, equations registered later may still add terms to this
+     one, so we can't keep the plan: build it in the scratch space the caller gave us. */
+  if (!adjointer->finished)
+  {
+    ierr = adj_compile_adjoint_plan(adjointer, equation, scratch);
+    if (ierr != ADJ_OK)
+    {
+      adj_destroy_adjoint_plan(scratch);
+      return adj_chkierr_auto(ierr);
+    }
+    *plan = scratch;
+    return ADJ_OK;
+  }
+
+  if (adjointer->adjoint_plans == NULL)
+  {
+    adjointer->adjoint_plans = (adj_adjoint_plan*) calloc(adjointer->nequations, sizeof(adj_adjoint_plan));
+    ADJ_CHKMALLOC(adjointer->adjoint_plans);
+    adjointer->nadjoint_plans = adjointer->nequations;
+  }
+
+  if (!adjointer->adjoint_plans[equation].compiled)
+  {
+    ierr = adj_compile_adjoint_plan(adjointer, equation, &(adjointer->adjoint_plans[equation]));
+    if (ierr != ADJ_OK)
+    {
+      adj_destroy_adjoint_plan(&(adjointer->adjoint_plans[equation]));
+      return adj_chkierr_auto(ierr);
+    }
+  }
+
+  *plan = &(adjointer->adjoint_plans[equation]);
+  return ADJ_OK;
+}
+
+int adj_compile_adjoint_plan(adj_adjointer* adjointer, int equation, adj_adjoint_plan* plan)
+{
+  int ierr;
+  int i, j, k;
+  int nops;
+  adj_equation* fwd_eqn;
+  adj_variable fwd_var;
+  adj_variable_data* fwd_data;
+
+  plan->compiled = ADJ_FALSE;
+  plan->nops = 0;
+  plan->ops = NULL;
+  plan->nadjoint_equations = 0;
+  plan->adjoint_equations = NULL;
+
+  fwd_eqn = &(adjointer->equations[equation]);
+  fwd_var = fwd_eqn->variable;
+
+  ierr = adj_find_variable_data(&(adjointer->varhash), &fwd_var, &fwd_data);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* First count the terms, so that we only malloc once */
+  nops = 0;
+  for (i = 0; i < fwd_data->ntargeting_equations; i++)
+  {
+    adj_equation* other_fwd_eqn = &(adjointer->equations[fwd_data->targeting_equations[i]]);
+    for (j = 0; j < other_fwd_eqn->nblocks; j++)
+      if (adj_variable_equal(&fwd_var, &(other_fwd_eqn->targets[j]), 1)) nops++;
+  }
+  for (i = 0; i < fwd_data->ndepending_equations; i++)
+  {
+    adj_equation* depending_eqn = &(adjointer->equations[fwd_data->depending_equations[i]]);
+
+    if (fwd_data->depending_equations[i] == equation)
+    {
+      /* This G-block is on the diagonal, and so we must assemble it .. later */
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Sorry, we can't handle G-blocks on the diagonal (yet).");
+      return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
+    }
+
+    for (j = 0; j < depending_eqn->nblocks; j++)
+    {
+      if (!depending_eqn->blocks[j].has_nonlinear_block) continue;
+      for (k = 0; k < depending_eqn->blocks[j].nonlinear_block.ndepends; k++)
+        if (adj_variable_equal(&fwd_var, &(depending_eqn->blocks[j].nonlinear_block.depends[k]), 1)) nops++;
+    }
+  }
+  nops += fwd_data->nrhs_equations;
+
+  if (nops > 0)
+  {
+    plan->ops = (adj_adjoint_plan_op*) malloc(nops * sizeof(adj_adjoint_plan_op));
+    ADJ_CHKMALLOC(plan->ops);
+  }
+
+  /* A* terms. The diagonal blocks are the ones in this equation that target fwd_var; their
+     hermitian is assembled into the lhs. The blocks of other equations that target fwd_var
+     act on the adjoints of those equations, and are subtracted from the rhs. */
+  for (i = 0; i < fwd_eqn->nblocks; i++)
+  {
+    if (adj_variable_equal(&(fwd_eqn->targets[i]), &fwd_var, 1))
+      adj_plan_add(plan, ADJ_PLAN_BLOCK_ASSEMBLY, &(fwd_eqn->blocks[i]), !fwd_eqn->blocks[i].hermitian, equation, NULL, (adj_scalar) 1.0);
+  }
+  for (i = 0; i < fwd_data->ntargeting_equations; i++)
+  {
+    int other = fwd_data->targeting_equations[i];
+    adj_equation* other_fwd_eqn = &(adjointer->equations[other]);
+
+    if (other == equation) continue; /* that term goes in the lhs, and we've already taken care of it */
+    for (j = 0; j < other_fwd_eqn->nblocks; j++)
+    {
+      if (adj_variable_equal(&fwd_var, &(other_fwd_eqn->targets[j]), 1))
+        adj_plan_add(plan, ADJ_PLAN_BLOCK_ACTION, &(other_fwd_eqn->blocks[j]), !other_fwd_eqn->blocks[j].hermitian, other, NULL, (adj_scalar) -1.0);
+    }
+  }
+
+  /* G* terms: the derivative of each nonlinear block that depends on fwd_var, contracted with
+     the block's target, acting on the adjoint of the depending equation. These are kept together,
+     as they are simplified as a group. */
+  for (i = 0; i < fwd_data->ndepending_equations; i++)
+  {
+    int depending = fwd_data->depending_equations[i];
+    adj_equation* depending_eqn = &(adjointer->equations[depending]);
+
+    for (j = 0; j < depending_eqn->nblocks; j++)
+    {
+      if (!depending_eqn->blocks[j].has_nonlinear_block) continue;
+      for (k = 0; k < depending_eqn->blocks[j].nonlinear_block.ndepends; k++)
+      {
+        if (adj_variable_equal(&fwd_var, &(depending_eqn->blocks[j].nonlinear_block.depends[k]), 1))
+          adj_plan_add(plan, ADJ_PLAN_DERIVATIVE_ACTION, &(depending_eqn->blocks[j]), !depending_eqn->blocks[j].hermitian, depending,
+                       &(depending_eqn->targets[j]), depending_eqn->blocks[j].coefficient);
+      }
+    }
+  }
+
+  /* R* terms: an rhs that is a function of the variable it solves for contributes to the lhs,
+     the others act on the adjoint of their equation and are added to the rhs. */
+  for (i = 0; i < fwd_data->nrhs_equations; i++)
+  {
+    int rhs_equation = fwd_data->rhs_equations[i];
+    if (adj_variable_equal(&(adjointer->equations[rhs_equation].variable), &fwd_var, 1))
+      adj_plan_add(plan, ADJ_PLAN_RHS_DERIVATIVE_ASSEMBLY, NULL, ADJ_TRUE, rhs_equation, NULL, (adj_scalar) -1.0);
+    else
+      adj_plan_add(plan, ADJ_PLAN_RHS_DERIVATIVE_ACTION, NULL, ADJ_TRUE, rhs_equation, NULL, (adj_scalar) 1.0);
+  }
+  assert(plan->nops == nops);
+
+  /* The adjoint equations the adjoint variable is necessary for are those of the targets and
+     dependencies of the blocks, and the dependencies of the rhs, of the forward equation. */
+  for (i = 0; i < fwd_eqn->nblocks; i++)
+  {
+    adj_variable_data* block_target_data;
+    ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn->targets[i]), &block_target_data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_append_unique(&(plan->adjoint_equations), &(plan->nadjoint_equations), block_target_data->equation);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+    for (j = 0; j < fwd_eqn->blocks[i].nonlinear_block.ndepends; j++)
+    {
+      adj_variable_data* j_data;
+      ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn->blocks[i].nonlinear_block.depends[j]), &j_data);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+      ierr = adj_append_unique(&(plan->adjoint_equations), &(plan->nadjoint_equations), j_data->equation);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+  }
+  for (i = 0; i < fwd_eqn->nrhsdeps; i++)
+  {
+    adj_variable_data* rhs_dep_data;
+    ierr = adj_find_variable_data(&(adjointer->varhash), &(fwd_eqn->rhsdeps[i]), &rhs_dep_data);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    ierr = adj_append_unique(&(plan->adjoint_equations), &(plan->nadjoint_equations), rhs_dep_data->equation);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+
+  plan->compiled = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+int adj_destroy_adjoint_plan(adj_adjoint_plan* plan)
+{
+  if (plan->ops != NULL) free(plan->ops);
+  if (plan->adjoint_equations != NULL) free(plan->adjoint_equations);
+  plan->ops = NULL;
+  plan->nops = 0;
+  plan->adjoint_equations = NULL;
+  plan->nadjoint_equations = 0;
+  plan->compiled = ADJ_FALSE;
+  return ADJ_OK;
+}
+
+int adj_destroy_adjoint_plans(adj_adjointer* adjointer)
+{
+  int i;
+  int ierr;
+
+  if (adjointer->adjoint_plans == NULL) return ADJ_OK;
+
+  for (i = 0; i < adjointer->nadjoint_plans; i++)
+  {
+    ierr = adj_destroy_adjoint_plan(&(adjointer->adjoint_plans[i]));
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  free(adjointer->adjoint_plans);
+  adjointer->adjoint_plans = NULL;
+  adjointer->nadjoint_plans = 0;
+  return ADJ_OK;
+}
@@ -0,0 +1,513 @@
+#include "libadjoint/adj_pod.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+#include <math.h>
+
+/* Values recorded with ADJ_STORAGE_MEMORY_POD (adj_storage_memory_pod) are not kept themselves:
+   they are projected onto a proper orthogonal decomposition of the states of that variable
+   recorded so far, and only their coefficients are kept.
+
+   The basis is built incrementally while a window of recordings fills, one state at a time. A state
+   whose energy the basis already captures to within the energy threshold (adj_set_pod_options) costs
+   nothing but its coefficients; otherwise what the basis misses is orthonormalised against it
+   (Gram-Schmidt, twice, which is enough in floating point) and becomes a new basis vector. Earlier
+   coefficients stay valid as the basis grows, as the basis vectors already there never change.
+
+   That basis is only as good as the order the states came in, so once the window is full it is
+   replaced by the proper orthogonal modes of its states (the method of snapshots): the eigenvectors of
+   the Gram matrix of their coefficients, ranked by eigenvalue, which is the energy of the states along
+   each mode. The leading modes that capture the energy threshold of the total are kept, the rest are
+   dropped, and the coefficients of every state are rewritten in the new basis. What each state lost
+   when it was projected is orthogonal to what the truncation drops, so the states of a window are
+   reconstructed with a relative error of at most sqrt(2 (1 - threshold)) together, in the norm of
+   vec_dot_product.
+
+   A basis serves a window of consecutive recordings of one variable name, and is freed when the
+   window is full and none of its values are held any more, so that a long run does not pile up
+   basis vectors. Values are reconstructed with vec_duplicate and vec_axpy when
+   adj_get_variable_value or the checkpointing asks for them, and the reconstruction is kept until
+   the value is forgotten from memory. Against a memory budget, a value is charged its coefficients
+   and any reconstruction, and the basis vectors are charged as they are made. adj_get_pod_stats
+   reports the number of basis vectors and the bytes the decomposition takes, against what the
+   values would take kept whole. */
+
+#define ADJ_POD_DEFAULT_WINDOW 50
+#define ADJ_POD_DEFAULT_ENERGY 0.99999999 /* reconstructions to within 1e-4 relative */
+
+typedef struct adj_pod_window
+{
+  char name[ADJ_NAME_LEN]; /* the variable name whose states it decomposes */
+  int nscalars;
+  adj_vector model; /* a vector of the layout, to reconstruct into duplicates of */
+  int nbasis;
+  int basis_sz;
+  adj_vector* basis;
+  size_t memory_size; /* bytes of the basis charged against the memory budget */
+  int nstates; /* recorded into it so far */
+  int nvalues; /* values still projected onto it */
+  int values_sz;
+  struct adj_pod_value** values; /* and which they are, so that truncating the basis can rewrite them */
+  struct adj_pod_window* next;
+} adj_pod_window;
+
+struct adj_pod_value
+{
+  adj_pod_window* window;
+  int index; /* in window->values */
+  adj_variable_data* data; /* whose value it is */
+  int ncoefficients;
+  adj_scalar* coefficients;
+  int reconstructed; /* whether storage.value holds the reconstruction at the moment */
+};
+
+struct adj_pod
+{
+  int window; /* recordings per basis */
+  adj_scalar energy_threshold;
+  adj_pod_window* windows;
+
+  int nbasis; /* over all windows */
+  size_t basis_bytes;
+  size_t coefficient_bytes;
+  size_t full_bytes; /* what the values projected would take kept whole */
+};
+
+static int adj_pod_init(adj_adjointer* adjointer)
+{
+  if (adjointer->pod != NULL) return ADJ_OK;
+
+  adjointer->pod = (struct adj_pod*) malloc(sizeof(struct adj_pod));
+  ADJ_CHKMALLOC(adjointer->pod);
+  memset(adjointer->pod, 0, sizeof(struct adj_pod));
+  adjointer->pod->window = ADJ_POD_DEFAULT_WINDOW;
+  adjointer->pod->energy_threshold = ADJ_POD_DEFAULT_ENERGY;
+  return ADJ_OK;
+}
+
+int adj_set_pod_options(adj_adjointer* adjointer, int window, adj_scalar energy_threshold)
+{
+  int ierr;
+
+  if (window < 1)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "A POD window needs at least one recording, but got %d.", window);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (!(energy_threshold > 0.0 && energy_threshold <= 1.0))
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The POD energy threshold must be in (0, 1], but got %e.", energy_threshold);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  ierr = adj_pod_init(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  adjointer->pod->window = window;
+  adjointer->pod->energy_threshold = energy_threshold;
+  return ADJ_OK;
+}
+
+static int adj_pod_open_window(adj_adjointer* adjointer, adj_variable var, adj_vector value, adj_pod_window** window)
+{
+  struct adj_pod* pod = adjointer->pod;
+  adj_pod_window* ptr;
+
+  for (ptr = pod->windows; ptr != NULL; ptr = ptr->next)
+  {
+    if (ptr->nstates < pod->window && strncmp(ptr->name, var.name, ADJ_NAME_LEN) == 0)
+    {
+      *window = ptr;
+      return ADJ_OK;
+    }
+  }
+
+  ptr = (adj_pod_window*) malloc(sizeof(adj_pod_window));
+  ADJ_CHKMALLOC(ptr);
+  memset(ptr, 0, sizeof(adj_pod_window));
+  strncpy(ptr->name, var.name, ADJ_NAME_LEN);
+  adjointer->callbacks.vec_get_size(value, &ptr->nscalars);
+  adjointer->callbacks.vec_duplicate(value, &ptr->model);
+  ptr->next = pod->windows;
+  pod->windows = ptr;
+
+  *window = ptr;
+  return ADJ_OK;
+}
+
+static void adj_pod_close_window(adj_adjointer* adjointer, adj_pod_window* window)
+{
+  struct adj_pod* pod = adjointer->pod;
+  adj_pod_window** link;
+  int i;
+
+  for (link = &pod->windows; *link != window; link = &(*link)->next);
+  *link = window->next;
+
+  for (i = 0; i < window->nbasis; i++)
+    adjointer->callbacks.vec_destroy(&window->basis[i]);
+  adjointer->callbacks.vec_destroy(&window->model);
+  pod->nbasis -= window->nbasis;
+  pod->basis_bytes -= (size_t) window->nbasis * window->nscalars * sizeof(adj_scalar);
+  adjointer->memory_used -= window->memory_size;
+  free(window->basis);
+  free(window->values);
+  free(window);
+}
+
+/* Take the projection of r onto the basis out of it, adding the coefficients to coefficients */
+static void adj_pod_orthogonalise(adj_adjointer* adjointer, adj_pod_window* window, adj_vector* r, adj_scalar* coefficients)
+{
+  adj_scalar c;
+  int i;
+
+  for (i = 0; i < window->nbasis; i++)
+  {
+    adjointer->callbacks.vec_dot_product(*r, window->basis[i], &c);
+    adjointer->callbacks.vec_axpy(r, -c, window->basis[i]);
+    coefficients[i] += c;
+  }
+}
+
+/* The eigenvalues of the symmetric n x n matrix a end up on its diagonal, and the eigenvectors
+   in the columns of v (cyclic Jacobi rotations; n is at most the window) */
+static void adj_pod_symmetric_eigen(int n, adj_scalar* a, adj_scalar* v)
+{
+  adj_scalar off, scale, theta, t, c, s, akp, akq;
+  int sweep, p, q, k;
+
+  for (p = 0; p < n; p++)
+    for (q = 0; q < n; q++)
+      v[p * n + q] = (p == q) ? 1.0 : 0.0;
+
+  for (sweep = 0; sweep < 50; sweep++)
+  {
+    off = 0.0;
+    scale = 0.0;
+    for (p = 0; p < n; p++)
+    {
+      scale += a[p * n + p] * a[p * n + p];
+      for (q = p + 1; q < n; q++)
+        off += a[p * n + q] * a[p * n + q];
+    }
+    if (off <= 1.0e-30 * scale) break;
+
+    for (p = 0; p < n; p++)
+    {
+      for (q = p + 1; q < n; q++)
+      {
+        if (a[p * n + q] == 0.0) continue;
+
+        /* The rotation in the (p, q) plane that zeroes a[p][q] */
+        theta = (a[q * n + q] - a[p * n + p]) / (2.0 * a[p * n + q]);
+        t = ((theta >= 0.0) ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+        c = 1.0 / sqrt(t * t + 1.0);
+        s = t * c;
+
+        for (k = 0; k < n; k++)
+        {
+          akp = a[k * n + p];
+          akq = a[k * n + q];
+          a[k * n + p] = c * akp - s * akq;
+          a[k * n + q] = s * akp + c * akq;
+        }
+        for (k = 0; k < n; k++)
+        {
+          akp = a[p * n + k];
+          akq = a[q * n + k];
+          a[p * n + k] = c * akp - s * akq;
+          a[q * n + k] = s * akp + c * akq;
+        }
+        for (k = 0; k < n; k++)
+        {
+          akp = v[k * n + p];
+          akq = v[k * n + q];
+          v[k * n + p] = c * akp - s * akq;
+          v[k * n + q] = s * akp + c * akq;
+        }
+      }
+    }
+  }
+}
+
+/* Replace the basis of a full window by the proper orthogonal modes of its states, keeping the
+   leading ones that capture the energy threshold */
+static int adj_pod_truncate_window(adj_adjointer* adjointer, adj_pod_window* window)
+{
+  struct adj_pod* pod = adjointer->pod;
+  struct adj_pod_value* value;
+  adj_scalar* gram;
+  adj_scalar* modes;
+  adj_scalar* coefficients;
+  int* order;
+  adj_vector* basis;
+  adj_scalar total, kept;
+  size_t vector_bytes = (size_t) window->nscalars * sizeof(adj_scalar);
+  int n = window->nbasis;
+  int nkept, i, j, k, m, ierr;
+
+  if (n <= 1) return ADJ_OK;
+
+  /* The Gram matrix of the states in the current basis: the energy they have along each pair of basis vectors */
+  gram = (adj_scalar*) calloc(n * n, sizeof(adj_scalar));
+  ADJ_CHKMALLOC(gram);
+  modes = (adj_scalar*) malloc(n * n * sizeof(adj_scalar));
+  ADJ_CHKMALLOC(modes);
+  order = (int*) malloc(n * sizeof(int));
+  ADJ_CHKMALLOC(order);
+  for (m = 0; m < window->nvalues; m++)
+  {
+    value = window->values[m];
+    for (i = 0; i < value->ncoefficients; i++)
+      for (j = 0; j < value->ncoefficients; j++)
+        gram[i * n + j] += value->coefficients[i] * value->coefficients[j];
+  }
+  adj_pod_symmetric_eigen(n, gram, modes);
+
+  /* Rank the modes by their energy, and keep as many as the threshold asks for */
+  total = 0.0;
+  for (i = 0; i < n; i++)
+  {
+    if (gram[i * n + i] < 0.0) gram[i * n + i] = 0.0;
+    total += gram[i * n + i];
+    order[i] = i;
+  }
+  for (i = 1; i < n; i++)
+  {
+    k = order[i];
+    for (j = i; j > 0 && gram[order[j - 1] * n + order[j - 1]] < gram[k * n + k]; j--)
+      order[j] = order[j - 1];
+    order[j] = k;
+  }
+  kept = 0.0;
+  for (nkept = 0; nkept < n && kept < pod->energy_threshold * total; nkept++)
+    kept += gram[order[nkept] * n + order[nkept]];
+  if (nkept == 0) nkept = 1;
+
+  ierr = ADJ_OK;
+  if (nkept < n)
+  {
+    /* The modes, as combinations of the old basis vectors */
+    basis = (adj_vector*) malloc(window->basis_sz * sizeof(adj_vector));
+    ADJ_CHKMALLOC(basis);
+    for (i = 0; i < nkept; i++)
+    {
+      adjointer->callbacks.vec_duplicate(window->model, &basis[i]);
+      for (j = 0; j < n; j++)
+        adjointer->callbacks.vec_axpy(&basis[i], modes[j * n + order[i]], window->basis[j]);
+    }
+    for (j = 0; j < n; j++)
+      adjointer->callbacks.vec_destroy(&window->basis[j]);
+    free(window->basis);
+    window->basis = basis;
+    window->nbasis = nkept;
+    pod->nbasis -= n - nkept;
+    pod->basis_bytes -= (size_t) (n - nkept) * vector_bytes;
+    if (window->memory_size >= (size_t) (n - nkept) * vector_bytes)
+    {
+      window->memory_size -= (size_t) (n - nkept) * vector_bytes;
+      adjointer->memory_used -= (size_t) (n - nkept) * vector_bytes;
+    }
+
+    /* and the coefficients of the states along them */
+    for (m = 0; m < window->nvalues; m++)
+    {
+      value = window->values[m];
+      coefficients = (adj_scalar*) malloc(nkept * sizeof(adj_scalar));
+      ADJ_CHKMALLOC(coefficients);
+      for (i = 0; i < nkept; i++)
+      {
+        coefficients[i] = 0.0;
+        for (j = 0; j < value->ncoefficients; j++)
+          coefficients[i] += modes[j * n + order[i]] * value->coefficients[j];
+      }
+      free(value->coefficients);
+      pod->coefficient_bytes -= (size_t) value->ncoefficients * sizeof(adj_scalar);
+      pod->coefficient_bytes += (size_t) nkept * sizeof(adj_scalar);
+      value->coefficients = coefficients;
+      value->ncoefficients = nkept;
+
+      ierr = adj_memory_budget_recharge(adjointer, value->data);
+      if (ierr != ADJ_OK) break;
+    }
+  }
+
+  free(gram);
+  free(modes);
+  free(order);
+  return adj_chkierr_auto(ierr);
+}
+
+int adj_pod_project_value(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_storage_data storage)
+{
+  struct adj_pod* pod;
+  struct adj_pod_value* projected;
+  adj_pod_window* window;
+  adj_scalar* coefficients;
+  adj_scalar energy, captured, rnorm;
+  adj_vector r;
+  int ierr, i;
+
+  if (adjointer->callbacks.vec_duplicate == NULL || adjointer->callbacks.vec_axpy == NULL || adjointer->callbacks.vec_dot_product == NULL ||
+      adjointer->callbacks.vec_destroy == NULL || adjointer->callbacks.vec_get_size == NULL)
+  {
+    strncpy(adj_error_msg, "POD storage needs the ADJ_VEC_DUPLICATE_CB, ADJ_VEC_AXPY_CB, ADJ_VEC_DOT_PRODUCT_CB, ADJ_VEC_DESTROY_CB and ADJ_VEC_GET_SIZE_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  ierr = adj_pod_init(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  pod = adjointer->pod;
+  ierr = adj_pod_open_window(adjointer, var, storage.value, &window);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* Room for a coefficient on a new basis vector, should it need one */
+  coefficients = (adj_scalar*) malloc((window->nbasis + 1) * sizeof(adj_scalar));
+  ADJ_CHKMALLOC(coefficients);
+
+  adjointer->callbacks.vec_dot_product(storage.value, storage.value, &energy);
+  captured = 0.0;
+  for (i = 0; i < window->nbasis; i++)
+  {
+    adjointer->callbacks.vec_dot_product(storage.value, window->basis[i], &coefficients[i]);
+    captured += coefficients[i] * coefficients[i];
+  }
+
+  if (energy > 0.0 && energy - captured > (1.0 - pod->energy_threshold) * energy)
+  {
+    adjointer->callbacks.vec_duplicate(storage.value, &r);
+    adjointer->callbacks.vec_axpy(&r, (adj_scalar)1.0, storage.value);
+    for (i = 0; i < window->nbasis; i++)
+      adjointer->callbacks.vec_axpy(&r, -coefficients[i], window->basis[i]);
+    adj_pod_orthogonalise(adjointer, window, &r, coefficients);
+    adjointer->callbacks.vec_dot_product(r, r, &rnorm);
+    rnorm = sqrt(rnorm);
+
+    if (rnorm > 0.0)
+    {
+      if (window->nbasis == window->basis_sz)
+      {
+        int new_sz = (window->basis_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * window->basis_sz;
+        window->basis = (adj_vector*) realloc(window->basis, new_sz * sizeof(adj_vector));
+        ADJ_CHKMALLOC(window->basis);
+        window->basis_sz = new_sz;
+      }
+      adjointer->callbacks.vec_duplicate(storage.value, &window->basis[window->nbasis]);
+      adjointer->callbacks.vec_axpy(&window->basis[window->nbasis], (adj_scalar)1.0 / rnorm, r);
+      coefficients[window->nbasis] = rnorm;
+      window->nbasis++;
+      pod->nbasis++;
+      pod->basis_bytes += (size_t) window->nscalars * sizeof(adj_scalar);
+      /* The values are charged only their coefficients, so the basis is charged here */
+      if (adjointer->memory_budget > 0)
+      {
+        window->memory_size += (size_t) window->nscalars * sizeof(adj_scalar);
+        adjointer->memory_used += (size_t) window->nscalars * sizeof(adj_scalar);
+      }
+    }
+    adjointer->callbacks.vec_destroy(&r);
+  }
+
+  projected = (struct adj_pod_value*) malloc(sizeof(struct adj_pod_value));
+  ADJ_CHKMALLOC(projected);
+  projected->window = window;
+  projected->data = data;
+  projected->ncoefficients = window->nbasis;
+  projected->coefficients = coefficients;
+  projected->reconstructed = ADJ_FALSE;
+  if (window->nvalues == window->values_sz)
+  {
+    int new_sz = (window->values_sz == 0) ? ADJ_PREALLOC_SIZE : 2 * window->values_sz;
+    window->values = (struct adj_pod_value**) realloc(window->values, new_sz * sizeof(struct adj_pod_value*));
+    ADJ_CHKMALLOC(window->values);
+    window->values_sz = new_sz;
+  }
+  projected->index = window->nvalues;
+  window->values[window->nvalues++] = projected;
+  window->nstates++;
+
+  data->storage.pod = projected;
+  memset(&(data->storage.value), 0, sizeof(adj_vector));
+
+  pod->coefficient_bytes += (size_t) projected->ncoefficients * sizeof(adj_scalar);
+  pod->full_bytes += (size_t) window->nscalars * sizeof(adj_scalar);
+
+  /* The window is full: rank its basis by energy */
+  if (window->nstates == pod->window)
+  {
+    ierr = adj_pod_truncate_window(adjointer, window);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  }
+  return ADJ_OK;
+}
+
+int adj_pod_reconstruct_value(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_pod_value* projected = data->storage.pod;
+  int i;
+
+  if (projected == NULL || projected->reconstructed) return ADJ_OK;
+
+  adjointer->callbacks.vec_duplicate(projected->window->model, &(data->storage.value));
+  for (i = 0; i < projected->ncoefficients; i++)
+    adjointer->callbacks.vec_axpy(&(data->storage.value), projected->coefficients[i], projected->window->basis[i]);
+  projected->reconstructed = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+size_t adj_pod_value_size(adj_variable_data* data)
+{
+  struct adj_pod_value* projected = data->storage.pod;
+
+  if (projected == NULL) return 0;
+  /* The reconstruction counts too, for as long as it is kept */
+  if (projected->reconstructed)
+    return (size_t) (projected->ncoefficients + projected->window->nscalars) * sizeof(adj_scalar);
+  return (size_t) projected->ncoefficients * sizeof(adj_scalar);
+}
+
+int adj_destroy_pod_value(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  struct adj_pod_value* projected = data->storage.pod;
+  adj_pod_window* window;
+
+  if (projected == NULL) return ADJ_OK;
+
+  window = projected->window;
+  if (projected->reconstructed)
+    adjointer->callbacks.vec_destroy(&(data->storage.value));
+  adjointer->pod->coefficient_bytes -= (size_t) projected->ncoefficients * sizeof(adj_scalar);
+  adjointer->pod->full_bytes -= (size_t) window->nscalars * sizeof(adj_scalar);
+  window->nvalues--;
+  window->values[projected->index] = window->values[window->nvalues];
+  window->values[projected->index]->index = projected->index;
+  free(projected->coefficients);
+  free(projected);
+  data->storage.pod = NULL;
+
+  /* A full window nothing refers to any more can't be needed again */
+  if (window->nvalues == 0 && window->nstates >= adjointer->pod->window)
+    adj_pod_close_window(adjointer, window);
+  return ADJ_OK;
+}
+
+int adj_destroy_pod(adj_adjointer* adjointer)
+{
+  struct adj_pod* pod = adjointer->pod;
+
+  if (pod == NULL) return ADJ_OK;
+
+  while (pod->windows != NULL)
+    adj_pod_close_window(adjointer, pod->windows);
+  free(pod);
+  adjointer->pod = NULL;
+  return ADJ_OK;
+}
+
+int adj_get_pod_stats(adj_adjointer* adjointer, int* nbasis, size_t* pod_bytes, size_t* full_bytes)
+{
+  struct adj_pod* pod = adjointer->pod;
+
+  *nbasis = (pod == NULL) ? 0 : pod->nbasis;
+  *pod_bytes = (pod == NULL) ? 0 : pod->basis_bytes + pod->coefficient_bytes;
+  *full_bytes = (pod == NULL) ? 0 : pod->full_bytes;
+  return ADJ_OK;
+}
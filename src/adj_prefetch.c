@@ -0,0 +1,351 @@
+#include "libadjoint/adj_prefetch.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* During the adjoint sweep, values that were recorded to disk are read back on demand by
+   adj_get_variable_value, so every adj_get_adjoint_equation waits for its reads. With
+   prefetching switched on (adj_set_prefetch_options), adj_get_adjoint_equations first queues
+   the disk values that the next few adjoint equations will need, as given by their
+   adjoint_equations, and a worker thread reads them with vec_read while the current equation
+   is assembled and solved. adj_get_variable_value then takes the prefetched vector instead of
+   reading it again, waiting for the worker if it is still busy with it.
+
+   Only the worker calls vec_read (and vec_get_size) behind the model's back, so those two
+   callbacks must be safe to call concurrently with the others. All the adjointer's own data
+   stays with the calling thread: the worker only ever sees the slots below. */
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+
+#define ADJ_PREFETCH_FREE 0
+#define ADJ_PREFETCH_QUEUED 1
+#define ADJ_PREFETCH_READING 2
+#define ADJ_PREFETCH_DONE 3
+
+typedef struct
+{
+  int state; /* ADJ_PREFETCH_FREE etc. */
+  int id; /* the variable being read */
+  adj_variable var;
+  int seq; /* order in which the slots were queued */
+  adj_vector value; /* the value read, once ADJ_PREFETCH_DONE */
+  size_t size; /* its size in bytes, if we can tell */
+} adj_prefetch_slot;
+
+struct adj_prefetch
+{
+  int window; /* how many adjoint equations to look ahead */
+  size_t memory_cap; /* bytes of prefetched values we may hold; 0 for no limit */
+  size_t memory_used; /* bytes of prefetched values not taken yet */
+  size_t largest; /* size of the largest value read so far, to estimate the reads in flight */
+  int nslots;
+  adj_prefetch_slot* slots;
+  int seq;
+  int stop;
+  int started;
+  void (*vec_read)(adj_variable var, adj_vector* x);
+  void (*vec_get_size)(adj_vector x, int* sz);
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t queued; /* signalled when work is queued, or the worker should stop */
+  pthread_cond_t done; /* signalled when a read finishes */
+};
+
+static void* adj_prefetch_worker(void* arg)
+{
+  struct adj_prefetch* prefetch = (struct adj_prefetch*) arg;
+  adj_prefetch_slot* slot;
+  adj_variable var;
+  adj_vector value;
+  int size;
+  int i, index;
+
+  pthread_mutex_lock(&prefetch->lock);
+  while (!prefetch->stop)
+  {
+    index = -1;
+    for (i = 0; i < prefetch->nslots; i++)
+      if (prefetch->slots[i].state == ADJ_PREFETCH_QUEUED && (index < 0 || prefetch->slots[i].seq < prefetch->slots[index].seq))
+        index = i;
+
+    if (index < 0)
+    {
+      pthread_cond_wait(&prefetch->queued, &prefetch->lock);
+      continue;
+    }
+
+    prefetch->slots[index].state = ADJ_PREFETCH_READING;
+    var = prefetch->slots[index].var;
+    pthread_mutex_unlock(&prefetch->lock);
+
+    prefetch->vec_read(var, &value);
+    size = 0;
+    if (prefetch->vec_get_size != NULL)
+      prefetch->vec_get_size(value, &size);
+
+    /* The slots may have been reallocated meanwhile */
+    pthread_mutex_lock(&prefetch->lock);
+    slot = &prefetch->slots[index];
+    slot->value = value;
+    slot->size = (size_t) size * sizeof(adj_scalar);
+    slot->state = ADJ_PREFETCH_DONE;
+    prefetch->memory_used += slot->size;
+    if (slot->size > prefetch->largest) prefetch->largest = slot->size;
+    pthread_cond_broadcast(&prefetch->done);
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+
+  return NULL;
+}
+
+/* Find the slot for the variable with the given id; call with the lock held */
+static adj_prefetch_slot* adj_prefetch_find_slot(struct adj_prefetch* prefetch, int id)
+{
+  int i;
+  for (i = 0; i < prefetch->nslots; i++)
+    if (prefetch->slots[i].state != ADJ_PREFETCH_FREE && prefetch->slots[i].id == id)
+      return &prefetch->slots[i];
+  return NULL;
+}
+
+/* Wait for the worker to read the slot, and take the value off it; call with the lock held */
+static adj_vector adj_prefetch_claim_slot(struct adj_prefetch* prefetch, adj_prefetch_slot* slot)
+{
+  while (slot->state != ADJ_PREFETCH_DONE)
+    pthread_cond_wait(&prefetch->done, &prefetch->lock);
+
+  prefetch->memory_used -= slot->size;
+  slot->state = ADJ_PREFETCH_FREE;
+  return slot->value;
+}
+#endif
+
+int adj_set_prefetch_options(adj_adjointer* adjointer, int window, size_t memory_cap)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_prefetch* prefetch;
+  int ierr;
+
+  if (window < 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The prefetch window must be non-negative, but got %d.", window);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  /* Start afresh, so that the worker never sees the options change under it */
+  ierr = adj_destroy_prefetch(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (window == 0) return ADJ_OK;
+
+  if (adjointer->callbacks.vec_read == NULL)
+  {
+    strncpy(adj_error_msg, "Prefetching needs the ADJ_VEC_READ_CB data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  prefetch = (struct adj_prefetch*) malloc(sizeof(struct adj_prefetch));
+  ADJ_CHKMALLOC(prefetch);
+  prefetch->window = window;
+  prefetch->memory_cap = memory_cap;
+  prefetch->memory_used = 0;
+  prefetch->largest = 0;
+  prefetch->nslots = 0;
+  prefetch->slots = NULL;
+  prefetch->seq = 0;
+  prefetch->stop = ADJ_FALSE;
+  prefetch->started = ADJ_FALSE;
+  prefetch->vec_read = adjointer->callbacks.vec_read;
+  prefetch->vec_get_size = adjointer->callbacks.vec_get_size;
+  pthread_mutex_init(&prefetch->lock, NULL);
+  pthread_cond_init(&prefetch->queued, NULL);
+  pthread_cond_init(&prefetch->done, NULL);
+
+  adjointer->prefetch = prefetch;
+  return ADJ_OK;
+#else
+  (void) adjointer;
+  (void) memory_cap;
+  if (window == 0) return ADJ_OK;
+  strncpy(adj_error_msg, "Prefetching needs libadjoint to be built with pthreads.", ADJ_ERROR_MSG_BUF);
+  return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
+#endif
+}
+
+int adj_prefetch_schedule(adj_adjointer* adjointer, int equation)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_prefetch* prefetch = adjointer->prefetch;
+  adj_variable_data* data;
+  adj_prefetch_slot* slot;
+  int nqueued = 0;
+  int k, i, new_sz;
+
+  if (prefetch == NULL || equation == 0) return ADJ_OK;
+
+  pthread_mutex_lock(&prefetch->lock);
+  for (k = 0; k < adjointer->nlive_variables; k++)
+  {
+    data = ADJ_VARIABLE_DATA(adjointer, adjointer->live_variables[k]);
+    if (data->storage.storage_memory_has_value || !data->storage.storage_disk_has_value)
+      continue;
+    /* Checkpoints on a storage tier are read with its own callbacks */
+    if (adj_tiers_variable_tier(adjointer, data) >= 0)
+      continue;
+    if (!adj_has_unique_in_range(data->adjoint_equations, data->nadjoint_equations, equation - prefetch->window, equation - 1))
+      continue;
+    if (adj_prefetch_find_slot(prefetch, data->id) != NULL)
+      continue;
+    /* Values still waiting to be written are served from the write queue */
+    if (adj_write_behind_pending(adjointer, data))
+      continue;
+
+    /* Count the reads still in flight as large as the largest value seen so far */
+    if (prefetch->memory_cap > 0)
+    {
+      size_t in_flight = 0;
+      for (i = 0; i < prefetch->nslots; i++)
+        if (prefetch->slots[i].state == ADJ_PREFETCH_QUEUED || prefetch->slots[i].state == ADJ_PREFETCH_READING)
+          in_flight += prefetch->largest;
+      if (prefetch->memory_used + in_flight >= prefetch->memory_cap)
+        break;
+    }
+
+    slot = NULL;
+    for (i = 0; i < prefetch->nslots; i++)
+      if (prefetch->slots[i].state == ADJ_PREFETCH_FREE)
+      {
+        slot = &prefetch->slots[i];
+        break;
+      }
+    if (slot == NULL)
+    {
+      new_sz = (prefetch->nslots == 0) ? ADJ_PREALLOC_SIZE : 2 * prefetch->nslots;
+      slot = (adj_prefetch_slot*) realloc(prefetch->slots, new_sz * sizeof(adj_prefetch_slot));
+      if (slot == NULL)
+      {
+        pthread_mutex_unlock(&prefetch->lock);
+        ADJ_CHKMALLOC(slot);
+      }
+      prefetch->slots = slot;
+      for (i = prefetch->nslots; i < new_sz; i++)
+        prefetch->slots[i].state = ADJ_PREFETCH_FREE;
+      slot = &prefetch->slots[prefetch->nslots];
+      prefetch->nslots = new_sz;
+    }
+
+    slot->state = ADJ_PREFETCH_QUEUED;
+    slot->id = data->id;
+    slot->var = adjointer->varentries[data->id]->variable;
+    slot->seq = prefetch->seq++;
+    slot->size = 0;
+    nqueued++;
+  }
+
+  if (nqueued > 0)
+    pthread_cond_signal(&prefetch->queued);
+  pthread_mutex_unlock(&prefetch->lock);
+
+  if (nqueued > 0 && !prefetch->started)
+  {
+    if (pthread_create(&prefetch->worker, NULL, adj_prefetch_worker, prefetch) != 0)
+    {
+      strncpy(adj_error_msg, "Could not start the prefetch thread.", ADJ_ERROR_MSG_BUF);
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
+    prefetch->started = ADJ_TRUE;
+  }
+#else
+  (void) adjointer;
+  (void) equation;
+#endif
+  return ADJ_OK;
+}
+
+int adj_prefetch_take(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value, int* found)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_prefetch* prefetch = adjointer->prefetch;
+  adj_prefetch_slot* slot;
+
+  *found = ADJ_FALSE;
+  if (prefetch == NULL) return ADJ_OK;
+
+  pthread_mutex_lock(&prefetch->lock);
+  slot = adj_prefetch_find_slot(prefetch, data->id);
+  if (slot != NULL)
+  {
+    *value = adj_prefetch_claim_slot(prefetch, slot);
+    *found = ADJ_TRUE;
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+#else
+  (void) adjointer;
+  (void) data;
+  (void) value;
+  *found = ADJ_FALSE;
+#endif
+  return ADJ_OK;
+}
+
+int adj_prefetch_cancel(adj_adjointer* adjointer, adj_variable_data* data)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_prefetch* prefetch = adjointer->prefetch;
+  adj_prefetch_slot* slot;
+  adj_vector value;
+  int have_value = ADJ_FALSE;
+
+  if (prefetch == NULL) return ADJ_OK;
+
+  pthread_mutex_lock(&prefetch->lock);
+  slot = adj_prefetch_find_slot(prefetch, data->id);
+  if (slot != NULL && slot->state == ADJ_PREFETCH_QUEUED)
+    slot->state = ADJ_PREFETCH_FREE;
+  else if (slot != NULL)
+  {
+    value = adj_prefetch_claim_slot(prefetch, slot);
+    have_value = ADJ_TRUE;
+  }
+  pthread_mutex_unlock(&prefetch->lock);
+
+  if (have_value)
+    adjointer->callbacks.vec_destroy(&value);
+#else
+  (void) adjointer;
+  (void) data;
+#endif
+  return ADJ_OK;
+}
+
+int adj_destroy_prefetch(adj_adjointer* adjointer)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_prefetch* prefetch = adjointer->prefetch;
+  int i;
+
+  if (prefetch == NULL) return ADJ_OK;
+
+  if (prefetch->started)
+  {
+    pthread_mutex_lock(&prefetch->lock);
+    prefetch->stop = ADJ_TRUE;
+    pthread_cond_signal(&prefetch->queued);
+    pthread_mutex_unlock(&prefetch->lock);
+    pthread_join(prefetch->worker, NULL);
+  }
+
+  for (i = 0; i < prefetch->nslots; i++)
+    if (prefetch->slots[i].state == ADJ_PREFETCH_DONE)
+      adjointer->callbacks.vec_destroy(&prefetch->slots[i].value);
+
+  pthread_mutex_destroy(&prefetch->lock);
+  pthread_cond_destroy(&prefetch->queued);
+  pthread_cond_destroy(&prefetch->done);
+  free(prefetch->slots);
+  free(prefetch);
+  adjointer->prefetch = NULL;
+#else
+  (void) adjointer;
+#endif
+  return ADJ_OK;
+}
@@ -12,55 +12,43 @@ int adj_simplify_derivatives(adj_adjointer* adjointer, int ninput, adj_nonlinear
      Now, if two adj_nonlinear_block_derivatives share the same u and the same c, they can be merged, meaning
      we only have to call the (potentially expensive) derivative computation routine.
 
-     Doing this in a naive way requires you to compare every derivative with every other derivative.
-     That's quadratic, and bad; however, it's much easier to code, so that's what we're going to do
-     for now. Typically we will only have ~4-5 of these to process at once anyhow, so it probably
-     won't ever be a problem.
-
-     For your edification, I will record the linear algorithm here, so that if it ever becomes a problem,
-     you'll know what to do!
-
-     The linear solution involves creating a hash table that maps
-     (variable to differentiate, operator name, operator dependencies, context)
-     to
-     (a linked list of adj_nonlinear_block_derivatives that all have the same properties).
-
-     Use uthash, in a similar way to the variable hash table that forms the heart of the
-     adjointer.
-
-     Once you've finished hashing, walk the lists.
-     For each list:
-       merge all the entries in the list.
-
-     And you're done. If it's your job to code it, have fun! -- pef */
+     To find the derivatives that can be merged without comparing every derivative with every other,
+     we hash each one on
+     (variable to differentiate, operator name, operator dependencies, context, hermitian, outer)
+     (see adj_simplification_group); every derivative is then merged into the first one that shares its key. */
 
   int i;
   int j;
+  int ierr;
   int count;
-  int merged[ninput];
-  int discarded[ninput];
-  int return_ierr;
+  int* first;
+  int* merged;
+  int* discarded;
   adj_nonlinear_block_derivative* copy;
 
+  first = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(first);
+  merged = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(merged);
+  discarded = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(discarded);
   memset(merged, ADJ_FALSE, ninput * sizeof(int));
   memset(discarded, ADJ_FALSE, ninput * sizeof(int));
 
+  ierr = adj_simplification_group(ninput, input, 0, NULL, first);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
   copy = (adj_nonlinear_block_derivative*) malloc(ninput * sizeof(adj_nonlinear_block_derivative));
   ADJ_CHKMALLOC(copy);
   memcpy(copy, input, ninput * sizeof(adj_nonlinear_block_derivative));
 
   for (i = 0; i < ninput; i++)
   {
-    for (j = i+1; j < ninput; j++)
-    {
-      if (discarded[j]) continue;
-      if (adj_simplification_compare(copy[i], copy[j]))
-      {
-        adj_simplification_merge(adjointer, &copy[i], &copy[j], merged[i]);
-        discarded[j] = ADJ_TRUE;
-        merged[i] = ADJ_TRUE;
-      }
-    }
+    j = first[i];
+    if (j == i) continue;
+    adj_simplification_merge(adjointer, &copy[j], &copy[i], merged[j]);
+    discarded[i] = ADJ_TRUE;
+    merged[j] = ADJ_TRUE;
   }
 
   count = 0;
@@ -85,7 +73,6 @@ int adj_simplify_derivatives(adj_adjointer* adjointer, int ninput, adj_nonlinear
       {
         /* We need to make a fresh copy, because adj_get_adjoint_equation will be deallocating these
            very soon. */
-        int ierr;
         ierr = adj_create_nonlinear_block_derivative(adjointer, copy[i].nonlinear_block, (adj_scalar) 1.0, copy[i].variable, copy[i].contraction, copy[i].hermitian, copy[i].outer, &(*output)[j]);
         if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
       }
@@ -93,18 +80,290 @@ int adj_simplify_derivatives(adj_adjointer* adjointer, int ninput, adj_nonlinear
     }
   }
   free(copy);
+  free(first);
+  free(merged);
+  free(discarded);
+
+  return ADJ_OK;
+}
+
+int adj_simplify_derivative_actions(adj_adjointer* adjointer, int ninput, adj_nonlinear_block_derivative_action* input, int* noutput, adj_nonlinear_block_derivative_action** output)
+{
+  /* adj_simplify_derivatives only merges derivatives that act on the same lambda, i.e. those that
+     come from the same equation. A row of G* collects terms from every equation that depends on
+     the forward variable,
+
+     sum_e sum_b factor_eb * ([ dV_b ]      )*
+                             ([ ---- ] c_eb )  lambda_e
+                             ([  du  ]      )
+
+     and two terms that share the operator and the contraction, but come from different equations,
+     can be merged too, by summing their lambdas instead of their contractions.
+
+     So we do this in two passes. First, the terms that act on the same input are merged as in
+     adj_simplify_derivatives. Then, of the terms that are left on their own, those that also share
+     the variable whose value is their contraction are merged by summing their inputs. Each
+     output term is then one call to the derivative action callback. */
+
+  int i;
+  int j;
+  int k;
+  int ierr;
+  int count;
+  int nsingle;
+  int* first;
+  int* single_index;
+  int* single_first;
+  int* single_merged;
+  int* merged;
+  int* discarded;
+  int* extra;
+  adj_nonlinear_block_derivative* single;
+  adj_nonlinear_block_derivative* copy;
+  adj_vector* summed;
+
+  first = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(first);
+  merged = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(merged);
+  discarded = (int*) malloc(ninput * sizeof(int));
+  ADJ_CHKMALLOC(discarded);
+  memset(merged, ADJ_FALSE, ninput * sizeof(int));
+  memset(discarded, ADJ_FALSE, ninput * sizeof(int));
+
+  copy = (adj_nonlinear_block_derivative*) malloc(ninput * sizeof(adj_nonlinear_block_derivative));
+  ADJ_CHKMALLOC(copy);
+  extra = (int*) malloc(ninput * sizeof(adj_variable_key));
+  ADJ_CHKMALLOC(extra);
 
-  if (ninput > 45) /* we did more than 1000 comparisons */
+  /* First pass: same input, so sum the contractions */
+  for (i = 0; i < ninput; i++)
+  {
+    copy[i] = input[i].derivative;
+    extra[i] = input[i].input_id;
+  }
+  ierr = adj_simplification_group(ninput, copy, 1, extra, first);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  for (i = 0; i < ninput; i++)
+  {
+    j = first[i];
+    if (j == i) continue;
+    adj_simplification_merge(adjointer, &copy[j], &copy[i], merged[j]);
+    discarded[i] = ADJ_TRUE;
+    merged[j] = ADJ_TRUE;
+  }
+
+  /* Second pass: of the terms left alone, those with the same contraction get their inputs summed */
+  nsingle = 0;
+  for (i = 0; i < ninput; i++)
+    if (!discarded[i] && !merged[i]) nsingle++;
+
+  single_index = (int*) malloc(nsingle * sizeof(int));
+  ADJ_CHKMALLOC(single_index);
+  single_first = (int*) malloc(nsingle * sizeof(int));
+  ADJ_CHKMALLOC(single_first);
+  single_merged = (int*) malloc(nsingle * sizeof(int));
+  ADJ_CHKMALLOC(single_merged);
+  memset(single_merged, ADJ_FALSE, nsingle * sizeof(int));
+  single = (adj_nonlinear_block_derivative*) malloc(nsingle * sizeof(adj_nonlinear_block_derivative));
+  ADJ_CHKMALLOC(single);
+
+  k = 0;
+  for (i = 0; i < ninput; i++)
+  {
+    if (!discarded[i] && !merged[i])
+    {
+      single_index[k] = i;
+      single[k] = copy[i];
+      memcpy(&extra[k * sizeof(adj_variable_key) / sizeof(int)], &input[i].contraction_key, sizeof(adj_variable_key));
+      k++;
+    }
+  }
+  ierr = adj_simplification_group(nsingle, single, sizeof(adj_variable_key) / sizeof(int), extra, single_first);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  for (k = 0; k < nsingle; k++)
   {
-    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "adj_simplify_derivatives contains a known quadratic loop.\nA linear algorithm is known and discussed in the comments.\nYou may wish to consider implementing it, since your problem\nis getting quite large (45 blocks in a row? really?).");
-    return_ierr = ADJ_WARN_NOT_IMPLEMENTED;
+    if (single_first[k] == k) continue;
+    discarded[single_index[k]] = ADJ_TRUE;
+    single_merged[single_first[k]] = ADJ_TRUE;
   }
-  else
+
+  /* Sum the inputs of the terms with the same contraction; their coefficients move into the sum */
+  summed = (adj_vector*) malloc(nsingle * sizeof(adj_vector));
+  ADJ_CHKMALLOC(summed);
+  for (k = 0; k < nsingle; k++)
   {
-    return_ierr = ADJ_OK;
+    j = single_first[k];
+    if (j == k)
+    {
+      if (!single_merged[k]) continue;
+      ierr = adj_vec_pool_get(adjointer, input[single_index[k]].input, &summed[k]);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    }
+    adjointer->callbacks.vec_axpy(&summed[j], single[k].nonlinear_block.coefficient, input[single_index[k]].input);
   }
 
-  return return_ierr;
+  count = 0;
+  for (i = 0; i < ninput; i++)
+    if (!discarded[i]) count++;
+
+  *noutput = count;
+  *output = (adj_nonlinear_block_derivative_action*) malloc(count * sizeof(adj_nonlinear_block_derivative_action));
+  ADJ_CHKMALLOC(*output);
+
+  /* Compact here; the singles are visited in the same order as the inputs */
+  j = 0;
+  k = 0;
+  for (i = 0; i < ninput; i++)
+  {
+    adj_nonlinear_block_derivative_action* action;
+    int is_single;
+
+    is_single = (k < nsingle && single_index[k] == i);
+    if (discarded[i])
+    {
+      if (is_single) k++;
+      continue;
+    }
+
+    action = &(*output)[j];
+    action->contraction_key = input[i].contraction_key;
+    action->input_id = input[i].input_id;
+    action->input = input[i].input;
+    action->owns_input = ADJ_FALSE;
+
+    if (merged[i])
+    {
+      action->derivative = copy[i];
+    }
+    else
+    {
+      ierr = adj_create_nonlinear_block_derivative(adjointer, copy[i].nonlinear_block, (adj_scalar) 1.0, copy[i].variable, copy[i].contraction, copy[i].hermitian, copy[i].outer, &action->derivative);
+      if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+      if (is_single && single_merged[k])
+      {
+        action->input = summed[k];
+        action->derivative.nonlinear_block.coefficient = (adj_scalar) 1.0;
+        action->owns_input = ADJ_TRUE;
+      }
+    }
+    if (is_single) k++;
+    j++;
+  }
+
+  free(copy);
+  free(first);
+  free(merged);
+  free(discarded);
+  free(extra);
+  free(single);
+  free(single_index);
+  free(single_first);
+  free(single_merged);
+  free(summed);
+
+  return ADJ_OK;
+}
+
+int adj_destroy_nonlinear_block_derivative_action(adj_adjointer* adjointer, adj_nonlinear_block_derivative_action* action)
+{
+  int ierr;
+
+  ierr = adj_destroy_nonlinear_block_derivative(adjointer, &action->derivative);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  if (action->owns_input)
+  {
+    ierr = adj_vec_pool_put(adjointer, &action->input);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    action->owns_input = ADJ_FALSE;
+  }
+  return ADJ_OK;
+}
+
+int adj_simplification_group(int ninput, adj_nonlinear_block_derivative* input, int nextra, int* extra, int* first)
+{
+  /* Sets first[i] to the index of the first derivative that can be merged with input[i] (so first[i] == i
+     if there is none before it). Two derivatives can be merged if they share
+     (variable to differentiate, operator name, operator dependencies, context, hermitian, outer)
+     and the nextra integers extra[i*nextra:(i+1)*nextra] that the caller uses to refine the grouping.
+     The comparison is done by hashing all of that into one flat key, so this is linear in ninput. */
+
+  int i;
+  int ierr;
+  adj_simplification_entry* table = NULL;
+  adj_simplification_entry* entries;
+  adj_simplification_entry* entry;
+
+  entries = (adj_simplification_entry*) malloc(ninput * sizeof(adj_simplification_entry));
+  ADJ_CHKMALLOC(entries);
+
+  for (i = 0; i < ninput; i++)
+  {
+    int keylen;
+
+    ierr = adj_simplification_key(input[i], nextra, nextra > 0 ? &extra[i * nextra] : NULL, &entries[i].key, &keylen);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+    HASH_FIND(hh, table, entries[i].key, keylen * sizeof(int), entry);
+    if (entry == NULL)
+    {
+      entries[i].first = i;
+      HASH_ADD_KEYPTR(hh, table, entries[i].key, keylen * sizeof(int), &entries[i]);
+      first[i] = i;
+    }
+    else
+    {
+      first[i] = entry->first;
+    }
+  }
+
+  HASH_CLEAR(hh, table);
+  for (i = 0; i < ninput; i++)
+    free(entries[i].key);
+  free(entries);
+
+  return ADJ_OK;
+}
+
+int adj_simplification_key(adj_nonlinear_block_derivative d, int nextra, int* extra, int** key, int* keylen)
+{
+  int ierr;
+  int i;
+  int pos;
+  int nvar = sizeof(adj_variable_key) / sizeof(int);
+  int nctx = (sizeof(void*) + sizeof(int) - 1) / sizeof(int);
+
+  *keylen = nvar + 4 + nctx + d.nonlinear_block.ndepends * nvar + nextra;
+  *key = (int*) malloc(*keylen * sizeof(int));
+  ADJ_CHKMALLOC(*key);
+  memset(*key, 0, *keylen * sizeof(int));
+
+  ierr = adj_variable_key_from_variable(&d.variable, ADJ_TRUE, (adj_variable_key*) &(*key)[0]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  pos = nvar;
+
+  ierr = adj_intern_name(d.nonlinear_block.name, ADJ_TRUE, &(*key)[pos++]);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  (*key)[pos++] = d.hermitian;
+  (*key)[pos++] = d.outer;
+  (*key)[pos++] = d.nonlinear_block.ndepends;
+  memcpy(&(*key)[pos], &d.nonlinear_block.context, sizeof(void*));
+  pos += nctx;
+
+  for (i = 0; i < d.nonlinear_block.ndepends; i++)
+  {
+    ierr = adj_variable_key_from_variable(&d.nonlinear_block.depends[i], ADJ_TRUE, (adj_variable_key*) &(*key)[pos]);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    pos += nvar;
+  }
+
+  if (nextra > 0)
+    memcpy(&(*key)[pos], extra, nextra * sizeof(int));
+
+  return ADJ_OK;
 }
 
 int adj_simplification_compare(adj_nonlinear_block_derivative d1, adj_nonlinear_block_derivative d2)
@@ -121,14 +380,14 @@ void adj_simplification_merge(adj_adjointer* adjointer, adj_nonlinear_block_deri
 {
   adj_vector new_contraction;
 
-  adjointer->callbacks.vec_duplicate(d1->contraction, &new_contraction);
+  adj_vec_pool_get(adjointer, d1->contraction, &new_contraction);
   adjointer->callbacks.vec_axpy(&new_contraction, d1->nonlinear_block.coefficient, d1->contraction);
   adjointer->callbacks.vec_axpy(&new_contraction, d2->nonlinear_block.coefficient, d2->contraction);
   d1->nonlinear_block.coefficient = (adj_scalar) 1.0;
 
   if (merged) /* We created this earlier as a result of a merge */
   {
-    adjointer->callbacks.vec_destroy(&d1->contraction);
+    adj_vec_pool_put(adjointer, &d1->contraction);
   }
   d1->contraction = new_contraction;
 }
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_adjointer_routines.h"
 
 void adj_test_assert(int passed, char *testdesc)
 {
@@ -13,3 +14,131 @@ int adj_sizeof_adjointer()
 {
   return sizeof(adj_adjointer);
 }
+
+/* A backend for the C tests, so that they can check the numbers they get back: vectors are
+   arrays of adj_test_vector_size scalars, one unless the test says otherwise, and matrices are
+   single scalars. Only the callbacks every test needs are registered, since registering some of
+   the others switches on features of their own (vec_get_size and vec_zero the vector pool, for
+   one); a test registers those it wants itself, along with its own versions of any it counts. */
+static int adj_test_vector_size = 1;
+
+void adj_test_mat_axpy(adj_matrix* Y, adj_scalar alpha, adj_matrix X)
+{
+  *(adj_scalar*) Y->ptr += alpha * *(adj_scalar*) X.ptr;
+}
+
+void adj_test_mat_destroy(adj_matrix* X)
+{
+  free(X->ptr);
+}
+
+void adj_test_register_scalar_callbacks(adj_adjointer* adjointer)
+{
+  adj_test_register_array_callbacks(adjointer, 1);
+  adj_register_data_callback(adjointer, ADJ_MAT_AXPY_CB, (void (*)(void)) adj_test_mat_axpy);
+  adj_register_data_callback(adjointer, ADJ_MAT_DESTROY_CB, (void (*)(void)) adj_test_mat_destroy);
+}
+
+void adj_test_register_array_callbacks(adj_adjointer* adjointer, int n)
+{
+  adj_test_vector_size = n;
+  adj_register_data_callback(adjointer, ADJ_VEC_DUPLICATE_CB, (void (*)(void)) adj_test_vec_duplicate);
+  adj_register_data_callback(adjointer, ADJ_VEC_AXPY_CB, (void (*)(void)) adj_test_vec_axpy);
+  adj_register_data_callback(adjointer, ADJ_VEC_DESTROY_CB, (void (*)(void)) adj_test_vec_destroy);
+}
+
+static void adj_test_vec_write_nothing(adj_variable var, adj_vector x)
+{
+  (void) var; (void) x;
+}
+
+static void adj_test_vec_read_nothing(adj_variable var, adj_vector* x)
+{
+  (void) var; (void) x;
+}
+
+static void adj_test_vec_delete_nothing(adj_variable var)
+{
+  (void) var;
+}
+
+/* For a memory budget that is never exceeded, which needs somewhere to spill to all the same */
+void adj_test_register_null_disk_callbacks(adj_adjointer* adjointer)
+{
+  adj_register_data_callback(adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) adj_test_vec_write_nothing);
+  adj_register_data_callback(adjointer, ADJ_VEC_READ_CB, (void (*)(void)) adj_test_vec_read_nothing);
+  adj_register_data_callback(adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) adj_test_vec_delete_nothing);
+}
+
+void adj_test_vec_duplicate(adj_vector x, adj_vector* newx)
+{
+  newx->ptr = calloc(adj_test_vector_size, sizeof(adj_scalar));
+  newx->klass = x.klass;
+  newx->flags = 0;
+}
+
+void adj_test_vec_axpy(adj_vector* y, adj_scalar alpha, adj_vector x)
+{
+  int i;
+  for (i = 0; i < adj_test_vector_size; i++)
+    ((adj_scalar*) y->ptr)[i] += alpha * ((adj_scalar*) x.ptr)[i];
+}
+
+void adj_test_vec_destroy(adj_vector* x)
+{
+  free(x->ptr);
+}
+
+void adj_test_vec_get_size(adj_vector x, int* sz)
+{
+  (void) x;
+  *sz = adj_test_vector_size;
+}
+
+void adj_test_vec_get_values(adj_vector x, adj_scalar* scalars[])
+{
+  memcpy(*scalars, x.ptr, adj_test_vector_size * sizeof(adj_scalar));
+}
+
+void adj_test_vec_set_values(adj_vector* x, adj_scalar scalars[])
+{
+  memcpy(x->ptr, scalars, adj_test_vector_size * sizeof(adj_scalar));
+}
+
+void adj_test_vec_dot_product(adj_vector x, adj_vector y, adj_scalar* val)
+{
+  int i;
+  *val = 0.0;
+  for (i = 0; i < adj_test_vector_size; i++)
+    *val += ((adj_scalar*) x.ptr)[i] * ((adj_scalar*) y.ptr)[i];
+}
+
+void adj_test_scalar_solve(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector* soln)
+{
+  (void) var;
+  soln->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) soln->ptr = *(adj_scalar*) rhs.ptr / *(adj_scalar*) mat.ptr;
+}
+
+/* Every operator is its coefficient times the identity */
+void adj_test_scalar_block_assembly(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, void* context, adj_matrix* output, adj_vector* rhs)
+{
+  (void) ndepends; (void) variables; (void) dependencies; (void) hermitian; (void) context;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = coefficient;
+  rhs->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) rhs->ptr = (adj_scalar) 0.0;
+}
+
+void adj_test_scalar_block_action(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, adj_vector input, void* context, adj_vector* output)
+{
+  (void) ndepends; (void) variables; (void) dependencies; (void) hermitian; (void) context;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = coefficient * *(adj_scalar*) input.ptr;
+}
+
+void adj_test_scalar_block_action_accumulate(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, adj_vector input, adj_scalar alpha, void* context, adj_vector* output)
+{
+  (void) ndepends; (void) variables; (void) dependencies; (void) hermitian; (void) context;
+  *(adj_scalar*) output->ptr += alpha * coefficient * *(adj_scalar*) input.ptr;
+}
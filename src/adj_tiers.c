@@ -0,0 +1,367 @@
+#include "libadjoint/adj_tiers.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* Revolve in multistage mode only tells two kinds of checkpoint storage apart, memory and
+   disk. adj_set_revolve_tier_options replaces the two with any number of storage tiers, each
+   with a capacity in checkpoints and a cost to write and read one. A tier with its own
+   ADJ_VEC_WRITE_CB, ADJ_VEC_READ_CB and ADJ_VEC_DELETE_CB data callbacks (registered with
+   adj_register_tier_data_callback) keeps its checkpoints through them; a tier without keeps
+   them in memory.
+
+   The schedule is revolve's offline one for as many checkpoints as the tiers hold together,
+   less the memory checkpoint that is always kept for the last timestep. Revolve reuses a fixed
+   set of checkpoint slots, so before the forward run starts, the whole schedule is played
+   through once to count how often each slot is restored from, and the slots are handed out
+   to the tiers in order of cost: the slots restored from most go on the tier cheapest to read,
+   as many as it holds, the next on the next tier, and so on. A slot holds one checkpoint at a
+   time, so no tier ever holds more checkpoints than its capacity.
+
+   Values checkpointed to a tier are written with that tier's callbacks, bypassing write-behind,
+   prefetching and the disk store, and read back and deleted with them. */
+
+typedef struct
+{
+  int capacity;
+  adj_scalar write_cost;
+  adj_scalar read_cost;
+  void (*vec_write)(adj_variable var, adj_vector x);
+  void (*vec_read)(adj_variable var, adj_vector* x);
+  void (*vec_delete)(adj_variable var);
+} adj_tier;
+
+struct adj_tiers
+{
+  int ntiers;
+  adj_tier* tiers;
+  int nslots;
+  int* slot_tier; /* the tier each revolve checkpoint slot goes on */
+  int nvariables;
+  int* variable_tier; /* the tier each variable's value is on, by the id of its data; -1 if it isn't on one */
+};
+
+#define ADJ_TIER_IN_MEMORY(tier) ((tier)->vec_write == NULL)
+
+int adj_set_revolve_tier_options(adj_adjointer* adjointer, int steps, int ntiers, int* capacities, adj_scalar* write_costs, adj_scalar* read_costs, int verbose)
+{
+  struct adj_tiers* tiers;
+  int i, n;
+
+  if (adjointer->revolve_data.revolve.ptr != NULL)
+  {
+    strncpy(adj_error_msg, "The checkpoint tiers can't be changed once the checkpointing has started.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  if (ntiers <= 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Need at least one checkpoint tier, but got %d.", ntiers);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  for (i = 0; i < ntiers; i++)
+  {
+    if (capacities[i] < 0 || write_costs[i] < 0.0 || read_costs[i] < 0.0)
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The capacity and costs of checkpoint tier %d must be non-negative.", i);
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+    }
+  }
+
+  if (adjointer->tiers == NULL)
+  {
+    adjointer->tiers = (struct adj_tiers*) malloc(sizeof(struct adj_tiers));
+    ADJ_CHKMALLOC(adjointer->tiers);
+    memset(adjointer->tiers, 0, sizeof(struct adj_tiers));
+  }
+  tiers = adjointer->tiers;
+
+  /* Tiers that were there before keep their callbacks */
+  n = tiers->ntiers;
+  tiers->tiers = (adj_tier*) realloc(tiers->tiers, ntiers * sizeof(adj_tier));
+  ADJ_CHKMALLOC(tiers->tiers);
+  if (ntiers > n)
+    memset(tiers->tiers + n, 0, (ntiers - n) * sizeof(adj_tier));
+  tiers->ntiers = ntiers;
+
+  for (i = 0; i < ntiers; i++)
+  {
+    tiers->tiers[i].capacity = capacities[i];
+    tiers->tiers[i].write_cost = write_costs[i];
+    tiers->tiers[i].read_cost = read_costs[i];
+  }
+
+  adjointer->revolve_data.steps = steps;
+  adjointer->revolve_data.verbose = verbose;
+  return adj_tiers_revolve_options(adjointer);
+}
+
+int adj_register_tier_data_callback(adj_adjointer* adjointer, int tier, int type, void (*fn)(void))
+{
+  adj_tier* t;
+
+  if (adjointer->tiers == NULL || tier < 0 || tier >= adjointer->tiers->ntiers)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "There is no checkpoint tier %d; call adj_set_revolve_tier_options first.", tier);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+  t = &adjointer->tiers->tiers[tier];
+
+  switch (type)
+  {
+    case ADJ_VEC_WRITE_CB:
+      t->vec_write = (void(*)(adj_variable, adj_vector x)) fn;
+      break;
+    case ADJ_VEC_READ_CB:
+      t->vec_read = (void(*)(adj_variable var, adj_vector* x)) fn;
+      break;
+    case ADJ_VEC_DELETE_CB:
+      t->vec_delete = (void(*)(adj_variable var)) fn;
+      break;
+    default:
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Only the ADJ_VEC_WRITE_CB, ADJ_VEC_READ_CB and ADJ_VEC_DELETE_CB data callbacks can be registered for a tier, but got %d.", type);
+      return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  return adj_tiers_revolve_options(adjointer);
+}
+
+/* Set revolve's checkpoint counts from the tiers */
+int adj_tiers_revolve_options(adj_adjointer* adjointer)
+{
+  struct adj_tiers* tiers = adjointer->tiers;
+  int i;
+
+  adjointer->revolve_data.snaps = 0;
+  adjointer->revolve_data.snaps_in_ram = 0;
+  for (i = 0; i < tiers->ntiers; i++)
+  {
+    adjointer->revolve_data.snaps += tiers->tiers[i].capacity;
+    if (ADJ_TIER_IN_MEMORY(&tiers->tiers[i]))
+      adjointer->revolve_data.snaps_in_ram += tiers->tiers[i].capacity;
+  }
+  return ADJ_OK;
+}
+
+/* Whether slot a should go on a faster tier than slot b */
+static int adj_tiers_slot_before(int* restores, int* writes, int a, int b)
+{
+  if (restores[a] != restores[b]) return restores[a] > restores[b];
+  if (writes[a] != writes[b]) return writes[a] > writes[b];
+  return a < b;
+}
+
+/* Whether tier a is faster than tier b */
+static int adj_tiers_tier_before(adj_tier* tiers, int a, int b)
+{
+  if (tiers[a].read_cost != tiers[b].read_cost) return tiers[a].read_cost < tiers[b].read_cost;
+  if (tiers[a].write_cost != tiers[b].write_cost) return tiers[a].write_cost < tiers[b].write_cost;
+  return a < b;
+}
+
+/* Play the offline schedule through and put the slots restored from most on the fastest tiers */
+int adj_tiers_schedule(adj_adjointer* adjointer)
+{
+  struct adj_tiers* tiers = adjointer->tiers;
+  CRevolve r;
+  CACTION action;
+  int* restores;
+  int* writes;
+  int* slots;
+  int* order;
+  int* room;
+  int i, j, k, tmp, slot, reserved;
+
+  for (i = 0; i < tiers->ntiers; i++)
+  {
+    if ((tiers->tiers[i].vec_write == NULL) != (tiers->tiers[i].vec_read == NULL) ||
+        (tiers->tiers[i].vec_write == NULL) != (tiers->tiers[i].vec_delete == NULL))
+    {
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Checkpoint tier %d needs all of the ADJ_VEC_WRITE_CB, ADJ_VEC_READ_CB and ADJ_VEC_DELETE_CB data callbacks, or none of them to keep its checkpoints in memory.", i);
+      return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+    }
+  }
+
+  tiers->nslots = adjointer->revolve_data.snaps - 1;
+  free(tiers->slot_tier);
+  tiers->slot_tier = (int*) malloc(tiers->nslots * sizeof(int));
+  ADJ_CHKMALLOC(tiers->slot_tier);
+  restores = (int*) calloc(tiers->nslots, sizeof(int));
+  ADJ_CHKMALLOC(restores);
+  writes = (int*) calloc(tiers->nslots, sizeof(int));
+  ADJ_CHKMALLOC(writes);
+  slots = (int*) malloc(tiers->nslots * sizeof(int));
+  ADJ_CHKMALLOC(slots);
+  order = (int*) malloc(tiers->ntiers * sizeof(int));
+  ADJ_CHKMALLOC(order);
+  room = (int*) malloc(tiers->ntiers * sizeof(int));
+  ADJ_CHKMALLOC(room);
+
+  r = revolve_create_offline(adjointer->revolve_data.steps, tiers->nslots);
+  do
+  {
+    action = revolve(r);
+    slot = revolve_getcheck(r);
+    if (action == CACTION_TAKESHOT && slot >= 0 && slot < tiers->nslots)
+      writes[slot]++;
+    else if (action == CACTION_RESTORE && slot >= 0 && slot < tiers->nslots)
+      restores[slot]++;
+  } while (action != CACTION_TERMINATE && action != CACTION_ERROR);
+  revolve_destroy(r);
+
+  /* Sort the slots by how often they are restored from, and the tiers by how fast they are */
+  for (i = 0; i < tiers->nslots; i++)
+  {
+    slots[i] = i;
+    for (j = i; j > 0 && adj_tiers_slot_before(restores, writes, slots[j], slots[j - 1]); j--)
+    {
+      tmp = slots[j]; slots[j] = slots[j - 1]; slots[j - 1] = tmp;
+    }
+  }
+  for (i = 0; i < tiers->ntiers; i++)
+  {
+    order[i] = i;
+    for (j = i; j > 0 && adj_tiers_tier_before(tiers->tiers, order[j], order[j - 1]); j--)
+    {
+      tmp = order[j]; order[j] = order[j - 1]; order[j - 1] = tmp;
+    }
+  }
+
+  /* The fastest memory tier gives up one checkpoint for the last timestep */
+  reserved = ADJ_FALSE;
+  for (i = 0; i < tiers->ntiers; i++)
+  {
+    room[order[i]] = tiers->tiers[order[i]].capacity;
+    if (!reserved && ADJ_TIER_IN_MEMORY(&tiers->tiers[order[i]]) && room[order[i]] > 0)
+    {
+      room[order[i]]--;
+      reserved = ADJ_TRUE;
+    }
+  }
+
+  k = 0;
+  for (i = 0; i < tiers->nslots; i++)
+  {
+    while (room[order[k]] == 0) k++;
+    tiers->slot_tier[slots[i]] = order[k];
+    room[order[k]]--;
+    if (adjointer->revolve_data.verbose)
+      printf("Revolve: Checkpoint slot %i (restored from %i times) goes on tier %i.\n", slots[i], restores[slots[i]], order[k]);
+  }
+
+  free(restores);
+  free(writes);
+  free(slots);
+  free(order);
+  free(room);
+  return ADJ_OK;
+}
+
+/* Where the checkpoint revolve is about to take should be stored */
+int adj_tiers_takeshot_storage(adj_adjointer* adjointer, int* checkpoint_storage)
+{
+  struct adj_tiers* tiers = adjointer->tiers;
+  int slot, tier;
+
+  slot = revolve_getcheck(adjointer->revolve_data.revolve);
+  if (slot < 0 || slot >= tiers->nslots)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "An internal error occured: Revolve wants to take a checkpoint in slot %d, but there are only %d.", slot, tiers->nslots);
+    return adj_chkierr_auto(ADJ_ERR_REVOLVE_ERROR);
+  }
+
+  tier = tiers->slot_tier[slot];
+  if (ADJ_TIER_IN_MEMORY(&tiers->tiers[tier]))
+    *checkpoint_storage = ADJ_CHECKPOINT_STORAGE_MEMORY;
+  else
+    *checkpoint_storage = ADJ_CHECKPOINT_STORAGE_TIER + tier;
+  return ADJ_OK;
+}
+
+/* Whether checkpoints with the given storage are kept in memory or on disk */
+int adj_tiers_storage_kind(adj_adjointer* adjointer, int checkpoint_storage, int* kind)
+{
+  int tier = checkpoint_storage - ADJ_CHECKPOINT_STORAGE_TIER;
+
+  if (checkpoint_storage < ADJ_CHECKPOINT_STORAGE_TIER)
+  {
+    *kind = checkpoint_storage;
+    return ADJ_OK;
+  }
+  if (adjointer->tiers == NULL || tier >= adjointer->tiers->ntiers)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "There is no checkpoint tier %d.", tier);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  *kind = ADJ_TIER_IN_MEMORY(&adjointer->tiers->tiers[tier]) ? ADJ_CHECKPOINT_STORAGE_MEMORY : ADJ_CHECKPOINT_STORAGE_DISK;
+  return ADJ_OK;
+}
+
+int adj_tiers_variable_tier(adj_adjointer* adjointer, adj_variable_data* data)
+{
+  if (adjointer->tiers == NULL || data->id >= adjointer->tiers->nvariables) return -1;
+  return adjointer->tiers->variable_tier[data->id];
+}
+
+int adj_tiers_write(adj_adjointer* adjointer, int checkpoint_storage, adj_variable var, adj_variable_data* data)
+{
+  struct adj_tiers* tiers = adjointer->tiers;
+  adj_vector value;
+  int tier = checkpoint_storage - ADJ_CHECKPOINT_STORAGE_TIER;
+  int i, ierr;
+
+  if (data->id >= tiers->nvariables)
+  {
+    i = tiers->nvariables;
+    tiers->nvariables = adjointer->variables_sz;
+    tiers->variable_tier = (int*) realloc(tiers->variable_tier, tiers->nvariables * sizeof(int));
+    ADJ_CHKMALLOC(tiers->variable_tier);
+    for (; i < tiers->nvariables; i++)
+      tiers->variable_tier[i] = -1;
+  }
+
+  ierr = adj_storage_memory_value(adjointer, data, &value);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  tiers->tiers[tier].vec_write(var, value);
+
+  tiers->variable_tier[data->id] = tier;
+  data->storage.storage_disk_has_value = ADJ_TRUE;
+  data->storage.storage_disk_is_checkpoint = ADJ_TRUE;
+  return adj_update_live_variable(adjointer, data);
+}
+
+int adj_tiers_read(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector* value, int* found)
+{
+  int tier = adj_tiers_variable_tier(adjointer, data);
+
+  *found = ADJ_FALSE;
+  if (tier < 0) return ADJ_OK;
+
+  adjointer->tiers->tiers[tier].vec_read(var, value);
+  *found = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+int adj_tiers_delete(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, int* found)
+{
+  int tier = adj_tiers_variable_tier(adjointer, data);
+
+  *found = ADJ_FALSE;
+  if (tier < 0) return ADJ_OK;
+
+  adjointer->tiers->tiers[tier].vec_delete(var);
+  adjointer->tiers->variable_tier[data->id] = -1;
+  *found = ADJ_TRUE;
+  return ADJ_OK;
+}
+
+int adj_destroy_tiers(adj_adjointer* adjointer)
+{
+  if (adjointer->tiers == NULL) return ADJ_OK;
+
+  free(adjointer->tiers->tiers);
+  free(adjointer->tiers->slot_tier);
+  free(adjointer->tiers->variable_tier);
+  free(adjointer->tiers);
+  adjointer->tiers = NULL;
+  return ADJ_OK;
+}
@@ -1,5 +1,116 @@
 #include "libadjoint/adj_variable_lookup.h"
 #include "libadjoint/adj_error_handling.h"
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Variable names are interned once into small integer ids, so that the variable hash tables
+   key on a compact adj_variable_key rather than the whole adj_variable (which carries two
+   ADJ_NAME_LEN character arrays). The table is shared by every hash, since the local hashes
+   built in adj_evaluation.c must agree with the adjointer's own.
+
+   Every adjointer holds a reference to the table, and it is freed when the last one is
+   destroyed, so ids are only meaningful while some adjointer is alive. It is locked, so that
+   adjointers can be used from different threads. */
+static adj_name_intern* adj_name_table = NULL;
+static int adj_name_count = 0;
+static int adj_name_users = 0;
+#ifdef HAVE_PTHREADS
+static pthread_mutex_t adj_name_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
+
+static void adj_intern_lock(void)
+{
+#ifdef HAVE_PTHREADS
+  pthread_mutex_lock(&adj_name_lock);
+#endif
+}
+
+static void adj_intern_unlock(void)
+{
+#ifdef HAVE_PTHREADS
+  pthread_mutex_unlock(&adj_name_lock);
+#endif
+}
+
+int adj_intern_name(char* name, int create, int* id)
+{
+  adj_name_intern* entry;
+  size_t len;
+
+  len = strnlen(name, ADJ_NAME_LEN);
+  adj_intern_lock();
+  HASH_FIND(hh, adj_name_table, name, len, entry);
+
+  if (entry == NULL)
+  {
+    if (!create)
+    {
+      adj_intern_unlock();
+      snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "Name %.*s has not been interned.", (int) len, name);
+      return ADJ_ERR_HASH_FAILED;
+    }
+
+    /* The name is kept just after the entry, so that one free gets rid of both */
+    entry = (adj_name_intern*) malloc(sizeof(adj_name_intern) + (len + 1) * sizeof(char));
+    if (entry == NULL)
+    {
+      adj_intern_unlock();
+      ADJ_CHKMALLOC(entry);
+    }
+    entry->name = (char*) (entry + 1);
+    memcpy(entry->name, name, len);
+    entry->name[len] = '\0';
+    entry->id = adj_name_count++;
+    HASH_ADD_KEYPTR(hh, adj_name_table, entry->name, len, entry);
+  }
+
+  *id = entry->id;
+  adj_intern_unlock();
+  return ADJ_OK;
+}
+
+void adj_intern_retain(void)
+{
+  adj_intern_lock();
+  adj_name_users++;
+  adj_intern_unlock();
+}
+
+void adj_intern_release(void)
+{
+  adj_name_intern* entry;
+  adj_name_intern* tmp;
+
+  adj_intern_lock();
+  if (adj_name_users > 0 && --adj_name_users == 0)
+  {
+    HASH_ITER(hh, adj_name_table, entry, tmp)
+    {
+      HASH_DEL(adj_name_table, entry);
+      free(entry);
+    }
+    adj_name_count = 0;
+  }
+  adj_intern_unlock();
+}
+
+int adj_variable_key_from_variable(adj_variable* var, int create, adj_variable_key* key)
+{
+  int ierr;
+
+  memset(key, 0, sizeof(adj_variable_key));
+  ierr = adj_intern_name(var->name, create, &key->name);
+  if (ierr != ADJ_OK) return ierr;
+  ierr = adj_intern_name(var->functional, create, &key->functional);
+  if (ierr != ADJ_OK) return ierr;
+
+  key->timestep = var->timestep;
+  key->iteration = var->iteration;
+  key->type = var->type;
+  key->auxiliary = var->auxiliary;
+  return ADJ_OK;
+}
 
 
 int adj_find_variable_equation_nb(adj_adjointer* adjointer, adj_variable* var, int* equation_nb) 
@@ -20,13 +131,32 @@ int adj_find_variable_equation_nb(adj_adjointer* adjointer, adj_variable* var, i
 }
 
 int adj_add_variable_data(adj_variable_hash** hash, adj_variable* var, adj_variable_data* data)
+{
+  adj_variable_hash* entry;
+  int ierr;
+
+  ierr = adj_add_variable_data_entry(hash, var, data, &entry);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  /* Only adj_add_new_hash_entry hands out ids, so data hashed here belongs to no adjointer */
+  data->id = -1;
+  data->live_index = -1;
+  return ADJ_OK;
+}
+
+int adj_add_variable_data_entry(adj_variable_hash** hash, adj_variable* var, adj_variable_data* data, adj_variable_hash** entry_out)
 {
   adj_variable_hash* entry;
   adj_variable_hash* check;
 
+  adj_variable_key key;
+  int ierr;
+
   data->type = var->type;
 
-  HASH_FIND(hh, *hash, var, sizeof(adj_variable), check);
+  ierr = adj_variable_key_from_variable(var, ADJ_TRUE, &key);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  HASH_FIND(hh, *hash, &key, sizeof(adj_variable_key), check);
 
   if (check != NULL)
   {
@@ -39,18 +169,23 @@ int adj_add_variable_data(adj_variable_hash** hash, adj_variable* var, adj_varia
   entry = (adj_variable_hash*) malloc(sizeof(adj_variable_hash));
   ADJ_CHKMALLOC(entry);
   memset(entry, 0, sizeof(adj_variable_hash));
+  entry->key = key;
   entry->variable = *var;
   entry->data = data;
 
-  HASH_ADD(hh, *hash, variable, sizeof(adj_variable), entry);
+  HASH_ADD(hh, *hash, key, sizeof(adj_variable_key), entry);
+  *entry_out = entry;
   return ADJ_OK;
 }
 
 int adj_find_variable_data(adj_variable_hash** hash, adj_variable* var, adj_variable_data** data)
 {
-  adj_variable_hash* check;
+  adj_variable_hash* check = NULL;
+  adj_variable_key key;
 
-  HASH_FIND(hh, *hash, var, sizeof(adj_variable), check);
+  /* If either name has never been interned, no hash can possibly contain the variable */
+  if (adj_variable_key_from_variable(var, ADJ_FALSE, &key) == ADJ_OK)
+    HASH_FIND(hh, *hash, &key, sizeof(adj_variable_key), check);
 
   if (check == NULL)
   {
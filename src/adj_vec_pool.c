@@ -0,0 +1,100 @@
+#include "libadjoint/adj_vec_pool.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* The core makes and throws away a lot of short-lived work vectors, and for most models each
+   vec_duplicate/vec_destroy pair costs a real allocation and free. Instead, work vectors handed
+   back with adj_vec_pool_put are kept, and adj_vec_pool_get hands one of them out again if it
+   has the same layout as the model vector, zeroed so that it looks just like a fresh duplicate.
+   Layouts are told apart by klass and vec_get_size, and reused vectors are cleared with the
+   vec_zero data callback, so the pool is only used if the model supplies both. */
+
+static int adj_vec_pool_enabled(adj_adjointer* adjointer)
+{
+  return (adjointer->callbacks.vec_zero != NULL && adjointer->callbacks.vec_get_size != NULL);
+}
+
+int adj_vec_pool_get(adj_adjointer* adjointer, adj_vector model, adj_vector* x)
+{
+  adj_vec_pool* pool = adjointer->vec_pool;
+  int size;
+  int i;
+
+  if (adjointer->callbacks.vec_duplicate == NULL)
+  {
+    strncpy(adj_error_msg, "Need the ADJ_VEC_DUPLICATE_CB data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  if (pool != NULL && pool->nvectors > 0 && adj_vec_pool_enabled(adjointer))
+  {
+    adjointer->callbacks.vec_get_size(model, &size);
+
+    /* Search from the most recently returned, as that is the most likely to still be in cache */
+    for (i = pool->nvectors - 1; i >= 0; i--)
+    {
+      if (pool->vectors[i].klass == model.klass && pool->sizes[i] == size)
+      {
+        *x = pool->vectors[i];
+        pool->nvectors--;
+        pool->vectors[i] = pool->vectors[pool->nvectors];
+        pool->sizes[i] = pool->sizes[pool->nvectors];
+        adjointer->callbacks.vec_zero(x);
+        return ADJ_OK;
+      }
+    }
+  }
+
+  adjointer->callbacks.vec_duplicate(model, x);
+  return ADJ_OK;
+}
+
+int adj_vec_pool_put(adj_adjointer* adjointer, adj_vector* x)
+{
+  adj_vec_pool* pool;
+
+  if (adjointer->callbacks.vec_destroy == NULL)
+  {
+    strncpy(adj_error_msg, "Need the ADJ_VEC_DESTROY_CB data callback, but it hasn't been supplied.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  if (!adj_vec_pool_enabled(adjointer))
+  {
+    adjointer->callbacks.vec_destroy(x);
+    return ADJ_OK;
+  }
+
+  if (adjointer->vec_pool == NULL)
+  {
+    adjointer->vec_pool = (adj_vec_pool*) malloc(sizeof(adj_vec_pool));
+    ADJ_CHKMALLOC(adjointer->vec_pool);
+    adjointer->vec_pool->nvectors = 0;
+  }
+  pool = adjointer->vec_pool;
+
+  /* The pool is only meant to hold the working set of a single equation; past that, really free it */
+  if (pool->nvectors == ADJ_VEC_POOL_SIZE)
+  {
+    adjointer->callbacks.vec_destroy(x);
+    return ADJ_OK;
+  }
+
+  pool->vectors[pool->nvectors] = *x;
+  adjointer->callbacks.vec_get_size(*x, &(pool->sizes[pool->nvectors]));
+  pool->nvectors++;
+  return ADJ_OK;
+}
+
+int adj_destroy_vec_pool(adj_adjointer* adjointer)
+{
+  int i;
+
+  if (adjointer->vec_pool == NULL) return ADJ_OK;
+
+  for (i = 0; i < adjointer->vec_pool->nvectors; i++)
+    adjointer->callbacks.vec_destroy(&(adjointer->vec_pool->vectors[i]));
+
+  free(adjointer->vec_pool);
+  adjointer->vec_pool = NULL;
+  return ADJ_OK;
+}
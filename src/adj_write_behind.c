@@ -0,0 +1,331 @@
+#include "libadjoint/adj_write_behind.h"
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_error_handling.h"
+
+/* Recording a value to disk calls vec_write straight away, so the forward model waits for
+   every file to be written. With write-behind switched on (adj_set_write_behind_options), the
+   value is copied into a work vector and put on a queue instead, and a worker thread writes
+   the queue out with vec_write in the order it was recorded. At most depth writes are
+   outstanding: recording one more waits for the oldest to finish.
+
+   Until its write has finished, a value is served from its copy on the queue, and deleting
+   it from disk waits for the write first, so nothing can tell the write has not happened yet.
+   adj_flush_disk_writes waits for the whole queue, for when the files themselves must be
+   complete.
+
+   Only the worker calls vec_write behind the model's back, so that callback must be safe to
+   call concurrently with the others. The copies are made and destroyed by the calling thread. */
+
+#ifdef HAVE_PTHREADS
+#include <pthread.h>
+
+#define ADJ_WRITE_QUEUED 1
+#define ADJ_WRITE_WRITING 2
+#define ADJ_WRITE_DONE 3
+
+typedef struct
+{
+  int state; /* ADJ_WRITE_QUEUED etc. */
+  int id; /* the variable being written */
+  adj_variable var;
+  adj_vector value; /* our copy of the value to write */
+} adj_write_entry;
+
+struct adj_write_behind
+{
+  int depth; /* the most writes we let be outstanding */
+  adj_write_entry* entries; /* a ring of depth entries, oldest first from head */
+  int head;
+  int count;
+  int stop;
+  void (*vec_write)(adj_variable var, adj_vector x);
+  pthread_t worker;
+  pthread_mutex_t lock;
+  pthread_cond_t queued; /* signalled when a write is queued, or the worker should stop */
+  pthread_cond_t done; /* signalled when a write finishes */
+};
+
+#define ADJ_WRITE_ENTRY(wb, i) (&(wb)->entries[((wb)->head + (i)) % (wb)->depth])
+
+static void* adj_write_behind_worker(void* arg)
+{
+  struct adj_write_behind* wb = (struct adj_write_behind*) arg;
+  adj_write_entry* entry;
+  int i;
+
+  pthread_mutex_lock(&wb->lock);
+  for (;;)
+  {
+    entry = NULL;
+    for (i = 0; i < wb->count; i++)
+      if (ADJ_WRITE_ENTRY(wb, i)->state == ADJ_WRITE_QUEUED)
+      {
+        entry = ADJ_WRITE_ENTRY(wb, i);
+        break;
+      }
+
+    if (entry == NULL)
+    {
+      if (wb->stop) break;
+      pthread_cond_wait(&wb->queued, &wb->lock);
+      continue;
+    }
+
+    /* The ring never moves, and the entry isn't reused until it is done */
+    entry->state = ADJ_WRITE_WRITING;
+    pthread_mutex_unlock(&wb->lock);
+    wb->vec_write(entry->var, entry->value);
+    pthread_mutex_lock(&wb->lock);
+    entry->state = ADJ_WRITE_DONE;
+    pthread_cond_broadcast(&wb->done);
+  }
+  pthread_mutex_unlock(&wb->lock);
+
+  return NULL;
+}
+
+/* Hand the copies of finished writes back; call with the lock held */
+static int adj_write_behind_reclaim(adj_adjointer* adjointer, struct adj_write_behind* wb)
+{
+  int ierr;
+
+  while (wb->count > 0 && ADJ_WRITE_ENTRY(wb, 0)->state == ADJ_WRITE_DONE)
+  {
+    ierr = adj_vec_pool_put(adjointer, &(ADJ_WRITE_ENTRY(wb, 0)->value));
+    if (ierr != ADJ_OK) return ierr;
+    wb->head = (wb->head + 1) % wb->depth;
+    wb->count--;
+  }
+  return ADJ_OK;
+}
+#endif
+
+int adj_set_write_behind_options(adj_adjointer* adjointer, int depth)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb;
+  int ierr;
+
+  if (depth < 0)
+  {
+    snprintf(adj_error_msg, ADJ_ERROR_MSG_BUF, "The write-behind depth must be non-negative, but got %d.", depth);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  /* Finish what is queued with the old settings */
+  ierr = adj_destroy_write_behind(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+  if (depth == 0) return ADJ_OK;
+
+  if (adjointer->callbacks.vec_write == NULL || adjointer->callbacks.vec_duplicate == NULL || adjointer->callbacks.vec_axpy == NULL)
+  {
+    strncpy(adj_error_msg, "Write-behind needs the ADJ_VEC_WRITE_CB, ADJ_VEC_DUPLICATE_CB and ADJ_VEC_AXPY_CB data callbacks.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_NEED_CALLBACK);
+  }
+
+  wb = (struct adj_write_behind*) malloc(sizeof(struct adj_write_behind));
+  ADJ_CHKMALLOC(wb);
+  wb->entries = (adj_write_entry*) malloc(depth * sizeof(adj_write_entry));
+  ADJ_CHKMALLOC(wb->entries);
+  wb->depth = depth;
+  wb->head = 0;
+  wb->count = 0;
+  wb->stop = ADJ_FALSE;
+  wb->vec_write = adjointer->callbacks.vec_write;
+  pthread_mutex_init(&wb->lock, NULL);
+  pthread_cond_init(&wb->queued, NULL);
+  pthread_cond_init(&wb->done, NULL);
+
+  if (pthread_create(&wb->worker, NULL, adj_write_behind_worker, wb) != 0)
+  {
+    free(wb->entries);
+    free(wb);
+    strncpy(adj_error_msg, "Could not start the write-behind thread.", ADJ_ERROR_MSG_BUF);
+    return adj_chkierr_auto(ADJ_ERR_INVALID_INPUTS);
+  }
+
+  adjointer->write_behind = wb;
+  return ADJ_OK;
+#else
+  (void) adjointer;
+  if (depth == 0) return ADJ_OK;
+  strncpy(adj_error_msg, "Write-behind needs libadjoint to be built with pthreads.", ADJ_ERROR_MSG_BUF);
+  return adj_chkierr_auto(ADJ_ERR_NOT_IMPLEMENTED);
+#endif
+}
+
+int adj_flush_disk_writes(adj_adjointer* adjointer)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  int ierr;
+  int i;
+
+  if (wb == NULL) return ADJ_OK;
+
+  pthread_mutex_lock(&wb->lock);
+  for (i = 0; i < wb->count; i++)
+    while (ADJ_WRITE_ENTRY(wb, i)->state != ADJ_WRITE_DONE)
+      pthread_cond_wait(&wb->done, &wb->lock);
+  ierr = adj_write_behind_reclaim(adjointer, wb);
+  pthread_mutex_unlock(&wb->lock);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+#else
+  (void) adjointer;
+#endif
+  return ADJ_OK;
+}
+
+int adj_write_behind_write(adj_adjointer* adjointer, adj_variable_data* data, adj_variable var, adj_vector value)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  adj_write_entry* entry;
+  adj_vector copy;
+  int ierr;
+
+  if (wb != NULL)
+  {
+    ierr = adj_vec_pool_get(adjointer, value, &copy);
+    if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+    adjointer->callbacks.vec_axpy(&copy, (adj_scalar) 1.0, value);
+
+    pthread_mutex_lock(&wb->lock);
+    ierr = adj_write_behind_reclaim(adjointer, wb);
+    while (ierr == ADJ_OK && wb->count == wb->depth)
+    {
+      pthread_cond_wait(&wb->done, &wb->lock);
+      ierr = adj_write_behind_reclaim(adjointer, wb);
+    }
+    if (ierr != ADJ_OK)
+    {
+      pthread_mutex_unlock(&wb->lock);
+      return adj_chkierr_auto(ierr);
+    }
+
+    entry = ADJ_WRITE_ENTRY(wb, wb->count);
+    entry->state = ADJ_WRITE_QUEUED;
+    entry->id = data->id;
+    entry->var = var;
+    entry->value = copy;
+    wb->count++;
+    pthread_cond_signal(&wb->queued);
+    pthread_mutex_unlock(&wb->lock);
+    return ADJ_OK;
+  }
+#else
+  (void) data;
+#endif
+
+  adjointer->callbacks.vec_write(var, value);
+  return ADJ_OK;
+}
+
+int adj_write_behind_read(adj_adjointer* adjointer, adj_variable_data* data, adj_vector* value, int* found)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  adj_write_entry* entry;
+  int ierr = ADJ_OK;
+  int i;
+
+  *found = ADJ_FALSE;
+  if (wb == NULL) return ADJ_OK;
+
+  /* The newest copy is the one on disk once the queue is written */
+  pthread_mutex_lock(&wb->lock);
+  for (i = wb->count - 1; i >= 0; i--)
+  {
+    entry = ADJ_WRITE_ENTRY(wb, i);
+    if (entry->id == data->id)
+    {
+      ierr = adj_vec_pool_get(adjointer, entry->value, value);
+      if (ierr == ADJ_OK)
+      {
+        adjointer->callbacks.vec_axpy(value, (adj_scalar) 1.0, entry->value);
+        *found = ADJ_TRUE;
+      }
+      break;
+    }
+  }
+  pthread_mutex_unlock(&wb->lock);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+#else
+  (void) adjointer;
+  (void) data;
+  (void) value;
+  *found = ADJ_FALSE;
+#endif
+  return ADJ_OK;
+}
+
+int adj_write_behind_pending(adj_adjointer* adjointer, adj_variable_data* data)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  int pending = ADJ_FALSE;
+  int i;
+
+  if (wb == NULL) return ADJ_FALSE;
+
+  pthread_mutex_lock(&wb->lock);
+  for (i = 0; i < wb->count; i++)
+    if (ADJ_WRITE_ENTRY(wb, i)->id == data->id && ADJ_WRITE_ENTRY(wb, i)->state != ADJ_WRITE_DONE)
+      pending = ADJ_TRUE;
+  pthread_mutex_unlock(&wb->lock);
+  return pending;
+#else
+  (void) adjointer;
+  (void) data;
+  return ADJ_FALSE;
+#endif
+}
+
+int adj_write_behind_wait(adj_adjointer* adjointer, adj_variable_data* data)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  int i;
+
+  if (wb == NULL) return ADJ_OK;
+
+  pthread_mutex_lock(&wb->lock);
+  for (i = 0; i < wb->count; i++)
+    while (ADJ_WRITE_ENTRY(wb, i)->id == data->id && ADJ_WRITE_ENTRY(wb, i)->state != ADJ_WRITE_DONE)
+      pthread_cond_wait(&wb->done, &wb->lock);
+  pthread_mutex_unlock(&wb->lock);
+#else
+  (void) adjointer;
+  (void) data;
+#endif
+  return ADJ_OK;
+}
+
+int adj_destroy_write_behind(adj_adjointer* adjointer)
+{
+#ifdef HAVE_PTHREADS
+  struct adj_write_behind* wb = adjointer->write_behind;
+  int ierr;
+
+  if (wb == NULL) return ADJ_OK;
+
+  ierr = adj_flush_disk_writes(adjointer);
+  if (ierr != ADJ_OK) return adj_chkierr_auto(ierr);
+
+  pthread_mutex_lock(&wb->lock);
+  wb->stop = ADJ_TRUE;
+  pthread_cond_signal(&wb->queued);
+  pthread_mutex_unlock(&wb->lock);
+  pthread_join(wb->worker, NULL);
+
+  pthread_mutex_destroy(&wb->lock);
+  pthread_cond_destroy(&wb->queued);
+  pthread_cond_destroy(&wb->done);
+  free(wb->entries);
+  free(wb);
+  adjointer->write_behind = NULL;
+#else
+  (void) adjointer;
+#endif
+  return ADJ_OK;
+}
@@ -1128,6 +1128,57 @@ ACTION::action Offline::revolve()
 }
 
 
+/***************************************************************************************************************************************
+All routines of class Prescribed
+****************************************************************************************************************************************/
+
+Prescribed::Prescribed(int st,int sn,Checkpoint *c,const vector <ACTION::action> *a,const vector <int> *ch,const vector <int> *ca) : Schedule(sn,c)
+{
+  actions=a;
+  checks=ch;
+  capos=ca;
+  check=-1;
+  capo=0;
+  fine=st;
+  next=0;
+  info=0;
+}
+
+ACTION::action Prescribed::revolve()
+{
+  ACTION::action whatodo;
+  int oldcapo=capo;
+
+  checkpoint->commands++;
+  if (next >= (int) actions->size())
+  {
+    check=-1;
+    return ACTION::terminate;
+  }
+  whatodo=(*actions)[next];
+  check=(*checks)[next];
+  capo=(*capos)[next];
+  next++;
+  switch (whatodo)
+  {
+    case ACTION::advance:
+      checkpoint->advances+=capo-oldcapo;
+      break;
+    case ACTION::takeshot:
+      checkpoint->takeshots++;
+      checkpoint->ch[check]=capo;
+      break;
+    case ACTION::firsturn:
+    case ACTION::youturn:
+      fine=capo;
+      break;
+    default:
+      break;
+  }
+  return whatodo;
+}
+
+
 // All routines of class Revolve
 
 Revolve::Revolve(int st,int sn)
@@ -1196,6 +1247,26 @@ Revolve::Revolve(int st,int sn,int sn_ram)
   checkpoint->commands=0;
 }
 
+Revolve::Revolve(int st,int sn,const vector <ACTION::action> &a,const vector <int> &ch,const vector <int> &ca)
+{
+  capo=0;
+  prescribed_actions=a;
+  prescribed_checks=ch;
+  prescribed_capos=ca;
+  checkpoint = new Checkpoint(sn);
+  f=new Prescribed(st,sn,checkpoint,&prescribed_actions,&prescribed_checks,&prescribed_capos);
+  online=false;
+  steps=st;
+  snaps=sn;
+  check=-1;
+  info = 0;
+  multi=false;
+  where.assign(snaps,true);
+  checkpoint->advances=0;
+  checkpoint->takeshots=0;
+  checkpoint->commands=0;
+}
+
 Revolve::Revolve(int sn)
 {
   checkpoint = new Checkpoint(sn);
@@ -18,6 +18,20 @@ extern "C" CRevolve revolve_create_online(int sn)
   r.ptr = new Revolve(sn); 
   return r;
 }
+extern "C" CRevolve revolve_create_prescribed(int st, int nactions, const int* actions, const int* checks, const int* capos)
+{
+  CRevolve r;
+  vector <ACTION::action> a(nactions);
+  vector <int> ch(checks, checks + nactions), ca(capos, capos + nactions);
+  int sn = 1;
+  for (int i = 0; i < nactions; i++)
+  {
+    a[i] = (ACTION::action) actions[i];
+    if (checks[i] + 1 > sn) sn = checks[i] + 1;
+  }
+  r.ptr = new Revolve(st, sn, a, ch, ca);
+  return r;
+}
 extern "C" void revolve_destroy(CRevolve r) { delete (Revolve*) r.ptr; }
 
 extern "C" int revolve_adjust(CRevolve r, int steps) { return ((Revolve*) r.ptr)->adjust(steps); }
@@ -0,0 +1,129 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_evaluation.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+static int nduplicates = 0;
+
+static void counting_vec_duplicate(adj_vector x, adj_vector* newx)
+{
+  nduplicates++;
+  adj_test_vec_duplicate(x, newx);
+}
+
+/* The source of the second equation is R(u0) = 4 u0 */
+static void rhs_derivative_action_accumulate(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies,
+                                             adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output)
+{
+  (void) adjointer; (void) variable; (void) ndepends; (void) variables; (void) dependencies; (void) d_variable; (void) hermitian; (void) context;
+  *(adj_scalar*) output->ptr += alpha * 4.0 * *(adj_scalar*) contraction.ptr;
+}
+
+/* N(u) v = u v, so the derivative of N(u) v with respect to u, contracted with c, is c v */
+static void nonlinear_derivative_action_accumulate(int ndepends, adj_variable* variables, adj_vector* dependencies, adj_variable derivative, adj_vector contraction,
+                                                   int hermitian, adj_vector input, adj_scalar coefficient, adj_scalar alpha, void* context, adj_vector* output)
+{
+  (void) ndepends; (void) variables; (void) dependencies; (void) derivative; (void) hermitian; (void) context;
+  *(adj_scalar*) output->ptr += alpha * coefficient * *(adj_scalar*) contraction.ptr * *(adj_scalar*) input.ptr;
+}
+
+/* J = u1, so dJ/du1 = 1 */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (derivative.timestep == 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+}
+
+static void record(adj_adjointer* adjointer, adj_variable var, adj_scalar value)
+{
+  adj_vector vec;
+  adj_storage_data storage;
+  vec.ptr = &value;
+  adj_storage_memory_copy(vec, &storage);
+  adj_record_variable(adjointer, var, storage);
+}
+
+void test_adj_accumulate_callbacks(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda;
+  adj_block B[2];
+  adj_equation eqn;
+  adj_matrix lhs;
+  adj_vector rhs;
+  adj_nonlinear_block nblock;
+  adj_nonlinear_block_derivative nblock_deriv;
+  adj_scalar contraction_value = 3.0, input_value = 5.0, rhs_value = 1.0;
+  adj_vector contraction, input;
+  int ierr, cs;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DUPLICATE_CB, (void (*)(void)) counting_vec_duplicate);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "MassMatrix", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+
+  /* Only the accumulating action of the coupling is supplied */
+  ierr = adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_ACCUMULATE_CB, "CouplingOperator", (void (*)(void)) adj_test_scalar_block_action_accumulate);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* 2 u0 = 1, and 2 u1 - 3 u0 = 4 u0 */
+  adj_create_block("CouplingOperator", NULL, NULL, -3.0, &B[0]);
+  adj_create_block("MassMatrix", NULL, NULL, 2.0, &B[1]);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+
+  adj_create_equation(u[0], 1, &B[1], &u[0], &eqn);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  record(&adjointer, u[0], 0.5);
+
+  adj_create_equation(u[1], 2, B, u, &eqn);
+  adj_equation_set_rhs_dependencies(&eqn, 1, &u[0], NULL);
+  adj_equation_set_rhs_derivative_action_accumulate_callback(&eqn, rhs_derivative_action_accumulate);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  record(&adjointer, u[1], 2.75);
+
+  adj_timestep_set_functional_dependencies(&adjointer, 1, "J", 1, &u[1]);
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  ierr = adj_get_adjoint_equation(&adjointer, 1, "J", &lhs, &rhs, &lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  record(&adjointer, lambda, *(adj_scalar*) rhs.ptr / *(adj_scalar*) lhs.ptr);
+  adj_test_mat_destroy(&lhs);
+  adj_test_vec_destroy(&rhs);
+
+  nduplicates = 0;
+  ierr = adj_get_adjoint_equation(&adjointer, 0, "J", &lhs, &rhs, &lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(*(adj_scalar*) lhs.ptr == 2.0 && *(adj_scalar*) rhs.ptr == 3.5, "The first adjoint equation is 2 lambda0 = 3 lambda1 + 4 lambda1");
+  adj_test_assert(nduplicates == 0, "Both terms should have been added to the rhs in place");
+  adj_test_mat_destroy(&lhs);
+  adj_test_vec_destroy(&rhs);
+
+  /* Nor is the plain derivative action of a nonlinear block needed if the accumulating one is there */
+  ierr = adj_register_operator_callback(&adjointer, ADJ_NBLOCK_DERIVATIVE_ACTION_ACCUMULATE_CB, "Advection", (void (*)(void)) nonlinear_derivative_action_accumulate);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_create_nonlinear_block("Advection", 1, &u[0], NULL, 2.0, &nblock);
+  contraction.ptr = &contraction_value;
+  ierr = adj_create_nonlinear_block_derivative(&adjointer, nblock, 1.0, u[0], contraction, ADJ_FALSE, ADJ_FALSE, &nblock_deriv);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  nduplicates = 0;
+  input.ptr = &input_value;
+  rhs.ptr = &rhs_value;
+  ierr = adj_evaluate_nonlinear_derivative_action(&adjointer, 1, &nblock_deriv, input, &rhs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked with only the accumulating derivative action");
+  adj_test_assert(rhs_value == 1.0 - 2.0 * 3.0 * 5.0, "Should have subtracted the derivative action from the rhs");
+  adj_test_assert(nduplicates == 0, "Should have subtracted it in place");
+
+  adj_destroy_nonlinear_block_derivative(&adjointer, &nblock_deriv);
+  adj_destroy_nonlinear_block(&nblock);
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
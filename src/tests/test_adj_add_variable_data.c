@@ -23,9 +23,20 @@ void test_adj_add_variable_data(void)
   ierr=adj_find_variable_data(&hash, &a, &data);
   adj_test_assert(ierr==ADJ_OK, "Should have worked");
   adj_test_assert(data->equation == 19, "Should have worked");
+  adj_test_assert(data->id == -1, "Data hashed outside an adjointer shouldn't have an id");
 
   ierr=adj_add_variable_data(&hash, &a, data);
   adj_test_assert(ierr!=ADJ_OK, "Should not have worked");
+
+  adj_variable b;
+  adj_variable_data* found;
+  adj_create_variable("NeverSeenBefore", 0, 0, ADJ_NORMAL_VARIABLE, &b);
+  ierr=adj_find_variable_data(&hash, &b, &found);
+  adj_test_assert(ierr!=ADJ_OK, "Should not have found a variable with an unknown name");
+
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &b);
+  ierr=adj_find_variable_data(&hash, &b, &found);
+  adj_test_assert(ierr!=ADJ_OK, "Should not have found a variable at a different timestep");
   
   adj_destroy_hash(&hash);
   free(data);
@@ -0,0 +1,152 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* u_t = u_{t-1} */
+#define NSTEPS 20
+
+static int nsolves[NSTEPS];
+
+static void counting_solve(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector* soln)
+{
+  if (var.type == ADJ_FORWARD) nsolves[var.timestep]++;
+  adj_test_scalar_solve(var, mat, rhs, soln);
+}
+
+/* The source of u_0 = 1 */
+static void forward_source(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* dependencies, adj_vector* values, void* context, adj_vector* output, int* has_output)
+{
+  (void) adjointer; (void) variable; (void) ndepends; (void) dependencies; (void) values; (void) context;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (adj_scalar) 1.0;
+  *has_output = ADJ_TRUE;
+}
+
+/* J = u_{NSTEPS-1} */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (derivative.timestep == NSTEPS - 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+}
+
+void test_adj_checkpoint_costs(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[NSTEPS];
+  adj_variable targets[2];
+  adj_block blocks[2];
+  adj_equation eqn;
+  adj_storage_data storage;
+  adj_vector soln;
+  adj_variable var, lambda;
+  adj_scalar seconds;
+  size_t bytes;
+  int storages[NSTEPS];
+  int ierr, cs, timestep, equation, nreplayed;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_SOLVE_CB, (void (*)(void)) counting_solve);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "IdentityOperator", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_ACCUMULATE_CB, "IdentityOperator", (void (*)(void)) adj_test_scalar_block_action_accumulate);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+  adj_set_checkpoint_strategy(&adjointer, ADJ_CHECKPOINT_REVOLVE_COST_AWARE);
+
+  ierr = adj_set_revolve_cost_options(&adjointer, NSTEPS, 0, ADJ_FALSE);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A budget of nothing holds no checkpoints");
+  /* Three checkpoints of one timestep's values */
+  ierr = adj_set_revolve_cost_options(&adjointer, NSTEPS, 3 * sizeof(adj_scalar), ADJ_FALSE);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  ierr = adj_set_timestep_cost(&adjointer, 0, -1.0, sizeof(adj_scalar));
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A timestep can't take negative time");
+  ierr = adj_get_timestep_cost(&adjointer, 0, &seconds, &bytes);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "Nothing is known about timestep 0 yet");
+
+  /* Timesteps 12 and 13 are fifty times as slow as the others, and timestep 4 solves for
+     so much that the checkpoint after it would take up the whole budget */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    seconds = (timestep == 12 || timestep == 13) ? 50.0 : 1.0;
+    bytes = (timestep == 4) ? 3 * sizeof(adj_scalar) : sizeof(adj_scalar);
+    ierr = adj_set_timestep_cost(&adjointer, timestep, seconds, bytes);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  ierr = adj_get_timestep_cost(&adjointer, 12, &seconds, &bytes);
+  adj_test_assert(ierr == ADJ_OK && seconds == 50.0 && bytes == sizeof(adj_scalar), "Should have got the estimate back");
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &blocks[0]);
+  adj_create_block("IdentityOperator", NULL, NULL, -1.0, &blocks[1]);
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[timestep]);
+    targets[0] = u[timestep];
+    if (timestep > 0) targets[1] = u[timestep - 1];
+    adj_create_equation(u[timestep], (timestep > 0) ? 2 : 1, blocks, targets, &eqn);
+    if (timestep == 0) adj_equation_set_rhs_callback(&eqn, forward_source);
+    ierr = adj_register_equation(&adjointer, eqn, &cs);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_destroy_equation(&eqn);
+
+    storages[timestep] = cs;
+    if (cs != ADJ_CHECKPOINT_STORAGE_NONE)
+    {
+      ierr = adj_checkpoint_equation(&adjointer, adjointer.nequations - 1, cs);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    }
+
+    ierr = adj_get_forward_solution(&adjointer, adjointer.nequations - 1, &soln, &var);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_storage_memory_incref(soln, &storage);
+    ierr = adj_record_variable(&adjointer, var, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  adj_timestep_set_functional_dependencies(&adjointer, NSTEPS - 1, "J", 1, &u[NSTEPS - 1]);
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  /* The adjoint run replays from the checkpoints as it goes, and J = u_{NSTEPS-1} = u_0 gives lambda = 1 throughout */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+    nsolves[timestep] = 0;
+  for (equation = NSTEPS - 1; equation >= 0; equation--)
+  {
+    ierr = adj_get_adjoint_solution(&adjointer, equation, "J", &soln, &lambda);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(*(adj_scalar*) soln.ptr == 1.0, "Should have got the right adjoint solution");
+    adj_storage_memory_incref(soln, &storage);
+    ierr = adj_record_variable(&adjointer, lambda, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    ierr = adj_forget_adjoint_equation(&adjointer, equation);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  nreplayed = 0;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+    nreplayed += nsolves[timestep];
+  adj_test_assert(nreplayed > 0, "Should have replayed from the checkpoints");
+  adj_test_assert(nsolves[12] == 0 && nsolves[13] == 0, "The slow timesteps should never have been replayed");
+
+  /* The two slow timesteps are never recomputed, and the big checkpoint at timestep 5 is never taken */
+  adj_test_assert(storages[0] == ADJ_CHECKPOINT_STORAGE_MEMORY, "Timestep 0 should be checkpointed");
+  adj_test_assert(storages[13] == ADJ_CHECKPOINT_STORAGE_MEMORY, "Timestep 13 should be checkpointed");
+  adj_test_assert(storages[14] == ADJ_CHECKPOINT_STORAGE_MEMORY, "Timestep 14 should be checkpointed");
+  adj_test_assert(storages[5] == ADJ_CHECKPOINT_STORAGE_NONE, "Timestep 5 shouldn't be checkpointed");
+  adj_test_assert(storages[NSTEPS - 1] == ADJ_CHECKPOINT_STORAGE_MEMORY, "The last timestep should be checkpointed");
+
+  /* The solves were measured, and the measurements replace the estimates */
+  ierr = adj_get_timestep_cost(&adjointer, 4, &seconds, &bytes);
+  adj_test_assert(ierr == ADJ_OK && bytes == sizeof(adj_scalar), "The size of timestep 4 should have been measured");
+  ierr = adj_get_timestep_cost(&adjointer, 12, &seconds, &bytes);
+  adj_test_assert(ierr == ADJ_OK && seconds >= 0.0 && seconds < 50.0, "The time of timestep 12 should have been measured");
+
+  /* and the next run is scheduled by them */
+  ierr = adj_reset_revolve(&adjointer);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_destroy_block(&blocks[0]);
+  adj_destroy_block(&blocks[1]);
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,156 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* Every timestep solves NEQ equations one after another,
+   u_k = u_{k-1} + 1 with u_0 = 1, so the value of equation k is k + 1 */
+#define NSTEPS 3
+#define NEQ 32
+
+static int nsolves;
+static int nwrong_dependencies;
+
+static void counting_solve(adj_variable var, adj_matrix mat, adj_vector rhs, adj_vector* soln)
+{
+  if (var.type == ADJ_FORWARD) nsolves++;
+  adj_test_scalar_solve(var, mat, rhs, soln);
+}
+
+static void forward_source(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies, void* context, adj_vector* output, int* has_output)
+{
+  (void) adjointer; (void) variable; (void) variables; (void) context;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (adj_scalar) 1.0;
+  if (ndepends > 0)
+    *(adj_scalar*) output->ptr += *(adj_scalar*) dependencies[0].ptr;
+  *has_output = ADJ_TRUE;
+}
+
+/* The derivative of the source is 1, but it checks that the value of u_{k-1} it gets is the recorded one */
+static void rhs_derivative_action_accumulate(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies,
+                                             adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output)
+{
+  (void) adjointer; (void) variable; (void) ndepends; (void) d_variable; (void) hermitian; (void) context;
+  if (*(adj_scalar*) dependencies[0].ptr != (adj_scalar) (variables[0].timestep * NEQ + variables[0].iteration + 1))
+    nwrong_dependencies++;
+  *(adj_scalar*) output->ptr += alpha * *(adj_scalar*) contraction.ptr;
+}
+
+/* J = u_{NSTEPS*NEQ-1} */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (derivative.timestep == NSTEPS - 1 && derivative.iteration == NEQ - 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+}
+
+/* Runs forward and backward with the given number of equation checkpoints, and returns
+   the most forward values ever held at once during the adjoint run */
+static int run_with_equation_checkpoints(int equation_snaps)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda;
+  adj_block identity;
+  adj_equation eqn;
+  adj_storage_data storage;
+  adj_vector vec, soln;
+  adj_scalar value;
+  int ierr, cs, timestep, i, equation, nheld, most_held;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_SOLVE_CB, (void (*)(void)) counting_solve);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "IdentityOperator", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+  adj_set_checkpoint_strategy(&adjointer, ADJ_CHECKPOINT_REVOLVE_MULTISTAGE);
+  adj_set_revolve_options(&adjointer, NSTEPS, 0, 2, ADJ_FALSE);
+  ierr = adj_set_revolve_equation_options(&adjointer, equation_snaps);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &identity);
+  vec.ptr = &value;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    for (i = 0; i < NEQ; i++)
+    {
+      u[0] = u[1];
+      adj_create_variable("Velocity", timestep, i, ADJ_NORMAL_VARIABLE, &u[1]);
+      adj_create_equation(u[1], 1, &identity, &u[1], &eqn);
+      adj_equation_set_rhs_callback(&eqn, forward_source);
+      if (timestep > 0 || i > 0)
+      {
+        adj_equation_set_rhs_dependencies(&eqn, 1, &u[0], NULL);
+        adj_equation_set_rhs_derivative_action_accumulate_callback(&eqn, rhs_derivative_action_accumulate);
+      }
+      ierr = adj_register_equation(&adjointer, eqn, &cs);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+      adj_destroy_equation(&eqn);
+      if (cs != ADJ_CHECKPOINT_STORAGE_NONE)
+        adj_checkpoint_equation(&adjointer, adjointer.nequations - 1, cs);
+      /* u_{k-1} is only known not to be needed once equation k is registered */
+      if (adjointer.nequations > 1)
+        adj_forget_forward_equation(&adjointer, adjointer.nequations - 2);
+
+      value = (adj_scalar) (adjointer.nequations);
+      adj_storage_memory_copy(vec, &storage);
+      ierr = adj_record_variable(&adjointer, u[1], storage);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    }
+  }
+  adj_timestep_set_functional_dependencies(&adjointer, NSTEPS - 1, "J", 1, &u[1]);
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  most_held = 0;
+  for (equation = NSTEPS * NEQ - 1; equation >= 0; equation--)
+  {
+    ierr = adj_get_adjoint_solution(&adjointer, equation, "J", &soln, &lambda);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    value = *(adj_scalar*) soln.ptr;
+    adj_storage_memory_incref(soln, &storage);
+    adj_record_variable(&adjointer, lambda, storage);
+
+    nheld = 0;
+    for (timestep = 0; timestep < NSTEPS; timestep++)
+    {
+      for (i = 0; i < NEQ; i++)
+      {
+        adj_create_variable("Velocity", timestep, i, ADJ_NORMAL_VARIABLE, &u[0]);
+        if (adj_has_variable_value(&adjointer, u[0]) == ADJ_OK) nheld++;
+      }
+    }
+    if (nheld > most_held) most_held = nheld;
+
+    ierr = adj_forget_adjoint_equation(&adjointer, equation);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  adj_test_assert(value == 1.0, "Should have got the right adjoint solution");
+
+  adj_destroy_block(&identity);
+  adj_destroy_adjointer(&adjointer);
+  return most_held;
+}
+
+void test_adj_checkpoint_equations(void)
+{
+  adj_adjointer adjointer;
+  int held, held_nested, nsolves_nested;
+  int ierr;
+
+  adj_create_adjointer(&adjointer);
+  ierr = adj_set_revolve_equation_options(&adjointer, -1);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A negative number of checkpoints makes no sense");
+  adj_destroy_adjointer(&adjointer);
+
+  nwrong_dependencies = 0;
+  held = run_with_equation_checkpoints(0);
+  adj_test_assert(nwrong_dependencies == 0, "The replayed values should be the recorded ones");
+  adj_test_assert(held >= NEQ, "Without equation checkpoints, a whole timestep should be held at once");
+
+  nsolves = 0;
+  held_nested = run_with_equation_checkpoints(3);
+  nsolves_nested = nsolves;
+  adj_test_assert(nwrong_dependencies == 0, "The replayed values should be the recorded ones");
+  adj_test_assert(held_nested < NEQ / 2, "With equation checkpoints, only part of a timestep should be held at once");
+  adj_test_assert(nsolves_nested < 3 * NSTEPS * NEQ, "Each equation should only be replayed a few times");
+}
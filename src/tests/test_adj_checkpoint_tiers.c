@@ -0,0 +1,127 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* u_t = u_{t-1} */
+#define N 4
+#define NSTEPS 10
+#define NTIERS 3
+
+static adj_scalar tier_store[NTIERS][NSTEPS][N];
+static int tier_writes[NTIERS], tier_reads[NTIERS], tier_deletes[NTIERS];
+
+static void tier_write(int tier, adj_variable var, adj_vector x)
+{
+  memcpy(tier_store[tier][var.timestep], x.ptr, N * sizeof(adj_scalar));
+  tier_writes[tier]++;
+}
+
+static void tier_read(int tier, adj_variable var, adj_vector* x)
+{
+  x->ptr = malloc(N * sizeof(adj_scalar));
+  x->klass = 0;
+  memcpy(x->ptr, tier_store[tier][var.timestep], N * sizeof(adj_scalar));
+  tier_reads[tier]++;
+}
+
+static void nvme_write(adj_variable var, adj_vector x) { tier_write(1, var, x); }
+static void nvme_read(adj_variable var, adj_vector* x) { tier_read(1, var, x); }
+static void nvme_delete(adj_variable var) { (void) var; tier_deletes[1]++; }
+static void pfs_write(adj_variable var, adj_vector x) { tier_write(2, var, x); }
+static void pfs_read(adj_variable var, adj_vector* x) { tier_read(2, var, x); }
+static void pfs_delete(adj_variable var) { (void) var; tier_deletes[2]++; }
+
+void test_adj_checkpoint_tiers(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[NSTEPS];
+  adj_variable targets[2];
+  adj_block blocks[2];
+  adj_equation eqn;
+  adj_storage_data storage;
+  adj_variable_data* data;
+  adj_vector vec;
+  adj_scalar values[N];
+  /* RAM, then a fast local scratch and a slow parallel filesystem */
+  int capacities[NTIERS] = {2, 2, 1};
+  adj_scalar write_costs[NTIERS] = {0.0, 1.0, 10.0};
+  adj_scalar read_costs[NTIERS] = {0.0, 1.0, 10.0};
+  int storages[NSTEPS];
+  int ierr, cs, timestep, i;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_set_checkpoint_strategy(&adjointer, ADJ_CHECKPOINT_REVOLVE_OFFLINE);
+
+  ierr = adj_register_tier_data_callback(&adjointer, 1, ADJ_VEC_WRITE_CB, (void (*)(void)) nvme_write);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "There are no tiers yet");
+  capacities[1] = -1;
+  ierr = adj_set_revolve_tier_options(&adjointer, NSTEPS, NTIERS, capacities, write_costs, read_costs, ADJ_FALSE);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A capacity can't be negative");
+  capacities[1] = 2;
+  ierr = adj_set_revolve_tier_options(&adjointer, NSTEPS, NTIERS, capacities, write_costs, read_costs, ADJ_FALSE);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_register_tier_data_callback(&adjointer, 1, ADJ_VEC_WRITE_CB, (void (*)(void)) nvme_write);
+  adj_register_tier_data_callback(&adjointer, 1, ADJ_VEC_READ_CB, (void (*)(void)) nvme_read);
+  adj_register_tier_data_callback(&adjointer, 1, ADJ_VEC_DELETE_CB, (void (*)(void)) nvme_delete);
+  adj_register_tier_data_callback(&adjointer, 2, ADJ_VEC_WRITE_CB, (void (*)(void)) pfs_write);
+  adj_register_tier_data_callback(&adjointer, 2, ADJ_VEC_READ_CB, (void (*)(void)) pfs_read);
+  adj_register_tier_data_callback(&adjointer, 2, ADJ_VEC_DELETE_CB, (void (*)(void)) pfs_delete);
+  adj_test_assert(adjointer.revolve_data.snaps == 5 && adjointer.revolve_data.snaps_in_ram == 2, "The tiers should hold five checkpoints, two in memory");
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &blocks[0]);
+  adj_create_block("IdentityOperator", NULL, NULL, -1.0, &blocks[1]);
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[timestep]);
+    targets[0] = u[timestep];
+    if (timestep > 0) targets[1] = u[timestep - 1];
+    adj_create_equation(u[timestep], (timestep > 0) ? 2 : 1, blocks, targets, &eqn);
+    ierr = adj_register_equation(&adjointer, eqn, &cs);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_destroy_equation(&eqn);
+
+    /* Whatever the storage, the checkpoint is taken the same way */
+    storages[timestep] = cs;
+    if (cs != ADJ_CHECKPOINT_STORAGE_NONE)
+    {
+      ierr = adj_checkpoint_equation(&adjointer, adjointer.nequations - 1, cs);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    }
+
+    for (i = 0; i < N; i++)
+      values[i] = timestep + 0.5 * i;
+    vec.ptr = values;
+    vec.klass = 0;
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u[timestep], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* Revolve restores from its slot for timestep 3 most, so that one gets the spare memory checkpoint;
+     the next most restored go on the scratch, and the rest on the parallel filesystem */
+  adj_test_assert(storages[0] == ADJ_CHECKPOINT_STORAGE_TIER + 1, "Timestep 0 should be checkpointed on the scratch");
+  adj_test_assert(storages[3] == ADJ_CHECKPOINT_STORAGE_MEMORY, "Timestep 3 should be checkpointed in memory");
+  adj_test_assert(storages[5] == ADJ_CHECKPOINT_STORAGE_TIER + 1, "Timestep 5 should be checkpointed on the scratch");
+  adj_test_assert(storages[7] == ADJ_CHECKPOINT_STORAGE_TIER + 2, "Timestep 7 should be checkpointed on the parallel filesystem");
+  adj_test_assert(storages[NSTEPS - 1] == ADJ_CHECKPOINT_STORAGE_MEMORY, "The last timestep should be checkpointed in memory");
+  adj_test_assert(tier_writes[1] == 1 && tier_writes[2] == 1, "The previous timesteps of 5 and 7 should have been written to their tiers");
+  adj_test_assert(adj_is_variable_disk_checkpoint(&adjointer, u[6]) == ADJ_TRUE, "u_6 should be a checkpoint");
+
+  /* Values on a tier are read back with its callbacks */
+  ierr = adj_find_variable_data(&(adjointer.varhash), &u[6], &data);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_forget_variable_value_from_memory(&adjointer, data);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_get_variable_value(&adjointer, u[6], &vec);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(tier_reads[2] == 1 && tier_reads[1] == 0, "u_6 should have been read from the parallel filesystem");
+  adj_test_assert(((adj_scalar*) vec.ptr)[N - 1] == 6 + 0.5 * (N - 1), "The value should have come back unchanged");
+
+  ierr = adj_checkpoint_equation(&adjointer, 1, ADJ_CHECKPOINT_STORAGE_TIER + NTIERS);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "There is no such tier");
+
+  adj_destroy_adjointer(&adjointer);
+  adj_test_assert(tier_deletes[1] == 1 && tier_deletes[2] == 1, "The values on the tiers should have been deleted with their callbacks");
+}
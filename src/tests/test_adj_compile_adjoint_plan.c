@@ -0,0 +1,101 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* J = u1, so dJ/du1 = 1 */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (derivative.timestep == 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+}
+
+static void record(adj_adjointer* adjointer, adj_variable var, adj_scalar value)
+{
+  adj_vector vec;
+  adj_storage_data storage;
+  vec.ptr = &value;
+  adj_storage_memory_copy(vec, &storage);
+  adj_record_variable(adjointer, var, storage);
+}
+
+void test_adj_compile_adjoint_plan(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda;
+  adj_block B[2];
+  adj_equation eqn;
+  adj_matrix lhs;
+  adj_vector rhs;
+  adj_adjoint_plan* plan;
+  adj_adjoint_plan_op* ops;
+  int ierr, cs;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "MassMatrix", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "CouplingOperator", (void (*)(void)) adj_test_scalar_block_action);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+
+  /* 2 u0 = 1, and 2 u1 - 3 u0 = 0 */
+  adj_create_block("CouplingOperator", NULL, NULL, -3.0, &B[0]);
+  adj_create_block("MassMatrix", NULL, NULL, 2.0, &B[1]);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+
+  adj_create_equation(u[0], 1, &B[1], &u[0], &eqn);
+  ierr = adj_register_equation(&adjointer, eqn, &cs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_destroy_equation(&eqn);
+  record(&adjointer, u[0], 0.5);
+
+  adj_create_equation(u[1], 2, B, u, &eqn);
+  ierr = adj_register_equation(&adjointer, eqn, &cs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_destroy_equation(&eqn);
+  record(&adjointer, u[1], 0.75);
+
+  ierr = adj_timestep_set_functional_dependencies(&adjointer, 1, "J", 1, &u[1]);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* While the annotation is still open, the plan is thrown away after use */
+  ierr = adj_get_adjoint_equation(&adjointer, 1, "J", &lhs, &rhs, &lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.adjoint_plans == NULL, "Should not keep plans before the annotation is finished");
+  adj_test_assert(*(adj_scalar*) lhs.ptr == 2.0 && *(adj_scalar*) rhs.ptr == 1.0, "The last adjoint equation is 2 lambda1 = dJ/du1");
+  record(&adjointer, lambda, *(adj_scalar*) rhs.ptr / *(adj_scalar*) lhs.ptr);
+  adj_test_mat_destroy(&lhs);
+  adj_test_vec_destroy(&rhs);
+
+  adj_set_finished(&adjointer, ADJ_TRUE);
+  ierr = adj_get_adjoint_equation(&adjointer, 0, "J", &lhs, &rhs, &lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(*(adj_scalar*) lhs.ptr == 2.0 && *(adj_scalar*) rhs.ptr == 1.5, "The first adjoint equation is 2 lambda0 = 3 lambda1");
+  adj_test_mat_destroy(&lhs);
+  adj_test_vec_destroy(&rhs);
+
+  adj_test_assert(adjointer.adjoint_plans != NULL && adjointer.adjoint_plans[0].compiled, "Should keep the plan once the annotation is finished");
+  adj_test_assert(!adjointer.adjoint_plans[1].compiled, "Should only compile the plans that are asked for");
+  plan = &adjointer.adjoint_plans[0];
+  adj_test_assert(plan->nops == 2, "The first adjoint equation has two terms");
+  adj_test_assert(plan->ops[0].kind == ADJ_PLAN_BLOCK_ASSEMBLY && plan->ops[0].block == &adjointer.equations[0].blocks[0], "The diagonal block goes in the lhs");
+  adj_test_assert(plan->ops[1].kind == ADJ_PLAN_BLOCK_ACTION && plan->ops[1].source == 1 && plan->ops[1].coefficient == -1.0, "The coupling acts on the adjoint of the second equation");
+  adj_test_assert(plan->nadjoint_equations == 1 && plan->adjoint_equations[0] == 0, "Only the first adjoint equation needs lambda0");
+
+  /* A second sweep executes the same plan */
+  ops = plan->ops;
+  ierr = adj_get_adjoint_equation(&adjointer, 0, "J", &lhs, &rhs, &lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.adjoint_plans[0].ops == ops, "Should not have recompiled the plan");
+  adj_test_assert(*(adj_scalar*) lhs.ptr == 2.0 && *(adj_scalar*) rhs.ptr == 1.5, "Should get the same adjoint equation again");
+  adj_test_mat_destroy(&lhs);
+  adj_test_vec_destroy(&rhs);
+
+  adj_set_finished(&adjointer, ADJ_FALSE);
+  adj_test_assert(adjointer.adjoint_plans == NULL, "Reopening the annotation should throw the plans away");
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
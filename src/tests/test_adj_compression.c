@@ -0,0 +1,81 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+#include <math.h>
+
+#define N 512
+
+void test_adj_compression(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_scalar values[N];
+  adj_vector vec, out;
+  adj_storage_data storage;
+  adj_scalar tolerance = 1.0e-4;
+  adj_scalar compress_time, decompress_time, error;
+  size_t raw_bytes, compressed_bytes, charged;
+  int ierr, timestep, i, exact;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+  adj_register_data_callback(&adjointer, ADJ_VEC_SET_VALUES_CB, (void (*)(void)) adj_test_vec_set_values);
+  adj_test_register_null_disk_callbacks(&adjointer);
+
+  /* Big enough never to spill, just to see what the values are charged */
+  ierr = adj_set_memory_budget(&adjointer, 1 << 30);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  vec.ptr = values;
+  vec.klass = 0;
+  for (i = 0; i < N; i++)
+    values[i] = sin(2.0 * M_PI * i / N);
+
+  adj_storage_memory_compressed(vec, &storage);
+  ierr = adj_storage_set_compression(&storage, ADJ_COMPRESSION_LOSSY, 0.0);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "Lossy compression needs a positive tolerance");
+  ierr = adj_storage_set_compression(&storage, 3, tolerance);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "Should have rejected an unknown compression");
+
+  /* Timestep 0 losslessly, timestep 1 to within the tolerance */
+  for (timestep = 0; timestep < 2; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    adj_storage_memory_compressed(vec, &storage);
+    if (timestep == 1)
+    {
+      ierr = adj_storage_set_compression(&storage, ADJ_COMPRESSION_LOSSY, tolerance);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    }
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  charged = adjointer.memory_used;
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u);
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.memory_used == charged + N * sizeof(adj_scalar), "The decompressed copy should be charged too");
+  exact = 1;
+  for (i = 0; i < N; i++)
+    if (((adj_scalar*) out.ptr)[i] != values[i]) exact = 0;
+  adj_test_assert(exact, "Lossless compression should give back exactly what was recorded");
+
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u);
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  error = 0.0;
+  for (i = 0; i < N; i++)
+    error = fmax(error, fabs(((adj_scalar*) out.ptr)[i] - values[i]));
+  adj_test_assert(error <= tolerance * (1.0 + 1.0e-8), "Lossy compression should stay within the tolerance");
+
+  ierr = adj_get_compression_stats(&adjointer, &raw_bytes, &compressed_bytes, &compress_time, &decompress_time);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(raw_bytes == 2 * N * sizeof(adj_scalar), "Should have counted what went in");
+  adj_test_assert(compressed_bytes < raw_bytes / 2, "Should have compressed by at least half");
+  adj_test_assert(compress_time >= 0.0 && decompress_time >= 0.0, "Should have timed it");
+
+  adj_destroy_adjointer(&adjointer);
+}
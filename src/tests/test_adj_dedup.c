@@ -0,0 +1,117 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#define N 32
+#define NSTEPS 10
+
+static int nduplicates = 0;
+
+static void counting_vec_duplicate(adj_vector x, adj_vector* newx)
+{
+  nduplicates++;
+  adj_test_vec_duplicate(x, newx);
+}
+
+static void record(adj_adjointer* adjointer, char* name, int timestep, adj_scalar* values)
+{
+  adj_variable var;
+  adj_vector vec;
+  adj_storage_data storage;
+  int ierr;
+
+  adj_create_variable(name, timestep, 0, ADJ_NORMAL_VARIABLE, &var);
+  vec.ptr = values;
+  vec.klass = 0;
+  adj_storage_memory_copy(vec, &storage);
+  ierr = adj_record_variable(adjointer, var, storage);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+}
+
+static void forget(adj_adjointer* adjointer, char* name, int timestep)
+{
+  adj_variable var;
+  adj_variable_data* data;
+  int ierr;
+
+  adj_create_variable(name, timestep, 0, ADJ_NORMAL_VARIABLE, &var);
+  ierr = adj_find_variable_data(&(adjointer->varhash), &var, &data);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_forget_variable_value_from_memory(adjointer, data);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+}
+
+void test_adj_dedup(void)
+{
+  adj_adjointer adjointer;
+  adj_variable var;
+  adj_vector out;
+  adj_scalar coefficient[N], velocity[N];
+  size_t shared_bytes, saved_bytes;
+  int ierr, timestep, i, ncopies, correct;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DUPLICATE_CB, (void (*)(void)) counting_vec_duplicate);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+
+  ierr = adj_set_deduplication(&adjointer, 2);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "dedup is either on or off");
+  ierr = adj_set_deduplication(&adjointer, ADJ_TRUE);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* A time-invariant coefficient, and a velocity that changes every timestep */
+  for (i = 0; i < N; i++)
+    coefficient[i] = 1.0 + i;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    for (i = 0; i < N; i++)
+      velocity[i] = timestep * N + i;
+    record(&adjointer, "Coefficient", timestep, coefficient);
+    record(&adjointer, "Velocity", timestep, velocity);
+  }
+
+  ierr = adj_get_deduplication_stats(&adjointer, &ncopies, &shared_bytes, &saved_bytes);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(ncopies == NSTEPS + 1, "The coefficient should have been kept only once");
+  adj_test_assert(nduplicates == NSTEPS + 1, "Only the distinct contents should have been duplicated");
+  adj_test_assert(shared_bytes == (NSTEPS + 1) * N * sizeof(adj_scalar), "Should have counted the copies");
+  adj_test_assert(saved_bytes == (NSTEPS - 1) * N * sizeof(adj_scalar), "Should have saved all but one coefficient");
+
+  correct = 1;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &var);
+    ierr = adj_get_variable_value(&adjointer, var, &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    for (i = 0; i < N; i++)
+      if (((adj_scalar*) out.ptr)[i] != timestep * N + i) correct = 0;
+  }
+  adj_test_assert(correct, "Distinct values should keep their own contents");
+
+  /* The shared copy goes with the last of the values that hold it */
+  for (timestep = 0; timestep < NSTEPS - 1; timestep++)
+    forget(&adjointer, "Coefficient", timestep);
+  ierr = adj_get_deduplication_stats(&adjointer, &ncopies, &shared_bytes, &saved_bytes);
+  adj_test_assert(ierr == ADJ_OK && ncopies == NSTEPS + 1 && saved_bytes == 0, "The last coefficient still holds the copy");
+
+  adj_create_variable("Coefficient", NSTEPS - 1, 0, ADJ_NORMAL_VARIABLE, &var);
+  ierr = adj_get_variable_value(&adjointer, var, &out);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(memcmp(out.ptr, coefficient, N * sizeof(adj_scalar)) == 0, "The shared copy should still be there");
+
+  forget(&adjointer, "Coefficient", NSTEPS - 1);
+  ierr = adj_get_deduplication_stats(&adjointer, &ncopies, &shared_bytes, &saved_bytes);
+  adj_test_assert(ierr == ADJ_OK && ncopies == NSTEPS, "The shared copy should have been released");
+
+  /* Switched off, values get their own copies again */
+  ierr = adj_set_deduplication(&adjointer, ADJ_FALSE);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  record(&adjointer, "Coefficient", NSTEPS, coefficient);
+  record(&adjointer, "Coefficient", NSTEPS + 1, coefficient);
+  ierr = adj_get_deduplication_stats(&adjointer, &ncopies, &shared_bytes, &saved_bytes);
+  adj_test_assert(ierr == ADJ_OK && ncopies == NSTEPS && saved_bytes == 0, "Nothing more should have been shared");
+
+  adj_destroy_adjointer(&adjointer);
+}
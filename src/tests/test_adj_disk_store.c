@@ -0,0 +1,82 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#define N 3
+#define NSTEPS 6
+
+static int segment_exists(char* directory, int segment)
+{
+  char filename[ADJ_NAME_LEN];
+  snprintf(filename, ADJ_NAME_LEN, "%s/adj_segment_%d.log", directory, segment);
+  return access(filename, F_OK) == 0;
+}
+
+void test_adj_disk_store(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_variable_data* data;
+  adj_scalar values[N];
+  adj_vector vec, out;
+  adj_storage_data storage;
+  char directory[] = "/tmp/adj_disk_store_XXXXXX";
+  size_t record_size;
+  int ierr, timestep, i, correct;
+
+  adj_test_assert(mkdtemp(directory) != NULL, "Should have made a directory");
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_SET_VALUES_CB, (void (*)(void)) adj_test_vec_set_values);
+
+  /* Two records to a segment */
+  record_size = sizeof(adj_variable_key) + 2 * sizeof(int) + N * sizeof(adj_scalar);
+  ierr = adj_set_disk_store(&adjointer, directory, record_size + 1);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "The disk store needs ADJ_VEC_GET_VALUES_CB");
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+  ierr = adj_set_disk_store(&adjointer, directory, record_size + 1);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  vec.ptr = values;
+  vec.klass = 0;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    for (i = 0; i < N; i++)
+      values[i] = (adj_scalar) (N * timestep + i);
+    adj_storage_disk(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  adj_test_assert(segment_exists(directory, 0) && segment_exists(directory, 2) && !segment_exists(directory, 3), "Should have filled three segments");
+
+  /* Values come back in the layout they were written in */
+  correct = 1;
+  for (timestep = NSTEPS - 1; timestep >= 0; timestep--)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    ierr = adj_get_variable_value(&adjointer, u, &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    for (i = 0; i < N; i++)
+      if (((adj_scalar*) out.ptr)[i] != (adj_scalar) (N * timestep + i)) correct = 0;
+  }
+  adj_test_assert(correct, "Should have read back the recorded values");
+
+  /* A segment goes once nothing in it is needed */
+  for (timestep = 0; timestep < 3; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    ierr = adj_find_variable_data(&(adjointer.varhash), &u, &data);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    ierr = adj_forget_variable_value_from_disk(&adjointer, u, data);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  adj_test_assert(!segment_exists(directory, 0), "The first segment should have been removed");
+  adj_test_assert(segment_exists(directory, 1), "The second segment still holds a value");
+
+  adj_destroy_adjointer(&adjointer);
+  adj_test_assert(!segment_exists(directory, 1) && !segment_exists(directory, 2), "Destroying the adjointer should remove the segments");
+  adj_test_assert(rmdir(directory) == 0, "Nothing else should have been left in the directory");
+}
@@ -0,0 +1,75 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* flags is set on vectors that wrap someone else's array, which they mustn't free */
+#define N 3
+
+static void array_vec_destroy(adj_vector* x)
+{
+  if (!x->flags) free(x->ptr);
+}
+
+static void array_vec_wrap_values(adj_vector model, adj_scalar scalars[], adj_vector* x)
+{
+  x->ptr = scalars;
+  x->klass = model.klass;
+  x->flags = 1;
+}
+
+void test_adj_disk_store_map(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_variable_data* data;
+  adj_scalar values[N];
+  adj_vector vec, out;
+  adj_storage_data storage;
+  char directory[] = "/tmp/adj_disk_store_XXXXXX";
+  int ierr, timestep, i;
+
+  adj_test_assert(mkdtemp(directory) != NULL, "Should have made a directory");
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DESTROY_CB, (void (*)(void)) array_vec_destroy);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+  adj_register_data_callback(&adjointer, ADJ_VEC_SET_VALUES_CB, (void (*)(void)) adj_test_vec_set_values);
+  adj_register_data_callback(&adjointer, ADJ_VEC_WRAP_VALUES_CB, (void (*)(void)) array_vec_wrap_values);
+  ierr = adj_set_disk_store(&adjointer, directory, 1 << 20);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  vec.ptr = values;
+  vec.klass = 0;
+  vec.flags = 0;
+  for (timestep = 0; timestep < 2; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    for (i = 0; i < N; i++)
+      values[i] = (adj_scalar) (N * timestep + i);
+    adj_storage_disk(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* The restored value is the record itself, mapped into memory */
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u);
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(out.flags == 1, "Should have wrapped the mapped record");
+  adj_test_assert(((adj_scalar*) out.ptr)[0] == 3.0 && ((adj_scalar*) out.ptr)[2] == 5.0, "Should have got the recorded value");
+
+  /* Changing it must not change what is on disk */
+  ((adj_scalar*) out.ptr)[0] = (adj_scalar) -1.0;
+  ierr = adj_find_variable_data(&(adjointer.varhash), &u, &data);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_forget_variable_value_from_memory(&adjointer, data);
+  adj_test_assert(ierr == ADJ_OK && data->mapping == NULL, "Forgetting the value should have unmapped it");
+
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK && ((adj_scalar*) out.ptr)[0] == 3.0, "The record should not have been changed");
+
+  adj_destroy_adjointer(&adjointer);
+  adj_test_assert(rmdir(directory) == 0, "Nothing should have been left in the directory");
+}
@@ -0,0 +1,84 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#define NSTEPS 50
+
+static void record(adj_adjointer* adjointer, int timestep)
+{
+  adj_variable u;
+  adj_vector vec;
+  adj_scalar value = 1.0;
+  adj_storage_data storage;
+  int ierr;
+
+  vec.ptr = &value;
+  adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+  adj_storage_memory_copy(vec, &storage);
+  ierr = adj_record_variable(adjointer, u, storage);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+}
+
+void test_adj_expiry(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2];
+  adj_block I;
+  adj_equation eqn;
+  int ierr, cs, timestep, equation, nvisits;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &I);
+
+  /* u_t = f(u_{t-1}), so u_{t-1} is needed by forward equation t and by adjoint equation t - 1 */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    u[0] = u[1];
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    adj_create_equation(u[1], 1, &I, &u[1], &eqn);
+    if (timestep > 0)
+      adj_equation_set_rhs_dependencies(&eqn, 1, &u[0], NULL);
+    ierr = adj_register_equation(&adjointer, eqn, &cs);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_destroy_equation(&eqn);
+  }
+
+  /* Forward: each forget only looks at the velocity that dies there */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    record(&adjointer, timestep);
+    ierr = adj_forget_forward_equation(&adjointer, timestep);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adj_expiry_visits(&adjointer) == (timestep == 0 ? 0 : (timestep == NSTEPS - 1 ? 2 : 1)), "Only u_{t-1} (and u_t at the end) should have been looked at");
+    adj_test_assert(adjointer.nlive_variables == (timestep == NSTEPS - 1 ? 0 : 1), "Only the latest velocity should stay live");
+  }
+
+  /* Adjoint, with the whole run held: still one velocity per forget, not the whole tape */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+    record(&adjointer, timestep);
+  for (equation = NSTEPS - 1; equation >= 0; equation--)
+  {
+    /* A value recorded again after its bucket was drained is still forgotten */
+    if (equation == NSTEPS / 2) record(&adjointer, NSTEPS - 1);
+
+    ierr = adj_forget_adjoint_equation(&adjointer, equation);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    nvisits = adj_expiry_visits(&adjointer);
+    adj_test_assert(nvisits == (equation == NSTEPS / 2 ? 2 : 1), "Only the velocities that expire here should have been looked at");
+    adj_test_assert(adjointer.nlive_variables == equation, "The velocity of this equation should have been forgotten");
+  }
+
+  /* Until a bound: the equations past it don't count, so only the velocity solved past it is kept */
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+    record(&adjointer, timestep);
+  ierr = adj_forget_forward_equation_until(&adjointer, NSTEPS - 2, NSTEPS - 2);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.nlive_variables == 1, "Only the last velocity should be left");
+  ierr = adj_forget_forward_equation_until(&adjointer, NSTEPS - 1, NSTEPS - 1);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.nlive_variables == 0, "Nothing should be left");
+
+  adj_destroy_block(&I);
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,68 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+static void first_action(void) {}
+static void second_action(void) {}
+static void functional(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output)
+{
+  (void) adjointer; (void) timestep; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  *output = (adj_scalar) 0.0;
+}
+
+void test_adj_find_operator_callback(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_block I;
+  adj_equation eqn;
+  adj_block* registered;
+  void (*fn)(void);
+  void (*func_fn)(adj_adjointer* adjointer, int timestep, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_scalar* output);
+  int ierr, cs;
+
+  adj_create_adjointer(&adjointer);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u);
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &I);
+  adj_test_assert(I.callbacks == NULL, "A fresh block should not have any callbacks cached");
+
+  adj_create_equation(u, 1, &I, &u, &eqn);
+  ierr = adj_register_equation(&adjointer, eqn, &cs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_destroy_equation(&eqn);
+
+  registered = &adjointer.equations[0].blocks[0];
+  adj_test_assert(registered->callbacks != NULL, "Registering the equation should cache the callback entry");
+
+  ierr = adj_find_cached_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, registered->callbacks, registered->name, &fn);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "Nothing has been registered yet");
+
+  /* Callbacks registered after the equation should still be found through the cached entry */
+  ierr = adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "IdentityOperator", first_action);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_find_cached_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, registered->callbacks, registered->name, &fn);
+  adj_test_assert(ierr == ADJ_OK && fn == first_action, "Should find the callback registered after the equation");
+
+  /* and replacing a callback should be seen by the cached entry too */
+  ierr = adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "IdentityOperator", second_action);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_find_cached_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, registered->callbacks, registered->name, &fn);
+  adj_test_assert(ierr == ADJ_OK && fn == second_action, "Should find the replacement callback");
+  adj_test_assert(adjointer.block_action_list.firstnode == adjointer.block_action_list.lastnode, "Replacing a callback should not add another");
+
+  ierr = adj_find_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "IdentityOperator", &fn);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "Callbacks of different types should not be confused");
+  ierr = adj_find_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "UnknownOperator", &fn);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "Should not find a callback for an unknown operator");
+
+  /* Functionals share the table, under their own names */
+  ierr = adj_register_functional_callback(&adjointer, "Drag", functional);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_find_functional_callback(&adjointer, "Drag", &func_fn);
+  adj_test_assert(ierr == ADJ_OK && func_fn == functional, "Should find the functional callback");
+  ierr = adj_find_functional_callback(&adjointer, "IdentityOperator", &func_fn);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "An operator callback is not a functional callback");
+
+  adj_destroy_block(&I);
+  adj_destroy_adjointer(&adjointer);
+}
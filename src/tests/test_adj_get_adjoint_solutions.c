@@ -0,0 +1,117 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+static int nassemblies = 0;
+static int nsolves = 0;
+
+static void scalar_solve_multi(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns)
+{
+  int i;
+  (void) vars;
+  nsolves++;
+  for (i = 0; i < nrhs; i++)
+  {
+    solns[i].ptr = malloc(sizeof(adj_scalar));
+    *(adj_scalar*) solns[i].ptr = *(adj_scalar*) rhs[i].ptr / *(adj_scalar*) mat.ptr;
+  }
+}
+
+static void scalar_block_assembly(int ndepends, adj_variable* variables, adj_vector* dependencies, int hermitian, adj_scalar coefficient, void* context, adj_matrix* output, adj_vector* rhs)
+{
+  nassemblies++;
+  adj_test_scalar_block_assembly(ndepends, variables, dependencies, hermitian, coefficient, context, output, rhs);
+}
+
+/* J = u1 and K = 2 u1 + u0 */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies;
+  output->ptr = malloc(sizeof(adj_scalar));
+  if (strncmp(name, "J", ADJ_NAME_LEN) == 0)
+    *(adj_scalar*) output->ptr = (derivative.timestep == 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+  else
+    *(adj_scalar*) output->ptr = (derivative.timestep == 1) ? (adj_scalar) 2.0 : (adj_scalar) 1.0;
+}
+
+static void record(adj_adjointer* adjointer, adj_variable var, adj_vector vec)
+{
+  adj_storage_data storage;
+  adj_storage_memory_copy(vec, &storage);
+  adj_record_variable(adjointer, var, storage);
+}
+
+void test_adj_get_adjoint_solutions(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda[2];
+  adj_block B[2];
+  adj_equation eqn;
+  adj_vector solns[2];
+  adj_scalar value;
+  char* functionals[2] = {"J", "K"};
+  int ierr, cs, i;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "MassMatrix", (void (*)(void)) scalar_block_assembly);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "CouplingOperator", (void (*)(void)) adj_test_scalar_block_action);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+  adj_register_functional_derivative_callback(&adjointer, "K", functional_derivative);
+
+  /* 2 u0 = 1, and 2 u1 - 3 u0 = 0 */
+  adj_create_block("CouplingOperator", NULL, NULL, -3.0, &B[0]);
+  adj_create_block("MassMatrix", NULL, NULL, 2.0, &B[1]);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+
+  adj_create_equation(u[0], 1, &B[1], &u[0], &eqn);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  value = 0.5; solns[0].ptr = &value;
+  record(&adjointer, u[0], solns[0]);
+
+  adj_create_equation(u[1], 2, B, u, &eqn);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  value = 0.75; solns[0].ptr = &value;
+  record(&adjointer, u[1], solns[0]);
+
+  adj_timestep_set_functional_dependencies(&adjointer, 1, "J", 1, &u[1]);
+  adj_timestep_set_functional_dependencies(&adjointer, 1, "K", 2, u);
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  ierr = adj_get_adjoint_solutions(&adjointer, 1, 2, functionals, solns, lambda);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "Should need a solve callback");
+
+  adj_register_data_callback(&adjointer, ADJ_SOLVE_MULTI_CB, (void (*)(void)) scalar_solve_multi);
+
+  ierr = adj_get_adjoint_solutions(&adjointer, 1, 2, functionals, solns, lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nassemblies == 1 && nsolves == 1, "Should assemble and solve once for both functionals");
+  adj_test_assert(strncmp(lambda[0].functional, "J", ADJ_NAME_LEN) == 0 && strncmp(lambda[1].functional, "K", ADJ_NAME_LEN) == 0, "Should get one adjoint variable per functional");
+  adj_test_assert(*(adj_scalar*) solns[0].ptr == 0.5 && *(adj_scalar*) solns[1].ptr == 1.0, "2 lambda1 = dJ/du1, and 2 kappa1 = dK/du1");
+  for (i = 0; i < 2; i++)
+  {
+    record(&adjointer, lambda[i], solns[i]);
+    adj_test_vec_destroy(&solns[i]);
+  }
+
+  ierr = adj_get_adjoint_solutions(&adjointer, 0, 2, functionals, solns, lambda);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nassemblies == 2 && nsolves == 2, "Should assemble and solve once for both functionals");
+  adj_test_assert(*(adj_scalar*) solns[0].ptr == 0.75 && *(adj_scalar*) solns[1].ptr == 2.0, "2 lambda0 = 3 lambda1, and 2 kappa0 = 3 kappa1 + dK/du0");
+  for (i = 0; i < 2; i++)
+    adj_test_vec_destroy(&solns[i]);
+
+  /* and the single-functional version should agree */
+  ierr = adj_get_adjoint_solution(&adjointer, 0, "K", &solns[0], &lambda[0]);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(*(adj_scalar*) solns[0].ptr == 2.0, "Should get the same solution on its own");
+  adj_test_vec_destroy(&solns[0]);
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,128 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+#include <math.h>
+
+#define NSTEPS 10
+#define STRIDE 3
+#define DT 0.5
+
+static void scalar_vec_delete(adj_variable var)
+{
+  (void) var;
+}
+
+/* Velocity is quadratic in time and interpolated with cubics; Pressure is linear, and interpolated linearly */
+static adj_scalar velocity(int timestep)
+{
+  return (DT * timestep) * (DT * timestep);
+}
+
+static adj_scalar pressure(int timestep)
+{
+  return 1.0 + 2.0 * DT * timestep;
+}
+
+static int has_memory_value(adj_adjointer* adjointer, char* name, int timestep)
+{
+  adj_variable var;
+  adj_create_variable(name, timestep, 0, ADJ_NORMAL_VARIABLE, &var);
+  return adj_has_variable_value_memory(adjointer, var) == ADJ_OK;
+}
+
+void test_adj_interpolation(void)
+{
+  adj_adjointer adjointer;
+  adj_variable vars[2];
+  adj_block I;
+  adj_equation eqn;
+  adj_vector vec, out;
+  adj_scalar value;
+  adj_storage_data storage;
+  int ierr, cs, timestep, j, correct, interpolated;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) scalar_vec_delete);
+
+  ierr = adj_set_interpolation(&adjointer, "Velocity", 0, ADJ_INTERPOLATION_LINEAR);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "The stride must be at least one");
+  ierr = adj_set_interpolation(&adjointer, "Velocity", STRIDE, ADJ_INTERPOLATION_CUBIC_HERMITE);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_set_interpolation(&adjointer, "Pressure", STRIDE, ADJ_INTERPOLATION_LINEAR);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* Two equations a timestep, and a functional of both variables at every timestep */
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &I);
+  vec.ptr = &value;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &vars[0]);
+    adj_create_variable("Pressure", timestep, 0, ADJ_NORMAL_VARIABLE, &vars[1]);
+    for (j = 0; j < 2; j++)
+    {
+      adj_create_equation(vars[j], 1, &I, &vars[j], &eqn);
+      adj_register_equation(&adjointer, eqn, &cs);
+      adj_destroy_equation(&eqn);
+    }
+    adj_timestep_set_times(&adjointer, timestep, DT * (timestep - 1), DT * timestep);
+    adj_timestep_set_functional_dependencies(&adjointer, timestep, "Functional", 2, vars);
+
+    value = velocity(timestep);
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, vars[0], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    value = pressure(timestep);
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, vars[1], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* Only the anchors are kept, but everything has a value */
+  interpolated = 1;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &vars[0]);
+    if (has_memory_value(&adjointer, "Velocity", timestep) != (timestep % STRIDE == 0)) interpolated = 0;
+    if (adj_has_variable_value(&adjointer, vars[0]) != ADJ_OK) interpolated = 0;
+  }
+  adj_test_assert(interpolated, "Only the anchors should have been kept");
+  adj_test_assert(adjointer.nlive_variables == 2 * (NSTEPS / STRIDE + 1), "Only the anchors should be live");
+
+  /* Linear interpolation of a linear function, and cubic Hermite interpolation of a quadratic
+     away from the ends of the run, are exact */
+  correct = 1;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Pressure", timestep, 0, ADJ_NORMAL_VARIABLE, &vars[1]);
+    ierr = adj_get_variable_value(&adjointer, vars[1], &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    if (fabs(*(adj_scalar*) out.ptr - pressure(timestep)) > 1.0e-12) correct = 0;
+  }
+  adj_test_assert(correct, "Should have interpolated Pressure linearly");
+
+  correct = 1;
+  for (timestep = STRIDE + 1; timestep < 2 * STRIDE; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &vars[0]);
+    ierr = adj_get_variable_value(&adjointer, vars[0], &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    if (fabs(*(adj_scalar*) out.ptr - velocity(timestep)) > 1.0e-12) correct = 0;
+  }
+  adj_test_assert(correct, "Should have interpolated Velocity with cubics");
+
+  /* Going back to timestep 5, the values of timestep 4 are still needed, so the anchors they are
+     interpolated from must stay; the cubics for Velocity take in the anchor at 9 as well */
+  ierr = adj_forget_adjoint_equation(&adjointer, 2 * 5);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(has_memory_value(&adjointer, "Velocity", 9), "The cubics still need the last anchor");
+  adj_test_assert(!has_memory_value(&adjointer, "Pressure", 9), "Linear interpolation doesn't need the last anchor");
+  adj_test_assert(has_memory_value(&adjointer, "Pressure", 6) && has_memory_value(&adjointer, "Pressure", 3), "Pressure at timestep 4 needs these");
+
+  ierr = adj_forget_adjoint_equation(&adjointer, 2 * 1);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(!has_memory_value(&adjointer, "Velocity", 3) && !has_memory_value(&adjointer, "Velocity", 9), "Nothing interpolated is needed any more");
+  adj_test_assert(has_memory_value(&adjointer, "Velocity", 0), "The first timestep is still needed");
+
+  adj_destroy_adjointer(&adjointer);
+}
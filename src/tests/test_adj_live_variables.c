@@ -0,0 +1,85 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+static int live_list_is_consistent(adj_adjointer* adjointer)
+{
+  int k, id, nlive = 0;
+  adj_variable_data* data;
+
+  for (k = 0; k < adjointer->nlive_variables; k++)
+  {
+    data = ADJ_VARIABLE_DATA(adjointer, adjointer->live_variables[k]);
+    if (data->live_index != k || !data->storage.storage_memory_has_value) return 0;
+  }
+  for (id = 0; id < adjointer->nvariables; id++)
+    if (ADJ_VARIABLE_DATA(adjointer, id)->storage.storage_memory_has_value) nlive++;
+
+  return nlive == adjointer->nlive_variables;
+}
+
+void test_adj_live_variables(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2];
+  adj_block B[2];
+  adj_equation eqn;
+  adj_vector vec;
+  adj_scalar value = 1.0;
+  adj_storage_data storage;
+  int ierr, cs, timestep, nsteps = 6;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &B[1]);
+  adj_create_block("TimesteppingOperator", NULL, NULL, -1.0, &B[0]);
+  vec.ptr = &value;
+
+  /* u0 = 1, and u_n - u_{n-1} = 0 */
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+  adj_create_equation(u[1], 1, &B[1], &u[1], &eqn);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  for (timestep = 1; timestep < nsteps; timestep++)
+  {
+    u[0] = u[1];
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    adj_create_equation(u[1], 2, B, u, &eqn);
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+  }
+  adj_test_assert(adjointer.nlive_variables == 0, "Nothing has a value yet");
+
+  /* Only the latest velocity is needed for the next equation */
+  for (timestep = 0; timestep < nsteps; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u[0], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adjointer.nlive_variables == (timestep == 0 ? 1 : 2), "The new velocity should be live");
+
+    ierr = adj_forget_forward_equation(&adjointer, timestep);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adjointer.nlive_variables == (timestep == nsteps - 1 ? 0 : 1), "Only the latest velocity should stay live");
+    adj_test_assert(live_list_is_consistent(&adjointer), "The live list should match the stored values");
+  }
+
+  /* Forgetting from the middle of the list must keep it consistent */
+  for (timestep = 0; timestep < nsteps; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_storage_memory_copy(vec, &storage);
+    adj_record_variable(&adjointer, u[0], storage);
+  }
+  adj_test_assert(adjointer.nlive_variables == nsteps, "Every velocity should be live");
+  ierr = adj_forget_forward_equation_until(&adjointer, 3, 4);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.nlive_variables == 3, "Velocities 0 to 2 should have been forgotten");
+  adj_test_assert(live_list_is_consistent(&adjointer), "The live list should match the stored values");
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
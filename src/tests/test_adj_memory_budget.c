@@ -0,0 +1,175 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* The "disk" is one slot per timestep */
+#define VECTOR_SIZE 4
+#define NSTEPS 6
+static adj_scalar disk[NSTEPS][VECTOR_SIZE];
+static int nwrites = 0;
+static int nreads = 0;
+
+static void array_vec_write(adj_variable var, adj_vector x)
+{
+  nwrites++;
+  memcpy(disk[var.timestep], x.ptr, VECTOR_SIZE * sizeof(adj_scalar));
+}
+
+static void array_vec_read(adj_variable var, adj_vector* x)
+{
+  nreads++;
+  x->ptr = malloc(VECTOR_SIZE * sizeof(adj_scalar));
+  memcpy(x->ptr, disk[var.timestep], VECTOR_SIZE * sizeof(adj_scalar));
+}
+
+static void array_vec_delete(adj_variable var)
+{
+  (void) var;
+}
+
+void test_adj_memory_budget(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2];
+  adj_block B[2];
+  adj_equation eqn;
+  adj_vector vec;
+  adj_scalar values[VECTOR_SIZE];
+  adj_storage_data storage;
+  size_t vector_bytes = VECTOR_SIZE * sizeof(adj_scalar);
+  int ierr, cs, timestep, i;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, VECTOR_SIZE);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+
+  ierr = adj_set_memory_budget(&adjointer, 3 * vector_bytes);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "A budget needs the disk callbacks");
+
+  adj_register_data_callback(&adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) array_vec_write);
+  adj_register_data_callback(&adjointer, ADJ_VEC_READ_CB, (void (*)(void)) array_vec_read);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) array_vec_delete);
+
+  /* u0 = 1, and u_n - u_{n-1} = 0 */
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &B[1]);
+  adj_create_block("TimesteppingOperator", NULL, NULL, -1.0, &B[0]);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+  adj_create_equation(u[1], 1, &B[1], &u[1], &eqn);
+  adj_register_equation(&adjointer, eqn, &cs);
+  adj_destroy_equation(&eqn);
+  for (timestep = 1; timestep < NSTEPS; timestep++)
+  {
+    u[0] = u[1];
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    adj_create_equation(u[1], 2, B, u, &eqn);
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+  }
+
+  /* The first two values are recorded before the budget is set, and must be charged too */
+  vec.ptr = values;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    if (timestep == 2)
+    {
+      ierr = adj_set_memory_budget(&adjointer, 3 * vector_bytes);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+      adj_test_assert(adjointer.memory_used == 2 * vector_bytes, "Should have charged the values already recorded");
+    }
+
+    for (i = 0; i < VECTOR_SIZE; i++)
+      values[i] = (adj_scalar) (10 * timestep + i);
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u[0], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adjointer.memory_used <= 3 * vector_bytes, "Should have kept to the budget");
+  }
+
+  /* The adjoint run needs the latest values first, so the oldest went to disk */
+  adj_test_assert(nwrites == NSTEPS - 3, "Should have spilled the values that don't fit");
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    if (timestep < NSTEPS - 3)
+      adj_test_assert(adj_has_variable_value_memory(&adjointer, u[0]) != ADJ_OK && adj_has_variable_value_disk(&adjointer, u[0]) == ADJ_OK,
+                      "The oldest values should be on disk only");
+    else
+      adj_test_assert(adj_has_variable_value_memory(&adjointer, u[0]) == ADJ_OK && adj_has_variable_value_disk(&adjointer, u[0]) != ADJ_OK,
+                      "The latest values should be in memory only");
+  }
+
+  /* Spilled values come back unchanged */
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+  ierr = adj_get_variable_value(&adjointer, u[0], &vec);
+  adj_test_assert(ierr == ADJ_OK && nreads == 1, "Should have read the value back from disk");
+  adj_test_assert(((adj_scalar*) vec.ptr)[0] == 10.0 && ((adj_scalar*) vec.ptr)[3] == 13.0, "Should have got the recorded value back");
+  adj_test_assert(adjointer.memory_used == 4 * vector_bytes, "The value read back is charged too");
+
+  /* Forgetting releases the charge */
+  ierr = adj_forget_forward_equation(&adjointer, NSTEPS - 1);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.memory_used == 0, "Nothing should be charged any more");
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+
+  /* Values read back during the adjoint run are brought back under the budget by the forget calls.
+     u_n = f(u_{n-1}), so u_n is needed by adjoint equation n, and can only be kept one at a time. */
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, VECTOR_SIZE);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) array_vec_write);
+  adj_register_data_callback(&adjointer, ADJ_VEC_READ_CB, (void (*)(void)) array_vec_read);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) array_vec_delete);
+  ierr = adj_set_memory_budget(&adjointer, vector_bytes);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &B[1]);
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    u[0] = u[1];
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    adj_create_equation(u[1], 1, &B[1], &u[1], &eqn);
+    if (timestep > 0)
+      adj_equation_set_rhs_dependencies(&eqn, 1, &u[0], NULL);
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+
+    for (i = 0; i < VECTOR_SIZE; i++)
+      values[i] = (adj_scalar) (10 * timestep + i);
+    vec.ptr = values;
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u[1], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adjointer.memory_used <= vector_bytes, "Should have kept to the budget");
+  }
+
+  /* Each adjoint equation reads its own value and the next two back: the vectors it was handed stay
+     valid until the forget call, which spills the one needed furthest down the run */
+  for (timestep = NSTEPS - 2; timestep >= 2; timestep--)
+  {
+    adj_vector read[3];
+    for (i = 0; i < 3; i++)
+    {
+      adj_create_variable("Velocity", timestep - i, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+      ierr = adj_get_variable_value(&adjointer, u[0], &read[i]);
+      adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    }
+    for (i = 0; i < 3; i++)
+      adj_test_assert(((adj_scalar*) read[i].ptr)[1] == (adj_scalar) (10 * (timestep - i) + 1), "Should have got the recorded value back");
+
+    ierr = adj_forget_adjoint_equation(&adjointer, timestep);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_assert(adjointer.memory_used <= vector_bytes, "Should be back within the budget");
+    adj_create_variable("Velocity", timestep - 1, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_test_assert(adj_has_variable_value_memory(&adjointer, u[0]) == ADJ_OK, "The value needed next should have stayed in memory");
+    adj_create_variable("Velocity", timestep - 2, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_test_assert(adj_has_variable_value_memory(&adjointer, u[0]) != ADJ_OK && adj_has_variable_value_disk(&adjointer, u[0]) == ADJ_OK,
+                    "The value needed later should have gone back to disk");
+  }
+
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
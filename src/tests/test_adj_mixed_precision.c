@@ -0,0 +1,146 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+#include <math.h>
+
+/* u0 = 1/3 and u_t = C u_{t-1}, with J = sum_t u_t^2 / 2.
+   The adjoint of every timestep needs the forward value of that timestep, so the gradient
+   dJ/du0 = lambda0 sees whatever precision the forward values were kept in. */
+#define NSTEPS 10
+#define C 1.1
+
+static void scalar_solve_multi(int nrhs, adj_variable* vars, adj_matrix mat, adj_vector* rhs, adj_vector* solns)
+{
+  int i;
+  (void) vars;
+  for (i = 0; i < nrhs; i++)
+  {
+    solns[i].ptr = malloc(sizeof(adj_scalar));
+    *(adj_scalar*) solns[i].ptr = *(adj_scalar*) rhs[i].ptr / *(adj_scalar*) mat.ptr;
+  }
+}
+
+/* dJ/du_t = u_t */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) derivative; (void) ndepends; (void) variables; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = *(adj_scalar*) dependencies[0].ptr;
+}
+
+static adj_scalar gradient(int precision, size_t* compressed_bytes)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda;
+  adj_block B[2];
+  adj_equation eqn;
+  adj_vector vec, soln;
+  adj_storage_data storage;
+  adj_scalar value, lambda0, compress_time, decompress_time;
+  size_t raw_bytes;
+  int ierr, cs, timestep;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+  adj_register_data_callback(&adjointer, ADJ_VEC_SET_VALUES_CB, (void (*)(void)) adj_test_vec_set_values);
+  adj_register_data_callback(&adjointer, ADJ_SOLVE_MULTI_CB, (void (*)(void)) scalar_solve_multi);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "MassMatrix", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_CB, "CouplingOperator", (void (*)(void)) adj_test_scalar_block_action);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+
+  adj_create_block("CouplingOperator", NULL, NULL, -C, &B[0]);
+  adj_create_block("MassMatrix", NULL, NULL, 1.0, &B[1]);
+  vec.ptr = &value;
+  vec.klass = 0;
+  value = 1.0 / 3.0;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    if (timestep == 0)
+      adj_create_equation(u[1], 1, &B[1], &u[1], &eqn);
+    else
+    {
+      adj_create_variable("Velocity", timestep - 1, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+      adj_create_equation(u[1], 2, B, u, &eqn);
+      value *= C;
+    }
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+    adj_timestep_set_functional_dependencies(&adjointer, timestep, "J", 1, &u[1]);
+
+    adj_storage_memory_copy(vec, &storage);
+    ierr = adj_storage_set_precision(&storage, precision);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    ierr = adj_record_variable(&adjointer, u[1], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  lambda0 = 0.0;
+  for (timestep = NSTEPS - 1; timestep >= 0; timestep--)
+  {
+    ierr = adj_get_adjoint_solution(&adjointer, timestep, "J", &soln, &lambda);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    lambda0 = *(adj_scalar*) soln.ptr;
+    adj_storage_memory_copy(soln, &storage);
+    ierr = adj_record_variable(&adjointer, lambda, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    adj_test_vec_destroy(&soln);
+    ierr = adj_forget_adjoint_equation(&adjointer, timestep);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  ierr = adj_get_compression_stats(&adjointer, &raw_bytes, compressed_bytes, &compress_time, &decompress_time);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(raw_bytes == ((precision == ADJ_PRECISION_DOUBLE) ? 0 : NSTEPS * sizeof(adj_scalar)), "Only the forward values should have been narrowed");
+
+  adj_destroy_adjointer(&adjointer);
+  return lambda0;
+}
+
+void test_adj_mixed_precision(void)
+{
+  adj_adjointer adjointer;
+  adj_storage_data storage;
+  adj_variable u;
+  adj_vector vec;
+  adj_scalar value, exact, full, single, bfloat16;
+  size_t bytes;
+  int ierr, timestep;
+
+  value = 1.0;
+  vec.ptr = &value;
+  vec.klass = 0;
+  adj_storage_memory_copy(vec, &storage);
+  ierr = adj_storage_set_precision(&storage, 3);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "There is no such precision");
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u);
+  adj_storage_memory_incref(vec, &storage);
+  adj_storage_set_precision(&storage, ADJ_PRECISION_SINGLE);
+  ierr = adj_record_variable(&adjointer, u, storage);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "Values that aren't copied can't be narrowed");
+  adj_destroy_adjointer(&adjointer);
+
+  /* lambda0 = sum_t C^t u_t = sum_t C^(2t) / 3 */
+  exact = 0.0;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+    exact += pow(C, 2 * timestep) / 3.0;
+
+  full = gradient(ADJ_PRECISION_DOUBLE, &bytes);
+  adj_test_assert(fabs(full - exact) < 1.0e-12 * exact, "The full precision gradient should be exact");
+  adj_test_assert(bytes == 0, "Nothing should have been narrowed");
+
+  single = gradient(ADJ_PRECISION_SINGLE, &bytes);
+  adj_test_assert(bytes == NSTEPS * sizeof(float), "Single precision values should take four bytes each");
+  adj_test_assert(fabs(single - full) < 1.0e-6 * full, "The single precision gradient should be within the float epsilon");
+
+  bfloat16 = gradient(ADJ_PRECISION_BFLOAT16, &bytes);
+  adj_test_assert(bytes == NSTEPS * 2, "bfloat16 values should take two bytes each");
+  adj_test_assert(fabs(bfloat16 - full) > 0.0 && fabs(bfloat16 - full) < 1.0e-2 * full, "The bfloat16 gradient should be within the bfloat16 epsilon");
+}
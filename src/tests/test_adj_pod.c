@@ -0,0 +1,146 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+#include <math.h>
+
+#define N 64
+#define NSTEPS 20
+
+/* A travelling wave: every state is a combination of sin(x) and cos(x) */
+static adj_scalar wave(int timestep, int i)
+{
+  return sin(2.0 * M_PI * i / N + 0.1 * timestep);
+}
+
+/* A slow mode of the same wave, which only the first state of the second run has a little of */
+static adj_scalar ripple(int timestep, int i)
+{
+  if (timestep == 0)
+    return sin(2.0 * M_PI * i / N) + 0.3 * sin(4.0 * M_PI * i / N);
+  return 10.0 * wave(timestep, i);
+}
+
+void test_adj_pod(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_variable_data* data;
+  adj_scalar values[N];
+  adj_vector vec, out;
+  adj_storage_data storage;
+  adj_scalar error;
+  size_t pod_bytes, full_bytes;
+  int ierr, timestep, i, nbasis;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DOT_PRODUCT_CB, (void (*)(void)) adj_test_vec_dot_product);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_test_register_null_disk_callbacks(&adjointer);
+
+  ierr = adj_set_pod_options(&adjointer, 0, 0.9999);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A window needs at least one recording");
+  ierr = adj_set_pod_options(&adjointer, 10, 1.5);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "The energy threshold can't be more than one");
+  ierr = adj_set_pod_options(&adjointer, NSTEPS / 2, 1.0 - 1.0e-12);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  /* Big enough never to spill, just to see what the decomposition is charged */
+  ierr = adj_set_memory_budget(&adjointer, 1 << 30);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  vec.ptr = values;
+  vec.klass = 0;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    for (i = 0; i < N; i++)
+      values[i] = wave(timestep, i);
+    adj_storage_memory_pod(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* Two windows, of two modes each */
+  ierr = adj_get_pod_stats(&adjointer, &nbasis, &pod_bytes, &full_bytes);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nbasis == 4, "Each window should need only the two modes of the wave");
+  adj_test_assert(full_bytes == NSTEPS * N * sizeof(adj_scalar), "Should have counted what the values would take");
+  adj_test_assert(pod_bytes < full_bytes / 2, "The decomposition should take much less than the values");
+  adj_test_assert(adjointer.memory_used == pod_bytes, "The basis and the coefficients should be charged");
+
+  error = 0.0;
+  for (timestep = NSTEPS - 1; timestep >= 0; timestep--)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    ierr = adj_get_variable_value(&adjointer, u, &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    for (i = 0; i < N; i++)
+      error = fmax(error, fabs(((adj_scalar*) out.ptr)[i] - wave(timestep, i)));
+  }
+  adj_test_assert(error < 1.0e-6, "Should have reconstructed the recorded states");
+  adj_test_assert(adjointer.memory_used == pod_bytes + full_bytes, "The reconstructions should be charged too");
+
+  /* A window goes once none of its values are held */
+  for (timestep = 0; timestep < NSTEPS / 2; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    ierr = adj_find_variable_data(&(adjointer.varhash), &u, &data);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    ierr = adj_forget_variable_value_from_memory(&adjointer, data);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  ierr = adj_get_pod_stats(&adjointer, &nbasis, &pod_bytes, &full_bytes);
+  adj_test_assert(ierr == ADJ_OK && nbasis == 2, "The first window's basis should have been freed");
+  adj_test_assert(adjointer.memory_used == pod_bytes + full_bytes, "Forgetting should release the whole charge");
+
+  adj_destroy_adjointer(&adjointer);
+
+  /* The first state brings in a direction that has next to none of the energy of the window:
+     building the basis state by state keeps it, ranking the modes once the window is full drops it */
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DOT_PRODUCT_CB, (void (*)(void)) adj_test_vec_dot_product);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_test_register_null_disk_callbacks(&adjointer);
+  ierr = adj_set_pod_options(&adjointer, NSTEPS / 2, 0.999);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  ierr = adj_set_memory_budget(&adjointer, 1 << 30);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  for (timestep = 0; timestep < NSTEPS / 2; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    for (i = 0; i < N; i++)
+      values[i] = ripple(timestep, i);
+    adj_storage_memory_pod(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+    ierr = adj_get_pod_stats(&adjointer, &nbasis, &pod_bytes, &full_bytes);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    if (timestep == NSTEPS / 2 - 2)
+      adj_test_assert(nbasis == 3, "Until the window is full, the basis should keep every direction it was given");
+  }
+  adj_test_assert(nbasis == 2, "The full window should keep only the two modes with the energy");
+  adj_test_assert(adjointer.memory_used == pod_bytes, "The truncated basis and coefficients should be charged");
+
+  for (timestep = 0; timestep < NSTEPS / 2; timestep++)
+  {
+    adj_scalar norm = 0.0;
+    error = 0.0;
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    ierr = adj_get_variable_value(&adjointer, u, &out);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    for (i = 0; i < N; i++)
+    {
+      error += pow(((adj_scalar*) out.ptr)[i] - ripple(timestep, i), 2);
+      norm += pow(ripple(timestep, i), 2);
+    }
+    if (timestep == 0)
+      adj_test_assert(sqrt(error / norm) < 0.3, "The state with the dropped mode should lose no more than it");
+    else
+      adj_test_assert(sqrt(error / norm) < sqrt(2.0 * (1.0 - 0.999)), "The other states should be reconstructed to within the threshold");
+  }
+
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,141 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_core.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#ifndef HAVE_PTHREADS
+void test_adj_prefetch(void)
+{
+  adj_test_assert(1 == 1, "Don't have pthreads so can't run this test.");
+}
+#else
+#include <pthread.h>
+
+/* The "disk" is one slot per timestep */
+#define NSTEPS 6
+static adj_scalar disk[NSTEPS];
+static pthread_t main_thread;
+static int nmain_reads = 0;
+static int nworker_reads = 0;
+static int nwrong_dependencies = 0;
+
+static void scalar_vec_write(adj_variable var, adj_vector x)
+{
+  disk[var.timestep] = *(adj_scalar*) x.ptr;
+}
+
+static void scalar_vec_read(adj_variable var, adj_vector* x)
+{
+  if (pthread_equal(pthread_self(), main_thread))
+    nmain_reads++;
+  else
+    nworker_reads++;
+  x->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) x->ptr = disk[var.timestep];
+}
+
+static void scalar_vec_delete(adj_variable var)
+{
+  disk[var.timestep] = (adj_scalar) -1.0;
+}
+
+/* The source of equation n is R(u_{n-1}) = u_{n-1}^2; its derivative needs the value of u_{n-1} */
+static void rhs_derivative_action_accumulate(adj_adjointer* adjointer, adj_variable variable, int ndepends, adj_variable* variables, adj_vector* dependencies,
+                                             adj_variable d_variable, adj_vector contraction, int hermitian, adj_scalar alpha, void* context, adj_vector* output)
+{
+  adj_scalar u = *(adj_scalar*) dependencies[0].ptr;
+  (void) adjointer; (void) variable; (void) ndepends; (void) d_variable; (void) hermitian; (void) context;
+  if (u != (adj_scalar) (variables[0].timestep + 1)) nwrong_dependencies++;
+  *(adj_scalar*) output->ptr += alpha * 2.0 * u * *(adj_scalar*) contraction.ptr;
+}
+
+/* J = u_{NSTEPS-1} */
+static void functional_derivative(adj_adjointer* adjointer, adj_variable derivative, int ndepends, adj_variable* variables, adj_vector* dependencies, char* name, adj_vector* output)
+{
+  (void) adjointer; (void) ndepends; (void) variables; (void) dependencies; (void) name;
+  output->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) output->ptr = (derivative.timestep == NSTEPS - 1) ? (adj_scalar) 1.0 : (adj_scalar) 0.0;
+}
+
+void test_adj_prefetch(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[2], lambda;
+  adj_block B[2];
+  adj_equation eqn;
+  adj_matrix lhs;
+  adj_vector rhs;
+  adj_scalar value;
+  adj_vector vec;
+  adj_storage_data storage;
+  int ierr, cs, timestep, equation;
+
+  main_thread = pthread_self();
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) scalar_vec_write);
+  adj_register_data_callback(&adjointer, ADJ_VEC_READ_CB, (void (*)(void)) scalar_vec_read);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) scalar_vec_delete);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ASSEMBLY_CB, "IdentityOperator", (void (*)(void)) adj_test_scalar_block_assembly);
+  adj_register_operator_callback(&adjointer, ADJ_BLOCK_ACTION_ACCUMULATE_CB, "CouplingOperator", (void (*)(void)) adj_test_scalar_block_action_accumulate);
+  adj_register_functional_derivative_callback(&adjointer, "J", functional_derivative);
+
+  ierr = adj_set_prefetch_options(&adjointer, -1, 0);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "A negative window makes no sense");
+  ierr = adj_set_prefetch_options(&adjointer, 2, 0);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* u0 = 1, and u_n - u_{n-1} = u_{n-1}^2, with every value recorded to disk */
+  adj_create_block("CouplingOperator", NULL, NULL, -1.0, &B[0]);
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &B[1]);
+  vec.ptr = &value;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    u[0] = u[1];
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[1]);
+    if (timestep == 0)
+      adj_create_equation(u[1], 1, &B[1], &u[1], &eqn);
+    else
+    {
+      adj_create_equation(u[1], 2, B, u, &eqn);
+      adj_equation_set_rhs_dependencies(&eqn, 1, &u[0], NULL);
+      adj_equation_set_rhs_derivative_action_accumulate_callback(&eqn, rhs_derivative_action_accumulate);
+    }
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+
+    value = (adj_scalar) (timestep + 1);
+    adj_storage_disk(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u[1], storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  adj_timestep_set_functional_dependencies(&adjointer, NSTEPS - 1, "J", 1, &u[1]);
+  adj_set_finished(&adjointer, ADJ_TRUE);
+
+  for (equation = NSTEPS - 1; equation >= 0; equation--)
+  {
+    ierr = adj_get_adjoint_equation(&adjointer, equation, "J", &lhs, &rhs, &lambda);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+    value = *(adj_scalar*) rhs.ptr / *(adj_scalar*) lhs.ptr;
+    adj_storage_memory_copy(vec, &storage);
+    adj_record_variable(&adjointer, lambda, storage);
+    adj_test_mat_destroy(&lhs);
+    adj_test_vec_destroy(&rhs);
+
+    ierr = adj_forget_adjoint_equation(&adjointer, equation);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* Only the value the first adjoint equation needs was read on the spot */
+  adj_test_assert(nwrong_dependencies == 0, "The prefetched values should be the recorded ones");
+  adj_test_assert(nmain_reads == 1, "Only the last velocity should have been read on demand");
+  adj_test_assert(nworker_reads == NSTEPS - 1, "All the other velocities should have been prefetched");
+
+  /* lambda_n = (1 + 2 u_n) lambda_{n+1}, starting from lambda_5 = 1 */
+  adj_test_assert(value == 3.0 * 5.0 * 7.0 * 9.0 * 11.0, "Should have got the right adjoint solution");
+
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
+#endif
@@ -0,0 +1,78 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_data_structures.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* Each registered equation carries several ADJ_NAME_LEN buffers, so a 100000-timestep tape
+   needs several GB of memory; build with -DSHARED_DEPENDENCY_NSTEPS=100000 to benchmark that,
+   which also prints how long the registration took. */
+#ifdef SHARED_DEPENDENCY_NSTEPS
+#define SHARED_DEPENDENCY_BENCHMARK
+#include <time.h>
+#else
+#define SHARED_DEPENDENCY_NSTEPS 10000
+#endif
+
+/* Annotates a long tape where every timestep depends on the same coefficient field, so that
+   the coefficient's dependency lists grow with the length of the run. This used to cost
+   O(n^2) in adj_append_unique; it also serves as a benchmark for registration. */
+void test_adj_register_equation_shared_dependency(void)
+{
+  int ierr, cs, t, i, sorted;
+  int nsteps = SHARED_DEPENDENCY_NSTEPS;
+  adj_adjointer adjointer;
+  adj_variable u[2], coefficient;
+  adj_nonlinear_block V;
+  adj_block B[2];
+  adj_equation equation;
+  adj_variable_data* data_ptr;
+#ifdef SHARED_DEPENDENCY_BENCHMARK
+  clock_t start;
+#endif
+
+  adj_create_adjointer(&adjointer);
+  adj_create_variable("Viscosity", 0, 0, ADJ_AUXILIARY_VARIABLE, &coefficient);
+  adj_create_nonlinear_block("DiffusionOperator", 1, &coefficient, NULL, 1.0, &V);
+  adj_create_block("MassMatrix", NULL, NULL, 1.0, &B[0]);
+  adj_create_block("TimesteppingOperator", &V, NULL, -1.0, &B[1]);
+
+#ifdef SHARED_DEPENDENCY_BENCHMARK
+  start = clock();
+#endif
+
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+  adj_create_equation(u[0], 1, B, u, &equation);
+  ierr = adj_register_equation(&adjointer, equation, &cs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_destroy_equation(&equation);
+
+  for (t = 1; t < nsteps; t++)
+  {
+    /* u[0] is the new value, u[1] the old one */
+    u[1] = u[0];
+    adj_create_variable("Velocity", t, 0, ADJ_NORMAL_VARIABLE, &u[0]);
+    adj_create_equation(u[0], 2, B, u, &equation);
+    ierr = adj_register_equation(&adjointer, equation, &cs);
+    adj_destroy_equation(&equation);
+    if (ierr != ADJ_OK) break;
+  }
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+#ifdef SHARED_DEPENDENCY_BENCHMARK
+  printf("  registered %d timesteps with a shared coefficient in %.2f s\n", nsteps, (double) (clock() - start) / CLOCKS_PER_SEC);
+#endif
+
+  ierr = adj_find_variable_data(&(adjointer.varhash), &coefficient, &data_ptr);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(data_ptr->ndepending_equations == nsteps - 1, "Every equation but the first depends on the coefficient");
+
+  sorted = ADJ_TRUE;
+  for (i = 1; i < data_ptr->ndepending_equations; i++)
+    if (data_ptr->depending_equations[i-1] >= data_ptr->depending_equations[i]) sorted = ADJ_FALSE;
+  adj_test_assert(sorted, "Dependency lists should be strictly increasing");
+
+  adj_destroy_nonlinear_block(&V);
+  adj_destroy_block(&B[0]);
+  adj_destroy_block(&B[1]);
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,81 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#define N 20
+#define NSTEPS 4
+
+static int record(adj_adjointer* adjointer, adj_variable var, adj_scalar* values)
+{
+  adj_vector vec;
+  adj_storage_data storage;
+
+  vec.ptr = values;
+  vec.klass = 0;
+  adj_storage_memory_copy(vec, &storage);
+  return adj_record_variable(adjointer, var, storage);
+}
+
+void test_adj_revolve_verification(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u[NSTEPS];
+  adj_block I;
+  adj_equation eqn;
+  adj_scalar values[N];
+  int ierr, cs, timestep, i, nchecked, nfailed;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_array_callbacks(&adjointer, N);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) adj_test_vec_get_size);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_VALUES_CB, (void (*)(void)) adj_test_vec_get_values);
+
+  ierr = adj_set_revolve_verification(&adjointer, ADJ_TRUE, -1.0);
+  adj_test_assert(ierr == ADJ_ERR_INVALID_INPUTS, "The tolerance can't be negative");
+  ierr = adj_set_revolve_verification(&adjointer, ADJ_TRUE, 1.0e-8);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_create_block("IdentityOperator", NULL, NULL, 1.0, &I);
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u[timestep]);
+    adj_create_equation(u[timestep], 1, &I, &u[timestep], &eqn);
+    adj_register_equation(&adjointer, eqn, &cs);
+    adj_destroy_equation(&eqn);
+
+    for (i = 0; i < N; i++)
+      values[i] = timestep + 0.1 * i;
+    ierr = record(&adjointer, u[timestep], values);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+
+  /* Forgetting still goes ahead */
+  ierr = adj_forget_adjoint_equation(&adjointer, NSTEPS - 1);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(adjointer.nlive_variables == 0, "Nothing should be kept for the verification");
+
+  /* A replay that gives the same values, or values within the tolerance, passes */
+  for (i = 0; i < N; i++)
+    values[i] = 0.1 * i;
+  ierr = record(&adjointer, u[0], values);
+  adj_test_assert(ierr == ADJ_OK, "The same value should pass");
+
+  for (i = 0; i < N; i++)
+    values[i] = 1.0 + 0.1 * i + ((i % 2) ? 1.0e-10 : -1.0e-10);
+  ierr = record(&adjointer, u[1], values);
+  adj_test_assert(ierr == ADJ_OK, "A value within the tolerance should pass");
+
+  /* A replay that swaps two values keeps the norm, but not the block sums */
+  for (i = 0; i < N; i++)
+    values[i] = 2.0 + 0.1 * i;
+  values[0] = 2.0 + 0.1 * (N - 1);
+  values[N - 1] = 2.0;
+  ierr = record(&adjointer, u[2], values);
+  adj_test_assert(ierr == ADJ_WARN_COMPARISON_FAILED, "Swapped values should fail");
+
+  ierr = adj_get_revolve_verification_stats(&adjointer, &nchecked, &nfailed);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nchecked == 3 && nfailed == 1, "Should have checked three values, and failed one");
+
+  adj_destroy_adjointer(&adjointer);
+}
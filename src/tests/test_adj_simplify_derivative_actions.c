@@ -0,0 +1,98 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_simplification.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+void test_adj_simplify_derivative_actions(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u, c[4];
+  adj_nonlinear_block V, W;
+  adj_nonlinear_block_derivative_action actions[5];
+  adj_nonlinear_block_derivative_action* new_actions;
+  adj_nonlinear_block_derivative derivs[100];
+  adj_nonlinear_block_derivative* new_derivs;
+  adj_scalar lambda[3] = {2.0, 7.0, 13.0};
+  adj_scalar contraction[4] = {3.0, 5.0, 11.0, 17.0};
+  adj_vector lambda_vec[3], contraction_vec[4];
+  int ierr, i, nnew;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+
+  adj_create_variable("Velocity", 0, 0, ADJ_NORMAL_VARIABLE, &u);
+  for (i = 0; i < 4; i++)
+  {
+    adj_create_variable("Velocity", i + 1, 0, ADJ_NORMAL_VARIABLE, &c[i]);
+    contraction_vec[i].ptr = &contraction[i];
+  }
+  for (i = 0; i < 3; i++)
+    lambda_vec[i].ptr = &lambda[i];
+
+  adj_create_nonlinear_block("AdvectionOperator", 1, &u, NULL, 1.0, &V);
+  adj_create_nonlinear_block("DiffusionOperator", 1, &u, NULL, 1.0, &W);
+
+  /* Two terms from the same equation: their contractions are summed */
+  adj_create_nonlinear_block_derivative(&adjointer, V, 1.0, u, contraction_vec[0], ADJ_TRUE, ADJ_FALSE, &actions[0].derivative);
+  adj_create_nonlinear_block_derivative(&adjointer, V, 1.0, u, contraction_vec[1], ADJ_TRUE, ADJ_FALSE, &actions[1].derivative);
+  /* Two terms from different equations with the same contraction: their inputs are summed */
+  adj_create_nonlinear_block_derivative(&adjointer, V, 2.0, u, contraction_vec[2], ADJ_TRUE, ADJ_FALSE, &actions[2].derivative);
+  adj_create_nonlinear_block_derivative(&adjointer, V, 0.5, u, contraction_vec[2], ADJ_TRUE, ADJ_FALSE, &actions[3].derivative);
+  /* and one that can't be merged with anything, because its operator is different */
+  adj_create_nonlinear_block_derivative(&adjointer, W, 1.0, u, contraction_vec[2], ADJ_TRUE, ADJ_FALSE, &actions[4].derivative);
+
+  adj_variable_key_from_variable(&c[0], ADJ_TRUE, &actions[0].contraction_key);
+  adj_variable_key_from_variable(&c[1], ADJ_TRUE, &actions[1].contraction_key);
+  adj_variable_key_from_variable(&c[2], ADJ_TRUE, &actions[2].contraction_key);
+  adj_variable_key_from_variable(&c[2], ADJ_TRUE, &actions[3].contraction_key);
+  adj_variable_key_from_variable(&c[2], ADJ_TRUE, &actions[4].contraction_key);
+  actions[0].input_id = 0; actions[0].input = lambda_vec[0];
+  actions[1].input_id = 0; actions[1].input = lambda_vec[0];
+  actions[2].input_id = 1; actions[2].input = lambda_vec[1];
+  actions[3].input_id = 2; actions[3].input = lambda_vec[2];
+  actions[4].input_id = 2; actions[4].input = lambda_vec[2];
+  for (i = 0; i < 5; i++)
+    actions[i].owns_input = ADJ_FALSE;
+
+  ierr = adj_simplify_derivative_actions(&adjointer, 5, actions, &nnew, &new_actions);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nnew == 3, "Should have merged five terms into three");
+
+  adj_test_assert(*(adj_scalar*) new_actions[0].derivative.contraction.ptr == 8.0, "Contractions of the same input should be summed");
+  adj_test_assert(new_actions[0].input.ptr == lambda_vec[0].ptr, "Should act on the shared input");
+  adj_test_assert(!new_actions[0].owns_input, "Should not own the shared input");
+
+  adj_test_assert(*(adj_scalar*) new_actions[1].derivative.contraction.ptr == 11.0, "Should keep the shared contraction");
+  adj_test_assert(new_actions[1].derivative.nonlinear_block.coefficient == 1.0, "Coefficients should move into the summed input");
+  adj_test_assert(new_actions[1].owns_input, "Should own the summed input");
+  adj_test_assert(*(adj_scalar*) new_actions[1].input.ptr == 2.0 * 7.0 + 0.5 * 13.0, "Inputs with the same contraction should be summed");
+
+  adj_test_assert(strncmp(new_actions[2].derivative.nonlinear_block.name, "DiffusionOperator", ADJ_NAME_LEN) == 0, "Should keep the other operator on its own");
+  adj_test_assert(new_actions[2].input.ptr == lambda_vec[2].ptr, "Should act on its own input");
+
+  for (i = 0; i < 5; i++)
+    adj_destroy_nonlinear_block_derivative_action(&adjointer, &actions[i]);
+  for (i = 0; i < nnew; i++)
+    adj_destroy_nonlinear_block_derivative_action(&adjointer, &new_actions[i]);
+  free(new_actions);
+
+  /* Many derivatives within one equation, which used to be compared pairwise */
+  for (i = 0; i < 100; i++)
+    adj_create_nonlinear_block_derivative(&adjointer, i % 2 ? V : W, 1.0, u, contraction_vec[i % 4], ADJ_TRUE, ADJ_FALSE, &derivs[i]);
+
+  ierr = adj_simplify_derivatives(&adjointer, 100, derivs, &nnew, &new_derivs);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nnew == 2, "Should have merged into one derivative per operator");
+  adj_test_assert(*(adj_scalar*) new_derivs[0].contraction.ptr == 25.0 * (3.0 + 11.0), "Should have summed the contractions of the first operator");
+  adj_test_assert(*(adj_scalar*) new_derivs[1].contraction.ptr == 25.0 * (5.0 + 17.0), "Should have summed the contractions of the second operator");
+
+  for (i = 0; i < 100; i++)
+    adj_destroy_nonlinear_block_derivative(&adjointer, &derivs[i]);
+  for (i = 0; i < nnew; i++)
+    adj_destroy_nonlinear_block_derivative(&adjointer, &new_derivs[i]);
+  free(new_derivs);
+
+  adj_destroy_nonlinear_block(&V);
+  adj_destroy_nonlinear_block(&W);
+  adj_destroy_adjointer(&adjointer);
+}
@@ -0,0 +1,90 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+/* Vectors here are arrays of adj_scalar, with their length in the flags */
+static int nduplicates = 0;
+static int ndestroys = 0;
+
+static void array_vec_duplicate(adj_vector x, adj_vector* newx)
+{
+  nduplicates++;
+  newx->ptr = calloc(x.flags, sizeof(adj_scalar));
+  newx->klass = x.klass;
+  newx->flags = x.flags;
+}
+
+static void array_vec_destroy(adj_vector* x)
+{
+  ndestroys++;
+  free(x->ptr);
+}
+
+static void array_vec_get_size(adj_vector x, int* sz)
+{
+  *sz = x.flags;
+}
+
+static void array_vec_zero(adj_vector* x)
+{
+  int i;
+  for (i = 0; i < x->flags; i++)
+    ((adj_scalar*) x->ptr)[i] = (adj_scalar) 0.0;
+}
+
+void test_adj_vec_pool(void)
+{
+  adj_adjointer adjointer;
+  adj_vector model2, model3, x, y, z;
+  adj_vector many[ADJ_VEC_POOL_SIZE + 1];
+  adj_scalar values2[2] = {1.0, 2.0};
+  adj_scalar values3[3] = {1.0, 2.0, 3.0};
+  int ierr, i;
+
+  model2.ptr = values2; model2.klass = 0; model2.flags = 2;
+  model3.ptr = values3; model3.klass = 0; model3.flags = 3;
+
+  adj_create_adjointer(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DUPLICATE_CB, (void (*)(void)) array_vec_duplicate);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DESTROY_CB, (void (*)(void)) array_vec_destroy);
+  adj_register_data_callback(&adjointer, ADJ_VEC_GET_SIZE_CB, (void (*)(void)) array_vec_get_size);
+
+  /* Without a way to zero vectors, nothing is kept */
+  ierr = adj_vec_pool_get(&adjointer, model2, &x);
+  adj_test_assert(ierr == ADJ_OK && nduplicates == 1, "Should have duplicated the model");
+  ierr = adj_vec_pool_put(&adjointer, &x);
+  adj_test_assert(ierr == ADJ_OK && ndestroys == 1 && adjointer.vec_pool == NULL, "Should have destroyed the vector straight away");
+
+  ierr = adj_register_data_callback(&adjointer, ADJ_VEC_ZERO_CB, (void (*)(void)) array_vec_zero);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  adj_vec_pool_get(&adjointer, model2, &x);
+  adj_vec_pool_get(&adjointer, model3, &y);
+  ((adj_scalar*) x.ptr)[1] = 5.0;
+  adj_vec_pool_put(&adjointer, &x);
+  adj_vec_pool_put(&adjointer, &y);
+  adj_test_assert(ndestroys == 1 && adjointer.vec_pool->nvectors == 2, "Should have kept both vectors");
+
+  /* The vector handed out must have the layout of the model, and be zero */
+  ierr = adj_vec_pool_get(&adjointer, model2, &z);
+  adj_test_assert(ierr == ADJ_OK && nduplicates == 3, "Should not have duplicated anything");
+  adj_test_assert(z.ptr == x.ptr && z.flags == 2, "Should have reused the vector of the same size");
+  adj_test_assert(((adj_scalar*) z.ptr)[0] == 0.0 && ((adj_scalar*) z.ptr)[1] == 0.0, "A reused vector should be zeroed");
+  adj_vec_pool_put(&adjointer, &z);
+
+  model3.klass = 1;
+  adj_vec_pool_get(&adjointer, model3, &z);
+  adj_test_assert(nduplicates == 4 && z.ptr != y.ptr, "Vectors of another klass should not be reused");
+  adj_vec_pool_put(&adjointer, &z);
+
+  /* The pool has a fixed size; past that, vectors are really destroyed */
+  for (i = 0; i < ADJ_VEC_POOL_SIZE + 1; i++)
+    adj_vec_pool_get(&adjointer, model2, &many[i]);
+  for (i = 0; i < ADJ_VEC_POOL_SIZE + 1; i++)
+    adj_vec_pool_put(&adjointer, &many[i]);
+  adj_test_assert(adjointer.vec_pool->nvectors == ADJ_VEC_POOL_SIZE, "The pool should be full");
+  adj_test_assert(ndestroys == 4, "The vectors that don't fit should be destroyed");
+
+  adj_destroy_adjointer(&adjointer);
+  adj_test_assert(ndestroys == nduplicates, "Destroying the adjointer should free the pool");
+}
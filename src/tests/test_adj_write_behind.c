@@ -0,0 +1,100 @@
+#include "libadjoint/adj_adjointer_routines.h"
+#include "libadjoint/adj_test_tools.h"
+#include "libadjoint/adj_test_main.h"
+
+#ifndef HAVE_PTHREADS
+void test_adj_write_behind(void)
+{
+  adj_test_assert(1 == 1, "Don't have pthreads so can't run this test.");
+}
+#else
+#include <pthread.h>
+
+/* The "disk" is one slot per timestep, and writes to it block until the test opens the gate */
+#define NSTEPS 3
+static adj_scalar disk[NSTEPS];
+static int nwrites = 0;
+static int nreads = 0;
+static int gate_open = 0;
+static pthread_mutex_t gate_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_cond = PTHREAD_COND_INITIALIZER;
+
+static void scalar_vec_write(adj_variable var, adj_vector x)
+{
+  pthread_mutex_lock(&gate_lock);
+  while (!gate_open)
+    pthread_cond_wait(&gate_cond, &gate_lock);
+  disk[var.timestep] = *(adj_scalar*) x.ptr;
+  nwrites++;
+  pthread_mutex_unlock(&gate_lock);
+}
+
+static void scalar_vec_read(adj_variable var, adj_vector* x)
+{
+  nreads++;
+  x->ptr = malloc(sizeof(adj_scalar));
+  *(adj_scalar*) x->ptr = disk[var.timestep];
+}
+
+static void scalar_vec_delete(adj_variable var)
+{
+  disk[var.timestep] = (adj_scalar) -1.0;
+}
+
+void test_adj_write_behind(void)
+{
+  adj_adjointer adjointer;
+  adj_variable u;
+  adj_scalar value;
+  adj_vector vec, out;
+  adj_storage_data storage;
+  int ierr, timestep;
+
+  adj_create_adjointer(&adjointer);
+  adj_test_register_scalar_callbacks(&adjointer);
+  adj_register_data_callback(&adjointer, ADJ_VEC_READ_CB, (void (*)(void)) scalar_vec_read);
+  adj_register_data_callback(&adjointer, ADJ_VEC_DELETE_CB, (void (*)(void)) scalar_vec_delete);
+
+  ierr = adj_set_write_behind_options(&adjointer, 4);
+  adj_test_assert(ierr == ADJ_ERR_NEED_CALLBACK, "Write-behind needs ADJ_VEC_WRITE_CB");
+  adj_register_data_callback(&adjointer, ADJ_VEC_WRITE_CB, (void (*)(void)) scalar_vec_write);
+  ierr = adj_set_write_behind_options(&adjointer, 4);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+
+  /* With the gate shut no write can finish, so recording must not wait for them */
+  vec.ptr = &value;
+  for (timestep = 0; timestep < NSTEPS; timestep++)
+  {
+    adj_create_variable("Velocity", timestep, 0, ADJ_NORMAL_VARIABLE, &u);
+    value = (adj_scalar) (timestep + 1);
+    adj_storage_disk(vec, &storage);
+    ierr = adj_record_variable(&adjointer, u, storage);
+    adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  }
+  value = (adj_scalar) 0.0; /* the queue must have its own copies */
+  adj_test_assert(nwrites == 0, "Nothing should have been written yet");
+
+  /* A value still on the queue is served from it */
+  adj_create_variable("Velocity", 1, 0, ADJ_NORMAL_VARIABLE, &u);
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nreads == 0 && *(adj_scalar*) out.ptr == 2.0, "Should have got the queued value without reading");
+
+  pthread_mutex_lock(&gate_lock);
+  gate_open = 1;
+  pthread_cond_broadcast(&gate_cond);
+  pthread_mutex_unlock(&gate_lock);
+
+  ierr = adj_flush_disk_writes(&adjointer);
+  adj_test_assert(ierr == ADJ_OK, "Should have worked");
+  adj_test_assert(nwrites == NSTEPS, "Flushing should have written everything");
+  adj_test_assert(disk[0] == 1.0 && disk[1] == 2.0 && disk[2] == 3.0, "Should have written the recorded values");
+
+  /* Once written, values come from disk as usual */
+  adj_create_variable("Velocity", 2, 0, ADJ_NORMAL_VARIABLE, &u);
+  ierr = adj_get_variable_value(&adjointer, u, &out);
+  adj_test_assert(ierr == ADJ_OK && nreads == 1 && *(adj_scalar*) out.ptr == 3.0, "Should have read the value from disk");
+
+  adj_destroy_adjointer(&adjointer);
+}
+#endif